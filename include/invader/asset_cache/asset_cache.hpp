@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef INVADER__ASSET_CACHE__ASSET_CACHE_HPP
+#define INVADER__ASSET_CACHE__ASSET_CACHE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace Invader {
+    /**
+     * Content-addressed cache for generated asset data (such as processed bitmap data), so tools can skip work when their inputs have not changed
+     */
+    class AssetCache {
+    public:
+        /**
+         * Key for a cache entry, built by hashing every input that affects the output
+         */
+        class Key {
+        public:
+            /**
+             * Hash the data into the key
+             * @param data pointer to the data
+             * @param size size of the data
+             * @return     this key
+             */
+            Key &add(const void *data, std::size_t size) noexcept;
+
+            /**
+             * Hash the bytes of the data into the key
+             * @param data data to hash
+             * @return     this key
+             */
+            Key &add(const std::vector<std::byte> &data) noexcept {
+                this->add_value(data.size());
+                return this->add(data.data(), data.size());
+            }
+
+            /**
+             * Hash the string into the key
+             * @param string string to hash
+             * @return       this key
+             */
+            Key &add(const std::string &string) noexcept {
+                this->add_value(string.size());
+                return this->add(string.data(), string.size());
+            }
+
+            /**
+             * Hash the value into the key
+             * @param value value to hash
+             * @return      this key
+             */
+            template <typename T> Key &add_value(const T &value) noexcept {
+                static_assert(std::is_trivially_copyable_v<T>);
+                return this->add(&value, sizeof(value));
+            }
+
+            /**
+             * Hash the optional value into the key, distinguishing between no value and any value
+             * @param value value to hash
+             * @return      this key
+             */
+            template <typename T> Key &add_value(const std::optional<T> &value) noexcept {
+                this->add_value(value.has_value());
+                if(value.has_value()) {
+                    this->add_value(*value);
+                }
+                return *this;
+            }
+
+            /**
+             * Get the key as a hexadecimal string, used as the name of the cache entry
+             * @return key as a string
+             */
+            std::string to_string() const;
+
+            /**
+             * Initialize a key, salted with Invader's version so cache entries from other versions are never used
+             * @param kind name of the kind of data being cached
+             */
+            Key(const char *kind);
+
+        private:
+            std::uint64_t lanes[2];
+            std::uint64_t pending = 0;
+            std::size_t pending_bytes = 0;
+            std::uint64_t total_bytes = 0;
+
+            void add_word(std::uint64_t word) noexcept;
+        };
+
+        /**
+         * Look up a cache entry
+         * @param key key to look up
+         * @return    cached data if it exists and is intact, or std::nullopt if not
+         */
+        std::optional<std::vector<std::byte>> load(const Key &key) const;
+
+        /**
+         * Store a cache entry. This is written to a temporary file and then moved into place so other processes never see partial entries.
+         * @param key  key to store
+         * @param data data to store
+         * @return     true on success; false on failure
+         */
+        bool store(const Key &key, const std::vector<std::byte> &data) const;
+
+        /**
+         * Get the directory of the cache
+         * @return directory
+         */
+        const std::filesystem::path &get_directory() const noexcept {
+            return this->directory;
+        }
+
+        /**
+         * Initialize a cache
+         * @param directory directory to hold the cache (created if it does not exist)
+         */
+        AssetCache(const std::filesystem::path &directory);
+
+    private:
+        std::filesystem::path directory;
+
+        std::filesystem::path path_for_key(const Key &key) const;
+    };
+}
+
+#endif
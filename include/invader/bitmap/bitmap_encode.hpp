@@ -96,6 +96,22 @@ namespace Invader::BitmapEncode {
      * @param mipmap_count number of mipmaps (by default, just check the base bitmap)
      */
     HEK::BitmapDataFormat most_efficient_format(const std::byte *input_data, std::size_t width, std::size_t height, std::size_t depth, HEK::BitmapFormat category, HEK::BitmapDataType type, std::size_t mipmap_count = 0) noexcept;
+
+    /**
+     * Find the most efficient format without any loss in data and encode the bitmap to it. This only goes through the
+     * pixels once for monochrome bitmaps. The input bitmap MUST be in 32-bit BGRA (A8R8G8B8) format.
+     * @param input_data    pixel data
+     * @param category      category of formats to use
+     * @param output_format set to the format that was chosen
+     * @param width         width of the bitmap in pixels
+     * @param height        height of the bitmap in pixels
+     * @param depth         depth of the bitmap (must be 1 for 2D textures)
+     * @param type          type of bitmap
+     * @param mipmap_count  number of mipmaps
+     * @param dither        dither
+     * @return              encoded data
+     */
+    std::vector<std::byte> encode_bitmap_most_efficient(const std::byte *input_data, HEK::BitmapFormat category, HEK::BitmapDataFormat &output_format, std::size_t width, std::size_t height, std::size_t depth, HEK::BitmapDataType type, std::size_t mipmap_count, bool dither = false);
 }
 
 #endif
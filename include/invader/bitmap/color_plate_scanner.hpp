@@ -129,7 +129,8 @@ namespace Invader {
         bool is_ignored(const Pixel &color) const;
 
         /**
-         * Read the color plate data bitmap data
+         * Read the color plate data bitmap data. Each sequence is scanned in one pass, row by row, and then bitmaps are copied out of the
+         * color plate (in parallel for large color plates).
          * @param generated_bitmap bitmap data to write to (output)
          * @param pixels           pixel input
          * @param width            width of input
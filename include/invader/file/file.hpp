@@ -68,6 +68,13 @@ namespace Invader::File {
      */
     std::optional<std::vector<std::byte>> open_file(const std::filesystem::path &path);
 
+    /**
+     * Attempt to open a text file with one entry per line, skipping blank lines
+     * @param path path to the file
+     * @return     each line or std::nullopt if failed
+     */
+    std::optional<std::vector<std::string>> open_list_file(const std::filesystem::path &path);
+
     /**
      * Attempt to save the file
      * @param  path path to the file
@@ -76,6 +83,66 @@ namespace Invader::File {
      */
     bool save_file(const std::filesystem::path &path, const std::vector<std::byte> &data);
 
+    /**
+     * Attempt to save the file by writing it next to the path and then renaming it over the path, so the file is never
+     * left partially written
+     * @param  path path to the file
+     * @param  data data to write
+     * @return      true on success; false on failure
+     */
+    bool save_file_atomically(const std::filesystem::path &path, const std::vector<std::byte> &data);
+
+    /**
+     * A file mapped into memory. The mapping is private and copy-on-write, so its data can be modified without changing
+     * the file.
+     */
+    class MemoryMappedFile {
+    public:
+        /**
+         * Attempt to map the file into memory
+         * @param path path to the file
+         * @return     the mapped file or std::nullopt if failed
+         */
+        static std::optional<MemoryMappedFile> map_file(const std::filesystem::path &path);
+
+        /**
+         * Get the file data
+         * @return file data
+         */
+        std::byte *data() noexcept {
+            return this->mapping;
+        }
+
+        /**
+         * Get the file data
+         * @return file data
+         */
+        const std::byte *data() const noexcept {
+            return this->mapping;
+        }
+
+        /**
+         * Get the size of the file
+         * @return size in bytes
+         */
+        std::size_t size() const noexcept {
+            return this->mapping_size;
+        }
+
+        MemoryMappedFile(MemoryMappedFile &&move) noexcept;
+        MemoryMappedFile &operator=(MemoryMappedFile &&move) noexcept;
+        MemoryMappedFile(const MemoryMappedFile &) = delete;
+        MemoryMappedFile &operator=(const MemoryMappedFile &) = delete;
+        ~MemoryMappedFile();
+
+    private:
+        MemoryMappedFile() = default;
+        void unmap() noexcept;
+
+        std::byte *mapping = nullptr;
+        std::size_t mapping_size = 0;
+    };
+
     /**
      * Convert a tag path to a file path for one tags directory. The file must exist, or std::nullopt will be returned.
      * @param  tag_path   tag path to use
@@ -213,6 +280,14 @@ namespace Invader::File {
      */
     std::string remove_duplicate_slashes(const std::string &path);
 
+    /**
+     * Remove duplicate slashes from the path
+     * @param  path   path to remove duplicate slashes from; this does not need to be null terminated
+     * @param  length length of the path
+     * @return        path with removed duplicate slashes
+     */
+    std::string remove_duplicate_slashes(const char *path, std::size_t length);
+
     /**
      * Remove duplicate slashes from the path
      * @param  path path to remove duplicate slashes from
@@ -263,6 +338,50 @@ namespace Invader::File {
      * @return        true if a match was found
      */
     bool path_matches(const char *path, const std::vector<std::string> &include, const std::vector<std::string> &exclude) noexcept;
+
+    /**
+     * Include and exclude patterns compiled once for matching many paths, with the same rules as path_matches()
+     */
+    class PathMatcher {
+    public:
+        /**
+         * Compile the patterns
+         * @param include include patterns to check (empty matches all)
+         * @param exclude exclude patterns to check
+         */
+        PathMatcher(const std::vector<std::string> &include, const std::vector<std::string> &exclude);
+
+        /**
+         * Check if the path matches
+         * @param path path to check
+         * @return     true if not excluded and included (or there are no include patterns)
+         */
+        bool matches(const char *path) const noexcept;
+
+    private:
+        struct Pattern {
+            /** Pattern with repeated *'s collapsed and every path separator turned into / */
+            std::string pattern;
+
+            /** Number of characters before the first wildcard, which the path has to start with */
+            std::size_t prefix_length;
+
+            /** Number of characters after the last *, which the path has to end with (0 if these contain a ?) */
+            std::size_t suffix_length;
+
+            /** Minimum length of a matching path */
+            std::size_t minimum_length;
+
+            /** No wildcards, so the path has to match exactly */
+            bool literal;
+        };
+
+        static Pattern compile(const std::string &pattern);
+        static bool matches(const Pattern &pattern, const char *path, std::size_t path_length) noexcept;
+
+        std::vector<Pattern> include;
+        std::vector<Pattern> exclude;
+    };
 }
 
 #endif
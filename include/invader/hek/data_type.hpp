@@ -1048,7 +1048,54 @@ namespace Invader::HEK {
     ModelVertexCompressed<NativeEndian> compress_model_vertex(const ModelVertexUncompressed<NativeEndian> &vertex) noexcept;
     ModelVertexUncompressed<NativeEndian> decompress_model_vertex(const ModelVertexCompressed<NativeEndian> &vertex) noexcept;
 
+    /**
+     * Compress many model vertices at once
+     * @param vertices   vertices to compress
+     * @param compressed array to write count compressed vertices to
+     * @param count      number of vertices
+     */
+    void compress_model_vertices(const ModelVertexUncompressed<NativeEndian> *vertices, ModelVertexCompressed<NativeEndian> *compressed, std::size_t count) noexcept;
+
+    /**
+     * Decompress many model vertices at once
+     * @param compressed vertices to decompress
+     * @param vertices   array to write count decompressed vertices to
+     * @param count      number of vertices
+     */
+    void decompress_model_vertices(const ModelVertexCompressed<NativeEndian> *compressed, ModelVertexUncompressed<NativeEndian> *vertices, std::size_t count) noexcept;
+
     std::uint32_t compress_vector(float i, float j, float k) noexcept;
+    void decompress_vector(std::uint32_t v, float &i, float &j, float &k) noexcept;
+
+    /**
+     * Compress many vectors into 11/11/10-bit vectors at once. Each component is in its own array so this can be
+     * vectorized, and the result is the same as calling compress_vector() on each vector.
+     * @param i          i components
+     * @param j          j components
+     * @param k          k components
+     * @param compressed array to write count compressed vectors to
+     * @param count      number of vectors
+     */
+    void compress_vectors(const float *i, const float *j, const float *k, std::uint32_t *compressed, std::size_t count) noexcept;
+
+    /**
+     * Decompress many 11/11/10-bit vectors at once into separate component arrays
+     * @param compressed compressed vectors
+     * @param i          array to write i components to
+     * @param j          array to write j components to
+     * @param k          array to write k components to
+     * @param count      number of vectors
+     */
+    void decompress_vectors(const std::uint32_t *compressed, float *i, float *j, float *k, std::size_t count) noexcept;
+
+    /**
+     * Normalize many vectors in place, giving the same result as Vector3D::normalize() on each vector
+     * @param i     i components
+     * @param j     j components
+     * @param k     k components
+     * @param count number of vectors
+     */
+    void normalize_vectors(float *i, float *j, float *k, std::size_t count) noexcept;
 
     ScenarioStructureBSPMaterialCompressedRenderedVertex<NativeEndian> compress_sbsp_rendered_vertex(const ScenarioStructureBSPMaterialUncompressedRenderedVertex<NativeEndian> &vertex) noexcept;
     ScenarioStructureBSPMaterialUncompressedRenderedVertex<NativeEndian> decompress_sbsp_rendered_vertex(const ScenarioStructureBSPMaterialCompressedRenderedVertex<NativeEndian> &vertex) noexcept;
@@ -0,0 +1,18 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef INVADER__JSON__JSON_HPP
+#define INVADER__JSON__JSON_HPP
+
+#include <string>
+#include <string_view>
+
+namespace Invader {
+    /**
+     * Quote and escape a string for use in JSON output
+     * @param string string to escape
+     * @return       quoted JSON string
+     */
+    std::string json_string(std::string_view string);
+}
+
+#endif
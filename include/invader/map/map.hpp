@@ -176,6 +176,15 @@ namespace Invader {
                                  std::vector<std::byte> &&loc_data = std::vector<std::byte>(),
                                  std::vector<std::byte> &&sounds_data = std::vector<std::byte>());
 
+        /**
+         * Create a Map that uses the given data without copying it (e.g. a memory-mapped file). The data must outlive the
+         * map. Compressed maps are decompressed into memory managed by the map instead.
+         * @param  data      pointer to map data
+         * @param  data_size length of map data
+         * @return           map
+         */
+        static Map map_with_pointer(std::byte *data, std::size_t data_size);
+
         /**
          * Get the data at the specified offset
          * @param  offset       offset
@@ -324,6 +333,12 @@ namespace Invader {
         /** Map data if managed */
         std::vector<std::byte> data;
 
+        /** Map data if not managed */
+        std::byte *unmanaged_data = nullptr;
+
+        /** Length of map data if not managed */
+        std::size_t unmanaged_data_size = 0;
+
 
         /** Bitmaps data if managed */
         std::vector<std::byte> bitmap_data;
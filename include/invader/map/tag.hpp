@@ -54,6 +54,14 @@ namespace Invader {
             return this->tag_fourcc;
         }
 
+        /**
+         * Get the pointer to the tag's base struct
+         * @return pointer to the base struct
+         */
+        HEK::Pointer get_base_struct_pointer() const noexcept {
+            return this->base_struct_pointer;
+        }
+
         /**
          * Get whether this is an indexed tag that is not in the map
          * @return true if this is an indexed tag that is not in the map
@@ -105,10 +105,26 @@ namespace Invader {
         std::string string() const;
         static JMS from_string(const char *string, const char **end = nullptr);
         
+        /**
+         * Serialize to a compact binary format that can be loaded with from_binary() without parsing any text
+         * @return binary data
+         */
+        std::vector<std::byte> to_binary() const;
+        
+        /**
+         * Load a JMS that was serialized with to_binary()
+         * @param data data to load
+         * @param size size of the data
+         * @return     JMS
+         * @throws     std::invalid_argument if the data is truncated or invalid
+         */
+        static JMS from_binary(const std::byte *data, std::size_t size);
+        
         /**
          * Optimize, removing duplicate vertices
+         * @param weld_epsilon if greater than 0, also merge vertices that are the same when snapped to a grid this size
          */
-        void optimize();
+        void optimize(float weld_epsilon = 0.0F);
     };
     
     using JMSMap = std::map<std::string, JMS>;
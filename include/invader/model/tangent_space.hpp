@@ -0,0 +1,22 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef INVADER__MODEL__TANGENT_SPACE_HPP
+#define INVADER__MODEL__TANGENT_SPACE_HPP
+
+#include <vector>
+
+#include "jms.hpp"
+#include "../tag/parser/parser.hpp"
+
+namespace Invader::TangentSpace {
+    /**
+     * Calculate the binormal and tangent of each vertex from the positions and texture coordinates of the triangles that
+     * use it, then normalize them. Each triangle corner adds its normalized binormal and tangent onto what the vertex
+     * already has (in triangle order), so this gives the same result as doing it one triangle at a time.
+     * @param vertices  vertices to calculate binormals and tangents for
+     * @param triangles triangles (every vertex index must be less than the number of vertices)
+     */
+    void calculate_binormals_and_tangents(std::vector<Parser::ModelVertexUncompressed> &vertices, const std::vector<JMS::Triangle> &triangles);
+}
+
+#endif
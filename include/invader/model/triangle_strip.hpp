@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef INVADER__MODEL__TRIANGLE_STRIP_HPP
+#define INVADER__MODEL__TRIANGLE_STRIP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "jms.hpp"
+
+namespace Invader::TriangleStrip {
+    /**
+     * Number of vertices assumed to fit in the post-transform vertex cache
+     */
+    static constexpr std::size_t VERTEX_CACHE_SIZE = 32;
+
+    /**
+     * Reorder triangles so vertices get reused while they are still in the post-transform vertex cache. This uses Tom
+     * Forsyth's linear-speed vertex cache optimization.
+     * @param triangles    triangles to reorder
+     * @param vertex_count number of vertices (every vertex index must be less than this)
+     */
+    void optimize_vertex_cache(std::vector<JMS::Triangle> &triangles, std::size_t vertex_count);
+
+    /**
+     * Join triangles into a single triangle strip, following shared edges where possible and joining separate strips
+     * with degenerate triangles. Triangle k of the strip is (s[k], s[k+1], s[k+2]) if k is even and
+     * (s[k], s[k+2], s[k+1]) if k is odd, so every triangle keeps its winding order.
+     * @param triangles    triangles to strip, preferably ordered with optimize_vertex_cache() first
+     * @param vertex_count number of vertices (every vertex index must be less than this)
+     * @return             strip indices
+     */
+    std::vector<std::uint32_t> make_strip(const std::vector<JMS::Triangle> &triangles, std::size_t vertex_count);
+
+    /**
+     * Calculate the average cache miss ratio (vertices transformed per triangle) of a triangle list
+     * @param triangles  triangles to check
+     * @param cache_size size of the FIFO vertex cache to simulate
+     * @return           average cache miss ratio
+     */
+    double calculate_list_acmr(const std::vector<JMS::Triangle> &triangles, std::size_t cache_size = VERTEX_CACHE_SIZE);
+
+    /**
+     * Calculate the average cache miss ratio (vertices transformed per triangle) of a triangle strip, not counting
+     * degenerate triangles as triangles
+     * @param strip      strip indices
+     * @param cache_size size of the FIFO vertex cache to simulate
+     * @return           average cache miss ratio
+     */
+    double calculate_strip_acmr(const std::vector<std::uint32_t> &strip, std::size_t cache_size = VERTEX_CACHE_SIZE);
+}
+
+#endif
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef INVADER__PARALLEL__PARALLEL_HPP
+#define INVADER__PARALLEL__PARALLEL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+namespace Invader {
+    /**
+     * Run a function over a range of indices on a pool of threads.
+     *
+     * The range is cut into chunks, and each thread starts with an even share of them. A thread that runs out takes half
+     * of the remaining chunks from another thread, so uneven work (e.g. a few very large tags) still keeps every thread
+     * busy. Anything printed with oprintf/eprintf while running an index is held and printed in index order.
+     */
+    class Parallel {
+    public:
+        /**
+         * Get the default number of threads to use
+         * @return number of CPU threads, or 1 if unknown
+         */
+        static std::size_t default_thread_count() noexcept;
+
+        /**
+         * Run the function for every index in [0, count), blocking until done. The calling thread is one of the threads.
+         * @param count      number of indices
+         * @param function   function to call for each index
+         * @param chunk_size number of consecutive indices a thread takes at once
+         * @return           true if every index was run; false if cancelled
+         * @throws           the first exception thrown by the function, after all threads have stopped
+         */
+        bool for_each(std::size_t count, const std::function<void (std::size_t index)> &function, std::size_t chunk_size = 1);
+
+        /**
+         * Stop handing out indices; indices that are already running finish. This can be called from the function. Once
+         * cancelled, later calls to for_each() do nothing.
+         */
+        void cancel() noexcept {
+            this->cancelled = true;
+        }
+
+        /**
+         * Get whether cancel() was called
+         * @return true if cancelled
+         */
+        bool is_cancelled() const noexcept {
+            return this->cancelled;
+        }
+
+        /**
+         * Get the number of threads used
+         * @return number of threads
+         */
+        std::size_t get_thread_count() const noexcept {
+            return this->thread_count;
+        }
+
+        /**
+         * Instantiate an executor
+         * @param thread_count number of threads to use (0 uses the default)
+         */
+        Parallel(std::size_t thread_count = 0) noexcept;
+
+        Parallel(const Parallel &) = delete;
+        Parallel &operator=(const Parallel &) = delete;
+
+    private:
+        std::size_t thread_count;
+        std::atomic<bool> cancelled = false;
+    };
+}
+
+#endif
@@ -16,9 +16,48 @@ bool is_on_color_term() noexcept;
 #include <cstdlib>
 #include <cstring>
 #include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
 
-#define eprintf(...) std::fprintf(stderr, __VA_ARGS__)
-#define oprintf(...) std::fprintf(stdout, __VA_ARGS__)
+/**
+ * Text printed by a thread while it has a buffer set, in the order it was printed, along with the stream it was for
+ */
+using PrintfBuffer = std::vector<std::pair<std::FILE *, std::string>>;
+
+/**
+ * Set the buffer the calling thread's eprintf and oprintf calls go to instead of stderr and stdout
+ * @param buffer buffer to use, or nullptr to print directly again
+ * @return       the buffer that was set before
+ */
+PrintfBuffer *set_printf_buffer(PrintfBuffer *buffer) noexcept;
+
+/**
+ * Print to the stream, or to the calling thread's buffer if one is set
+ * @param stream stream to print to
+ * @param format printf format
+ * @return       number of characters printed, or a negative value on failure
+ */
+#if defined(__GNUC__) && !defined(_WIN32)
+__attribute__((format(printf, 2, 3)))
+#endif
+int buffered_fprintf(std::FILE *stream, const char *format, ...) noexcept;
+
+/**
+ * Get the buffer the calling thread's eprintf and oprintf calls go to
+ * @return buffer, or nullptr if printing directly
+ */
+PrintfBuffer *get_printf_buffer() noexcept;
+
+/**
+ * Write out everything in the buffer and clear it
+ * @param buffer      buffer to write out
+ * @param destination buffer to move the text to instead of writing it, if not nullptr
+ */
+void flush_printf_buffer(PrintfBuffer &buffer, PrintfBuffer *destination = nullptr) noexcept;
+
+#define eprintf(...) buffered_fprintf(stderr, __VA_ARGS__)
+#define oprintf(...) buffered_fprintf(stdout, __VA_ARGS__)
 #define oflush(...) std::fflush(stdout)
 
 #define eprintf_error(...) if(ON_COLOR_TERM(stderr)) {\
@@ -52,14 +52,24 @@ namespace Invader::SoundEncoder {
      */
     std::vector<std::byte> encode_to_flac(const std::vector<std::byte> &pcm, std::size_t bits_per_sample, std::uint32_t channel_count, std::uint32_t sample_rate, std::uint32_t compression_level = 5);
 
+    enum XboxADPCMEncodeMode {
+        /** Produce the same output as encoding every block in order, regardless of thread count */
+        XBOX_ADPCM_ENCODE_DETERMINISTIC,
+
+        /** Look further ahead and use noise shaping; much slower, so it's best used with more threads */
+        XBOX_ADPCM_ENCODE_QUALITY
+    };
+
     /**
      * Encode the PCM data to Xbox ADPCM. This is lossy.
      * @param pcm             PCM data
      * @param bits_per_sample bits per sample of the PCM data
      * @param channel_count   number of channels
+     * @param mode            encoding mode
+     * @param thread_count    number of threads to encode runs of blocks with
      * @return                Xbox ADPCM data
      */
-    std::vector<std::byte> encode_to_xbox_adpcm(const std::vector<std::byte> &pcm, std::size_t bits_per_sample, std::size_t channel_count);
+    std::vector<std::byte> encode_to_xbox_adpcm(const std::vector<std::byte> &pcm, std::size_t bits_per_sample, std::size_t channel_count, XboxADPCMEncodeMode mode = XboxADPCMEncodeMode::XBOX_ADPCM_ENCODE_DETERMINISTIC, std::size_t thread_count = 1);
     
     /**
      * Calculate the PCM block size to use for encoding to ADPCM. Basically the number of samples must be a multiple of this.
@@ -76,6 +86,15 @@ namespace Invader::SoundEncoder {
      */
     std::vector<std::byte> convert_to_16_bit_pcm_big_endian(const std::vector<std::byte> &pcm, std::size_t bits_per_sample);
 
+    /**
+     * Encode the PCM data to 16-bit big endian PCM into a buffer that can hold sample_count 16-bit samples.
+     * @param pcm             PCM data
+     * @param output          output buffer
+     * @param sample_count    number of samples (not frames) to convert
+     * @param bits_per_sample bits per sample of the PCM data
+     */
+    void convert_to_16_bit_pcm_big_endian(const std::byte *pcm, std::byte *output, std::size_t sample_count, std::size_t bits_per_sample) noexcept;
+
     /**
      * Encode from one PCM size to another. This is lossless unless converting from higher to lower.
      * @param pcm                 PCM data
@@ -85,6 +104,16 @@ namespace Invader::SoundEncoder {
      */
     std::vector<std::byte> convert_int_to_int(const std::vector<std::byte> &pcm, std::size_t bits_per_sample, std::size_t new_bits_per_sample);
 
+    /**
+     * Encode from one PCM size to another into a buffer that can hold sample_count samples of the new size.
+     * @param pcm                 PCM data
+     * @param output              output buffer
+     * @param sample_count        number of samples (not frames) to convert
+     * @param bits_per_sample     bits per sample
+     * @param new_bits_per_sample new bits per sample
+     */
+    void convert_int_to_int(const std::byte *pcm, std::byte *output, std::size_t sample_count, std::size_t bits_per_sample, std::size_t new_bits_per_sample) noexcept;
+
     /**
      * Encode from one PCM size to another. This is lossless.
      * @param pcm             PCM data
@@ -93,6 +122,15 @@ namespace Invader::SoundEncoder {
      */
     std::vector<float> convert_int_to_float(const std::vector<std::byte> &pcm, std::size_t bits_per_sample);
 
+    /**
+     * Convert integer PCM to float into a buffer that can hold sample_count floats.
+     * @param pcm             PCM data
+     * @param output          output buffer
+     * @param sample_count    number of samples (not frames) to convert
+     * @param bits_per_sample bits per sample
+     */
+    void convert_int_to_float(const std::byte *pcm, float *output, std::size_t sample_count, std::size_t bits_per_sample) noexcept;
+
     /**
      * Encode from one PCM size to another. This is lossy unless the PCM data was originally integer PCM of the same bitness or smaller.
      * @param pcm                 PCM data
@@ -100,6 +138,26 @@ namespace Invader::SoundEncoder {
      */
     std::vector<std::byte> convert_float_to_int(const std::vector<float> &pcm, std::size_t new_bits_per_sample);
 
+    /**
+     * Convert float PCM to integer into a buffer that can hold sample_count samples.
+     * @param pcm                 PCM data
+     * @param output              output buffer
+     * @param sample_count        number of samples (not frames) to convert
+     * @param new_bits_per_sample new bits per sample
+     */
+    void convert_float_to_int(const float *pcm, std::byte *output, std::size_t sample_count, std::size_t new_bits_per_sample) noexcept;
+
+    /**
+     * Resample integer PCM data a chunk at a time. The output has the same bits per sample and channel count as the input.
+     * @param pcm             PCM data
+     * @param bits_per_sample bits per sample
+     * @param channel_count   channel count
+     * @param ratio           output sample rate divided by input sample rate
+     * @param max_frames      stop after this many frames have been output, if set
+     * @return                resampled PCM data
+     */
+    std::vector<std::byte> resample(const std::vector<std::byte> &pcm, std::size_t bits_per_sample, std::size_t channel_count, double ratio, std::optional<std::size_t> max_frames = std::nullopt);
+
     /**
      * Read the little sample as an int.
      * @param  pcm             pointer to sample
@@ -3,10 +3,15 @@
 #ifndef INVADER__TAG__HEK__CLASS__MODEL_COLLISION_GEOMETRY_HPP
 #define INVADER__TAG__HEK__CLASS__MODEL_COLLISION_GEOMETRY_HPP
 
+#include <memory>
+#include <vector>
+
 #include "../../../hek/data_type.hpp"
 #include "../definition.hpp"
 
 namespace Invader::HEK {
+    class PreparedBSP;
+
     /**
      * Struct for containing all information required to find intersections among other things
      */
@@ -58,6 +63,137 @@ namespace Invader::HEK {
          * @param leaf_index if non-null and this function returns true, this will be set to the leaf index where the point is located
          */
         bool check_if_point_inside_bsp(const Point3D<LittleEndian> &point, std::uint32_t *leaf_index = nullptr) const;
+
+        /**
+         * Prepared copy of this BSP used for queries; if null, queries walk the tag data directly
+         */
+        std::shared_ptr<const PreparedBSP> prepared;
+
+        /**
+         * Build a prepared copy of this BSP for faster queries. This must be called again if the tag data is changed.
+         */
+        void prepare();
+    };
+
+    /**
+     * Native-endian copy of a collision BSP laid out for fast intersection queries.
+     *
+     * Nodes are renumbered depth-first with their planes stored inline, and the 2D projection of each BSP2D reference is
+     * computed ahead of time. All indices are validated when preparing, so queries do not need to check them again.
+     * Leaf and surface indices returned are the same as those of the original BSP.
+     */
+    class PreparedBSP {
+    public:
+        /**
+         * Prepare a BSP for queries
+         * @param  bsp BSP to prepare
+         * @return     prepared BSP, or null if the BSP has invalid indices (in which case the tag data must be walked directly so the errors can be reported)
+         */
+        static std::shared_ptr<const PreparedBSP> prepare(const BSPData &bsp);
+
+        /**
+         * Determine if a point intersects vertically with the BSP. This matches BSPData::check_for_intersection.
+         * @param point_a            one point in the line to check
+         * @param point_b            the other point in the line to check
+         * @param intersection_point if non-null and this function returns true, this will be set to the point where an intersection was found
+         * @param surface_index      if non-null and this function returns true, this will be set to the surface index where the intersection was found
+         * @param leaf_index         if non-null and this function returns true, this will be set to the leaf index where the intersection was found
+         * @return                   true if an intersection was found
+         */
+        bool check_for_intersection(const Point3D<NativeEndian> &point_a, const Point3D<NativeEndian> &point_b, Point3D<NativeEndian> *intersection_point = nullptr, std::uint32_t *surface_index = nullptr, std::uint32_t *leaf_index = nullptr) const noexcept;
+
+        /**
+         * Determine if a point intersects vertically with the BSP. This matches BSPData::check_for_intersection.
+         * @param point              point to check
+         * @param range              range up-and-down to check
+         * @param intersection_point if non-null and this function returns true, this will be set to the point where an intersection was found
+         * @param surface_index      if non-null and this function returns true, this will be set to the surface index where the intersection was found
+         * @param leaf_index         if non-null and this function returns true, this will be set to the leaf index where the intersection was found
+         * @return                   true if an intersection was found
+         */
+        bool check_for_intersection(const Point3D<NativeEndian> &point, float range, Point3D<NativeEndian> *intersection_point = nullptr, std::uint32_t *surface_index = nullptr, std::uint32_t *leaf_index = nullptr) const noexcept;
+
+        /**
+         * Determine if a point lays inside of a BSP. This matches BSPData::check_if_point_inside_bsp.
+         * @param point      point to check
+         * @param leaf_index if non-null and this function returns true, this will be set to the leaf index where the point is located
+         */
+        bool check_if_point_inside_bsp(const Point3D<NativeEndian> &point, std::uint32_t *leaf_index = nullptr) const noexcept;
+
+        struct Node3D {
+            Plane3D<NativeEndian> plane;
+
+            /** Children indexed by whether or not the point is in front of the plane; leaves and null are the same as in the tag */
+            FlaggedInt<std::uint32_t> children[2];
+        };
+
+        struct Leaf {
+            std::uint32_t first_bsp2d_reference;
+            std::uint32_t bsp2d_reference_count;
+        };
+
+        struct Reference2D {
+            Plane3D<NativeEndian> plane;
+            FlaggedInt<std::uint32_t> bsp2d_node;
+
+            /** Components of the 3D point to use for the X and Y of the projected 2D point */
+            std::uint8_t projection[2];
+        };
+
+        struct Node2D {
+            Plane2D<NativeEndian> plane;
+
+            /** Children indexed by whether or not the point is in front of the plane; surfaces and null are the same as in the tag */
+            FlaggedInt<std::uint32_t> children[2];
+        };
+
+    private:
+        struct IntersectionQuery;
+
+        std::vector<Node3D> bsp3d_nodes;
+        std::vector<Leaf> leaves;
+        std::vector<Reference2D> bsp2d_references;
+        std::vector<Node2D> bsp2d_nodes;
     };
+
+    /**
+     * Point to look up with find_points_in_bsps()
+     */
+    struct BSPPointQuery {
+        /** Point to look up */
+        Point3D<NativeEndian> point;
+
+        /** Index of the BSP to look in */
+        std::size_t bsp_index;
+
+        /** If true, look for a surface within range above or below the point; otherwise, look for the leaf the point is in */
+        bool raycast;
+
+        /** Range up-and-down to check if raycasting */
+        float range = 0.5F;
+    };
+
+    /**
+     * Result of a BSPPointQuery
+     */
+    struct BSPPointResult {
+        /** True if a surface (if raycasting) or leaf was found */
+        bool found = false;
+
+        /** Surface index found if raycasting, or 0 */
+        std::uint32_t surface_index = 0;
+
+        /** Leaf index found */
+        std::uint32_t leaf_index = 0;
+    };
+
+    /**
+     * Look up a batch of points in BSPs. Queries are spread across threads if every BSP queried is prepared; otherwise,
+     * they are done in order on this thread so errors are reported the same way as single queries.
+     * @param bsps    BSPs to look in
+     * @param queries points to look up
+     * @return        results in the same order as the queries
+     */
+    std::vector<BSPPointResult> find_points_in_bsps(const std::vector<BSPData> &bsps, const std::vector<BSPPointQuery> &queries);
 }
 #endif
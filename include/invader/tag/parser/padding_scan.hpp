@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef INVADER__TAG__PARSER__PADDING_SCAN_HPP
+#define INVADER__TAG__PARSER__PADDING_SCAN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "../../hek/data_type.hpp"
+
+namespace Invader {
+    class Tag;
+}
+
+/**
+ * Results of the generated scan_padding() functions, which look for non-zero bytes in cache file structs that aren't
+ * part of any known field.
+ */
+namespace Invader::Parser {
+    /**
+     * A non-zero byte that isn't part of any known field
+     */
+    struct PaddingFinding {
+        /** Name of the struct the byte is in */
+        const char *struct_name;
+
+        /** Offset of the byte in the struct */
+        std::size_t offset;
+
+        /** Value of the byte */
+        std::uint8_t value;
+
+        /** Address of the struct in the tag data */
+        HEK::Pointer struct_pointer;
+    };
+
+    /**
+     * Function called for each non-zero byte found
+     */
+    using PaddingScanCallback = std::function<void (const Tag &tag, const PaddingFinding &finding)>;
+}
+
+#endif
@@ -1101,13 +1101,29 @@ namespace Invader::Parser {
          * @param differences     an optional pointer to a list of strings to be filled with the differences (verbose mode)
          */
         bool compare(const ParserStruct *what, bool precision = false, bool ignore_volatile = false, std::list<std::string> *differences = nullptr) const;
-        
+
+        /**
+         * Compare the struct against another struct using generated, typed code without building a list of differences
+         * @param what            struct to compare against
+         * @param precision       allow small differences for floats
+         * @param ignore_volatile ignore data that can be added or removed when a map is compiled
+         * @return                true if the same; this agrees with compare()
+         */
+        virtual bool compare_fast(const ParserStruct &what, bool precision = false, bool ignore_volatile = false) const = 0;
+
+        /**
+         * Get a 64-bit hash of the values compare() looks at. Structs that are the same without precision have the same hash.
+         * @param ignore_volatile ignore data that can be added or removed when a map is compiled
+         * @return                hash
+         */
+        virtual std::uint64_t structural_hash(bool ignore_volatile = false) const = 0;
+
         bool operator==(const ParserStruct &other) const {
-            return this->compare(&other);
+            return this->compare_fast(other);
         }
-        
+
         bool operator!=(const ParserStruct &other) const {
-            return !this->compare(&other);
+            return !this->compare_fast(other);
         }
 
         virtual ~ParserStruct() = default;
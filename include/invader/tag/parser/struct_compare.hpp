@@ -0,0 +1,253 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef INVADER__TAG__PARSER__STRUCT_COMPARE_HPP
+#define INVADER__TAG__PARSER__STRUCT_COMPARE_HPP
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "parser_struct.hpp"
+
+/**
+ * Typed helpers used by the generated ParserStruct::compare_fast() and ParserStruct::structural_hash() functions.
+ *
+ * These follow the same rules as the reflective ParserStruct::compare(): floats may be compared with precision, enums
+ * compare equal if they resolve to the same name, only the given bits of bitmasks are compared, and dependency classes
+ * are only compared if the path is set. The hash is built from the values rather than their bytes, so it does not
+ * depend on the host's endianness, and any two values that compare equal without precision hash equally.
+ */
+namespace Invader::Parser::StructCompare {
+    /**
+     * Check if two floats are too different to be considered the same when comparing with precision
+     * @param a first value
+     * @param b second value
+     * @return  true if too different
+     */
+    constexpr bool too_different(double a, double b) noexcept {
+        double delta = FLOAT_EPSILON;
+
+        auto max_discrepency = a * delta;
+        if(max_discrepency < 0.0) {
+            max_discrepency *= -1.0;
+        }
+
+        auto difference = (a - b);
+        if(difference < 0.0) {
+            difference *= -1.0;
+        }
+
+        // (a-b) > delta && b is not in [a - dA, a + dA]
+        return difference > delta && ((b > a + max_discrepency) || (b < a - max_discrepency));
+    }
+
+    /**
+     * Seed for a structural hash
+     */
+    constexpr std::uint64_t HASH_SEED = 0xCBF29CE484222325;
+
+    /**
+     * Mix a 64-bit word into the hash
+     * @param hash hash to mix into
+     * @param word word to mix
+     * @return     new hash
+     */
+    constexpr std::uint64_t hash_word(std::uint64_t hash, std::uint64_t word) noexcept {
+        word += 0x9E3779B97F4A7C15;
+        word = (word ^ (word >> 30)) * 0xBF58476D1CE4E5B9;
+        word = (word ^ (word >> 27)) * 0x94D049BB133111EB;
+        word ^= word >> 31;
+        return (hash ^ word) * 0x100000001B3;
+    }
+
+    /**
+     * Mix the bytes into the hash, eight at a time
+     * @param hash hash to mix into
+     * @param data data to hash
+     * @param size number of bytes
+     * @return     new hash
+     */
+    inline std::uint64_t hash_bytes(std::uint64_t hash, const std::byte *data, std::size_t size) noexcept {
+        hash = hash_word(hash, size);
+        std::size_t i = 0;
+        for(; i + 8 <= size; i += 8) {
+            std::uint64_t word = 0;
+            for(std::size_t b = 0; b < 8; b++) {
+                word |= static_cast<std::uint64_t>(data[i + b]) << (b * 8);
+            }
+            hash = hash_word(hash, word);
+        }
+        if(i < size) {
+            std::uint64_t word = 0;
+            for(std::size_t b = 0; i + b < size; b++) {
+                word |= static_cast<std::uint64_t>(data[i + b]) << (b * 8);
+            }
+            hash = hash_word(hash, word);
+        }
+        return hash;
+    }
+
+    // Scalars
+
+    inline bool same_value(float a, float b, bool precision) noexcept {
+        return a == b || (precision && !too_different(a, b));
+    }
+
+    inline std::uint64_t hash_value(std::uint64_t hash, float value) noexcept {
+        // -0.0 and 0.0 compare equal, so they need to hash equally
+        return hash_word(hash, value == 0.0F ? 0 : std::bit_cast<std::uint32_t>(value));
+    }
+
+    template <typename T> requires std::is_integral_v<T> bool same_value(T a, T b, bool) noexcept {
+        return a == b;
+    }
+
+    template <typename T> requires std::is_integral_v<T> std::uint64_t hash_value(std::uint64_t hash, T value) noexcept {
+        return hash_word(hash, static_cast<std::uint64_t>(value));
+    }
+
+    template <typename T> bool same_value(const HEK::FlaggedInt<T> &a, const HEK::FlaggedInt<T> &b, bool) noexcept {
+        return a.value == b.value;
+    }
+
+    template <typename T> std::uint64_t hash_value(std::uint64_t hash, const HEK::FlaggedInt<T> &value) noexcept {
+        return hash_word(hash, value.value);
+    }
+
+    template <typename T> bool same_value(const HEK::NativeEndian<T> &a, const HEK::NativeEndian<T> &b, bool precision) noexcept {
+        return same_value(static_cast<T>(a), static_cast<T>(b), precision);
+    }
+
+    template <typename T> std::uint64_t hash_value(std::uint64_t hash, const HEK::NativeEndian<T> &value) noexcept {
+        return hash_value(hash, static_cast<T>(value));
+    }
+
+    template <typename T> bool same_value(const HEK::Bounds<T> &a, const HEK::Bounds<T> &b, bool precision) noexcept {
+        return same_value(a.from, b.from, precision) && same_value(a.to, b.to, precision);
+    }
+
+    template <typename T> std::uint64_t hash_value(std::uint64_t hash, const HEK::Bounds<T> &value) noexcept {
+        return hash_value(hash_value(hash, value.from), value.to);
+    }
+
+    // Compound values; each of these is compared component-wise in the same order ParserStructValue lists them
+
+    #define INVADER_STRUCT_COMPARE_2(type, a, b) \
+        inline bool same_value(const type &x, const type &y, bool precision) noexcept { \
+            return same_value(x.a, y.a, precision) && same_value(x.b, y.b, precision); \
+        } \
+        inline std::uint64_t hash_value(std::uint64_t hash, const type &x) noexcept { \
+            return hash_value(hash_value(hash, x.a), x.b); \
+        }
+    #define INVADER_STRUCT_COMPARE_3(type, a, b, c) \
+        inline bool same_value(const type &x, const type &y, bool precision) noexcept { \
+            return same_value(x.a, y.a, precision) && same_value(x.b, y.b, precision) && same_value(x.c, y.c, precision); \
+        } \
+        inline std::uint64_t hash_value(std::uint64_t hash, const type &x) noexcept { \
+            return hash_value(hash_value(hash_value(hash, x.a), x.b), x.c); \
+        }
+    #define INVADER_STRUCT_COMPARE_4(type, a, b, c, d) \
+        inline bool same_value(const type &x, const type &y, bool precision) noexcept { \
+            return same_value(x.a, y.a, precision) && same_value(x.b, y.b, precision) && same_value(x.c, y.c, precision) && same_value(x.d, y.d, precision); \
+        } \
+        inline std::uint64_t hash_value(std::uint64_t hash, const type &x) noexcept { \
+            return hash_value(hash_value(hash_value(hash_value(hash, x.a), x.b), x.c), x.d); \
+        }
+
+    INVADER_STRUCT_COMPARE_4(HEK::ColorARGB<HEK::NativeEndian>, alpha, red, green, blue)
+    INVADER_STRUCT_COMPARE_4(HEK::ColorARGBInt, alpha, red, green, blue)
+    INVADER_STRUCT_COMPARE_3(HEK::ColorRGB<HEK::NativeEndian>, red, green, blue)
+    INVADER_STRUCT_COMPARE_2(HEK::Euler2D<HEK::NativeEndian>, yaw, pitch)
+    INVADER_STRUCT_COMPARE_3(HEK::Euler3D<HEK::NativeEndian>, yaw, pitch, roll)
+    INVADER_STRUCT_COMPARE_2(HEK::Point2D<HEK::NativeEndian>, x, y)
+    INVADER_STRUCT_COMPARE_2(HEK::Point2DInt<HEK::NativeEndian>, x, y)
+    INVADER_STRUCT_COMPARE_3(HEK::Point3D<HEK::NativeEndian>, x, y, z)
+    INVADER_STRUCT_COMPARE_4(HEK::Quaternion<HEK::NativeEndian>, i, j, k, w)
+    INVADER_STRUCT_COMPARE_4(HEK::Rectangle2D<HEK::NativeEndian>, top, left, bottom, right)
+    INVADER_STRUCT_COMPARE_2(HEK::Vector2D<HEK::NativeEndian>, i, j)
+    INVADER_STRUCT_COMPARE_3(HEK::Vector3D<HEK::NativeEndian>, i, j, k)
+    INVADER_STRUCT_COMPARE_2(HEK::Plane2D<HEK::NativeEndian>, vector, w)
+    INVADER_STRUCT_COMPARE_2(HEK::Plane3D<HEK::NativeEndian>, vector, w)
+
+    #undef INVADER_STRUCT_COMPARE_2
+    #undef INVADER_STRUCT_COMPARE_3
+    #undef INVADER_STRUCT_COMPARE_4
+
+    inline bool same_value(const HEK::Matrix<HEK::NativeEndian> &a, const HEK::Matrix<HEK::NativeEndian> &b, bool precision) noexcept {
+        for(std::size_t r = 0; r < 3; r++) {
+            for(std::size_t c = 0; c < 3; c++) {
+                if(!same_value(a.matrix[r][c], b.matrix[r][c], precision)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    inline std::uint64_t hash_value(std::uint64_t hash, const HEK::Matrix<HEK::NativeEndian> &value) noexcept {
+        for(auto &r : value.matrix) {
+            for(auto &c : r) {
+                hash = hash_value(hash, c);
+            }
+        }
+        return hash;
+    }
+
+    // Tag data
+
+    inline bool same_value(const HEK::TagString &a, const HEK::TagString &b, bool) noexcept {
+        return std::strcmp(a.string, b.string) == 0;
+    }
+
+    inline std::uint64_t hash_value(std::uint64_t hash, const HEK::TagString &value) noexcept {
+        return hash_bytes(hash, reinterpret_cast<const std::byte *>(value.string), std::strlen(value.string));
+    }
+
+    inline bool same_value(const Dependency &a, const Dependency &b, bool) noexcept {
+        return a == b;
+    }
+
+    inline std::uint64_t hash_value(std::uint64_t hash, const Dependency &value) noexcept {
+        hash = hash_bytes(hash, reinterpret_cast<const std::byte *>(value.path.data()), value.path.size());
+        return value.path.empty() ? hash : hash_word(hash, static_cast<std::uint32_t>(value.tag_fourcc));
+    }
+
+    inline bool same_value(const std::vector<std::byte> &a, const std::vector<std::byte> &b, bool) noexcept {
+        return a == b;
+    }
+
+    inline std::uint64_t hash_value(std::uint64_t hash, const std::vector<std::byte> &value) noexcept {
+        return hash_bytes(hash, value.data(), value.size());
+    }
+
+    // Enums and bitmasks
+
+    /**
+     * Compare two enum values; values outside of the enum all resolve to the same (unknown) name
+     * @param a     first value
+     * @param b     second value
+     * @param count number of options in the enum
+     * @return      true if the same
+     */
+    template <typename T> bool same_enum(T a, T b, std::size_t count) noexcept {
+        auto a_value = static_cast<std::size_t>(a);
+        auto b_value = static_cast<std::size_t>(b);
+        return a_value == b_value || (a_value >= count && b_value >= count);
+    }
+
+    template <typename T> std::uint64_t hash_enum(std::uint64_t hash, T value, std::size_t count) noexcept {
+        auto v = static_cast<std::size_t>(value);
+        return hash_word(hash, v < count ? v : count);
+    }
+
+    template <typename T> bool same_bitmask(T a, T b, std::uint64_t mask) noexcept {
+        return ((static_cast<std::uint64_t>(a) ^ static_cast<std::uint64_t>(b)) & mask) == 0;
+    }
+
+    template <typename T> std::uint64_t hash_bitmask(std::uint64_t hash, T value, std::uint64_t mask) noexcept {
+        return hash_word(hash, static_cast<std::uint64_t>(value) & mask);
+    }
+}
+
+#endif
@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef INVADER__TAG__PARSER__TAG_VIEW_HPP
+#define INVADER__TAG__PARSER__TAG_VIEW_HPP
+
+#include <cstddef>
+#include <iterator>
+#include <string_view>
+#include <vector>
+#include "../../hek/fourcc.hpp"
+
+/**
+ * Read-only views of HEK tag files.
+ *
+ * Each generated Parser struct has a View type that reads the big endian tag file in place rather than parsing it into
+ * a native object. Views are made with View::from_hek_tag_file(), which checks the whole file once; after that, nothing
+ * is bounds checked or copied again. The tag file must outlive any views into it.
+ */
+namespace Invader::Parser {
+    /**
+     * A tag reference as it is stored in a HEK tag file
+     */
+    struct DependencyView {
+        /** Tag class being referenced */
+        TagFourCC tag_fourcc;
+
+        /** Path being referenced; this is empty if nothing is referenced, and duplicate slashes are not removed */
+        std::string_view path;
+    };
+
+    /**
+     * An array of structs in a HEK tag file; in a tag file, the structs are followed by each struct's data in order
+     */
+    template <typename V> class ReflexiveView {
+    public:
+        class iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = V;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = V;
+
+            iterator(const std::byte *element, const std::byte *tail) noexcept : element(element), tail(tail) {}
+
+            V operator*() const noexcept {
+                return V(this->element, this->tail);
+            }
+
+            iterator &operator++() noexcept {
+                this->tail += V(this->element, this->tail).tail_size();
+                this->element += sizeof(typename V::struct_big);
+                return *this;
+            }
+
+            iterator operator++(int) noexcept {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            bool operator==(const iterator &other) const noexcept {
+                return this->element == other.element;
+            }
+
+            bool operator!=(const iterator &other) const noexcept {
+                return this->element != other.element;
+            }
+
+        private:
+            const std::byte *element;
+            const std::byte *tail;
+        };
+
+        /**
+         * Make a view of an array that has already been validated
+         * @param array pointer to the first struct
+         * @param count number of structs
+         */
+        ReflexiveView(const std::byte *array, std::size_t count) noexcept : array(array), count(count) {}
+
+        /**
+         * Get the number of structs
+         * @return number of structs
+         */
+        std::size_t size() const noexcept {
+            return this->count;
+        }
+
+        /**
+         * Get whether there are no structs
+         * @return true if empty
+         */
+        bool empty() const noexcept {
+            return this->count == 0;
+        }
+
+        iterator begin() const noexcept {
+            return iterator(this->array, this->array + this->count * sizeof(typename V::struct_big));
+        }
+
+        iterator end() const noexcept {
+            return iterator(this->array + this->count * sizeof(typename V::struct_big), nullptr);
+        }
+
+        /**
+         * Get the struct at the index; this skips over the data of each struct before it, so use iterators if going
+         * through all of them
+         * @param index index of the struct
+         * @return      view of the struct
+         */
+        V operator[](std::size_t index) const noexcept {
+            auto i = this->begin();
+            for(std::size_t s = 0; s < index; s++) {
+                ++i;
+            }
+            return *i;
+        }
+
+        /**
+         * Get the number of bytes taken by the structs and their data
+         * @return size in bytes
+         */
+        std::size_t size_in_bytes() const noexcept {
+            const std::byte *element = this->array;
+            const std::byte *tail = this->array + this->count * sizeof(typename V::struct_big);
+            for(std::size_t s = 0; s < this->count; s++) {
+                tail += V(element, tail).tail_size();
+                element += sizeof(typename V::struct_big);
+            }
+            return tail - this->array;
+        }
+
+    private:
+        const std::byte *array;
+        std::size_t count;
+    };
+
+    /**
+     * List every dependency in a HEK tag file, including ones in reflexives, without parsing it
+     * @param data         tag file data
+     * @param data_size    size of the tag file
+     * @param dependencies list to append the dependencies to; these point into data
+     * @throws             if the tag file is invalid
+     */
+    void list_hek_tag_file_dependencies(const std::byte *data, std::size_t data_size, std::vector<DependencyView> &dependencies);
+}
+
+#endif
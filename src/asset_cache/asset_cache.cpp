@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <invader/asset_cache/asset_cache.hpp>
+#include <invader/hek/endian.hpp>
+#include <invader/file/file.hpp>
+#include <invader/printf.hpp>
+#include <invader/version.hpp>
+#include "../crc/crc32.h"
+
+#include <atomic>
+#include <cstring>
+#include <random>
+
+namespace Invader {
+    // Bump this if the layout of cache entries ever changes
+    static constexpr char ASSET_CACHE_ENTRY_MAGIC[4] = { 'i', 'a', 'c', '1' };
+
+    struct AssetCacheEntryHeader {
+        char magic[sizeof(ASSET_CACHE_ENTRY_MAGIC)];
+        HEK::LittleEndian<std::uint32_t> crc32;
+        HEK::LittleEndian<std::uint64_t> size;
+    };
+    static_assert(sizeof(AssetCacheEntryHeader) == 0x10);
+
+    static constexpr std::uint64_t KEY_PRIME_A = 0x9E3779B185EBCA87;
+    static constexpr std::uint64_t KEY_PRIME_B = 0xC2B2AE3D27D4EB4F;
+    static constexpr std::uint64_t KEY_PRIME_C = 0x165667B19E3779F9;
+
+    static inline std::uint64_t rotate_left(std::uint64_t value, int bits) noexcept {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    // Final avalanche so every input bit affects every output bit
+    static inline std::uint64_t finalize_lane(std::uint64_t value) noexcept {
+        value ^= value >> 33;
+        value *= 0xFF51AFD7ED558CCD;
+        value ^= value >> 33;
+        value *= 0xC4CEB9FE1A85EC53;
+        value ^= value >> 33;
+        return value;
+    }
+
+    AssetCache::Key::Key(const char *kind) : lanes { KEY_PRIME_A, KEY_PRIME_B } {
+        this->add(std::string(full_version()));
+        this->add(std::string(kind));
+    }
+
+    void AssetCache::Key::add_word(std::uint64_t word) noexcept {
+        this->lanes[0] = rotate_left(this->lanes[0] ^ (word * KEY_PRIME_B), 31) * KEY_PRIME_A;
+        this->lanes[1] = rotate_left(this->lanes[1] ^ (word * KEY_PRIME_C), 29) * KEY_PRIME_B + this->lanes[0];
+    }
+
+    AssetCache::Key &AssetCache::Key::add(const void *data, std::size_t size) noexcept {
+        const auto *bytes = reinterpret_cast<const std::uint8_t *>(data);
+        this->total_bytes += size;
+
+        // Finish off any partial word first
+        while(size > 0 && this->pending_bytes > 0) {
+            this->pending |= static_cast<std::uint64_t>(*(bytes++)) << (this->pending_bytes * 8);
+            size--;
+            if(++this->pending_bytes == sizeof(this->pending)) {
+                this->add_word(this->pending);
+                this->pending = 0;
+                this->pending_bytes = 0;
+            }
+        }
+
+        // Then do whole words at a time
+        while(size >= sizeof(std::uint64_t)) {
+            HEK::LittleEndian<std::uint64_t> word;
+            std::memcpy(&word, bytes, sizeof(word));
+            this->add_word(word.read());
+            bytes += sizeof(word);
+            size -= sizeof(word);
+        }
+
+        // Hold onto the rest
+        while(size > 0) {
+            this->pending |= static_cast<std::uint64_t>(*(bytes++)) << (this->pending_bytes * 8);
+            this->pending_bytes++;
+            size--;
+        }
+
+        return *this;
+    }
+
+    std::string AssetCache::Key::to_string() const {
+        auto copy = *this;
+        copy.add_word(copy.pending ^ (static_cast<std::uint64_t>(copy.pending_bytes) << 56));
+        copy.add_word(copy.total_bytes);
+
+        std::uint64_t a = finalize_lane(copy.lanes[0] ^ rotate_left(copy.lanes[1], 17));
+        std::uint64_t b = finalize_lane(copy.lanes[1] ^ a);
+
+        char key_string[33];
+        std::snprintf(key_string, sizeof(key_string), "%016llx%016llx", static_cast<unsigned long long>(a), static_cast<unsigned long long>(b));
+        return key_string;
+    }
+
+    AssetCache::AssetCache(const std::filesystem::path &directory) : directory(directory) {
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+    }
+
+    std::filesystem::path AssetCache::path_for_key(const Key &key) const {
+        // Spread the entries across subdirectories so we don't end up with one directory with hundreds of thousands of files in it
+        auto key_string = key.to_string();
+        return this->directory / key_string.substr(0, 2) / key_string;
+    }
+
+    std::optional<std::vector<std::byte>> AssetCache::load(const Key &key) const {
+        auto path = this->path_for_key(key);
+
+        std::error_code ec;
+        if(!std::filesystem::is_regular_file(path, ec)) {
+            return std::nullopt;
+        }
+
+        auto entry = File::open_file(path);
+        if(!entry.has_value() || entry->size() < sizeof(AssetCacheEntryHeader)) {
+            return std::nullopt;
+        }
+
+        // Make sure the entry is intact before using it
+        AssetCacheEntryHeader header;
+        std::memcpy(&header, entry->data(), sizeof(header));
+        const auto *data = entry->data() + sizeof(header);
+        std::size_t data_size = entry->size() - sizeof(header);
+        if(std::memcmp(header.magic, ASSET_CACHE_ENTRY_MAGIC, sizeof(header.magic)) != 0 || header.size.read() != data_size || header.crc32.read() != crc32_buffer(0, data, data_size)) {
+            eprintf_warn("Ignoring corrupt cache entry %s", path.string().c_str());
+            return std::nullopt;
+        }
+
+        return std::vector<std::byte>(data, data + data_size);
+    }
+
+    bool AssetCache::store(const Key &key, const std::vector<std::byte> &data) const {
+        auto path = this->path_for_key(key);
+
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path(), ec);
+
+        AssetCacheEntryHeader header;
+        std::memcpy(header.magic, ASSET_CACHE_ENTRY_MAGIC, sizeof(header.magic));
+        header.crc32 = crc32_buffer(0, data.data(), data.size());
+        header.size = data.size();
+
+        std::vector<std::byte> entry;
+        entry.reserve(sizeof(header) + data.size());
+        entry.insert(entry.end(), reinterpret_cast<const std::byte *>(&header), reinterpret_cast<const std::byte *>(&header + 1));
+        entry.insert(entry.end(), data.begin(), data.end());
+
+        // Write to a file that nothing else will be using (other threads or processes may be storing the same entry), then move it into place
+        static const auto temp_salt = std::random_device()();
+        static std::atomic<std::size_t> temp_counter = 0;
+        auto temp_path = path;
+        temp_path += ".tmp" + std::to_string(temp_salt) + "-" + std::to_string(temp_counter++);
+        if(!File::save_file(temp_path, entry)) {
+            return false;
+        }
+
+        std::filesystem::rename(temp_path, path, ec);
+        if(ec) {
+            std::filesystem::remove(temp_path, ec);
+            return false;
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,25 @@
+# SPDX-License-Identifier: GPL-3.0-only
+
+if(NOT DEFINED ${INVADER_BENCHMARK})
+    set(INVADER_BENCHMARK false CACHE BOOL "Build micro-benchmarks for Invader's hot paths (not installed)")
+endif()
+
+if(${INVADER_BENCHMARK})
+    add_executable(invader-benchmark-swizzle
+        src/benchmark/swizzle.cpp
+    )
+
+    target_link_libraries(invader-benchmark-swizzle invader ${INVADER_CRT_NOGLOB})
+
+    add_executable(invader-benchmark-sound-pcm
+        src/benchmark/sound_pcm.cpp
+    )
+
+    target_link_libraries(invader-benchmark-sound-pcm invader ${INVADER_CRT_NOGLOB})
+
+    add_executable(invader-benchmark-collision-bsp
+        src/benchmark/collision_bsp.cpp
+    )
+
+    target_link_libraries(invader-benchmark-collision-bsp invader ${INVADER_CRT_NOGLOB})
+endif()
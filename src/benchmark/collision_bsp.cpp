@@ -0,0 +1,269 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <invader/tag/hek/class/model_collision_geometry.hpp>
+#include <invader/printf.hpp>
+
+// Benchmark collision BSP queries on the tag data against the same queries on a prepared BSP, checking that both give
+// the same results. The BSP is synthesized: a grid of cells split k-d style, each with two sloped floors that are
+// divided into four surfaces by a BSP2D tree.
+
+using namespace Invader::HEK;
+
+namespace {
+    struct SyntheticBSP {
+        std::vector<ModelCollisionGeometryBSP3DNode<LittleEndian>> bsp3d_nodes;
+        std::vector<ModelCollisionGeometryBSPPlane<LittleEndian>> planes;
+        std::vector<ModelCollisionGeometryBSPLeaf<LittleEndian>> leaves;
+        std::vector<ModelCollisionGeometryBSP2DNode<LittleEndian>> bsp2d_nodes;
+        std::vector<ModelCollisionGeometryBSP2DReference<LittleEndian>> bsp2d_references;
+        std::uint32_t surface_count = 0;
+
+        std::mt19937 rng;
+
+        static constexpr FlaggedInt<std::uint32_t> NULL_CHILD = { 0xFFFFFFFF };
+
+        static FlaggedInt<std::uint32_t> leaf(std::uint32_t index) {
+            return FlaggedInt<std::uint32_t> { index | FlaggedInt<std::uint32_t>::FLAG_BIT };
+        }
+
+        std::uint32_t add_plane(float i, float j, float k, float w) {
+            auto &plane = this->planes.emplace_back();
+            plane.plane.vector.i = i;
+            plane.plane.vector.j = j;
+            plane.plane.vector.k = k;
+            plane.plane.w = w;
+            return static_cast<std::uint32_t>(this->planes.size() - 1);
+        }
+
+        std::uint32_t add_node(std::uint32_t plane, FlaggedInt<std::uint32_t> back, FlaggedInt<std::uint32_t> front) {
+            auto &node = this->bsp3d_nodes.emplace_back();
+            node.plane = plane;
+            node.back_child = back;
+            node.front_child = front;
+            return static_cast<std::uint32_t>(this->bsp3d_nodes.size() - 1);
+        }
+
+        // Add a BSP2D tree splitting the cell into four surfaces
+        std::uint32_t add_bsp2d(float center_x, float center_y) {
+            auto add_2d_node = [this](float i, float j, float w, FlaggedInt<std::uint32_t> left, FlaggedInt<std::uint32_t> right) {
+                auto &node = this->bsp2d_nodes.emplace_back();
+                node.plane.vector.i = i;
+                node.plane.vector.j = j;
+                node.plane.w = w;
+                node.left_child = left;
+                node.right_child = right;
+                return static_cast<std::uint32_t>(this->bsp2d_nodes.size() - 1);
+            };
+
+            std::uint32_t s = this->surface_count;
+            this->surface_count += 4;
+            auto low = add_2d_node(0.0F, 1.0F, center_y, leaf(s + 0), leaf(s + 1));
+            auto high = add_2d_node(0.0F, 1.0F, center_y, leaf(s + 2), leaf(s + 3));
+            return add_2d_node(1.0F, 0.0F, center_x, FlaggedInt<std::uint32_t> { low }, FlaggedInt<std::uint32_t> { high });
+        }
+
+        std::uint32_t add_leaf(const std::vector<std::pair<std::uint32_t, std::uint32_t>> &references) {
+            auto &leaf = this->leaves.emplace_back();
+            leaf.bsp2d_reference_count = static_cast<std::uint16_t>(references.size());
+            leaf.first_bsp2d_reference = static_cast<std::uint32_t>(this->bsp2d_references.size());
+            for(auto &r : references) {
+                auto &reference = this->bsp2d_references.emplace_back();
+                reference.plane = FlaggedInt<std::uint32_t> { r.first };
+                reference.bsp2d_node = FlaggedInt<std::uint32_t> { r.second };
+            }
+            return static_cast<std::uint32_t>(this->leaves.size() - 1);
+        }
+
+        // Add a sloped floor plane passing through the given point
+        std::uint32_t add_floor(float x, float y, float z) {
+            std::uniform_real_distribution<float> slope(-0.3F, 0.3F);
+            float i = slope(this->rng), j = slope(this->rng), k = 1.0F;
+            float length = std::sqrt(i * i + j * j + k * k);
+            i /= length;
+            j /= length;
+            k /= length;
+            return this->add_plane(i, j, k, i * x + j * y + k * z);
+        }
+
+        std::uint32_t add_cell(float min_x, float min_y, float size) {
+            std::uniform_real_distribution<float> height(0.0F, 8.0F);
+            float center_x = min_x + size / 2.0F, center_y = min_y + size / 2.0F;
+            float lower = height(this->rng);
+            float upper = lower + 4.0F + height(this->rng);
+
+            auto lower_floor = this->add_floor(center_x, center_y, lower);
+            auto upper_floor = this->add_floor(center_x, center_y, upper);
+            auto lower_bsp2d = this->add_bsp2d(center_x, center_y);
+            auto upper_bsp2d = this->add_bsp2d(center_x, center_y);
+
+            auto above = this->add_leaf({{upper_floor, upper_bsp2d}});
+            auto between = this->add_leaf({{lower_floor, lower_bsp2d}, {upper_floor, upper_bsp2d}});
+            auto below = this->add_leaf({});
+
+            auto lower_node = this->add_node(lower_floor, leaf(below), leaf(between));
+            return this->add_node(upper_floor, FlaggedInt<std::uint32_t> { lower_node }, leaf(above));
+        }
+
+        // Split the region in half along alternating axes until we get down to cells
+        std::uint32_t add_region(float min_x, float min_y, std::size_t cells_x, std::size_t cells_y, float cell_size) {
+            if(cells_x == 1 && cells_y == 1) {
+                return this->add_cell(min_x, min_y, cell_size);
+            }
+
+            // Reserve the node first so parents come before their children like in tool-generated BSPs
+            auto node_index = this->add_node(0, NULL_CHILD, NULL_CHILD);
+            std::uint32_t plane, back, front;
+            if(cells_x >= cells_y) {
+                std::size_t half = cells_x / 2;
+                float split = min_x + half * cell_size;
+                plane = this->add_plane(1.0F, 0.0F, 0.0F, split);
+                back = this->add_region(min_x, min_y, half, cells_y, cell_size);
+                front = this->add_region(split, min_y, cells_x - half, cells_y, cell_size);
+            }
+            else {
+                std::size_t half = cells_y / 2;
+                float split = min_y + half * cell_size;
+                plane = this->add_plane(0.0F, 1.0F, 0.0F, split);
+                back = this->add_region(min_x, min_y, cells_x, half, cell_size);
+                front = this->add_region(min_x, split, cells_x, cells_y - half, cell_size);
+            }
+
+            auto &node = this->bsp3d_nodes[node_index];
+            node.plane = plane;
+            node.back_child = FlaggedInt<std::uint32_t> { back };
+            node.front_child = FlaggedInt<std::uint32_t> { front };
+            return node_index;
+        }
+
+        BSPData bsp_data() const {
+            BSPData data;
+            data.bsp3d_nodes = this->bsp3d_nodes.data();
+            data.bsp3d_node_count = static_cast<std::uint32_t>(this->bsp3d_nodes.size());
+            data.planes = this->planes.data();
+            data.plane_count = static_cast<std::uint32_t>(this->planes.size());
+            data.leaves = this->leaves.data();
+            data.leaf_count = static_cast<std::uint32_t>(this->leaves.size());
+            data.bsp2d_nodes = this->bsp2d_nodes.data();
+            data.bsp2d_node_count = static_cast<std::uint32_t>(this->bsp2d_nodes.size());
+            data.bsp2d_references = this->bsp2d_references.data();
+            data.bsp2d_reference_count = static_cast<std::uint32_t>(this->bsp2d_references.size());
+            data.surface_count = this->surface_count;
+            return data;
+        }
+    };
+
+    struct QueryResult {
+        bool found;
+        float x, y, z;
+        std::uint32_t surface_index;
+        std::uint32_t leaf_index;
+
+        bool operator==(const QueryResult &other) const noexcept {
+            return std::memcmp(this, &other, sizeof(*this)) == 0;
+        }
+    };
+}
+
+template <typename Function> static double time_milliseconds(std::size_t iterations, Function function) {
+    auto start = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < iterations; i++) {
+        function();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+int main() {
+    static constexpr std::size_t GRID_SIZE = 64;
+    static constexpr float CELL_SIZE = 16.0F;
+    static constexpr std::size_t QUERY_COUNT = 100000;
+    static constexpr std::size_t ITERATIONS = 10;
+
+    SyntheticBSP synthetic;
+    synthetic.rng.seed(0x42535021);
+    synthetic.add_region(0.0F, 0.0F, GRID_SIZE, GRID_SIZE, CELL_SIZE);
+
+    auto reference_bsp = synthetic.bsp_data();
+    auto prepared_bsp = reference_bsp;
+    prepared_bsp.prepare();
+    if(!prepared_bsp.prepared) {
+        eprintf_error("Failed to prepare the BSP");
+        return EXIT_FAILURE;
+    }
+
+    oprintf("BSP: %u BSP3D nodes, %u leaves, %u BSP2D references, %u BSP2D nodes\n", reference_bsp.bsp3d_node_count, reference_bsp.leaf_count, reference_bsp.bsp2d_reference_count, reference_bsp.bsp2d_node_count);
+
+    // Points anywhere in and slightly around the grid so some queries miss
+    std::mt19937 rng(0x51524945);
+    std::uniform_real_distribution<float> horizontal(-CELL_SIZE, GRID_SIZE * CELL_SIZE + CELL_SIZE);
+    std::uniform_real_distribution<float> vertical(-2.0F, 24.0F);
+    std::vector<Point3D<LittleEndian>> points(QUERY_COUNT);
+    for(auto &p : points) {
+        p.x = horizontal(rng);
+        p.y = horizontal(rng);
+        p.z = vertical(rng);
+    }
+
+    bool all_match = true;
+
+    oprintf("%-24s %12s %12s %8s\n", "query", "old (ms)", "new (ms)", "speedup");
+
+    auto benchmark = [&all_match](const char *name, auto query) {
+        std::vector<QueryResult> reference_output, new_output;
+        double reference_time = time_milliseconds(ITERATIONS, [&]() { reference_output = query(true); });
+        double new_time = time_milliseconds(ITERATIONS, [&]() { new_output = query(false); });
+        bool match = reference_output == new_output;
+        all_match = all_match && match;
+        oprintf("%-24s %12.4f %12.4f %7.2fx%s\n", name, reference_time, new_time, reference_time / new_time, match ? "" : " MISMATCH");
+    };
+
+    auto run_queries = [&](bool reference, auto query) {
+        auto &bsp = reference ? reference_bsp : prepared_bsp;
+        std::vector<QueryResult> results(points.size());
+        for(std::size_t p = 0; p < points.size(); p++) {
+            Point3D<LittleEndian> intersection = {};
+            auto &result = results[p];
+            std::memset(&result, 0, sizeof(result));
+            result.found = query(bsp, points[p], intersection, result.surface_index, result.leaf_index);
+            result.x = intersection.x;
+            result.y = intersection.y;
+            result.z = intersection.z;
+        }
+        return results;
+    };
+
+    benchmark("line segment", [&](bool reference) {
+        return run_queries(reference, [](const BSPData &bsp, const Point3D<LittleEndian> &point, Point3D<LittleEndian> &intersection, std::uint32_t &surface_index, std::uint32_t &leaf_index) {
+            auto below = point;
+            below.z = below.z - 16.0F;
+            return bsp.check_for_intersection(point, below, &intersection, &surface_index, &leaf_index);
+        });
+    });
+
+    benchmark("point (range 0.5)", [&](bool reference) {
+        return run_queries(reference, [](const BSPData &bsp, const Point3D<LittleEndian> &point, Point3D<LittleEndian> &intersection, std::uint32_t &surface_index, std::uint32_t &leaf_index) {
+            return bsp.check_for_intersection(point, 0.5F, &intersection, &surface_index, &leaf_index);
+        });
+    });
+
+    benchmark("point (range 32)", [&](bool reference) {
+        return run_queries(reference, [](const BSPData &bsp, const Point3D<LittleEndian> &point, Point3D<LittleEndian> &intersection, std::uint32_t &surface_index, std::uint32_t &leaf_index) {
+            return bsp.check_for_intersection(point, 32.0F, &intersection, &surface_index, &leaf_index);
+        });
+    });
+
+    benchmark("point inside BSP", [&](bool reference) {
+        return run_queries(reference, [](const BSPData &bsp, const Point3D<LittleEndian> &point, Point3D<LittleEndian> &, std::uint32_t &, std::uint32_t &leaf_index) {
+            return bsp.check_if_point_inside_bsp(point, &leaf_index);
+        });
+    });
+
+    return all_match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <invader/bitmap/swizzle.hpp>
+#include <invader/printf.hpp>
+
+// Benchmark the table-driven Morton swizzler against the recursive implementation it replaced. The reference
+// implementation is kept here verbatim so the output can also be checked for equality.
+
+namespace Reference {
+    template<typename Pixel> static std::size_t swizzle_block_2x2(const Pixel *values_in, Pixel *values_out, std::size_t stride, std::size_t counter, bool deswizzle) {
+        if(!deswizzle) {
+            values_out[counter++] = values_in[0];
+            values_out[counter++] = values_in[1];
+            values_out[counter++] = values_in[0 + stride];
+            values_out[counter++] = values_in[1 + stride];
+        }
+        else {
+            values_out[0] = values_in[counter++];
+            values_out[1] = values_in[counter++];
+            values_out[0 + stride] = values_in[counter++];
+            values_out[1 + stride] = values_in[counter++];
+        }
+        return counter;
+    }
+
+    template<typename Pixel> static std::size_t swizzle_block(const Pixel *values_in, Pixel *values_out, std::size_t width, std::size_t stride, std::size_t counter, bool deswizzle) {
+        if(width == 2) {
+            return swizzle_block_2x2(values_in, values_out, stride, counter, deswizzle);
+        }
+
+        std::size_t new_width = width / 2;
+
+        if(!deswizzle) {
+            counter = swizzle_block(values_in, values_out, new_width, stride, counter, deswizzle);
+            counter = swizzle_block(values_in + new_width, values_out, new_width, stride, counter, deswizzle);
+            counter = swizzle_block(values_in + stride * new_width, values_out, new_width, stride, counter, deswizzle);
+            counter = swizzle_block(values_in + stride * new_width + new_width, values_out, new_width, stride, counter, deswizzle);
+        }
+        else {
+            counter = swizzle_block(values_in, values_out, new_width, stride, counter, deswizzle);
+            counter = swizzle_block(values_in, values_out + new_width, new_width, stride, counter, deswizzle);
+            counter = swizzle_block(values_in, values_out + stride * new_width, new_width, stride, counter, deswizzle);
+            counter = swizzle_block(values_in, values_out + stride * new_width + new_width, new_width, stride, counter, deswizzle);
+        }
+
+        return counter;
+    }
+
+    template <typename Pixel> static void perform_swizzle_2d(const Pixel *values_in, Pixel *values_out, std::size_t width, std::size_t height, bool deswizzle) {
+        if(width <= 2 || height <= 1) {
+            std::memcpy(values_out, values_in, width * height * sizeof(*values_in));
+            return;
+        }
+
+        if(width < height) {
+            for(std::size_t y = 0; y < height; y += width) {
+                perform_swizzle_2d(values_in + y * width, values_out + y * width, width, width, deswizzle);
+            }
+            return;
+        }
+
+        std::size_t counter = 0;
+        for(std::size_t x = 0; x < width; x+=height) {
+            if(!deswizzle) {
+                counter = swizzle_block(values_in + x, values_out, height, width, counter, deswizzle);
+            }
+            else {
+                counter = swizzle_block(values_in, values_out + x, height, width, counter, deswizzle);
+            }
+        }
+    }
+
+    static constexpr std::uint64_t morton_encode_3d(unsigned int x, unsigned int y, unsigned int z) {
+        std::uint64_t answer = 0;
+        for (std::uint64_t i = 0; i < (sizeof(std::uint64_t) * 8)/3; ++i) {
+            std::uint64_t bit = static_cast<std::uint64_t>(1) << i;
+            answer |= ((x & bit) << 2*i) | ((y & bit) << (2*i + 1)) | ((z & bit) << (2*i + 2));
+        }
+        return answer;
+    }
+
+    template <typename Pixel> static void perform_swizzle_3d(const Pixel *values_in, Pixel *values_out, std::size_t width, std::size_t height, std::size_t depth, bool deswizzle) {
+        auto size = (width * height * depth);
+        for(std::size_t z = 0; z < depth; z++) {
+            for(std::size_t y = 0; y < height; y++) {
+                for(std::size_t x = 0; x < width; x++) {
+                    std::uint64_t m = morton_encode_3d(x,y,z) % size;
+                    auto offset = (x + y * width + z * width * height) % size;
+                    if(deswizzle) {
+                        values_out[offset] = values_in[m];
+                    }
+                    else {
+                        values_out[m] = values_in[offset];
+                    }
+                }
+            }
+        }
+    }
+
+    static std::vector<std::byte> swizzle(const std::byte *data, std::size_t width, std::size_t height, std::size_t depth, bool deswizzle) {
+        std::vector<std::byte> output(width * height * depth * sizeof(std::uint32_t));
+        auto *input_pixels = reinterpret_cast<const std::uint32_t *>(data);
+        auto *output_pixels = reinterpret_cast<std::uint32_t *>(output.data());
+        if(depth > 1) {
+            perform_swizzle_3d(input_pixels, output_pixels, width, height, depth, deswizzle);
+        }
+        else {
+            perform_swizzle_2d(input_pixels, output_pixels, width, height, deswizzle);
+        }
+        return output;
+    }
+}
+
+struct BenchmarkCase {
+    std::size_t width;
+    std::size_t height;
+    std::size_t depth;
+    std::size_t iterations;
+};
+
+template <typename Function> static double time_milliseconds(std::size_t iterations, Function function) {
+    auto start = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < iterations; i++) {
+        function();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+int main() {
+    static constexpr BenchmarkCase CASES[] = {
+        { 64, 64, 1, 2000 },
+        { 256, 64, 1, 500 },
+        { 64, 256, 1, 500 },
+        { 512, 512, 1, 50 },
+        { 2048, 2048, 1, 5 },
+        { 64, 64, 64, 10 },
+    };
+
+    std::mt19937 rng(0x1A2B3C4D);
+    bool all_match = true;
+
+    oprintf("%-14s %-10s %12s %12s %8s\n", "size", "direction", "old (ms)", "new (ms)", "speedup");
+
+    for(auto &c : CASES) {
+        std::vector<std::byte> input(c.width * c.height * c.depth * sizeof(std::uint32_t));
+        for(auto &b : input) {
+            b = static_cast<std::byte>(rng());
+        }
+
+        for(bool deswizzle : { false, true }) {
+            std::vector<std::byte> reference_output, new_output;
+            double reference_time = time_milliseconds(c.iterations, [&]() {
+                reference_output = Reference::swizzle(input.data(), c.width, c.height, c.depth, deswizzle);
+            });
+            double new_time = time_milliseconds(c.iterations, [&]() {
+                new_output = Invader::Swizzle::swizzle(input.data(), 32, c.width, c.height, c.depth, deswizzle);
+            });
+
+            bool match = reference_output == new_output;
+            all_match = all_match && match;
+
+            char size[32];
+            std::snprintf(size, sizeof(size), "%zux%zux%zu", c.width, c.height, c.depth);
+            oprintf("%-14s %-10s %12.4f %12.4f %7.2fx%s\n", size, deswizzle ? "deswizzle" : "swizzle", reference_time, new_time, reference_time / new_time, match ? "" : " MISMATCH");
+        }
+    }
+
+    return all_match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
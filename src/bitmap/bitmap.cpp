@@ -3,6 +3,7 @@
 #include <zlib.h>
 #include <filesystem>
 #include <optional>
+#include <algorithm>
 
 #include <invader/printf.hpp>
 #include <invader/version.hpp>
@@ -15,6 +16,11 @@
 #include "../command_line_option.hpp"
 #include <invader/file/file.hpp>
 #include <invader/tag/parser/parser.hpp>
+#include <invader/asset_cache/asset_cache.hpp>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
 
 enum SupportedFormatsInt {
     SUPPORTED_FORMATS_TIF = 0,
@@ -39,6 +45,36 @@ static_assert(sizeof(SUPPORTED_FORMATS) / sizeof(*SUPPORTED_FORMATS) == SUPPORTE
 using namespace Invader;
 using namespace Invader::HEK;
 
+// Time spent in each stage of making a bitmap, summed across every bitmap made (in microseconds)
+struct BitmapStageTimes {
+    enum Stage {
+        STAGE_LOAD,
+        STAGE_SCAN,
+        STAGE_MIPMAPS,
+        STAGE_COMPRESS,
+        STAGE_ENCODE,
+        STAGE_WRITE,
+
+        STAGE_COUNT
+    };
+
+    static constexpr const char *STAGE_NAMES[STAGE_COUNT] = {
+        "load",
+        "scan",
+        "mipmaps",
+        "compress",
+        "encode",
+        "write"
+    };
+
+    std::atomic<std::uint64_t> microseconds[STAGE_COUNT] = {};
+
+    void add(Stage stage, std::chrono::steady_clock::time_point start) noexcept {
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        this->microseconds[stage] += static_cast<std::uint64_t>(elapsed);
+    }
+};
+
 struct BitmapOptions {
     // Data directory
     std::filesystem::path data = "data";
@@ -102,8 +138,64 @@ struct BitmapOptions {
 
     // Regenerate?
     bool regenerate = false;
+
+    // Cache processed bitmap data here
+    std::optional<AssetCache> cache;
+
+    // Batch stuff
+    bool batch = false;
+    std::vector<std::string> search;
+    std::vector<std::string> search_exclude;
+    std::size_t max_threads = std::thread::hardware_concurrency() < 1 ? 1 : std::thread::hardware_concurrency();
+    std::optional<std::filesystem::path> tag_list;
+
+    // Record how long each stage took here, if set
+    BitmapStageTimes *stage_times = nullptr;
 };
 
+// Hash everything that affects the generated bitmap data. This must be called after the default values are set.
+static AssetCache::Key make_cache_key(const BitmapOptions &bitmap_options, SupportedFormatsInt image_format, const std::vector<std::byte> &image_data) {
+    AssetCache::Key key("bitmap");
+
+    key.add_value(bitmap_options.regenerate);
+    key.add_value(image_format);
+    key.add(image_data);
+
+    key.add_value(bitmap_options.allow_non_power_of_two);
+    key.add_value(bitmap_options.mipmap_scale_type);
+    key.add_value(bitmap_options.format);
+    key.add_value(bitmap_options.auto_format);
+    key.add_value(bitmap_options.usage);
+    key.add_value(bitmap_options.bump_height);
+    key.add_value(bitmap_options.palettize);
+    key.add_value(bitmap_options.mipmap_fade);
+    key.add_value(bitmap_options.bitmap_type);
+    key.add_value(bitmap_options.sprite_usage);
+    key.add_value(bitmap_options.sprite_budget);
+    key.add_value(bitmap_options.sprite_budget_count);
+    key.add_value(bitmap_options.sprite_spacing);
+    key.add_value(bitmap_options.force_square_sprite_sheets);
+    key.add_value(bitmap_options.dithering);
+    key.add_value(bitmap_options.sharpen);
+    key.add_value(bitmap_options.blur);
+    key.add_value(bitmap_options.alpha_bias);
+    key.add_value(bitmap_options.max_mipmap_count);
+    key.add_value(bitmap_options.filthy_sprite_bug_fix);
+
+    return key;
+}
+
+// Everything in the bitmap tag that's generated from the color plate
+template <typename T> static void copy_generated_bitmap_data(T &to, const T &from) {
+    to.color_plate_width = from.color_plate_width;
+    to.color_plate_height = from.color_plate_height;
+    to.compressed_color_plate_data = from.compressed_color_plate_data;
+    to.processed_pixel_data = from.processed_pixel_data;
+    to.bitmap_group_sequence = from.bitmap_group_sequence;
+    to.bitmap_data = from.bitmap_data;
+    to.encoding_format = from.encoding_format;
+}
+
 template <typename T> static int perform_the_ritual(const std::string &bitmap_tag, const std::filesystem::path &tag_path, const std::filesystem::path &final_path, BitmapOptions &bitmap_options, TagFourCC tag_fourcc) {
     // Let's begin
     std::filesystem::path data_path = bitmap_options.data;
@@ -120,15 +212,15 @@ template <typename T> static int perform_the_ritual(const std::string &bitmap_ta
         // These are available in the Rust implementation instead.
         if(bitmap_tag_data.flags & HEK::BitmapFlagsFlag::BITMAP_FLAGS_FLAG_INVERT_DETAIL_FADE) {
             eprintf_error("The \"invert detail fade\" option is not supported by this implementation of invader-bitmap");
-            std::exit(EXIT_FAILURE);
+            return EXIT_FAILURE;
         }
         if(bitmap_tag_data.flags & HEK::BitmapFlagsFlag::BITMAP_FLAGS_FLAG_USE_AVERAGE_COLOR_FOR_DETAIL_FADE) {
             eprintf_error("The \"use average color for detail fade\" option is not supported by this implementation of invader-bitmap");
-            std::exit(EXIT_FAILURE);
+            return EXIT_FAILURE;
         }
         if((bitmap_tag_data.encoding_format == HEK::BitmapFormat::BITMAP_FORMAT_BC7 && !bitmap_options.format.has_value()) || bitmap_options.format == HEK::BitmapFormat::BITMAP_FORMAT_BC7) {
             eprintf_error("BC7 bitmap encoding is not supported by this implementation of invader-bitmap");
-            std::exit(EXIT_FAILURE);
+            return EXIT_FAILURE;
         }
 
         // Set some default values
@@ -195,7 +287,7 @@ template <typename T> static int perform_the_ritual(const std::string &bitmap_ta
     }
     else if(bitmap_options.regenerate) {
         eprintf_error("Cannot regenerate. No bitmap tag exists at %s", final_path.string().c_str());
-        std::exit(EXIT_FAILURE);
+        return EXIT_FAILURE;
     }
 
     // If these values weren't set, set them
@@ -223,57 +315,137 @@ template <typename T> static int perform_the_ritual(const std::string &bitmap_ta
 
     #undef DEFAULT_VALUE
 
-    // Have these variables handy
-    std::uint32_t image_width = 0, image_height = 0;
-    std::size_t image_size = 0;
-    std::vector<Pixel> image_pixels;
+    // Find our color plate
+    std::string image_path;
+    SupportedFormatsInt image_format = SUPPORTED_FORMATS_INT_COUNT;
+    if(!bitmap_options.regenerate) {
+        // Try to figure out the extension
+        auto bitmap_data_path = (data_path / bitmap_tag).string();
+        for(auto i = static_cast<SupportedFormatsInt>(0); i < SUPPORTED_FORMATS_INT_COUNT; i = static_cast<SupportedFormatsInt>(i + 1)) {
+            image_path = bitmap_data_path + SUPPORTED_FORMATS[i];
+            if(std::filesystem::exists(image_path)) {
+                image_format = i;
+                break;
+            }
+        }
 
-    // If we're regenerating, our color plate data is in the tag
-    if(bitmap_options.regenerate) {
-        // Check to see if we have data
-        auto size = bitmap_tag_data.compressed_color_plate_data.size();
-        image_width = bitmap_tag_data.color_plate_width;
-        image_height = bitmap_tag_data.color_plate_height;
-        if(size < sizeof(std::uint32_t) || image_width == 0 || image_height == 0) {
-            eprintf_error("Cannot regenerate a bitmap that doesn't have color plate data.");
+        if(image_format == SUPPORTED_FORMATS_INT_COUNT) {
+            eprintf_error("Failed to find %s in %s", bitmap_tag.c_str(), bitmap_options.data.string().c_str());
+            eprintf("Valid formats are:\n");
+            for(auto *format : SUPPORTED_FORMATS) {
+                eprintf("    %s\n", format);
+            }
             return EXIT_FAILURE;
         }
+    }
 
-        // Get the size of the data we're going to decompress
-        auto *data = bitmap_tag_data.compressed_color_plate_data.data();
-        image_size = reinterpret_cast<HEK::BigEndian<std::uint32_t> *>(data)->read();
-        if((image_size % sizeof(Pixel)) != 0) {
-            eprintf_error("Cannot regenerate due the compressed color plate data size being wrong");
-            return EXIT_FAILURE;
+    // If we don't have a format, set it to null (it will determine it instead)
+    if(*bitmap_options.auto_format) {
+        bitmap_options.format = std::nullopt;
+    }
+
+    // Now let's add the actual bitmap data
+    #define BYTES_TO_MIB(bytes) (bytes / 1024.0F / 1024.0F)
+
+    auto print_total = [&bitmap_tag_data, &bitmap_options, &bitmap_tag](bool cached) {
+        // Use one call so lines don't get mixed up when making multiple bitmaps at once
+        if(bitmap_options.batch) {
+            oprintf("%s: %.03f MiB%s\n", bitmap_tag.c_str(), BYTES_TO_MIB(bitmap_tag_data.processed_pixel_data.size()), cached ? " (cached)" : "");
+        }
+        else {
+            oprintf("Total: %.03f MiB%s\n", BYTES_TO_MIB(bitmap_tag_data.processed_pixel_data.size()), cached ? " (cached)" : "");
         }
-        image_pixels = std::vector<Pixel>(image_size / sizeof(Pixel));
+    };
 
-        data += sizeof(std::uint32_t);
-        size -= sizeof(std::uint32_t);
+    // Check if we already made this bitmap data
+    std::optional<AssetCache::Key> cache_key;
+    if(bitmap_options.cache.has_value()) {
+        if(bitmap_options.regenerate) {
+            cache_key = make_cache_key(bitmap_options, image_format, bitmap_tag_data.compressed_color_plate_data);
+        }
+        else {
+            auto image_data = File::open_file(image_path);
+            if(!image_data.has_value()) {
+                return EXIT_FAILURE;
+            }
+            cache_key = make_cache_key(bitmap_options, image_format, *image_data);
+        }
 
-        z_stream inflate_stream;
-        inflate_stream.zalloc = Z_NULL;
-        inflate_stream.zfree = Z_NULL;
-        inflate_stream.opaque = Z_NULL;
-        inflate_stream.avail_out = image_size;
-        inflate_stream.next_out = reinterpret_cast<Bytef *>(image_pixels.data());
-        inflate_stream.avail_in = size;
-        inflate_stream.next_in = reinterpret_cast<Bytef *>(data);
+        auto cached = bitmap_options.cache->load(*cache_key);
+        if(cached.has_value()) {
+            try {
+                copy_generated_bitmap_data(bitmap_tag_data, T::parse_hek_tag_file(cached->data(), cached->size()));
+                bitmap_options.format = bitmap_tag_data.encoding_format;
+                print_total(true);
+            }
+            catch(std::exception &e) {
+                eprintf_warn("Ignoring unreadable cache entry for %s: %s", bitmap_tag.c_str(), e.what());
+                cached = std::nullopt;
+            }
+        }
 
-        // Do it
-        inflateInit(&inflate_stream);
-        inflate(&inflate_stream, Z_FINISH);
-        inflateEnd(&inflate_stream);
+        if(cached.has_value()) {
+            goto spaghetti_set_more_parameters;
+        }
     }
 
-    // Otherwise, find the file
-    else {
-        // Try to figure out the extension
-        auto bitmap_data_path = (data_path / bitmap_tag).string();
-        for(auto i = static_cast<SupportedFormatsInt>(0); i < SUPPORTED_FORMATS_INT_COUNT; i = static_cast<SupportedFormatsInt>(i + 1)) {
-            std::string image_path = bitmap_data_path + SUPPORTED_FORMATS[i];
-            if(std::filesystem::exists(image_path)) {
-                switch(i) {
+    {
+        // Time each stage if we're asked to
+        auto stage_start = std::chrono::steady_clock::now();
+        auto end_stage = [&bitmap_options, &stage_start](BitmapStageTimes::Stage stage) {
+            if(bitmap_options.stage_times != nullptr) {
+                bitmap_options.stage_times->add(stage, stage_start);
+            }
+            stage_start = std::chrono::steady_clock::now();
+        };
+
+        // Have these variables handy
+        std::uint32_t image_width = 0, image_height = 0;
+        std::size_t image_size = 0;
+        std::vector<Pixel> image_pixels;
+
+        // If we're regenerating, our color plate data is in the tag
+        if(bitmap_options.regenerate) {
+            // Check to see if we have data
+            auto size = bitmap_tag_data.compressed_color_plate_data.size();
+            image_width = bitmap_tag_data.color_plate_width;
+            image_height = bitmap_tag_data.color_plate_height;
+            if(size < sizeof(std::uint32_t) || image_width == 0 || image_height == 0) {
+                eprintf_error("Cannot regenerate a bitmap that doesn't have color plate data.");
+                return EXIT_FAILURE;
+            }
+
+            // Get the size of the data we're going to decompress
+            auto *data = bitmap_tag_data.compressed_color_plate_data.data();
+            image_size = reinterpret_cast<HEK::BigEndian<std::uint32_t> *>(data)->read();
+            if((image_size % sizeof(Pixel)) != 0) {
+                eprintf_error("Cannot regenerate due the compressed color plate data size being wrong");
+                return EXIT_FAILURE;
+            }
+            image_pixels = std::vector<Pixel>(image_size / sizeof(Pixel));
+
+            data += sizeof(std::uint32_t);
+            size -= sizeof(std::uint32_t);
+
+            z_stream inflate_stream;
+            inflate_stream.zalloc = Z_NULL;
+            inflate_stream.zfree = Z_NULL;
+            inflate_stream.opaque = Z_NULL;
+            inflate_stream.avail_out = image_size;
+            inflate_stream.next_out = reinterpret_cast<Bytef *>(image_pixels.data());
+            inflate_stream.avail_in = size;
+            inflate_stream.next_in = reinterpret_cast<Bytef *>(data);
+
+            // Do it
+            inflateInit(&inflate_stream);
+            inflate(&inflate_stream, Z_FINISH);
+            inflateEnd(&inflate_stream);
+        }
+
+        // Otherwise, load the file
+        else {
+            try {
+                switch(image_format) {
                     case SUPPORTED_FORMATS_TIF:
                     case SUPPORTED_FORMATS_TIFF:
                         image_pixels = load_tiff(image_path.c_str(), image_width, image_height, image_size);
@@ -287,143 +459,142 @@ template <typename T> static int perform_the_ritual(const std::string &bitmap_ta
                         std::terminate();
                         break;
                 }
-                break;
             }
-        }
-
-        if(image_pixels.empty()) {
-            eprintf_error("Failed to find %s in %s", bitmap_tag.c_str(), bitmap_options.data.string().c_str());
-            eprintf("Valid formats are:\n");
-            for(auto *format : SUPPORTED_FORMATS) {
-                eprintf("    %s\n", format);
+            catch(std::exception &) {
+                return EXIT_FAILURE;
             }
-            return EXIT_FAILURE;
         }
-    }
+        end_stage(BitmapStageTimes::STAGE_LOAD);
 
-    // Set up sprite parameters
-    std::optional<BitmapProcessorSpriteParameters> sprite_parameters;
-    if(bitmap_options.bitmap_type.value() == BitmapType::BITMAP_TYPE_SPRITES) {
-        sprite_parameters.emplace();
-        auto &p = sprite_parameters.value();
-        p.sprite_budget = bitmap_options.sprite_budget.value();
-        p.sprite_budget_count = bitmap_options.sprite_budget_count.value();
-        p.sprite_usage = bitmap_options.sprite_usage.value();
-        p.sprite_spacing = bitmap_options.sprite_spacing.value();
-        p.force_square_sprite_sheets = bitmap_options.force_square_sprite_sheets;
-    }
+        // Set up sprite parameters
+        std::optional<BitmapProcessorSpriteParameters> sprite_parameters;
+        if(bitmap_options.bitmap_type.value() == BitmapType::BITMAP_TYPE_SPRITES) {
+            sprite_parameters.emplace();
+            auto &p = sprite_parameters.value();
+            p.sprite_budget = bitmap_options.sprite_budget.value();
+            p.sprite_budget_count = bitmap_options.sprite_budget_count.value();
+            p.sprite_usage = bitmap_options.sprite_usage.value();
+            p.sprite_spacing = bitmap_options.sprite_spacing.value();
+            p.force_square_sprite_sheets = bitmap_options.force_square_sprite_sheets;
+        }
 
-    // Do it!
-    auto try_to_scan_color_plate = [&image_pixels, &image_width, &image_height, &bitmap_options, &sprite_parameters]() {
+        // Do it!
+        GeneratedBitmapData scanned_color_plate;
         try {
-            auto scanned_data = ColorPlateScanner::scan_color_plate(image_pixels.data(), image_width, image_height, bitmap_options.bitmap_type.value(), bitmap_options.usage.value(), *bitmap_options.filthy_sprite_bug_fix, bitmap_options.allow_non_power_of_two);
-            BitmapProcessor::process_bitmap_data(scanned_data, bitmap_options.bitmap_type.value(), bitmap_options.usage.value(), bitmap_options.bump_height.value(), sprite_parameters, bitmap_options.max_mipmap_count.value(), bitmap_options.mipmap_scale_type.value(), bitmap_options.usage == BitmapUsage::BITMAP_USAGE_DETAIL_MAP ? bitmap_options.mipmap_fade : std::nullopt, bitmap_options.sharpen, bitmap_options.blur, bitmap_options.alpha_bias);
-            return scanned_data;
+            scanned_color_plate = ColorPlateScanner::scan_color_plate(image_pixels.data(), image_width, image_height, bitmap_options.bitmap_type.value(), bitmap_options.usage.value(), *bitmap_options.filthy_sprite_bug_fix, bitmap_options.allow_non_power_of_two);
+            end_stage(BitmapStageTimes::STAGE_SCAN);
+            BitmapProcessor::process_bitmap_data(scanned_color_plate, bitmap_options.bitmap_type.value(), bitmap_options.usage.value(), bitmap_options.bump_height.value(), sprite_parameters, bitmap_options.max_mipmap_count.value(), bitmap_options.mipmap_scale_type.value(), bitmap_options.usage == BitmapUsage::BITMAP_USAGE_DETAIL_MAP ? bitmap_options.mipmap_fade : std::nullopt, bitmap_options.sharpen, bitmap_options.blur, bitmap_options.alpha_bias);
         }
         catch (std::exception &e) {
             eprintf_error("Failed to process the image: %s", e.what());
-            std::exit(1);
-        };
-    };
-
-    auto scanned_color_plate = try_to_scan_color_plate();
-
-    // Compress the original input blob
-    if(!bitmap_options.regenerate) {
-        if(image_width > static_cast<std::uint16_t>(INT16_MAX) || image_height > static_cast<std::uint16_t>(INT16_MAX)) {
-            eprintf_warn("Color plate dimensions exceed %zux%zu\nThe bitmap can still be made, but it cannot be regenerated.", static_cast<std::size_t>(INT16_MAX),  static_cast<std::size_t>(INT16_MAX));
-            bitmap_tag_data.color_plate_width = 0;
-            bitmap_tag_data.color_plate_height = 0;
+            return EXIT_FAILURE;
         }
-        else {
-            // Get ready
-            bitmap_tag_data.compressed_color_plate_data.clear();
-            std::vector<std::byte> compressed_data(image_size * 4);
-            BigEndian<std::uint32_t> decompressed_size;
-            decompressed_size = static_cast<std::uint32_t>(image_size);
-            bitmap_tag_data.color_plate_width = image_width;
-            bitmap_tag_data.color_plate_height = image_height;
-
-            // Set compressed size
-            bitmap_tag_data.compressed_color_plate_data.resize(sizeof(decompressed_size));
-            *reinterpret_cast<BigEndian<std::uint32_t> *>(bitmap_tag_data.compressed_color_plate_data.data()) = decompressed_size;
-
-            // Deflate color plate data
-            compressed_data.resize(image_size * 4);
-            z_stream deflate_stream;
-            deflate_stream.zalloc = Z_NULL;
-            deflate_stream.zfree = Z_NULL;
-            deflate_stream.opaque = Z_NULL;
-            deflate_stream.avail_in = image_size;
-            deflate_stream.next_in = const_cast<Bytef *>(reinterpret_cast<const Bytef *>(image_pixels.data()));
-            deflate_stream.avail_out = compressed_data.size();
-            deflate_stream.next_out = reinterpret_cast<Bytef *>(compressed_data.data());
-
-            // Do it
-            deflateInit(&deflate_stream, Z_BEST_COMPRESSION);
-            deflate(&deflate_stream, Z_FINISH);
-            deflateEnd(&deflate_stream);
-            bitmap_tag_data.compressed_color_plate_data.insert(bitmap_tag_data.compressed_color_plate_data.end(), compressed_data.data(), compressed_data.data() + deflate_stream.total_out);
+        end_stage(BitmapStageTimes::STAGE_MIPMAPS);
+
+        // Compress the original input blob
+        if(!bitmap_options.regenerate) {
+            if(image_width > static_cast<std::uint16_t>(INT16_MAX) || image_height > static_cast<std::uint16_t>(INT16_MAX)) {
+                eprintf_warn("Color plate dimensions exceed %zux%zu\nThe bitmap can still be made, but it cannot be regenerated.", static_cast<std::size_t>(INT16_MAX),  static_cast<std::size_t>(INT16_MAX));
+                bitmap_tag_data.color_plate_width = 0;
+                bitmap_tag_data.color_plate_height = 0;
+            }
+            else {
+                // Get ready
+                bitmap_tag_data.compressed_color_plate_data.clear();
+                BigEndian<std::uint32_t> decompressed_size;
+                decompressed_size = static_cast<std::uint32_t>(image_size);
+                bitmap_tag_data.color_plate_width = image_width;
+                bitmap_tag_data.color_plate_height = image_height;
+
+                // Set compressed size
+                bitmap_tag_data.compressed_color_plate_data.resize(sizeof(decompressed_size));
+                *reinterpret_cast<BigEndian<std::uint32_t> *>(bitmap_tag_data.compressed_color_plate_data.data()) = decompressed_size;
+
+                // Deflate color plate data
+                z_stream deflate_stream;
+                deflate_stream.zalloc = Z_NULL;
+                deflate_stream.zfree = Z_NULL;
+                deflate_stream.opaque = Z_NULL;
+                deflateInit(&deflate_stream, Z_BEST_COMPRESSION);
+
+                // Only allocate as much as deflate could possibly need (large color plates would otherwise need several times their size here)
+                std::vector<std::byte> compressed_data(deflateBound(&deflate_stream, image_size));
+                deflate_stream.avail_in = image_size;
+                deflate_stream.next_in = const_cast<Bytef *>(reinterpret_cast<const Bytef *>(image_pixels.data()));
+                deflate_stream.avail_out = compressed_data.size();
+                deflate_stream.next_out = reinterpret_cast<Bytef *>(compressed_data.data());
+
+                // Do it
+                deflate(&deflate_stream, Z_FINISH);
+                deflateEnd(&deflate_stream);
+                bitmap_tag_data.compressed_color_plate_data.insert(bitmap_tag_data.compressed_color_plate_data.end(), compressed_data.data(), compressed_data.data() + deflate_stream.total_out);
+            }
         }
-    }
 
-    // Now let's add the actual bitmap data
-    #define BYTES_TO_MIB(bytes) (bytes / 1024.0F / 1024.0F)
+        end_stage(BitmapStageTimes::STAGE_COMPRESS);
 
-    // Add our bitmap data
-    try {
-        // If we don't have a format, set it to null (it will determine it instead)
-        if(*bitmap_options.auto_format) {
-            bitmap_options.format = std::nullopt;
+        // Add our bitmap data
+        try {
+            write_bitmap_data(scanned_color_plate, bitmap_tag_data.processed_pixel_data, bitmap_tag_data.bitmap_data, bitmap_options.usage.value(), bitmap_options.format, bitmap_options.bitmap_type.value(), bitmap_options.palettize.value(), bitmap_options.dithering.value());
         }
+        catch (std::exception &e) {
+            eprintf_error("Failed to generate bitmap data: %s", e.what());
+            return EXIT_FAILURE;
+        }
+        end_stage(BitmapStageTimes::STAGE_ENCODE);
+        print_total(false);
 
-        write_bitmap_data(scanned_color_plate, bitmap_tag_data.processed_pixel_data, bitmap_tag_data.bitmap_data, bitmap_options.usage.value(), bitmap_options.format, bitmap_options.bitmap_type.value(), bitmap_options.palettize.value(), bitmap_options.dithering.value());
-    }
-    catch (std::exception &e) {
-        eprintf_error("Failed to generate bitmap data: %s", e.what());
-        std::exit(1);
-    }
-    oprintf("Total: %.03f MiB\n", BYTES_TO_MIB(bitmap_tag_data.processed_pixel_data.size()));
+        // Add all sequences
+        for(auto &sequence : scanned_color_plate.sequences) {
+            auto &bgs = bitmap_tag_data.bitmap_group_sequence.emplace_back();
 
-    // Add all sequences
-    for(auto &sequence : scanned_color_plate.sequences) {
-        auto &bgs = bitmap_tag_data.bitmap_group_sequence.emplace_back();
+            if(bitmap_options.bitmap_type.value() == BitmapType::BITMAP_TYPE_SPRITES) {
+                bgs.bitmap_count = sequence.sprites.size() == 1 ? 1 : 0;
+                bgs.first_bitmap_index = NULL_INDEX;
+            }
+            else {
+                bgs.bitmap_count = sequence.bitmap_count;
+                bgs.first_bitmap_index = sequence.first_bitmap;
+            }
 
-        if(bitmap_options.bitmap_type.value() == BitmapType::BITMAP_TYPE_SPRITES) {
-            bgs.bitmap_count = sequence.sprites.size() == 1 ? 1 : 0;
-            bgs.first_bitmap_index = NULL_INDEX;
-        }
-        else {
-            bgs.bitmap_count = sequence.bitmap_count;
-            bgs.first_bitmap_index = sequence.first_bitmap;
-        }
+            // Add the sprites in the sequence
+            for(auto &sprite : sequence.sprites) {
+                auto &bgss = bgs.sprites.emplace_back();
+                auto &bitmap = scanned_color_plate.bitmaps[sprite.bitmap_index];
+                bgss.bitmap_index = sprite.bitmap_index;
 
-        // Add the sprites in the sequence
-        for(auto &sprite : sequence.sprites) {
-            auto &bgss = bgs.sprites.emplace_back();
-            auto &bitmap = scanned_color_plate.bitmaps[sprite.bitmap_index];
-            bgss.bitmap_index = sprite.bitmap_index;
+                bgss.bottom = static_cast<float>(sprite.bottom) / bitmap.height;
+                bgss.top = static_cast<float>(sprite.top) / bitmap.height;
+                bgss.registration_point.y = static_cast<float>(sprite.registration_point_y) / bitmap.height;
 
-            bgss.bottom = static_cast<float>(sprite.bottom) / bitmap.height;
-            bgss.top = static_cast<float>(sprite.top) / bitmap.height;
-            bgss.registration_point.y = static_cast<float>(sprite.registration_point_y) / bitmap.height;
+                bgss.left = static_cast<float>(sprite.left) / bitmap.width;
+                bgss.right = static_cast<float>(sprite.right) / bitmap.width;
+                bgss.registration_point.x = static_cast<float>(sprite.registration_point_x) / bitmap.width;
 
-            bgss.left = static_cast<float>(sprite.left) / bitmap.width;
-            bgss.right = static_cast<float>(sprite.right) / bitmap.width;
-            bgss.registration_point.x = static_cast<float>(sprite.registration_point_x) / bitmap.width;
+                // Set the first bitmap index here
+                if(bgss.bitmap_index < bgs.first_bitmap_index) {
+                    bgs.first_bitmap_index = bgss.bitmap_index;
+                }
+            }
 
-            // Set the first bitmap index here
-            if(bgss.bitmap_index < bgs.first_bitmap_index) {
-                bgs.first_bitmap_index = bgss.bitmap_index;
+            // If we never set it, set it to 0
+            if(bgs.first_bitmap_index == NULL_INDEX) {
+                bgs.first_bitmap_index = 0;
             }
         }
 
-        // If we never set it, set it to 0
-        if(bgs.first_bitmap_index == NULL_INDEX) {
-            bgs.first_bitmap_index = 0;
+        // Save it for next time
+        if(cache_key.has_value()) {
+            T cache_entry = {};
+            bitmap_tag_data.encoding_format = bitmap_options.format.value();
+            copy_generated_bitmap_data(cache_entry, bitmap_tag_data);
+            if(!bitmap_options.cache->store(*cache_key, cache_entry.generate_hek_tag_data(TagFourCC::TAG_FOURCC_BITMAP))) {
+                eprintf_warn("Failed to cache the bitmap data for %s", bitmap_tag.c_str());
+            }
         }
     }
 
+    spaghetti_set_more_parameters:
     // Set more parameters
     bitmap_tag_data.type = bitmap_options.bitmap_type.value();
     bitmap_tag_data.usage = bitmap_options.usage.value();
@@ -474,6 +645,7 @@ template <typename T> static int perform_the_ritual(const std::string &bitmap_ta
     }
 
     // Write it all
+    auto write_start = std::chrono::steady_clock::now();
     std::error_code ec;
     std::filesystem::create_directories(tag_path.parent_path(), ec);
 
@@ -482,9 +654,146 @@ template <typename T> static int perform_the_ritual(const std::string &bitmap_ta
         return EXIT_FAILURE;
     }
 
+    if(bitmap_options.stage_times != nullptr) {
+        bitmap_options.stage_times->add(BitmapStageTimes::STAGE_WRITE, write_start);
+    }
+
     return EXIT_SUCCESS;
 }
 
+static std::optional<std::vector<std::string>> find_bitmap_tags_in_data(const BitmapOptions &bitmap_options) {
+    // Find every color plate in the data directory
+    std::vector<std::string> bitmap_tags;
+    File::PathMatcher matcher(bitmap_options.search, bitmap_options.search_exclude);
+    try {
+        for(auto &i : std::filesystem::recursive_directory_iterator(bitmap_options.data)) {
+            if(!i.is_regular_file()) {
+                continue;
+            }
+
+            auto extension = i.path().extension().string();
+            for(auto *format : SUPPORTED_FORMATS) {
+                if(extension == format) {
+                    auto bitmap_tag = i.path().lexically_relative(bitmap_options.data).replace_extension().string();
+                    if(matcher.matches(bitmap_tag.c_str())) {
+                        bitmap_tags.emplace_back(std::move(bitmap_tag));
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    catch(std::exception &e) {
+        eprintf_error("Error listing %s: %s", bitmap_options.data.string().c_str(), e.what());
+        return std::nullopt;
+    }
+    return bitmap_tags;
+}
+
+// Get the size of whatever we're making the bitmap from, or 0 if it can't be found (it'll fail later anyway)
+static std::uintmax_t source_size(const BitmapOptions &bitmap_options, const std::string &bitmap_tag) {
+    std::error_code ec;
+    if(bitmap_options.regenerate) {
+        auto size = std::filesystem::file_size(std::filesystem::path(bitmap_options.tags / bitmap_tag) += ".bitmap", ec);
+        return ec ? 0 : size;
+    }
+
+    auto bitmap_data_path = (bitmap_options.data / bitmap_tag).string();
+    for(auto *format : SUPPORTED_FORMATS) {
+        auto size = std::filesystem::file_size(bitmap_data_path + format, ec);
+        if(!ec) {
+            return size;
+        }
+    }
+    return 0;
+}
+
+static int perform_the_batch_ritual(BitmapOptions &bitmap_options, std::vector<std::string> bitmap_tags) {
+    auto batch_start = std::chrono::steady_clock::now();
+
+    // If there's more than one color plate with the same name but a different extension, only make it once
+    std::sort(bitmap_tags.begin(), bitmap_tags.end());
+    bitmap_tags.erase(std::unique(bitmap_tags.begin(), bitmap_tags.end()), bitmap_tags.end());
+
+    // Start with the biggest color plates so one big bitmap isn't left running by itself at the end
+    std::vector<std::pair<std::uintmax_t, std::string>> queue;
+    queue.reserve(bitmap_tags.size());
+    for(auto &bitmap_tag : bitmap_tags) {
+        queue.emplace_back(source_size(bitmap_options, bitmap_tag), std::move(bitmap_tag));
+    }
+    std::stable_sort(queue.begin(), queue.end(), [](auto &a, auto &b) { return a.first > b.first; });
+
+    BitmapStageTimes stage_times;
+    bitmap_options.stage_times = &stage_times;
+
+    std::mutex thread_mutex;
+    std::vector<std::thread> threads;
+    std::size_t bitmap_index = 0;
+    std::size_t success = 0;
+    std::size_t thread_count = std::min(bitmap_options.max_threads, queue.size());
+    threads.reserve(thread_count);
+
+    auto bitmap_worker = [](auto *queue, std::size_t *bitmap_index, std::mutex *thread_mutex, std::size_t *success, const BitmapOptions *bitmap_options) {
+        while(true) {
+            thread_mutex->lock();
+            std::size_t this_index = *bitmap_index;
+            if(this_index == queue->size()) {
+                thread_mutex->unlock();
+                return;
+            }
+            (*bitmap_index)++;
+            thread_mutex->unlock();
+
+            // Each bitmap gets its own options since they get filled in from the tag
+            auto &bitmap_tag = (*queue)[this_index].second;
+            auto options = *bitmap_options;
+            auto tag_path = options.tags / bitmap_tag;
+            auto final_path_bitmap = std::filesystem::path(tag_path) += ".bitmap";
+
+            int result;
+            try {
+                result = perform_the_ritual<Invader::Parser::Bitmap>(bitmap_tag, tag_path, final_path_bitmap, options, TagFourCC::TAG_FOURCC_BITMAP);
+            }
+            catch(std::exception &e) {
+                eprintf_error("Failed to make %s: %s", bitmap_tag.c_str(), e.what());
+                result = EXIT_FAILURE;
+            }
+
+            if(result != EXIT_SUCCESS) {
+                eprintf_error("Failed to make %s", bitmap_tag.c_str());
+            }
+
+            // Increment
+            thread_mutex->lock();
+            (*success) += result == EXIT_SUCCESS;
+            thread_mutex->unlock();
+        }
+    };
+
+    // Go through each bitmap
+    for(std::size_t i = 0; i < thread_count; i++) {
+        threads.emplace_back(bitmap_worker, &queue, &bitmap_index, &thread_mutex, &success, &bitmap_options);
+    }
+
+    // Wait for all threads to end
+    for(auto &i : threads) {
+        i.join();
+    }
+
+    bitmap_options.stage_times = nullptr;
+
+    oprintf("Made %zu out of %zu bitmap%s\n", success, queue.size(), queue.size() == 1 ? "" : "s");
+
+    // Show where the time went
+    oprintf("Time spent in each stage (summed across %zu thread%s):\n", thread_count, thread_count == 1 ? "" : "s");
+    for(std::size_t s = 0; s < BitmapStageTimes::STAGE_COUNT; s++) {
+        oprintf("    %-10s %10.03f s\n", BitmapStageTimes::STAGE_NAMES[s], stage_times.microseconds[s].load() / 1000000.0);
+    }
+    oprintf("Finished in %.03f s\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - batch_start).count());
+
+    return success == queue.size() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int main(int argc, char *argv[]) {
     set_up_color_term();
 
@@ -495,6 +804,11 @@ int main(int argc, char *argv[]) {
         CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_TAGS),
         CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_DATA),
         CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_FS_PATH),
+        CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_BATCH),
+        CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_BATCH_EXCLUDE),
+        CommandLineOption("threads", 'j', 1, "Set the number of threads to use when making more than one bitmap. Default: CPU thread count", "<count>"),
+        CommandLineOption("tag-list", 'L', 1, "Make every bitmap tag listed in the given file (one per line) in addition to any given as arguments.", "<file>"),
+        CommandLineOption("cache", 'c', 1, "Cache generated bitmap data in the given directory, reusing it if the color plate and bitmap settings are unchanged.", "<dir>"),
         CommandLineOption("ignore-tag", 'I', 0, "Ignore the tag data if the tag exists."),
         CommandLineOption("dithering", 'D', 1, "Apply dithering to 16-bit or p8 bitmaps. Can be: off or on. Default (new tag): off", "<val>"),
         CommandLineOption("format", 'F', 1, "Pixel format. Can be: 32-bit, 16-bit, monochrome, dxt5, dxt3, dxt1, or auto. 'auto' will be replaced with the best lossless format. Default (new tag): auto", "<type>"),
@@ -515,10 +829,10 @@ int main(int argc, char *argv[]) {
     };
 
     static constexpr char DESCRIPTION[] = "Create or modify a bitmap tag.";
-    static constexpr char USAGE[] = "[options] <bitmap-tag>";
+    static constexpr char USAGE[] = "[options] <-b [expr] | -L <file> | <bitmap-tag> [bitmap-tag ...]>";
 
     // Go through each argument
-    auto remaining_arguments = CommandLineOption::parse_arguments<BitmapOptions &>(argc, argv, options, USAGE, DESCRIPTION, 1, 1, bitmap_options, [](char opt, const std::vector<const char *> &arguments, auto &bitmap_options) {
+    auto remaining_arguments = CommandLineOption::parse_arguments<BitmapOptions &>(argc, argv, options, USAGE, DESCRIPTION, 0, 65535, bitmap_options, [](char opt, const std::vector<const char *> &arguments, auto &bitmap_options) {
         switch(opt) {
             case 'd':
                 bitmap_options.data = arguments[0];
@@ -688,32 +1002,119 @@ int main(int argc, char *argv[]) {
             case 'P':
                 bitmap_options.filesystem_path = true;
                 break;
+
+            case 'b':
+                bitmap_options.search.emplace_back(File::preferred_path_to_halo_path(arguments[0]));
+                break;
+
+            case 'e':
+                bitmap_options.search_exclude.emplace_back(File::preferred_path_to_halo_path(arguments[0]));
+                break;
+
+            case 'c':
+                bitmap_options.cache.emplace(arguments[0]);
+                break;
+
+            case 'L':
+                bitmap_options.tag_list = arguments[0];
+                break;
+
+            case 'j':
+                try {
+                    bitmap_options.max_threads = std::stoi(arguments[0]);
+                    if(bitmap_options.max_threads < 1) {
+                        throw std::exception();
+                    }
+                }
+                catch(std::exception &) {
+                    eprintf_error("Invalid number of threads %s\n", arguments[0]);
+                    std::exit(EXIT_FAILURE);
+                }
+                break;
         }
     });
 
-    // Resolve the bitmap tag
-    std::string bitmap_tag;
-    if(bitmap_options.filesystem_path) {
-        auto bitmap_tag_maybe = File::file_path_to_tag_path(remaining_arguments[0], bitmap_options.tags);
-        if(bitmap_tag_maybe.has_value() && std::filesystem::exists(remaining_arguments[0])) {
-            bitmap_tag = std::filesystem::path(*bitmap_tag_maybe).replace_extension().string();
+    // Check if the tags directory exists
+    if(!std::filesystem::is_directory(bitmap_options.tags)) {
+        eprintf_error("Directory %s was not found or is not a directory", bitmap_options.tags.string().c_str());
+        return EXIT_FAILURE;
+    }
+
+    // Make all matching bitmaps in the data directory?
+    if(!bitmap_options.search.empty() || !bitmap_options.search_exclude.empty()) {
+        if(!remaining_arguments.empty() || bitmap_options.tag_list.has_value()) {
+            eprintf_error("Can't use an extra tag path or --tag-list with -b. Use -h for more information.");
+            return EXIT_FAILURE;
         }
-        else {
-            eprintf_error("Failed to find a valid bitmap %s in the tags directory.", remaining_arguments[0]);
+        if(bitmap_options.regenerate || bitmap_options.filesystem_path) {
+            eprintf_error("Can't use --regenerate or --fs-path with -b. Use -h for more information.");
             return EXIT_FAILURE;
         }
+
+        auto bitmap_tags = find_bitmap_tags_in_data(bitmap_options);
+        if(!bitmap_tags.has_value()) {
+            return EXIT_FAILURE;
+        }
+
+        bitmap_options.batch = true;
+        return perform_the_batch_ritual(bitmap_options, std::move(*bitmap_tags));
     }
 
-    else {
-        bitmap_tag = remaining_arguments[0];
+    // Otherwise, get the bitmap tags we were given
+    std::vector<std::string> bitmap_tags;
+    if(bitmap_options.tag_list.has_value()) {
+        auto tag_list = File::open_file(*bitmap_options.tag_list);
+        if(!tag_list.has_value()) {
+            eprintf_error("Failed to open %s", bitmap_options.tag_list->string().c_str());
+            return EXIT_FAILURE;
+        }
+
+        // One tag per line; skip blank lines
+        std::string line;
+        for(auto b : *tag_list) {
+            auto c = static_cast<char>(b);
+            if(c == '\n' || c == '\r') {
+                if(!line.empty()) {
+                    bitmap_tags.emplace_back(std::move(line));
+                    line.clear();
+                }
+            }
+            else {
+                line += c;
+            }
+        }
+        if(!line.empty()) {
+            bitmap_tags.emplace_back(std::move(line));
+        }
     }
+    bitmap_tags.insert(bitmap_tags.end(), remaining_arguments.begin(), remaining_arguments.end());
 
-    // Check if the tags directory exists
-    if(!std::filesystem::is_directory(bitmap_options.tags)) {
-        eprintf_error("Directory %s was not found or is not a directory", bitmap_options.tags.string().c_str());
+    if(bitmap_tags.empty()) {
+        eprintf_error("A bitmap tag path was expected. Use -h for more information.");
         return EXIT_FAILURE;
     }
 
+    // Resolve the bitmap tags
+    if(bitmap_options.filesystem_path) {
+        for(auto &bitmap_tag : bitmap_tags) {
+            auto bitmap_tag_maybe = File::file_path_to_tag_path(bitmap_tag, bitmap_options.tags);
+            if(bitmap_tag_maybe.has_value() && std::filesystem::exists(bitmap_tag)) {
+                bitmap_tag = std::filesystem::path(*bitmap_tag_maybe).replace_extension().string();
+            }
+            else {
+                eprintf_error("Failed to find a valid bitmap %s in the tags directory.", bitmap_tag.c_str());
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    // More than one? Make them all at once
+    if(bitmap_tags.size() > 1 || bitmap_options.tag_list.has_value()) {
+        bitmap_options.batch = true;
+        return perform_the_batch_ritual(bitmap_options, std::move(bitmap_tags));
+    }
+
+    auto &bitmap_tag = bitmap_tags[0];
     auto tag_path = bitmap_options.tags / bitmap_tag;
     auto final_path_bitmap = std::filesystem::path(tag_path) += ".bitmap";
     return perform_the_ritual<Invader::Parser::Bitmap>(bitmap_tag, tag_path, final_path_bitmap, bitmap_options, TagFourCC::TAG_FOURCC_BITMAP);
@@ -99,7 +99,6 @@ namespace Invader {
             // Get the data
             std::vector<std::byte> current_bitmap_pixels(reinterpret_cast<const std::byte *>(bitmap_color_plate.pixels.data()), reinterpret_cast<const std::byte *>(bitmap_color_plate.pixels.data() + bitmap_color_plate.pixels.size()));
             auto *first_pixel = reinterpret_cast<Pixel *>(current_bitmap_pixels.data());
-            bitmap.format = BitmapEncode::most_efficient_format(current_bitmap_pixels.data(), bitmap.width, bitmap.height, bitmap.depth, *format, bitmap.type, mipmap_count);
 
             // Set the format
             bool compressed = (format == BitmapFormat::BITMAP_FORMAT_DXT1 || format == BitmapFormat::BITMAP_FORMAT_DXT3 || format == BitmapFormat::BITMAP_FORMAT_DXT5);
@@ -111,7 +110,6 @@ namespace Invader {
             bool should_p8 = (usage == BitmapUsage::BITMAP_USAGE_HEIGHT_MAP || usage == BitmapUsage::BITMAP_USAGE_VECTOR_MAP) && palettize;
             if(should_p8) {
                 compressed = false;
-                bitmap.format = BitmapDataFormat::BITMAP_DATA_FORMAT_P8_BUMP;
             }
 
             // Warn on 1-bit alpha being memed away
@@ -128,7 +126,16 @@ namespace Invader {
 
             // Go through each mipmap; compress
             bitmap.mipmap_count = mipmap_count;
-            auto encoded_pixels = BitmapEncode::encode_bitmap(reinterpret_cast<const std::byte *>(first_pixel), BitmapDataFormat::BITMAP_DATA_FORMAT_A8R8G8B8, bitmap.format, bitmap.width, bitmap.height, bitmap.depth, bitmap.type, bitmap.mipmap_count, dither);
+            std::vector<std::byte> encoded_pixels;
+            if(should_p8) {
+                bitmap.format = BitmapDataFormat::BITMAP_DATA_FORMAT_P8_BUMP;
+                encoded_pixels = BitmapEncode::encode_bitmap(reinterpret_cast<const std::byte *>(first_pixel), BitmapDataFormat::BITMAP_DATA_FORMAT_A8R8G8B8, bitmap.format, bitmap.width, bitmap.height, bitmap.depth, bitmap.type, bitmap.mipmap_count, dither);
+            }
+            else {
+                BitmapDataFormat chosen_format;
+                encoded_pixels = BitmapEncode::encode_bitmap_most_efficient(reinterpret_cast<const std::byte *>(first_pixel), *format, chosen_format, bitmap.width, bitmap.height, bitmap.depth, bitmap.type, bitmap.mipmap_count, dither);
+                bitmap.format = chosen_format;
+            }
             bitmap_data_pixels.insert(bitmap_data_pixels.end(), encoded_pixels.begin(), encoded_pixels.end());
 
             BitmapDataFlags flags = {};
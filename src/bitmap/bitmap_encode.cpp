@@ -3,83 +3,90 @@
 #include <invader/bitmap/bitmap_encode.hpp>
 #include <invader/tag/hek/class/bitmap.hpp>
 #include <invader/bitmap/pixel.hpp>
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <squish.h>
 
 #include "bcdec/bcdec.h"
 
+namespace Invader {
+    // Defined in the generated p8_palette.cpp
+    void rg_convert_to_p8(const std::uint8_t *bgra, std::uint8_t *p8, std::size_t pixel_count);
+}
+
 namespace Invader::BitmapEncode {
     static std::vector<Pixel> decode_to_32_bit(const std::byte *input_data, HEK::BitmapDataFormat input_format, std::size_t width, std::size_t height);
 
-    static void encode_bitmap(Pixel *input_data, std::byte *output_data, HEK::BitmapDataFormat output_format, std::size_t width, std::size_t height, bool dither) {
-        auto pixel_count = width * height;
-        auto first_pixel = input_data;
-        auto last_pixel = first_pixel + width * height;
-
-        // Do dithering based on https://en.wikipedia.org/wiki/Floyd–Steinberg_dithering
-        auto dither_do = [&dither](auto to_palette_fn, auto from_palette_fn, auto *from_pixels, auto *to_pixels, std::uint32_t width, std::uint32_t height) {
-            for(std::uint32_t y = 0; y < height; y++) {
-                for(std::uint32_t x = 0; x < width; x++) {
-                    // Get our pixels
-                    auto &pixel = from_pixels[x + y * width];
-                    auto &pixel_output = to_pixels[x + y * width];
-
-                    // Convert
-                    pixel_output = (pixel.*to_palette_fn)();
-
-                    // Get the error
-                    Pixel p8_return = from_palette_fn(pixel_output);
-                    float alpha_error = static_cast<std::int16_t>(pixel.alpha) - p8_return.alpha;
-                    float red_error = static_cast<std::int16_t>(pixel.red) - p8_return.red;
-                    float green_error = static_cast<std::int16_t>(pixel.green) - p8_return.green;
-                    float blue_error = static_cast<std::int16_t>(pixel.blue) - p8_return.blue;
-
-                    if(x > 0 && x < width - 1 && y < height - 1) {
-                        // Apply the error
-                        #define APPLY_ERROR(pixel, channel, error, multiply) {\
-                            float delta = (error * multiply / 16);\
-                            std::int16_t value = static_cast<std::int16_t>(pixel.channel) + delta;\
-                            if(value < 0) {\
-                                value = 0;\
-                            }\
-                            else if(value > UINT8_MAX) {\
-                                value = UINT8_MAX;\
-                            }\
-                            pixel.channel = static_cast<std::uint8_t>(value);\
-                        }
+    // Conversion kernels. These take whole runs of pixels and call the inlined Pixel conversions directly (rather than
+    // going through function pointers one pixel at a time) so the compiler can vectorize each loop.
+    template <typename Output, typename Conversion> static void convert_pixels(const Pixel *input, Output *output, std::size_t pixel_count, Conversion conversion) noexcept {
+        for(std::size_t i = 0; i < pixel_count; i++) {
+            output[i] = conversion(input[i]);
+        }
+    }
 
-                        auto &pixel_right = from_pixels[x + y * width + 1];
-                        auto &pixel_below_left = from_pixels[x + (y + 1) * width - 1];
-                        auto &pixel_below_middle = from_pixels[x + (y + 1) * width];
-                        auto &pixel_below_right = from_pixels[x + (y + 1) * width + 1];
-
-                        if(dither) {
-                            APPLY_ERROR(pixel_right, alpha, alpha_error, 7);
-                            APPLY_ERROR(pixel_below_left, alpha, alpha_error, 3);
-                            APPLY_ERROR(pixel_below_middle, alpha, alpha_error, 5);
-                            APPLY_ERROR(pixel_below_right, alpha, alpha_error, 1);
-
-                            APPLY_ERROR(pixel_right, red, red_error, 7);
-                            APPLY_ERROR(pixel_below_left, red, red_error, 3);
-                            APPLY_ERROR(pixel_below_middle, red, red_error, 5);
-                            APPLY_ERROR(pixel_below_right, red, red_error, 1);
-
-                            APPLY_ERROR(pixel_right, green, green_error, 7);
-                            APPLY_ERROR(pixel_below_left, green, green_error, 3);
-                            APPLY_ERROR(pixel_below_middle, green, green_error, 5);
-                            APPLY_ERROR(pixel_below_right, green, green_error, 1);
-
-                            APPLY_ERROR(pixel_right, blue, blue_error, 7);
-                            APPLY_ERROR(pixel_below_left, blue, blue_error, 3);
-                            APPLY_ERROR(pixel_below_middle, blue, blue_error, 5);
-                            APPLY_ERROR(pixel_below_right, blue, blue_error, 1);
-                        }
+    // Do dithering based on https://en.wikipedia.org/wiki/Floyd–Steinberg_dithering
+    template <typename Output, typename ToPalette, typename FromPalette> static void dither_pixels(Pixel *from_pixels, Output *to_pixels, std::size_t width, std::size_t height, ToPalette to_palette, FromPalette from_palette) noexcept {
+        auto apply_error = [](Pixel &pixel, const int (&error)[4], int multiply) {
+            // Equivalent to truncating channel + error * multiply / 16 since anything below zero gets clamped anyway
+            auto apply_to_channel = [&multiply](std::uint8_t &channel, int error) {
+                channel = static_cast<std::uint8_t>(std::clamp(channel + ((error * multiply) >> 4), 0, UINT8_MAX));
+            };
+            apply_to_channel(pixel.alpha, error[0]);
+            apply_to_channel(pixel.red, error[1]);
+            apply_to_channel(pixel.green, error[2]);
+            apply_to_channel(pixel.blue, error[3]);
+        };
 
-                        #undef APPLY_ERROR
-                    }
+        for(std::size_t y = 0; y < height; y++) {
+            auto *row = from_pixels + y * width;
+            auto *row_below = row + width;
+            auto *row_output = to_pixels + y * width;
+            bool diffuse_row = y + 1 < height;
+
+            for(std::size_t x = 0; x < width; x++) {
+                // Convert
+                auto &pixel = row[x];
+                auto converted = to_palette(pixel);
+                row_output[x] = converted;
+
+                if(!diffuse_row || x == 0 || x + 1 >= width) {
+                    continue;
                 }
+
+                // Get the error and spread it out
+                Pixel palette_pixel = from_palette(converted);
+                int error[4] = {
+                    pixel.alpha - palette_pixel.alpha,
+                    pixel.red - palette_pixel.red,
+                    pixel.green - palette_pixel.green,
+                    pixel.blue - palette_pixel.blue
+                };
+
+                apply_error(row[x + 1], error, 7);
+                apply_error(row_below[x - 1], error, 3);
+                apply_error(row_below[x], error, 5);
+                apply_error(row_below[x + 1], error, 1);
             }
-        };
+        }
+    }
+
+    template<std::uint8_t alpha, std::uint8_t red, std::uint8_t green, std::uint8_t blue> static void encode_16_bit(Pixel *input_data, std::byte *output_data, std::size_t width, std::size_t height, bool dither) noexcept {
+        auto *pixel_16_bit = reinterpret_cast<HEK::LittleEndian<std::uint16_t> *>(output_data);
+        auto to_16_bit = [](const Pixel &pixel) { return pixel.convert_to_16_bit<alpha, red, green, blue>(); };
+
+        if(dither) {
+            dither_pixels(input_data, pixel_16_bit, width, height, to_16_bit, Pixel::convert_from_16_bit<alpha, red, green, blue>);
+        }
+        else {
+            convert_pixels(input_data, pixel_16_bit, width * height, to_16_bit);
+        }
+    }
+
+    static void encode_bitmap(Pixel *input_data, std::byte *output_data, HEK::BitmapDataFormat output_format, std::size_t width, std::size_t height, bool dither) {
+        auto pixel_count = width * height;
+        auto first_pixel = input_data;
 
         switch(output_format) {
             // Straight copy
@@ -88,92 +95,42 @@ namespace Invader::BitmapEncode {
                 return;
 
             // Copy, but then set alpha to 0xFF
-            case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_X8R8G8B8: {
-                std::memcpy(output_data, first_pixel, pixel_count * sizeof(Pixel));
-                auto *start = reinterpret_cast<Pixel *>(output_data);
-                auto *end = reinterpret_cast<Pixel *>(output_data + pixel_count);
-                for(auto *i = start; i < end; i++) {
-                    i->alpha = 0xFF;
-                }
+            case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_X8R8G8B8:
+                convert_pixels(first_pixel, reinterpret_cast<Pixel *>(output_data), pixel_count, [](const Pixel &pixel) { return Pixel { pixel.blue, pixel.green, pixel.red, 0xFF }; });
                 return;
-            }
 
             // If it's 16-bit, there is stuff we will need to do
             case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_A1R5G5B5:
+                encode_16_bit<1,5,5,5>(input_data, output_data, width, height, dither);
+                return;
             case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_A4R4G4B4:
-            case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_R5G6B5: {
-                // Figure out what we'll be doing
-                std::uint16_t (Pixel::*conversion_function)() const;
-                Pixel (*deconversion_function)(std::uint16_t);
-
-                switch(output_format) {
-                    case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_A1R5G5B5:
-                        conversion_function = &Pixel::convert_to_16_bit<1,5,5,5>;
-                        deconversion_function = Pixel::convert_from_16_bit<1,5,5,5>;
-                        break;
-                    case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_A4R4G4B4:
-                        conversion_function = &Pixel::convert_to_16_bit<4,4,4,4>;
-                        deconversion_function = Pixel::convert_from_16_bit<4,4,4,4>;
-                        break;
-                    case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_R5G6B5:
-                        conversion_function = &Pixel::convert_to_16_bit<0,5,6,5>;
-                        deconversion_function = Pixel::convert_from_16_bit<0,5,6,5>;
-                        break;
-                    default:
-                        std::terminate();
-                        break;
-                }
-
-                // Begin
-                if(dither) {
-                    dither_do(conversion_function, deconversion_function, input_data, reinterpret_cast<HEK::LittleEndian<std::int16_t> *>(output_data), width, height);
-                }
-                else {
-                    auto *pixel_16_bit = reinterpret_cast<HEK::LittleEndian<std::int16_t> *>(output_data);
-
-                    for(const Pixel *pixel_32_bit = first_pixel; pixel_32_bit < last_pixel; pixel_32_bit++, pixel_16_bit++) {
-                        *pixel_16_bit = ((deconversion_function((pixel_32_bit->*conversion_function)())).*conversion_function)();
-                    }
-                }
-
+                encode_16_bit<4,4,4,4>(input_data, output_data, width, height, dither);
+                return;
+            case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_R5G6B5:
+                encode_16_bit<0,5,6,5>(input_data, output_data, width, height, dither);
                 return;
-            }
 
             // If it's monochrome, it depends
             case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_A8:
-            case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_AY8: {
-                auto *pixel_8_bit = reinterpret_cast<std::uint8_t *>(output_data);
-                for(auto *pixel = first_pixel; pixel < last_pixel; pixel++, pixel_8_bit++) {
-                    *pixel_8_bit = pixel->alpha;
-                }
-
+            case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_AY8:
+                convert_pixels(first_pixel, reinterpret_cast<std::uint8_t *>(output_data), pixel_count, [](const Pixel &pixel) { return pixel.convert_to_a8(); });
                 break;
-            }
-            case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_Y8: {
-                auto *pixel_8_bit = reinterpret_cast<std::uint8_t *>(output_data);
-                for(auto *pixel = first_pixel; pixel < last_pixel; pixel++, pixel_8_bit++) {
-                    *pixel_8_bit = pixel->convert_to_y8();
-                }
+            case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_Y8:
+                convert_pixels(first_pixel, reinterpret_cast<std::uint8_t *>(output_data), pixel_count, [](const Pixel &pixel) { return pixel.convert_to_y8(); });
                 break;
-            }
-            case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_A8Y8: {
-                auto *pixel_16_bit = reinterpret_cast<HEK::LittleEndian<std::uint16_t> *>(output_data);
-                for(auto *pixel = first_pixel; pixel < last_pixel; pixel++, pixel_16_bit++) {
-                    *pixel_16_bit = pixel->convert_to_a8y8();
-                }
+            case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_A8Y8:
+                convert_pixels(first_pixel, reinterpret_cast<HEK::LittleEndian<std::uint16_t> *>(output_data), pixel_count, [](const Pixel &pixel) { return pixel.convert_to_a8y8(); });
                 break;
-            }
             case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_P8_BUMP: {
                 auto *pixel_8_bit = reinterpret_cast<std::uint8_t *>(output_data);
 
                 // If we're dithering, do dithering things
                 if(dither) {
-                    dither_do(&Pixel::convert_to_p8, Pixel::convert_from_p8, first_pixel, pixel_8_bit, width, height);
+                    dither_pixels(first_pixel, pixel_8_bit, width, height, [](const Pixel &pixel) { return pixel.convert_to_p8(); }, Pixel::convert_from_p8);
                 }
                 else {
-                    for(auto *pixel = first_pixel; pixel < last_pixel; pixel++, pixel_8_bit++) {
-                        *pixel_8_bit = pixel->convert_to_p8();
-                    }
+                    // Look up the whole run in the palette at once
+                    rg_convert_to_p8(reinterpret_cast<const std::uint8_t *>(first_pixel), pixel_8_bit, pixel_count);
                 }
 
                 break;
@@ -419,41 +376,90 @@ namespace Invader::BitmapEncode {
         return data;
     }
 
-    static HEK::BitmapDataFormat most_efficient_format(const std::byte *input_data, std::size_t pixel_count, HEK::BitmapFormat category) noexcept {
-        // No need to check anything here
-        if(category == HEK::BitmapFormat::BITMAP_FORMAT_DXT1) {
-            return HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_DXT1;
-        }
-
-        enum AlphaPresent {
-            ALPHA_PRESENT_NONE = 0,
-            ALPHA_PRESENT_ONE_BIT = 1,
-            ALPHA_PRESENT_MULTI_BIT = 2
-        } alpha_present = AlphaPresent::ALPHA_PRESENT_NONE;
+    enum AlphaPresent {
+        ALPHA_PRESENT_NONE = 0,
+        ALPHA_PRESENT_ONE_BIT = 1,
+        ALPHA_PRESENT_MULTI_BIT = 2
+    };
 
+    struct PixelAnalysis {
+        AlphaPresent alpha_present = AlphaPresent::ALPHA_PRESENT_NONE;
+        bool all_white = true;
+        bool luminosity_equals_alpha = true;
+    };
+
+    /**
+     * Analyze the pixels a chunk at a time, stopping as soon as nothing further can change the chosen format
+     * @param pixels      pixels to analyze
+     * @param pixel_count number of pixels
+     * @param category    category of formats being chosen from
+     * @param luminosity  if set, every pixel's luminosity is written here (and no pixels are skipped)
+     * @return            analysis
+     */
+    static PixelAnalysis analyze_pixels(const Pixel *pixels, std::size_t pixel_count, HEK::BitmapFormat category, std::uint8_t *luminosity = nullptr) noexcept {
+        static constexpr std::size_t CHUNK_SIZE = 4096;
+
+        bool monochrome = category == HEK::BitmapFormat::BITMAP_FORMAT_MONOCHROME;
+        bool only_one_bit_matters = category != HEK::BitmapFormat::BITMAP_FORMAT_16_BIT && !monochrome;
+
+        bool any_transparent = false;
+        bool any_semi_transparent = false;
         bool all_white = true;
         bool luminosity_equals_alpha = true;
 
-        // Analyze each pixel
-        auto *starting_pixel = reinterpret_cast<const Pixel *>(input_data);
-        for(std::size_t i = 0; i < pixel_count; i++, starting_pixel++) {
-            if(starting_pixel->alpha == 0x00 && alpha_present == AlphaPresent::ALPHA_PRESENT_NONE) {
-                alpha_present = AlphaPresent::ALPHA_PRESENT_ONE_BIT;
-            }
-            else if(starting_pixel->alpha != 0x00 && starting_pixel->alpha != 0xFF) {
-                alpha_present = AlphaPresent::ALPHA_PRESENT_MULTI_BIT;
-            }
+        for(std::size_t offset = 0; offset < pixel_count; offset += CHUNK_SIZE) {
+            const auto *chunk = pixels + offset;
+            std::size_t chunk_size = std::min(CHUNK_SIZE, pixel_count - offset);
 
-            if(starting_pixel->convert_to_y8() != starting_pixel->alpha) {
-                luminosity_equals_alpha = false;
+            bool chunk_transparent = false;
+            bool chunk_semi_transparent = false;
+            for(std::size_t i = 0; i < chunk_size; i++) {
+                auto alpha = chunk[i].alpha;
+                chunk_transparent |= alpha == 0x00;
+                chunk_semi_transparent |= alpha != 0x00 && alpha != 0xFF;
+            }
+            any_transparent |= chunk_transparent;
+            any_semi_transparent |= chunk_semi_transparent;
+
+            if(monochrome) {
+                bool chunk_white = true;
+                bool chunk_luminosity_equals_alpha = true;
+                for(std::size_t i = 0; i < chunk_size; i++) {
+                    const auto &pixel = chunk[i];
+                    auto y8 = pixel.convert_to_y8();
+                    if(luminosity) {
+                        luminosity[offset + i] = y8;
+                    }
+                    chunk_luminosity_equals_alpha &= y8 == pixel.alpha;
+                    chunk_white &= (pixel.red & pixel.green & pixel.blue) == 0xFF;
+                }
+                all_white &= chunk_white;
+                luminosity_equals_alpha &= chunk_luminosity_equals_alpha;
             }
 
-            if(starting_pixel->red != 0xFF || starting_pixel->green != 0xFF || starting_pixel->blue != 0xFF) {
-                all_white = false;
+            // Can we stop here?
+            if(luminosity == nullptr) {
+                bool alpha_decided = any_semi_transparent || (only_one_bit_matters && any_transparent);
+                if(alpha_decided && (!monochrome || (!all_white && !luminosity_equals_alpha))) {
+                    break;
+                }
             }
         }
 
+        PixelAnalysis analysis;
+        analysis.alpha_present = any_semi_transparent ? AlphaPresent::ALPHA_PRESENT_MULTI_BIT : any_transparent ? AlphaPresent::ALPHA_PRESENT_ONE_BIT : AlphaPresent::ALPHA_PRESENT_NONE;
+        analysis.all_white = all_white;
+        analysis.luminosity_equals_alpha = luminosity_equals_alpha;
+        return analysis;
+    }
+
+    static HEK::BitmapDataFormat most_efficient_format(const PixelAnalysis &analysis, HEK::BitmapFormat category) noexcept {
+        auto alpha_present = analysis.alpha_present;
+
         switch(category) {
+            case HEK::BitmapFormat::BITMAP_FORMAT_DXT1:
+                return HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_DXT1;
+
             case HEK::BitmapFormat::BITMAP_FORMAT_BC7:
                 return HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_BC7;
 
@@ -475,10 +481,10 @@ namespace Invader::BitmapEncode {
                 if(alpha_present == AlphaPresent::ALPHA_PRESENT_NONE) {
                     return HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_Y8;
                 }
-                else if(all_white) {
+                else if(analysis.all_white) {
                     return HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_A8;
                 }
-                else if(luminosity_equals_alpha) {
+                else if(analysis.luminosity_equals_alpha) {
                     return HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_AY8;
                 }
                 else {
@@ -486,13 +492,21 @@ namespace Invader::BitmapEncode {
                 }
 
             case HEK::BitmapFormat::BITMAP_FORMAT_ENUM_COUNT:
-            case HEK::BitmapFormat::BITMAP_FORMAT_DXT1:
-                std::terminate(); // we just checked
+                break;
         }
 
         std::terminate(); // this shouldn't be reached
     }
 
+    static HEK::BitmapDataFormat most_efficient_format(const std::byte *input_data, std::size_t pixel_count, HEK::BitmapFormat category) noexcept {
+        // No need to check anything here
+        if(category == HEK::BitmapFormat::BITMAP_FORMAT_DXT1 || category == HEK::BitmapFormat::BITMAP_FORMAT_BC7) {
+            return most_efficient_format(PixelAnalysis {}, category);
+        }
+
+        return most_efficient_format(analyze_pixels(reinterpret_cast<const Pixel *>(input_data), pixel_count, category), category);
+    }
+
     std::size_t bitmap_data_size(std::size_t width, std::size_t height, std::size_t depth, std::size_t mipmap_count, HEK::BitmapDataFormat format, HEK::BitmapDataType type) noexcept {
         std::size_t size = 0;
         std::size_t bits_per_pixel = HEK::calculate_bits_per_pixel(format);
@@ -532,4 +546,42 @@ namespace Invader::BitmapEncode {
     HEK::BitmapDataFormat most_efficient_format(const std::byte *input_data, std::size_t width, std::size_t height, std::size_t depth, HEK::BitmapFormat category, HEK::BitmapDataType type, std::size_t mipmap_count) noexcept {
         return most_efficient_format(input_data, bitmap_data_size(width, height, depth, mipmap_count, HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_A8R8G8B8, type) / sizeof(Pixel), category);
     }
+
+    std::vector<std::byte> encode_bitmap_most_efficient(const std::byte *input_data, HEK::BitmapFormat category, HEK::BitmapDataFormat &output_format, std::size_t width, std::size_t height, std::size_t depth, HEK::BitmapDataType type, std::size_t mipmap_count, bool dither) {
+        auto pixel_count = bitmap_data_size(width, height, depth, mipmap_count, HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_A8R8G8B8, type) / sizeof(Pixel);
+        if(category != HEK::BitmapFormat::BITMAP_FORMAT_MONOCHROME) {
+            output_format = most_efficient_format(input_data, pixel_count, category);
+            return encode_bitmap(input_data, HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_A8R8G8B8, output_format, width, height, depth, type, mipmap_count, dither);
+        }
+
+        // Monochrome formats store one value per pixel in the same order as the input, so the luminosity calculated while
+        // analyzing can be used directly as (or packed into) the output
+        const auto *pixels = reinterpret_cast<const Pixel *>(input_data);
+        std::vector<std::byte> luminosity(pixel_count);
+        auto *luminosity_data = reinterpret_cast<std::uint8_t *>(luminosity.data());
+        output_format = most_efficient_format(analyze_pixels(pixels, pixel_count, category, luminosity_data), category);
+
+        switch(output_format) {
+            // Y8 is the luminosity, and AY8 is only chosen if the luminosity is the same as the alpha
+            case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_Y8:
+            case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_AY8:
+                return luminosity;
+
+            case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_A8:
+                convert_pixels(pixels, luminosity_data, pixel_count, [](const Pixel &pixel) { return pixel.convert_to_a8(); });
+                return luminosity;
+
+            case HEK::BitmapDataFormat::BITMAP_DATA_FORMAT_A8Y8: {
+                std::vector<std::byte> output(pixel_count * sizeof(std::uint16_t));
+                auto *output_data = reinterpret_cast<HEK::LittleEndian<std::uint16_t> *>(output.data());
+                for(std::size_t i = 0; i < pixel_count; i++) {
+                    output_data[i] = static_cast<std::uint16_t>((pixels[i].alpha << 8) | luminosity_data[i]);
+                }
+                return output;
+            }
+
+            default:
+                std::terminate();
+        }
+    }
 }
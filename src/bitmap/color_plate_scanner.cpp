@@ -3,6 +3,8 @@
 #include <cassert>
 #include <optional>
 #include <algorithm>
+#include <atomic>
+#include <thread>
 
 #include <invader/hek/data_type.hpp>
 #include <invader/bitmap/color_plate_scanner.hpp>
@@ -188,7 +190,26 @@ namespace Invader {
         return generated_bitmap;
     }
 
+    // Vertical extents of a column of a sequence
+    struct ColorPlateColumn {
+        // Anything that's not a magenta/blue pixel
+        bool occupied = false;
+        std::uint32_t virtual_min_y;
+        std::uint32_t virtual_max_y;
+
+        // Anything that's not a cyan/magenta/blue pixel
+        bool has_pixels = false;
+        std::uint32_t min_y;
+        std::uint32_t max_y;
+    };
+
+    // Don't bother spinning up threads to copy bitmaps out of small color plates
+    static constexpr std::size_t PARALLEL_COPY_MINIMUM_PIXELS = 1024 * 1024;
+
     void ColorPlateScanner::read_color_plate(GeneratedBitmapData &generated_bitmap, const Pixel *pixels, std::uint32_t width, bool reg_point_hack) const {
+        std::vector<ColorPlateColumn> columns(width);
+        std::size_t total_pixels = 0;
+
         for(auto &sequence : generated_bitmap.sequences) {
             sequence.first_bitmap = generated_bitmap.bitmaps.size();
             sequence.bitmap_count = 0;
@@ -201,173 +222,171 @@ namespace Invader {
             // This is used for the registration point
             const double MID_Y = (static_cast<double>(Y_START) + static_cast<double>(Y_END)) / 2.0;
 
-            // Go through each pixel
-            for(std::uint32_t x = 0; x < X_END; x++) {
-                for(std::uint32_t y = Y_START; y < Y_END; y++) {
-                    auto &pixel = GET_PIXEL(x,y);
+            // Go through each row once to find the extents of each column. Bitmaps are runs of occupied columns, so this is all we need to find them.
+            std::fill(columns.begin(), columns.end(), ColorPlateColumn {});
+            for(std::uint32_t y = Y_START; y < Y_END; y++) {
+                const auto *row = pixels + static_cast<std::size_t>(y) * width;
+                for(std::uint32_t x = 0; x < X_END; x++) {
+                    auto &pixel = row[x];
 
                     // Ignore? Okay.
                     if(this->is_transparency_color(pixel) || this->is_sequence_divider_color(pixel)) {
                         continue;
                     }
 
-                    // Begin.
-                    std::optional<std::uint32_t> min_x;
-                    std::optional<std::uint32_t> max_x;
-                    std::optional<std::uint32_t> min_y;
-                    std::optional<std::uint32_t> max_y;
-
-                    std::optional<std::uint32_t> virtual_min_x;
-                    std::optional<std::uint32_t> virtual_max_x;
-                    std::optional<std::uint32_t> virtual_min_y;
-                    std::optional<std::uint32_t> virtual_max_y;
-
-                    // Find the minimum x, y, max x, and max y stuff
-                    for(std::uint32_t xb = x; xb < X_END; xb++) {
-                        // Set this to false if we got something this column
-                        bool ignored_this_x = true;
-
-                        for(std::uint32_t yb = Y_START; yb < Y_END; yb++) {
-                            auto &pixel = GET_PIXEL(xb, yb);
-
-                            // This is for anything that's not a cyan/magenta/blue pixel
-                            if(!this->is_ignored(pixel)) {
-                                if(min_x.has_value()) {
-                                    if(min_x.value() > xb) {
-                                        min_x = xb;
-                                    }
-                                    if(min_y.value() > yb) {
-                                        min_y = yb;
-                                    }
-                                    if(max_x.value() < xb) {
-                                        max_x = xb;
-                                    }
-                                    if(max_y.value() < yb) {
-                                        max_y = yb;
-                                    }
-                                }
-                                else {
-                                    min_x = xb;
-                                    min_y = yb;
-                                    max_x = xb;
-                                    max_y = yb;
-                                }
-                            }
-
-                            // Anything that's not a magenta/blue pixel then
-                            if(!this->is_transparency_color(pixel) && !this->is_sequence_divider_color(pixel)) {
-                                ignored_this_x = false;
-
-                                if(virtual_min_x.has_value()) {
-                                    if(virtual_min_x.value() > xb) {
-                                        virtual_min_x = xb;
-                                    }
-                                    if(virtual_min_y.value() > yb) {
-                                        virtual_min_y = yb;
-                                    }
-                                    if(virtual_max_x.value() < xb) {
-                                        virtual_max_x = xb;
-                                    }
-                                    if(virtual_max_y.value() < yb) {
-                                        virtual_max_y = yb;
-                                    }
-                                }
-                                else {
-                                    virtual_min_x = xb;
-                                    virtual_min_y = yb;
-                                    virtual_max_x = xb;
-                                    virtual_max_y = yb;
-                                }
-                            }
-                        }
-
-                        if(ignored_this_x) {
-                            break;
-                        }
+                    // Since we go top to bottom, the first pixel we find in a column is the minimum and the last one is the maximum
+                    auto &column = columns[x];
+                    if(!column.occupied) {
+                        column.occupied = true;
+                        column.virtual_min_y = y;
                     }
+                    column.virtual_max_y = y;
 
-                    // If we never got a minimum x, then continue on
-                    if(!min_x.has_value()) {
-                        continue;
+                    if(!this->is_spacing_color(pixel)) {
+                        if(!column.has_pixels) {
+                            column.has_pixels = true;
+                            column.min_y = y;
+                        }
+                        column.max_y = y;
                     }
+                }
+            }
 
-                    // Get the width and height
-                    std::uint32_t bitmap_width = max_x.value() - min_x.value() + 1;
-                    std::uint32_t bitmap_height = max_y.value() - min_y.value() + 1;
+            // Go through each run of columns
+            for(std::uint32_t x = 0; x < X_END; x++) {
+                if(!columns[x].occupied) {
+                    continue;
+                }
 
-                    // If we require power-of-two, check
-                    if(power_of_two) {
-                        if(!HEK::is_power_of_two(bitmap_width)) {
-                            eprintf(ERROR_INVALID_BITMAP_WIDTH, bitmap_width);
-                            throw InvalidInputBitmapException();
+                // Begin.
+                std::optional<std::uint32_t> min_x;
+                std::optional<std::uint32_t> max_x;
+                std::optional<std::uint32_t> min_y;
+                std::optional<std::uint32_t> max_y;
+
+                std::uint32_t virtual_min_x = x;
+                std::uint32_t virtual_max_x = x;
+                std::uint32_t virtual_min_y = columns[x].virtual_min_y;
+                std::uint32_t virtual_max_y = columns[x].virtual_max_y;
+
+                // Find the minimum x, y, max x, and max y stuff
+                for(; x < X_END && columns[x].occupied; x++) {
+                    auto &column = columns[x];
+
+                    virtual_max_x = x;
+                    virtual_min_y = std::min(virtual_min_y, column.virtual_min_y);
+                    virtual_max_y = std::max(virtual_max_y, column.virtual_max_y);
+
+                    if(column.has_pixels) {
+                        if(min_x.has_value()) {
+                            min_y = std::min(*min_y, column.min_y);
+                            max_y = std::max(*max_y, column.max_y);
                         }
-                        if(!HEK::is_power_of_two(bitmap_height)) {
-                            eprintf(ERROR_INVALID_BITMAP_HEIGHT, bitmap_height);
-                            throw InvalidInputBitmapException();
+                        else {
+                            min_x = x;
+                            min_y = column.min_y;
+                            max_y = column.max_y;
                         }
+                        max_x = x;
                     }
+                }
 
-                    // Add the bitmap
-                    auto &bitmap = generated_bitmap.bitmaps.emplace_back();
-                    bitmap.width = bitmap_width;
-                    bitmap.height = bitmap_height;
-                    bitmap.color_plate_x = min_x.value();
-                    bitmap.color_plate_y = min_y.value();
-                    
-                    assert(min_x.has_value());
-                    assert(min_y.has_value());
-                    assert(virtual_min_x.has_value());
-                    assert(virtual_min_y.has_value());
-                    
-                    assert(max_x.has_value());
-                    assert(max_y.has_value());
-                    assert(virtual_max_x.has_value());
-                    assert(virtual_max_y.has_value());
-                    
-                    auto min_x_f = static_cast<double>(*min_x);
-                    auto min_y_f = static_cast<double>(*min_y);
-                    auto virtual_min_x_f = static_cast<double>(*virtual_min_x);
-                    auto virtual_min_y_f = static_cast<double>(*virtual_min_y);
-                    
-                    //auto max_x_f = static_cast<double>(*max_x);
-                    //auto max_y_f = static_cast<double>(*max_y);
-                    auto virtual_max_x_f = static_cast<double>(*virtual_max_x);
-                    auto virtual_max_y_f = static_cast<double>(*virtual_max_y);
+                // If we never got a minimum x, then continue on (the column we stopped at is empty anyway)
+                if(!min_x.has_value()) {
+                    continue;
+                }
 
-                    // Calculate registration point.
-                    const double MID_X = (virtual_max_x_f + virtual_min_x_f) / 2.0;
+                assert(max_x.has_value());
+                assert(min_y.has_value());
+                assert(max_y.has_value());
 
-                    // The x point is the midpoint of the width of the bitmap and cyan stuff relative to the left
-                    bitmap.registration_point_x = MID_X - min_x_f + 0.5;
+                // Get the width and height
+                std::uint32_t bitmap_width = max_x.value() - min_x.value() + 1;
+                std::uint32_t bitmap_height = max_y.value() - min_y.value() + 1;
 
-                    // The y point is the midpoint of the height of the entire sequence relative to the top (or if we have the reg point hack, relative to the top of the bitmap itself)
-                    if(!reg_point_hack) {
-                        bitmap.registration_point_y = MID_Y - min_y_f + 0.5;
+                // If we require power-of-two, check
+                if(power_of_two) {
+                    if(!HEK::is_power_of_two(bitmap_width)) {
+                        eprintf(ERROR_INVALID_BITMAP_WIDTH, bitmap_width);
+                        throw InvalidInputBitmapException();
                     }
-                    else {
-                        bitmap.registration_point_y = virtual_min_y_f - min_y_f + (virtual_max_y_f - virtual_min_y_f) / 2.0 + 0.5;
+                    if(!HEK::is_power_of_two(bitmap_height)) {
+                        eprintf(ERROR_INVALID_BITMAP_HEIGHT, bitmap_height);
+                        throw InvalidInputBitmapException();
                     }
+                }
 
-                    // Load the pixels
-                    for(std::uint32_t by = min_y.value(); by <= max_y.value(); by++) {
-                        for(std::uint32_t bx = min_x.value(); bx <= max_x.value(); bx++) {
-                            auto &pixel = GET_PIXEL(bx, by);
-                            if(this->is_ignored(pixel)) {
-                                bitmap.pixels.push_back(Pixel {});
-                            }
-                            else {
-                                bitmap.pixels.push_back(pixel);
-                            }
-                        }
-                    }
+                // Add the bitmap (its pixels are copied once we've found everything)
+                auto &bitmap = generated_bitmap.bitmaps.emplace_back();
+                bitmap.width = bitmap_width;
+                bitmap.height = bitmap_height;
+                bitmap.color_plate_x = min_x.value();
+                bitmap.color_plate_y = min_y.value();
+                total_pixels += static_cast<std::size_t>(bitmap_width) * bitmap_height;
 
-                    sequence.bitmap_count++;
+                auto min_x_f = static_cast<double>(*min_x);
+                auto min_y_f = static_cast<double>(*min_y);
+                auto virtual_min_x_f = static_cast<double>(virtual_min_x);
+                auto virtual_min_y_f = static_cast<double>(virtual_min_y);
 
-                    // Set it to the max value. Add 1 since sprites can't possibly be adjacent to each other. Then, the for loop will add 1 again to get to the minimum possible x value.
-                    x = virtual_max_x.value() + 1;
-                    break;
+                auto virtual_max_x_f = static_cast<double>(virtual_max_x);
+                auto virtual_max_y_f = static_cast<double>(virtual_max_y);
+
+                // Calculate registration point.
+                const double MID_X = (virtual_max_x_f + virtual_min_x_f) / 2.0;
+
+                // The x point is the midpoint of the width of the bitmap and cyan stuff relative to the left
+                bitmap.registration_point_x = MID_X - min_x_f + 0.5;
+
+                // The y point is the midpoint of the height of the entire sequence relative to the top (or if we have the reg point hack, relative to the top of the bitmap itself)
+                if(!reg_point_hack) {
+                    bitmap.registration_point_y = MID_Y - min_y_f + 0.5;
+                }
+                else {
+                    bitmap.registration_point_y = virtual_min_y_f - min_y_f + (virtual_max_y_f - virtual_min_y_f) / 2.0 + 0.5;
+                }
+
+                sequence.bitmap_count++;
+            }
+        }
+
+        // Load the pixels. Each bitmap is its own region of the color plate, so these can all be copied at the same time.
+        auto copy_bitmap = [this, &pixels, &width](GeneratedBitmapDataBitmap &bitmap) {
+            bitmap.pixels.resize(static_cast<std::size_t>(bitmap.width) * bitmap.height);
+            auto *output = bitmap.pixels.data();
+
+            for(std::uint32_t by = 0; by < bitmap.height; by++) {
+                const auto *row = pixels + static_cast<std::size_t>(bitmap.color_plate_y + by) * width + bitmap.color_plate_x;
+                for(std::uint32_t bx = 0; bx < bitmap.width; bx++) {
+                    *(output++) = this->is_ignored(row[bx]) ? Pixel {} : row[bx];
                 }
             }
+        };
+
+        auto &bitmaps = generated_bitmap.bitmaps;
+        std::size_t thread_count = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1U), bitmaps.size());
+        if(total_pixels < PARALLEL_COPY_MINIMUM_PIXELS || thread_count < 2) {
+            for(auto &bitmap : bitmaps) {
+                copy_bitmap(bitmap);
+            }
+            return;
+        }
+
+        std::atomic<std::size_t> next_bitmap = 0;
+        auto copy_bitmaps_thread = [&next_bitmap, &bitmaps, &copy_bitmap]() {
+            for(std::size_t i = next_bitmap++; i < bitmaps.size(); i = next_bitmap++) {
+                copy_bitmap(bitmaps[i]);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count - 1);
+        for(std::size_t t = 1; t < thread_count; t++) {
+            threads.emplace_back(copy_bitmaps_thread);
+        }
+        copy_bitmaps_thread();
+        for(auto &t : threads) {
+            t.join();
         }
     }
 
@@ -3,6 +3,9 @@
 #include <tiffio.h>
 #include "image_loader.hpp"
 #include <invader/printf.hpp>
+#include <invader/error.hpp>
+#include <algorithm>
+#include <cstring>
 #include "stb/stb_image.h"
 
 namespace Invader {
@@ -28,7 +31,7 @@ namespace Invader {
         auto *image_buffer = stbi_load(path, &x, &y, &channels, 4);
         if(!image_buffer) {
             eprintf_error("Failed to load %s. Error was: %s", path, stbi_failure_reason());
-            exit(EXIT_FAILURE);
+            throw InvalidInputBitmapException();
         }
 
         // Get the width and height
@@ -45,11 +48,63 @@ namespace Invader {
         return return_value;
     }
 
+    // Convert libtiff's packed ABGR raster pixels into our own pixels (this can be done in place, hence memcpy)
+    static void tiff_raster_to_pixels(const std::uint32_t *raster, Pixel *pixels, std::size_t pixel_count) noexcept {
+        for(std::size_t i = 0; i < pixel_count; i++) {
+            std::uint32_t abgr;
+            std::memcpy(&abgr, raster + i, sizeof(abgr));
+            pixels[i] = Pixel { static_cast<std::uint8_t>(TIFFGetB(abgr)), static_cast<std::uint8_t>(TIFFGetG(abgr)), static_cast<std::uint8_t>(TIFFGetR(abgr)), static_cast<std::uint8_t>(TIFFGetA(abgr)) };
+        }
+    }
+
+    // Strips and tiles are read with their origin at the bottom-left, so each row is flipped back into place as it is copied
+    static bool read_tiff_strips(TIFF *image_tiff, Pixel *pixels, std::uint32_t image_width, std::uint32_t image_height, std::uint32_t rows_per_strip) {
+        auto raster = std::vector<std::uint32_t>(static_cast<std::size_t>(image_width) * rows_per_strip);
+
+        for(std::uint32_t row = 0; row < image_height; row += rows_per_strip) {
+            if(!TIFFReadRGBAStrip(image_tiff, row, raster.data())) {
+                return false;
+            }
+
+            std::uint32_t rows_read = std::min(rows_per_strip, image_height - row);
+            for(std::uint32_t r = 0; r < rows_read; r++) {
+                tiff_raster_to_pixels(raster.data() + static_cast<std::size_t>(rows_read - r - 1) * image_width, pixels + static_cast<std::size_t>(row + r) * image_width, image_width);
+            }
+        }
+
+        return true;
+    }
+
+    static bool read_tiff_tiles(TIFF *image_tiff, Pixel *pixels, std::uint32_t image_width, std::uint32_t image_height) {
+        std::uint32_t tile_width = 0, tile_height = 0;
+        if(!TIFFGetField(image_tiff, TIFFTAG_TILEWIDTH, &tile_width) || !TIFFGetField(image_tiff, TIFFTAG_TILELENGTH, &tile_height) || tile_width == 0 || tile_height == 0) {
+            return false;
+        }
+
+        auto raster = std::vector<std::uint32_t>(static_cast<std::size_t>(tile_width) * tile_height);
+
+        for(std::uint32_t row = 0; row < image_height; row += tile_height) {
+            std::uint32_t rows_read = std::min(tile_height, image_height - row);
+            for(std::uint32_t column = 0; column < image_width; column += tile_width) {
+                if(!TIFFReadRGBATile(image_tiff, column, row, raster.data())) {
+                    return false;
+                }
+
+                std::uint32_t columns_read = std::min(tile_width, image_width - column);
+                for(std::uint32_t r = 0; r < rows_read; r++) {
+                    tiff_raster_to_pixels(raster.data() + static_cast<std::size_t>(tile_height - r - 1) * tile_width, pixels + static_cast<std::size_t>(row + r) * image_width + column, columns_read);
+                }
+            }
+        }
+
+        return true;
+    }
+
     std::vector<Pixel> load_tiff(const char *path, std::uint32_t &image_width, std::uint32_t &image_height, std::size_t &image_size) {
         TIFF *image_tiff = TIFFOpen(path, "r");
         if(!image_tiff) {
             eprintf_error("Cannot open %s", path);
-            exit(EXIT_FAILURE);
+            throw InvalidInputBitmapException();
         }
         TIFFGetField(image_tiff, TIFFTAG_IMAGEWIDTH, &image_width);
         TIFFGetField(image_tiff, TIFFTAG_IMAGELENGTH, &image_height);
@@ -65,22 +120,40 @@ namespace Invader {
             }
         }
 
-        // Read it all
-        image_size = image_width * image_height * sizeof(Invader::Pixel);
-        auto image_pixels = std::vector<Invader::Pixel>(image_size);
-        TIFFReadRGBAImageOriented(image_tiff, image_width, image_height, reinterpret_cast<std::uint32_t *>(image_pixels.data()), ORIENTATION_TOPLEFT);
+        std::size_t pixel_count = static_cast<std::size_t>(image_width) * image_height;
+        image_size = pixel_count * sizeof(Invader::Pixel);
+        auto image_pixels = std::vector<Invader::Pixel>(pixel_count);
 
-        // Close the TIFF
-        TIFFClose(image_tiff);
+        // Read it a strip or tile at a time if we can so that large color plates only need one extra strip or tile in memory rather than a second copy of the whole image
+        std::uint16_t orientation = ORIENTATION_TOPLEFT;
+        TIFFGetFieldDefaulted(image_tiff, TIFFTAG_ORIENTATION, &orientation);
 
-        // Swap red and blue channels
-        for(std::size_t i = 0; i < image_size / 4; i++) {
-            Invader::Pixel swapped = image_pixels[i];
-            swapped.red = image_pixels[i].blue;
-            swapped.blue = image_pixels[i].red;
-            image_pixels[i] = swapped;
+        bool read = false;
+        if(orientation == ORIENTATION_TOPLEFT) {
+            if(TIFFIsTiled(image_tiff)) {
+                read = read_tiff_tiles(image_tiff, image_pixels.data(), image_width, image_height);
+            }
+            else {
+                std::uint32_t rows_per_strip = image_height;
+                TIFFGetFieldDefaulted(image_tiff, TIFFTAG_ROWSPERSTRIP, &rows_per_strip);
+
+                // A single strip would need just as much memory as reading it all at once
+                if(rows_per_strip < image_height / 2) {
+                    read = read_tiff_strips(image_tiff, image_pixels.data(), image_width, image_height, rows_per_strip);
+                }
+            }
+        }
+
+        // Otherwise, read it all directly into the output and convert it in place
+        if(!read) {
+            auto *raster = reinterpret_cast<std::uint32_t *>(image_pixels.data());
+            TIFFReadRGBAImageOriented(image_tiff, image_width, image_height, raster, ORIENTATION_TOPLEFT);
+            tiff_raster_to_pixels(raster, image_pixels.data(), pixel_count);
         }
 
+        // Close the TIFF
+        TIFFClose(image_tiff);
+
         return image_pixels;
     }
 }
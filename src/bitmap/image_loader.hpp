@@ -8,6 +8,7 @@
 #include <cstdint>
 
 namespace Invader {
+    // These throw InvalidInputBitmapException if the image can't be loaded
     std::vector<Pixel> load_tiff(const char *path, std::uint32_t &image_width, std::uint32_t &image_height, std::size_t &image_size);
     std::vector<Pixel> load_image(const char *path, std::uint32_t &image_width, std::uint32_t &image_height, std::size_t &image_size);
 }
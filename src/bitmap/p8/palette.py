@@ -52,6 +52,7 @@ for red in range(0,256):
 # Now write the C++ file
 with open(sys.argv[2], "w") as cpp:
     cpp.write("// This value was auto-generated. Changes made to this file may get overwritten.\n")
+    cpp.write("#include <cstddef>\n")
     cpp.write("#include <cstdint>\n")
     cpp.write("namespace Invader {\n")
 
@@ -77,6 +78,12 @@ with open(sys.argv[2], "w") as cpp:
     cpp.write("        return p8_map[red * 256 + green];\n")
     cpp.write("    }\n")
 
+    cpp.write("    void rg_convert_to_p8(const std::uint8_t *bgra, std::uint8_t *p8, std::size_t pixel_count) {\n")
+    cpp.write("        for(std::size_t i = 0; i < pixel_count; i++, bgra += 4) {\n")
+    cpp.write("            p8[i] = bgra[3] < 0x2F ? static_cast<std::uint8_t>(0xFE + (bgra[0] >= 0x80)) : p8_map[bgra[2] * 256 + bgra[1]];\n")
+    cpp.write("        }\n")
+    cpp.write("    }\n")
+
     cpp.write("    void p8_convert_to_rgba(std::uint8_t p8, std::uint8_t &red, std::uint8_t &green, std::uint8_t &blue, std::uint8_t &alpha) {\n")
     cpp.write("        alpha = p8_colors[p8][0];\n")
     cpp.write("        red = p8_colors[p8][1];\n")
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-3.0-only
 
 #include <invader/bitmap/swizzle.hpp>
+#include <array>
 #include <vector>
 #include <cstdint>
 #include <cstring>
@@ -8,48 +9,83 @@
 #include <invader/printf.hpp>
 #include <invader/hek/data_type.hpp>
 
+#if defined(__BMI2__) && (defined(__x86_64__) || defined(_M_X64))
+#include <immintrin.h>
+#define INVADER_SWIZZLE_USE_PDEP
+#endif
+
 namespace Invader::Swizzle {
-    template<typename Pixel> static std::size_t swizzle_block_2x2(const Pixel *values_in, Pixel *values_out, std::size_t stride, std::size_t counter, bool deswizzle) {
-        if(!deswizzle) {
-            // values_in  = unswizzled
-            // values_out = swizzled
-            values_out[counter++] = values_in[0];
-            values_out[counter++] = values_in[1];
-            values_out[counter++] = values_in[0 + stride];
-            values_out[counter++] = values_in[1 + stride];
+    // Xbox textures are stored in Morton (Z) order: the bits of x, y (and z for 3D textures) are interleaved, with x
+    // being the least significant. Rather than recursing down to each 2x2 block, we compute the interleaved offset of
+    // every column, row, and slice once and then move whole rows at a time.
+
+    // Lookup tables spreading an 8-bit value out so there are one (2D) or two (3D) zero bits between each bit
+    static constexpr auto SPREAD_BITS_2D_TABLE = []() {
+        std::array<std::uint16_t, 256> table = {};
+        for(std::size_t i = 0; i < table.size(); i++) {
+            for(std::size_t b = 0; b < 8; b++) {
+                table[i] |= static_cast<std::uint16_t>(((i >> b) & 1) << (b * 2));
+            }
         }
-        else {
-            // values_in  = swizzled
-            // values_out = unswizzled
-            values_out[0] = values_in[counter++];
-            values_out[1] = values_in[counter++];
-            values_out[0 + stride] = values_in[counter++];
-            values_out[1 + stride] = values_in[counter++];
-        }
-        return counter;
-    }
+        return table;
+    }();
 
-    template<typename Pixel> static std::size_t swizzle_block(const Pixel *values_in, Pixel *values_out, std::size_t width, std::size_t stride, std::size_t counter, bool deswizzle) {
-        if(width == 2) {
-            return swizzle_block_2x2(values_in, values_out, stride, counter, deswizzle);
+    static constexpr auto SPREAD_BITS_3D_TABLE = []() {
+        std::array<std::uint32_t, 256> table = {};
+        for(std::size_t i = 0; i < table.size(); i++) {
+            for(std::size_t b = 0; b < 8; b++) {
+                table[i] |= static_cast<std::uint32_t>(((i >> b) & 1) << (b * 3));
+            }
         }
+        return table;
+    }();
 
-        std::size_t new_width = width / 2;
+    static_assert(SPREAD_BITS_2D_TABLE[0xFF] == 0x5555);
+    static_assert(SPREAD_BITS_3D_TABLE[0xFF] == 0x249249);
 
+    static std::size_t spread_bits_2d(std::size_t value) noexcept {
+        #ifdef INVADER_SWIZZLE_USE_PDEP
+        return static_cast<std::size_t>(_pdep_u64(value, 0x5555555555555555ull));
+        #else
+        std::size_t result = 0;
+        for(std::size_t shift = 0; value != 0; value >>= 8, shift += 16) {
+            result |= static_cast<std::size_t>(SPREAD_BITS_2D_TABLE[value & 0xFF]) << shift;
+        }
+        return result;
+        #endif
+    }
+
+    static std::size_t spread_bits_3d(std::size_t value) noexcept {
+        #ifdef INVADER_SWIZZLE_USE_PDEP
+        return static_cast<std::size_t>(_pdep_u64(value, 0x9249249249249249ull));
+        #else
+        std::size_t result = 0;
+        for(std::size_t shift = 0; value != 0; value >>= 8, shift += 24) {
+            result |= static_cast<std::size_t>(SPREAD_BITS_3D_TABLE[value & 0xFF]) << shift;
+        }
+        return result;
+        #endif
+    }
+
+    template <typename Pixel> static void swizzle_rows(const Pixel *values_in, Pixel *values_out, const std::size_t *x_offsets, const std::size_t *y_offsets, std::size_t width, std::size_t height, bool deswizzle) noexcept {
         if(!deswizzle) {
-            counter = swizzle_block(values_in, values_out                                 , new_width, stride, counter, deswizzle);
-            counter = swizzle_block(values_in + new_width                                 , values_out, new_width, stride, counter, deswizzle);
-            counter = swizzle_block(values_in + stride * new_width                        , values_out, new_width, stride, counter, deswizzle);
-            counter = swizzle_block(values_in + stride * new_width + new_width, values_out, new_width, stride, counter, deswizzle);
+            for(std::size_t y = 0; y < height; y++) {
+                const auto *row = values_in + y * width;
+                auto *block = values_out + y_offsets[y];
+                for(std::size_t x = 0; x < width; x++) {
+                    block[x_offsets[x]] = row[x];
+                }
+            }
         }
         else {
-            counter = swizzle_block(values_in, values_out                                 , new_width, stride, counter, deswizzle);
-            counter = swizzle_block(values_in, values_out + new_width                     , new_width, stride, counter, deswizzle);
-            counter = swizzle_block(values_in, values_out + stride * new_width            , new_width, stride, counter, deswizzle);
-            counter = swizzle_block(values_in, values_out + stride * new_width + new_width, new_width, stride, counter, deswizzle);
+            for(std::size_t y = 0; y < height; y++) {
+                auto *row = values_out + y * width;
+                const auto *block = values_in + y_offsets[y];
+                for(std::size_t x = 0; x < width; x++) {
+                    row[x] = block[x_offsets[x]];
+                }
+            }
         }
-
-        return counter;
     }
 
     template <typename Pixel> static void perform_swizzle_2d(const Pixel *values_in, Pixel *values_out, std::size_t width, std::size_t height, bool deswizzle) {
@@ -59,123 +95,120 @@ namespace Invader::Swizzle {
             return;
         }
 
-        // Also, if width is less than the height, we can subdivide
-        if(width < height) {
-            for(std::size_t y = 0; y < height; y += width) {
-                perform_swizzle_2d(values_in + y * width, values_out + y * width, width, width, deswizzle);
-            }
-            return;
+        // Non-square textures are stored as a series of square Morton-ordered tiles along the longer axis
+        std::size_t tile_length = width < height ? width : height;
+        std::size_t tile_size = tile_length * tile_length;
+
+        std::vector<std::size_t> x_offsets(width);
+        for(std::size_t x = 0; x < width; x++) {
+            x_offsets[x] = (x / tile_length) * tile_size + spread_bits_2d(x % tile_length);
         }
 
-        std::size_t counter = 0;
-        for(std::size_t x = 0; x < width; x+=height) {
-            if(!deswizzle) {
-                counter = swizzle_block(values_in + x, values_out, height, width, counter, deswizzle);
+        std::vector<std::size_t> y_offsets(height);
+        for(std::size_t y = 0; y < height; y++) {
+            y_offsets[y] = (y / tile_length) * tile_size + (spread_bits_2d(y % tile_length) << 1);
+        }
+
+        // Every tile is at least 2x2 here, and each 2x2 quad is stored contiguously, so move two rows at a time
+        if(!deswizzle) {
+            for(std::size_t y = 0; y < height; y += 2) {
+                const auto *row_0 = values_in + y * width;
+                const auto *row_1 = row_0 + width;
+                auto *block = values_out + y_offsets[y];
+                for(std::size_t x = 0; x < width; x += 2) {
+                    auto *quad = block + x_offsets[x];
+                    quad[0] = row_0[x];
+                    quad[1] = row_0[x + 1];
+                    quad[2] = row_1[x];
+                    quad[3] = row_1[x + 1];
+                }
             }
-            else {
-                counter = swizzle_block(values_in, values_out + x, height, width, counter, deswizzle);
+        }
+        else {
+            for(std::size_t y = 0; y < height; y += 2) {
+                auto *row_0 = values_out + y * width;
+                auto *row_1 = row_0 + width;
+                const auto *block = values_in + y_offsets[y];
+                for(std::size_t x = 0; x < width; x += 2) {
+                    const auto *quad = block + x_offsets[x];
+                    row_0[x] = quad[0];
+                    row_0[x + 1] = quad[1];
+                    row_1[x] = quad[2];
+                    row_1[x + 1] = quad[3];
+                }
             }
         }
     }
-    
-    // From https://www.forceflow.be/2013/10/07/morton-encodingdecoding-through-bit-interleaving-implementations/
-    static constexpr std::uint64_t morton_encode_3d(unsigned int x, unsigned int y, unsigned int z) {
-        std::uint64_t answer = 0;
-        for (std::uint64_t i = 0; i < (sizeof(std::uint64_t) * 8)/3; ++i) {
-            std::uint64_t bit = static_cast<std::uint64_t>(1) << i;
-            answer |= ((x & bit) << 2*i) | ((y & bit) << (2*i + 1)) | ((z & bit) << (2*i + 2));
-        }
-        return answer;
-    }
-    
-    /*static constexpr std::uint64_t morton_encode_2d(unsigned int x, unsigned int y) {
-        std::uint64_t answer = 0;
-        for (std::uint64_t i = 0; i < (sizeof(std::uint64_t) * 8)/3; ++i) {
-            std::uint64_t bit = static_cast<std::uint64_t>(1) << i;
-            answer |= ((x & bit) << i) | ((y & bit) << (i + 1));
-        }
-        return answer;
-    }*/
-    
+
     template <typename Pixel> static void perform_swizzle_3d(const Pixel *values_in, Pixel *values_out, std::size_t width, std::size_t height, std::size_t depth, bool deswizzle) {
-        // Subdivide
-        if(height > width) {
-            auto size = width * width * depth;
-            for(std::size_t i = 0; i < height / width; i++) {
-                perform_swizzle_3d(values_in + size * i, values_out + size * i, width, width, depth, deswizzle);
-            }
+        if(width * height * depth == 0) {
             return;
         }
-        
-        auto size = (width * height * depth);
-        
-        if(size == 0) {
-            return;
+
+        std::vector<std::size_t> x_offsets(width);
+        for(std::size_t x = 0; x < width; x++) {
+            x_offsets[x] = spread_bits_3d(x);
         }
-        
+
+        // Fold the z offset into the row offsets so each slice is just another set of rows
+        std::vector<std::size_t> y_offsets(height * depth);
         for(std::size_t z = 0; z < depth; z++) {
+            auto z_offset = spread_bits_3d(z) << 2;
             for(std::size_t y = 0; y < height; y++) {
-                for(std::size_t x = 0; x < width; x++) {
-                    std::uint64_t m = morton_encode_3d(x,y,z) % size;
-                    
-                    auto offset = (x + y * width + z * width * height) % size;
-                    
-                    if(deswizzle) {
-                        values_out[offset] = values_in[m];
-                    }
-                    else {
-                        values_out[m] = values_in[offset];
-                    }
-                }
+                y_offsets[y + z * height] = z_offset | (spread_bits_3d(y) << 1);
             }
         }
+
+        swizzle_rows(values_in, values_out, x_offsets.data(), y_offsets.data(), width, height * depth, deswizzle);
     }
 
-    std::vector<std::byte> swizzle(const std::byte *data, std::size_t bits_per_pixel, std::size_t width, std::size_t height, std::size_t depth, bool deswizzle) {
-        std::vector<std::byte> output(width*height*depth*(bits_per_pixel/8));
-        
+    template <typename Pixel> static void perform_swizzle(const Pixel *values_in, Pixel *values_out, std::size_t width, std::size_t height, std::size_t depth, bool deswizzle) {
+        if(depth > 1) {
+            perform_swizzle_3d(values_in, values_out, width, height, depth, deswizzle);
+        }
+        else {
+            perform_swizzle_2d(values_in, values_out, width, height, deswizzle);
+        }
+    }
+
+    void swizzle(const std::byte *data, std::byte *output, std::size_t bits_per_pixel, std::size_t width, std::size_t height, std::size_t depth, bool deswizzle) {
         if(!HEK::is_power_of_two(width) || !HEK::is_power_of_two(height) || !HEK::is_power_of_two(depth)) {
             eprintf_error("Cannot (de)swizzle non-power-of-two texture");
             throw std::exception();
         }
 
-        if(depth > 1) {
-            if(height != width || height != depth) {
-                eprintf_error("Cannot (de)swizzle a 3D texture that isn't 1x1x1");
-                throw std::exception();
-            }
-            
-            switch(bits_per_pixel) {
-                case 8:
-                    perform_swizzle_3d(reinterpret_cast<const std::uint8_t *>(data), reinterpret_cast<std::uint8_t *>(output.data()), width, height, depth, deswizzle);
-                    break;
-                case 16:
-                    perform_swizzle_3d(reinterpret_cast<const std::uint16_t *>(data), reinterpret_cast<std::uint16_t *>(output.data()), width, height, depth, deswizzle);
-                    break;
-                case 32:
-                    perform_swizzle_3d(reinterpret_cast<const std::uint32_t *>(data), reinterpret_cast<std::uint32_t *>(output.data()), width, height, depth, deswizzle);
-                    break;
-                case 64:
-                    perform_swizzle_3d(reinterpret_cast<const std::uint64_t *>(data), reinterpret_cast<std::uint64_t *>(output.data()), width, height, depth, deswizzle);
-                    break;
-            }
+        if(depth > 1 && (height != width || height != depth)) {
+            eprintf_error("Cannot (de)swizzle a 3D texture that isn't 1x1x1");
+            throw std::exception();
         }
-        else {
-            switch(bits_per_pixel) {
-                case 8:
-                    perform_swizzle_2d(reinterpret_cast<const std::uint8_t *>(data), reinterpret_cast<std::uint8_t *>(output.data()), width, height, deswizzle);
-                    break;
-                case 16:
-                    perform_swizzle_2d(reinterpret_cast<const std::uint16_t *>(data), reinterpret_cast<std::uint16_t *>(output.data()), width, height, deswizzle);
-                    break;
-                case 32:
-                    perform_swizzle_2d(reinterpret_cast<const std::uint32_t *>(data), reinterpret_cast<std::uint32_t *>(output.data()), width, height, deswizzle);
-                    break;
-                case 64:
-                    perform_swizzle_2d(reinterpret_cast<const std::uint64_t *>(data), reinterpret_cast<std::uint64_t *>(output.data()), width, height, deswizzle);
-                    break;
-            }
+
+        // If we're (de)swizzling in place, work off of a copy of the input
+        std::size_t data_size = width * height * depth * (bits_per_pixel / 8);
+        std::vector<std::byte> input_copy;
+        if(data < output + data_size && output < data + data_size) {
+            input_copy.insert(input_copy.end(), data, data + data_size);
+            data = input_copy.data();
+        }
+
+        switch(bits_per_pixel) {
+            case 8:
+                perform_swizzle(reinterpret_cast<const std::uint8_t *>(data), reinterpret_cast<std::uint8_t *>(output), width, height, depth, deswizzle);
+                break;
+            case 16:
+                perform_swizzle(reinterpret_cast<const std::uint16_t *>(data), reinterpret_cast<std::uint16_t *>(output), width, height, depth, deswizzle);
+                break;
+            case 32:
+                perform_swizzle(reinterpret_cast<const std::uint32_t *>(data), reinterpret_cast<std::uint32_t *>(output), width, height, depth, deswizzle);
+                break;
+            case 64:
+                perform_swizzle(reinterpret_cast<const std::uint64_t *>(data), reinterpret_cast<std::uint64_t *>(output), width, height, depth, deswizzle);
+                break;
         }
+    }
+
+    std::vector<std::byte> swizzle(const std::byte *data, std::size_t bits_per_pixel, std::size_t width, std::size_t height, std::size_t depth, bool deswizzle) {
+        std::vector<std::byte> output(width*height*depth*(bits_per_pixel/8));
+        swizzle(data, output.data(), bits_per_pixel, width, height, depth, deswizzle);
         return output;
     }
 }
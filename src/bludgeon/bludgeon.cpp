@@ -10,8 +10,8 @@
 #include "../command_line_option.hpp"
 #include <invader/tag/parser/parser.hpp>
 #include <invader/file/file.hpp>
-#include <thread>
-#include <mutex>
+#include <invader/parallel/parallel.hpp>
+#include <atomic>
 
 #include "bludgeoner.hpp"
 
@@ -92,12 +92,6 @@ static BludgeonAction all_fixes[] = {
     { .name = "everything", .fix_bit = static_cast<std::uint64_t>(~0) }
 };
 
-// Singleton the printf!
-static std::mutex bad_code_design_mutex;
-#define badly_designed_printf(function, ...) bad_code_design_mutex.lock(); \
-                                             function(__VA_ARGS__); \
-                                             bad_code_design_mutex.unlock();
-
 static int bludgeon_tag(const std::filesystem::path &file_path, const std::string &tag_path, std::uint64_t fixes, bool &bludgeoned) {
     using namespace Bludgeoner;
     using namespace HEK;
@@ -108,7 +102,7 @@ static int bludgeon_tag(const std::filesystem::path &file_path, const std::strin
     // Open the tag
     auto tag = open_file(file_path);
     if(!tag.has_value()) {
-        badly_designed_printf(eprintf_error, "Failed to open %s", file_path.string().c_str());
+        eprintf_error("Failed to open %s", file_path.string().c_str());
         return EXIT_FAILURE;
     }
 
@@ -125,7 +119,7 @@ static int bludgeon_tag(const std::filesystem::path &file_path, const std::strin
             for(auto &i : all_fixes) {
                 if(i.fix_fn.has_value()) {
                     if((*i.fix_fn)(parsed_data.get(), false)) {
-                        badly_designed_printf(oprintf_success_warn, "%s: Detected %s", tag_path.c_str(), i.name);
+                        oprintf_success_warn("%s: Detected %s", tag_path.c_str(), i.name);
                         issues_present = true;
                     }
                 }
@@ -135,7 +129,7 @@ static int bludgeon_tag(const std::filesystem::path &file_path, const std::strin
             for(auto &i : all_fixes) {
                 if(i.fix_fn.has_value() && (i.fix_bit & fixes) != 0) {
                     if((*i.fix_fn)(parsed_data.get(), true)) {
-                        badly_designed_printf(oprintf_success, "%s: Fixed %s", tag_path.c_str(), i.name);
+                        oprintf_success("%s: Fixed %s", tag_path.c_str(), i.name);
                         issues_present = true;
                     }
                 }
@@ -157,14 +151,14 @@ static int bludgeon_tag(const std::filesystem::path &file_path, const std::strin
         // Do it!
         file_data = parsed_data->generate_hek_tag_data(header->tag_fourcc, true);
         if(!File::save_file(file_path, file_data)) {
-            badly_designed_printf(eprintf_error, "Error: Failed to write to %s.", file_path.string().c_str());
+            eprintf_error("Error: Failed to write to %s.", file_path.string().c_str());
             return EXIT_FAILURE;
         }
 
         return EXIT_SUCCESS;
     }
     catch(std::exception &e) {
-        badly_designed_printf(eprintf_error, "Error: Failed to bludgeon %s: %s", tag_path.c_str(), e.what());
+        eprintf_error("Error: Failed to bludgeon %s: %s", tag_path.c_str(), e.what());
         return EXIT_FAILURE;
     }
 }
@@ -200,7 +194,7 @@ int main(int argc, char * const *argv) {
         bool fs_path = false;
         std::vector<std::string> search;
         std::vector<std::string> search_exclude;
-        std::size_t max_threads = std::thread::hardware_concurrency() < 1 ? 1 : std::thread::hardware_concurrency();
+        std::size_t max_threads = Parallel::default_thread_count();
     } bludgeon_options;
 
     auto remaining_arguments = CommandLineOption::parse_arguments<BludgeonOptions &>(argc, argv, options, USAGE, DESCRIPTION, 0, 1, bludgeon_options, [](char opt, const std::vector<const char *> &arguments, auto &bludgeon_options) {
@@ -274,7 +268,6 @@ int main(int argc, char * const *argv) {
 
     auto &fixes = bludgeon_options.fixes;
 
-    std::size_t success = 0;
     std::vector<File::TagFile> all_tags;
 
     if(single_tag.has_value()) {
@@ -294,52 +287,25 @@ int main(int argc, char * const *argv) {
     else {
         auto all_virtual_tags = File::load_virtual_tag_folder(std::vector<std::filesystem::path>(&bludgeon_options.tags, &bludgeon_options.tags + 1));
         all_tags.reserve(all_virtual_tags.size());
+        File::PathMatcher matcher(bludgeon_options.search, bludgeon_options.search_exclude);
         for(auto &i : all_virtual_tags) {
-            if(File::path_matches(i.tag_path.c_str(), bludgeon_options.search, bludgeon_options.search_exclude)) {
+            if(matcher.matches(i.tag_path.c_str())) {
                 all_tags.emplace_back(std::move(i));
             }
         }
     }
 
-    std::mutex thread_mutex;
-    std::vector<std::thread> threads;
-    std::size_t tag_index = 0;
-    threads.reserve(bludgeon_options.max_threads);
-
-    auto bludgeon_worker = [](auto *all_tags, std::size_t *tag_index, std::mutex *thread_mutex, std::size_t *success, auto *fixes) {
-        while(true) {
-            thread_mutex->lock();
-            std::size_t this_index = *tag_index;
-            if(this_index == all_tags->size()) {
-                thread_mutex->unlock();
-                return;
-            }
-            (*tag_index)++;
-            thread_mutex->unlock();
-
-            // Bludgeon
-            bool bludgeoned;
-            auto &tag = all_tags->data()[this_index];
-            bludgeon_tag(tag.full_path, tag.tag_path, *fixes, bludgeoned);
-
-            // Increment
-            thread_mutex->lock();
-            (*success) += bludgeoned;
-            thread_mutex->unlock();
-        }
-    };
-
     // Go through each tag
-    for(std::size_t i = 0; i < bludgeon_options.max_threads; i++) {
-        threads.emplace_back(bludgeon_worker, &all_tags, &tag_index, &thread_mutex, &success, &fixes);
-    }
-
-    // Wait for all threads to end
-    for(auto &i : threads) {
-        i.join();
-    }
+    std::atomic<std::size_t> success = 0;
+    Parallel(bludgeon_options.max_threads).for_each(all_tags.size(), [&all_tags, &success, &fixes](std::size_t i) {
+        bool bludgeoned;
+        auto &tag = all_tags[i];
+        bludgeon_tag(tag.full_path, tag.tag_path, fixes, bludgeoned);
+        success += bludgeoned;
+    });
 
-    oprintf("%s %zu out of %zu tag%s\n", fixes ? "Bludgeoned" : "Identified issues with", success, tag_index, tag_index == 1 ? "" : "s");
+    std::size_t total = all_tags.size();
+    oprintf("%s %zu out of %zu tag%s\n", fixes ? "Bludgeoned" : "Identified issues with", success.load(), total, total == 1 ? "" : "s");
 
     return EXIT_SUCCESS;
 }
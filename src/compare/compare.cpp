@@ -5,6 +5,7 @@
 #include <vector>
 #include <cstring>
 #include <regex>
+#include <optional>
 
 #include <invader/map/map.hpp>
 #include <invader/resource/resource_map.hpp>
@@ -249,10 +250,11 @@ int main(int argc, const char **argv) {
     close_input(compare_options);
 
     // Automatically make up maps directories for any map when necessary, then open their respective resources
+    File::PathMatcher matcher(compare_options.search, compare_options.search_exclude);
     for(auto &i : compare_options.inputs) {
         // Check if it matches our filters
-        auto add_if_matched = [&i, &compare_options](Invader::File::TagFilePath &&path) {
-            if(File::path_matches(Invader::File::preferred_path_to_halo_path(path.join()).c_str(), compare_options.search, compare_options.search_exclude)) {
+        auto add_if_matched = [&i, &matcher](Invader::File::TagFilePath &&path) {
+            if(matcher.matches(Invader::File::preferred_path_to_halo_path(path.join()).c_str())) {
                 i.tag_paths.emplace_back(std::move(path));
             }
         };
@@ -663,13 +665,29 @@ static void regular_comparison(const std::vector<Input> &inputs, bool precision,
                     }
                 }
                 else {
+                    // Without precision, tags that hash differently are different, so we don't need to walk them
+                    std::optional<std::uint64_t> first_hash;
+                    if(!precision) {
+                        first_hash = first_struct->structural_hash(true);
+                    }
+
                     for(std::size_t i = 1; i < found_count; i++) {
                         std::list<std::string> differences;
                         bool matched = false;
                         bool match_successful;
 
                         try {
-                            matched = first_struct->compare(structs[i].get(), precision, true, verbose ? &differences : nullptr);
+                            if(first_hash.has_value() && *first_hash != structs[i]->structural_hash(true)) {
+                                matched = false;
+                            }
+                            else {
+                                matched = first_struct->compare_fast(*structs[i], precision, true);
+                            }
+
+                            // Only list the differences if there are any
+                            if(!matched && verbose) {
+                                first_struct->compare(structs[i].get(), precision, true, &differences);
+                            }
                             match_successful = true;
                         }
                         catch(std::exception &e) {
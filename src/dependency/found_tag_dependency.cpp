@@ -2,38 +2,23 @@
 
 #include <invader/dependency/found_tag_dependency.hpp>
 #include <invader/printf.hpp>
+#include <invader/error.hpp>
 #include <invader/file/file.hpp>
-#include <invader/tag/parser/parser_struct.hpp>
+#include <invader/tag/parser/tag_view.hpp>
 
 #include <filesystem>
 
 namespace Invader {
     static std::vector<File::TagFilePath> get_dependencies(const std::byte *tag_data, std::size_t tag_data_length) {
-        std::vector<File::TagFilePath> dependencies;
-
-        auto recursively_get_dependencies = [&dependencies](const Parser::ParserStruct &st, auto &recursively_get_dependencies) -> void {
-            for(auto &v : st.get_values()) {
-                switch(v.get_type()) {
-                    case Parser::ParserStructValue::ValueType::VALUE_TYPE_REFLEXIVE: {
-                        auto count = v.get_array_size();
-                        for(std::size_t i = 0; i < count; i++) {
-                            recursively_get_dependencies(v.get_object_in_array(i), recursively_get_dependencies);
-                        }
-                        break;
-                    }
-                    case Parser::ParserStructValue::ValueType::VALUE_TYPE_DEPENDENCY: {
-                        auto &dep = v.get_dependency();
-                        if(!dep.path.empty()) {
-                            dependencies.emplace_back(File::halo_path_to_preferred_path(dep.path), dep.tag_fourcc);
-                        }
-                        break;
-                    }
-                    default: break;
-                }
-            }
-        };
+        // Read the references straight out of the tag file rather than parsing the whole tag
+        std::vector<Parser::DependencyView> dependency_views;
+        Parser::list_hek_tag_file_dependencies(tag_data, tag_data_length, dependency_views);
 
-        recursively_get_dependencies(*Parser::ParserStruct::parse_hek_tag_file(tag_data, tag_data_length), recursively_get_dependencies);
+        std::vector<File::TagFilePath> dependencies;
+        dependencies.reserve(dependency_views.size());
+        for(auto &dep : dependency_views) {
+            dependencies.emplace_back(File::halo_path_to_preferred_path(File::remove_duplicate_slashes(dep.path.data(), dep.path.size())), dep.tag_fourcc);
+        }
 
         return dependencies;
     }
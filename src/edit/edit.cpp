@@ -8,6 +8,8 @@
 #include <invader/tag/hek/header.hpp>
 #include "../crc/crc32.h"
 #include <string>
+#include <invader/parallel/parallel.hpp>
+#include <atomic>
 
 #include "expression.hpp"
 
@@ -41,6 +43,7 @@ struct Actions {
     std::string value;
     std::size_t count = 0;
     std::size_t position = 0;
+    std::vector<Edit::CompiledExpression> expressions = {}; // compiled from value when setting
 };
 
 static std::string get_top_member_name(const std::string &key, std::string &after_member) {
@@ -336,7 +339,25 @@ static std::string get_value(const Parser::ParserStructValue &value, const std::
     }
 }
 
-static void set_value(Parser::ParserStructValue &value, const std::string &new_value, const std::optional<std::string> bitfield = std::nullopt) {
+// Split a comma-separated list of expressions and compile each one so they can be reused for every value being set
+static std::vector<Edit::CompiledExpression> compile_expressions(const std::string &new_value) {
+    std::vector<Edit::CompiledExpression> expressions;
+
+    const char *start = new_value.c_str();
+    const char *cursor;
+    for(cursor = start; *cursor != 0; cursor++) {
+        if(*cursor == ',') {
+            expressions.emplace_back(std::string(start, cursor).c_str());
+            start = ++cursor;
+            continue;
+        }
+    }
+    expressions.emplace_back(std::string(start, cursor).c_str());
+
+    return expressions;
+}
+
+static void set_value(Parser::ParserStructValue &value, const std::string &new_value, const std::vector<Edit::CompiledExpression> &expressions, const std::optional<std::string> bitfield = std::nullopt) {
     auto format = value.get_number_format();
     auto type = value.get_type();
 
@@ -423,20 +444,6 @@ static void set_value(Parser::ParserStructValue &value, const std::string &new_v
     else {
         auto expected_value_count = value.get_value_count();
 
-        std::vector<std::string> expressions;
-        expressions.reserve(expected_value_count);
-
-        const char *start = new_value.c_str();
-        const char *cursor;
-        for(cursor = start; *cursor != 0; cursor++) {
-            if(*cursor == ',') {
-                expressions.emplace_back(start, cursor);
-                start = ++cursor;
-                continue;
-            }
-        }
-        expressions.emplace_back(start, cursor);
-
         if(expressions.size() != expected_value_count) {
             eprintf_error("Expected %zu comma-separated value%s but only got %zu", expected_value_count, expected_value_count == 1 ? "" : "s", expressions.size());
             throw std::exception();
@@ -445,13 +452,13 @@ static void set_value(Parser::ParserStructValue &value, const std::string &new_v
         auto all_values = value.get_values();
         for(std::size_t i = 0; i < expected_value_count; i++) {
             auto &v = all_values[i];
-            auto *e = expressions[i].c_str();
+            auto &e = expressions[i];
             switch(value.get_number_format()) {
                 case Parser::ParserStructValue::NumberFormat::NUMBER_FORMAT_INT:
-                    v = Edit::evaluate_expression(e, std::get<std::int64_t>(v));
+                    v = e.evaluate(std::get<std::int64_t>(v));
                     break;
                 case Parser::ParserStructValue::NumberFormat::NUMBER_FORMAT_FLOAT:
-                    v = Edit::evaluate_expression(e, std::get<double>(v));
+                    v = e.evaluate(std::get<double>(v));
                     break;
                 default:
                     std::terminate();
@@ -782,7 +789,8 @@ int main(int argc, char * const *argv) {
         CommandLineOption("move", 'M', 2, "Swap the selected structs with the structs at the given index or \"end\" if the end of the array. The regions must not intersect.", "<key> <pos>"),
         CommandLineOption("erase", 'E', 1, "Delete the selected struct(s).", "<key>"),
         CommandLineOption("copy", 'c', 2, "Copy the selected struct(s) to the given index or \"end\" if the end of the array.", "<key> <pos>"),
-        CommandLineOption("no-safeguards", 'n', 0, "Allow all tag data to be edited (proceed at your own risk)")
+        CommandLineOption("no-safeguards", 'n', 0, "Allow all tag data to be edited (proceed at your own risk)"),
+        CommandLineOption("threads", 'j', 1, "Set the number of threads to use when editing more than one tag. Default: CPU thread count", "<count>")
     };
 
     static constexpr char DESCRIPTION[] = "Edit tags via command-line.";
@@ -798,6 +806,7 @@ int main(int argc, char * const *argv) {
         bool view_checksum = false;
         std::vector<std::string> batch, batch_exclude;
         std::optional<std::variant<std::string, std::filesystem::path>> overwrite_path;
+        std::size_t max_threads = Parallel::default_thread_count();
     } edit_options;
 
     auto remaining_arguments = CommandLineOption::parse_arguments<EditOptions &>(argc, argv, options, USAGE, DESCRIPTION, 0, 1, edit_options, [](char opt, const std::vector<const char *> &arguments, auto &edit_options) {
@@ -877,6 +886,18 @@ int main(int argc, char * const *argv) {
                     std::exit(EXIT_FAILURE);
                 }
                 break;
+            case 'j':
+                try {
+                    edit_options.max_threads = std::stoi(arguments[0]);
+                    if(edit_options.max_threads < 1) {
+                        throw std::exception();
+                    }
+                }
+                catch(std::exception &) {
+                    eprintf_error("Invalid number of threads %s\n", arguments[0]);
+                    std::exit(EXIT_FAILURE);
+                }
+                break;
         }
     });
 
@@ -886,7 +907,14 @@ int main(int argc, char * const *argv) {
         return EXIT_FAILURE;
     }
 
-    auto do_it_do_it_do_it_do_it = [&edit_options](const std::string &tag_path) -> bool {
+    // Compile expressions once rather than once per value per tag
+    for(auto &i : edit_options.actions) {
+        if(i.type == ActionType::ACTION_TYPE_SET) {
+            i.expressions = compile_expressions(i.value);
+        }
+    }
+
+    auto do_it_do_it_do_it_do_it = [&edit_options](const std::string &tag_path, std::vector<std::string> &output) -> bool {
         std::filesystem::path file_path = std::filesystem::path(edit_options.tags) / tag_path;
         std::unique_ptr<Parser::ParserStruct> tag_struct;
 
@@ -905,12 +933,14 @@ int main(int argc, char * const *argv) {
             // If we're verifying the checksum or viewing the checksum of a new tag, well... okay I guess
             if(edit_options.verify_checksum || edit_options.view_checksum) {
                 if(edit_options.view_checksum) {
-                    std::printf("0x%08X\n", reinterpret_cast<HEK::TagFileHeader *>(tag_struct->generate_hek_tag_data().data())->crc32.read());
+                    char checksum_str[16];
+                    std::snprintf(checksum_str, sizeof(checksum_str), "0x%08X", reinterpret_cast<HEK::TagFileHeader *>(tag_struct->generate_hek_tag_data().data())->crc32.read());
+                    output.emplace_back(checksum_str);
                 }
 
                 // Can't really verify a tag that never existed
                 if(edit_options.verify_checksum) {
-                    std::printf("matched\n");
+                    output.emplace_back("matched");
                 }
             }
         }
@@ -936,16 +966,18 @@ int main(int argc, char * const *argv) {
 
                 // Print the checksum
                 if(edit_options.view_checksum) {
-                    std::printf("0x%08X\n", checksum);
+                    char checksum_str[16];
+                    std::snprintf(checksum_str, sizeof(checksum_str), "0x%08X", checksum);
+                    output.emplace_back(checksum_str);
                 }
 
                 // Verify it's correct
                 if(edit_options.verify_checksum) {
                     if(header->crc32 == ~crc32_buffer(0, value->data() + sizeof(*header), value->size() - sizeof(*header))) {
-                        std::printf("matched\n");
+                        output.emplace_back("matched");
                     }
                     else {
-                        std::printf("mismatched\n");
+                        output.emplace_back("mismatched");
                     }
                 }
             }
@@ -953,7 +985,6 @@ int main(int argc, char * const *argv) {
             tag_class = reinterpret_cast<const HEK::TagFileHeader *>(value->data())->tag_fourcc;
         }
 
-        std::vector<std::string> output;
         bool should_save = edit_options.new_tag; // by default only save if making a new tag. this will be set to true if --set, --insert, --copy, --move, or --delete are used too
 
         for(auto &i : edit_options.actions) {
@@ -979,7 +1010,7 @@ int main(int argc, char * const *argv) {
                     should_save = true;
                     auto arr = get_values_for_key(tag_struct.get(), i.key == "" ? "" : (std::string(".") + i.key), bitfield, edit_options.check_read_only);
                     for(auto &k : arr) {
-                        set_value(k, i.value, bitfield);
+                        set_value(k, i.value, i.expressions, bitfield);
                     }
                     break;
                 }
@@ -1079,10 +1110,6 @@ int main(int argc, char * const *argv) {
             }
         }
 
-        for(auto &i : output) {
-            std::puts(i.c_str());
-        }
-
         // If we're overwriting a file that isn't the main one, let's find out what
         bool create_directories_if_possible = false;
 
@@ -1121,7 +1148,7 @@ int main(int argc, char * const *argv) {
                 std::filesystem::create_directories(file_path.parent_path(), ec);
             }
 
-            if(!File::save_file(file_path, tag_struct->generate_hek_tag_data(tag_class))) {
+            if(!File::save_file_atomically(file_path, tag_struct->generate_hek_tag_data(tag_class))) {
                 eprintf_error("Unable to write to %s", file_path.string().c_str());
                 return false;
             }
@@ -1134,32 +1161,59 @@ int main(int argc, char * const *argv) {
 
     if(use_batching) {
         auto v = File::load_virtual_tag_folder({edit_options.tags});
-        std::size_t count = 0;
-        std::size_t total = 0;
+        File::PathMatcher matcher(edit_options.batch, edit_options.batch_exclude);
+
+        std::vector<std::string> batch_tags;
         for(auto &t : v) {
-            if(File::path_matches(t.tag_path.c_str(), edit_options.batch, edit_options.batch_exclude)) {
-                try {
-                    if(do_it_do_it_do_it_do_it(File::halo_path_to_preferred_path(t.tag_path))) {
-                        count++;
-                        oprintf_success("Successfully edited %s", t.tag_path.c_str());
-                    }
-                }
-                catch(std::exception &e) {
-                    eprintf_error("Failed to edit %s", t.tag_path.c_str());
-                }
-                total++;
+            if(matcher.matches(t.tag_path.c_str())) {
+                batch_tags.emplace_back(std::move(t.tag_path));
             }
         }
 
+        // Every tag would be saved to the same path, so only one tag can be edited at a time
+        std::size_t thread_count = edit_options.overwrite_path.has_value() ? 1 : edit_options.max_threads;
+
+        // Each tag's output and result is printed in order
+        std::atomic<std::size_t> count = 0;
+        std::size_t total = batch_tags.size();
+        Parallel(thread_count).for_each(total, [&batch_tags, &count, &do_it_do_it_do_it_do_it](std::size_t t) {
+            auto &tag_path = batch_tags[t];
+            std::vector<std::string> output;
+            bool success;
+            try {
+                success = do_it_do_it_do_it_do_it(File::halo_path_to_preferred_path(tag_path), output);
+            }
+            catch(std::exception &) {
+                success = false;
+            }
+
+            for(auto &i : output) {
+                oprintf("%s\n", i.c_str());
+            }
+
+            if(success) {
+                count++;
+                oprintf_success("Successfully edited %s", tag_path.c_str());
+            }
+            else {
+                eprintf_error("Failed to edit %s", tag_path.c_str());
+            }
+        });
+
         auto error_count = total - count;
         if(error_count > 0) {
-            oprintf_success_warn("Edited %zu out of %zu tag%s (%zu error%s)", count, total, total == 1 ? "" : "s", error_count, error_count == 1 ? "" : "s");
+            oprintf_success_warn("Edited %zu out of %zu tag%s (%zu error%s)", count.load(), total, total == 1 ? "" : "s", error_count, error_count == 1 ? "" : "s");
         }
         else {
-            oprintf_success("Edited %zu out of %zu tag%s", count, total, total == 1 ? "" : "s");
+            oprintf_success("Edited %zu out of %zu tag%s", count.load(), total, total == 1 ? "" : "s");
         }
     }
     else {
-        return do_it_do_it_do_it_do_it(File::halo_path_to_preferred_path(remaining_arguments[0])) ? EXIT_SUCCESS : EXIT_FAILURE;
+        std::vector<std::string> output;
+        auto result = do_it_do_it_do_it_do_it(File::halo_path_to_preferred_path(remaining_arguments[0]), output);
+        for(auto &i : output) {
+            std::puts(i.c_str());
+        }
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
     }
 }
@@ -8,59 +8,64 @@
 #include <cassert>
 #include <optional>
 #include <cmath>
-
-template <typename Number, Number number_from_value(const std::string &what)> static Number evaluate_expression_of_type(const char *expression, Number input) {
-    struct ParsedToken {
-        enum Type {
-            GROUP,
-            NUMBER,
-            INPUT,
-            POWER,
-            ADD,
-            SUBTRACT,
-            MULTIPLY,
-            DIVIDE
-        } type;
-
-        bool is_operator() const noexcept {
-            switch(this->type) {
-                case Type::ADD:
-                case Type::SUBTRACT:
-                case Type::MULTIPLY:
-                case Type::DIVIDE:
-                case Type::POWER:
-                    return true;
-                default:
-                    return false;
-            }
+#include <type_traits>
+#include <exception>
+#include <invader/printf.hpp>
+
+template <typename Number> struct ParsedToken {
+    enum Type {
+        GROUP,
+        NUMBER,
+        INPUT,
+        POWER,
+        ADD,
+        SUBTRACT,
+        MULTIPLY,
+        DIVIDE
+    } type;
+
+    bool is_operator() const noexcept {
+        switch(this->type) {
+            case Type::ADD:
+            case Type::SUBTRACT:
+            case Type::MULTIPLY:
+            case Type::DIVIDE:
+            case Type::POWER:
+                return true;
+            default:
+                return false;
         }
+    }
 
-        int operator_priority() noexcept {
-            assert(this->is_operator());
-
-            switch(this->type) {
-                case Type::ADD:
-                case Type::SUBTRACT:
-                    return 1;
-                case Type::MULTIPLY:
-                case Type::DIVIDE:
-                    return 2;
-                case Type::POWER:
-                    return 3;
-                default:
-                    std::terminate();
-            }
+    int operator_priority() noexcept {
+        assert(this->is_operator());
+
+        switch(this->type) {
+            case Type::ADD:
+            case Type::SUBTRACT:
+                return 1;
+            case Type::MULTIPLY:
+            case Type::DIVIDE:
+                return 2;
+            case Type::POWER:
+                return 3;
+            default:
+                std::terminate();
         }
+    }
 
-        std::vector<ParsedToken> group;
-        Number number = 1.0; // multiplier if group/input. number if number
+    std::vector<ParsedToken> group;
+    Number number = 1.0; // multiplier if group/input. number if number
 
-        // These next four lines somehow make GCC not scream at me for use-after-free warnings
-        ParsedToken() = default;
-        ParsedToken(ParsedToken &&moving) = default;
-        ParsedToken(const ParsedToken &moving) = default;
-        ParsedToken &operator=(const ParsedToken &moving) = default;
-    };
+    // These next four lines somehow make GCC not scream at me for use-after-free warnings
+    ParsedToken() = default;
+    ParsedToken(ParsedToken &&moving) = default;
+    ParsedToken(const ParsedToken &moving) = default;
+    ParsedToken &operator=(const ParsedToken &moving) = default;
+};
+
+template <typename Number, Number number_from_value(const std::string &what)> static ParsedToken<Number> parse_expression_of_type(const char *expression) {
+    using ParsedToken = ::ParsedToken<Number>;
 
     // Get tokens
     std::vector<std::string> tokens;
@@ -291,56 +296,145 @@ template <typename Number, Number number_from_value(const std::string &what)> st
 
     recursively_sort_group(main_group, recursively_sort_group);
 
-    // Now we can evaluate it!
-    auto recursively_evaluate_token = [](const ParsedToken &token, Number input, auto &recursively_evaluate_token) -> Number {
-        switch(token.type) {
-            case ParsedToken::Type::INPUT:
-                return input * token.number;
-            case ParsedToken::Type::NUMBER:
-                return token.number;
-            case ParsedToken::Type::GROUP: {
-                Number value = 0.0;
-                auto op = ParsedToken::Type::ADD;
-                auto length = token.group.size();
-                for(std::size_t i = 0; i < length; i+=2) {
-                    auto last = i + 1 == length;
-                    auto next_value = recursively_evaluate_token(token.group[i], input, recursively_evaluate_token);
-                    switch(op) {
-                        case ParsedToken::Type::ADD:
-                            value += next_value;
-                            break;
-                        case ParsedToken::Type::SUBTRACT:
-                            value -= next_value;
-                            break;
-                        case ParsedToken::Type::MULTIPLY:
-                            value *= next_value;
-                            break;
-                        case ParsedToken::Type::DIVIDE:
-                            if(next_value == 0) {
-                                std::fputs("Division by zero!\n", stderr);
-                                throw std::exception();
-                            }
-                            value /= next_value;
-                            break;
-                        case ParsedToken::Type::POWER:
-                            value = std::pow(value, next_value);
-                            break;
-                        default:
-                            assert(false);
-                    }
-                    if(!last) {
-                        op = token.group[i+1].type;
-                    }
+    return main_group;
+}
+
+template <typename Number> static void compile_token(const ParsedToken<Number> &token, Invader::Edit::CompiledExpression::Program<Number> &program, std::size_t &depth) {
+    using Edit = Invader::Edit::CompiledExpression;
+    using Type = typename ParsedToken<Number>::Type;
+
+    auto push = [&program, &depth](Edit::Operation operation, Number number) {
+        program.instructions.push_back({ operation, number });
+        if(++depth > program.stack_size) {
+            program.stack_size = depth;
+        }
+    };
+
+    switch(token.type) {
+        case Type::INPUT:
+            push(Edit::OPERATION_PUSH_INPUT, token.number);
+            return;
+        case Type::NUMBER:
+            push(Edit::OPERATION_PUSH_NUMBER, token.number);
+            return;
+        case Type::GROUP: {
+            // Groups are folded left to right starting from 0, so the first value gets 0 added to it (this only matters
+            // for floats, where it turns -0 into 0)
+            auto &first = token.group[0];
+            if(first.type == Type::NUMBER) {
+                push(Edit::OPERATION_PUSH_NUMBER, static_cast<Number>(first.number + 0));
+            }
+            else {
+                compile_token(first, program, depth);
+                if constexpr(std::is_floating_point<Number>::value) {
+                    program.instructions.push_back({ Edit::OPERATION_ADD_ZERO, 0 });
                 }
-                return value;
             }
-            default:
-                assert(false);
-                std::terminate();
+
+            for(std::size_t i = 2; i < token.group.size(); i += 2) {
+                compile_token(token.group[i], program, depth);
+
+                Edit::Operation operation;
+                switch(token.group[i - 1].type) {
+                    case Type::ADD:
+                        operation = Edit::OPERATION_ADD;
+                        break;
+                    case Type::SUBTRACT:
+                        operation = Edit::OPERATION_SUBTRACT;
+                        break;
+                    case Type::MULTIPLY:
+                        operation = Edit::OPERATION_MULTIPLY;
+                        break;
+                    case Type::DIVIDE:
+                        operation = Edit::OPERATION_DIVIDE;
+                        break;
+                    case Type::POWER:
+                        operation = Edit::OPERATION_POWER;
+                        break;
+                    default:
+                        std::terminate();
+                }
+                program.instructions.push_back({ operation, 0 });
+                depth--;
+            }
+            return;
         }
-    };
+        default:
+            std::terminate();
+    }
+}
 
-    return recursively_evaluate_token(main_group, input, recursively_evaluate_token);
+template <typename Number, Number number_from_value(const std::string &what)> static Invader::Edit::CompiledExpression::Program<Number> compile_expression_of_type(const char *expression) {
+    Invader::Edit::CompiledExpression::Program<Number> program;
+    try {
+        auto main_group = parse_expression_of_type<Number, number_from_value>(expression);
+        std::size_t depth = 0;
+        compile_token(main_group, program, depth);
+        program.valid = true;
+    }
+    catch(std::exception &) {
+        program.instructions.clear();
+    }
+    return program;
+}
+
+template <typename Number> static Number evaluate_program(const Invader::Edit::CompiledExpression::Program<Number> &program, Number input) {
+    using Edit = Invader::Edit::CompiledExpression;
+
+    if(!program.valid) {
+        throw std::exception();
+    }
+
+    // Most expressions are only a few values deep, so avoid allocating
+    Number small_stack[32];
+    std::vector<Number> large_stack;
+    Number *stack = small_stack;
+    if(program.stack_size > sizeof(small_stack) / sizeof(*small_stack)) {
+        large_stack.resize(program.stack_size);
+        stack = large_stack.data();
+    }
+
+    std::size_t top = 0;
+    for(auto &i : program.instructions) {
+        switch(i.operation) {
+            case Edit::OPERATION_PUSH_NUMBER:
+                stack[top++] = i.number;
+                break;
+            case Edit::OPERATION_PUSH_INPUT:
+                stack[top++] = input * i.number;
+                break;
+            case Edit::OPERATION_ADD_ZERO:
+                stack[top - 1] += 0;
+                break;
+            case Edit::OPERATION_ADD:
+                top--;
+                stack[top - 1] += stack[top];
+                break;
+            case Edit::OPERATION_SUBTRACT:
+                top--;
+                stack[top - 1] -= stack[top];
+                break;
+            case Edit::OPERATION_MULTIPLY:
+                top--;
+                stack[top - 1] *= stack[top];
+                break;
+            case Edit::OPERATION_DIVIDE:
+                top--;
+                if(stack[top] == 0) {
+                    eprintf_error("Division by zero!");
+                    throw std::exception();
+                }
+                stack[top - 1] /= stack[top];
+                break;
+            case Edit::OPERATION_POWER:
+                top--;
+                stack[top - 1] = static_cast<Number>(std::pow(stack[top - 1], stack[top]));
+                break;
+        }
+    }
+
+    assert(top == 1);
+    return stack[0];
 }
 
 static double string_to_double(const std::string &what) {
@@ -352,10 +446,22 @@ static std::int64_t string_to_int(const std::string &what) {
 }
 
 namespace Invader::Edit {
+    CompiledExpression::CompiledExpression(const char *expression) :
+        float_program(compile_expression_of_type<double, string_to_double>(expression)),
+        int_program(compile_expression_of_type<std::int64_t, string_to_int>(expression)) {}
+
+    double CompiledExpression::evaluate(double input) const {
+        return evaluate_program(this->float_program, input);
+    }
+
+    std::int64_t CompiledExpression::evaluate(std::int64_t input) const {
+        return evaluate_program(this->int_program, input);
+    }
+
     double evaluate_expression(const char *expression, double input) {
-        return evaluate_expression_of_type<double, string_to_double>(expression, input);
+        return evaluate_program(compile_expression_of_type<double, string_to_double>(expression), input);
     }
     std::int64_t evaluate_expression(const char *expression, std::int64_t input) {
-        return evaluate_expression_of_type<std::int64_t, string_to_int>(expression, input);
+        return evaluate_program(compile_expression_of_type<std::int64_t, string_to_int>(expression), input);
     }
 }
@@ -4,8 +4,65 @@
 #define INVADER__EDIT__EXPRESSION_HPP
 
 #include <cstdint>
+#include <cstddef>
+#include <vector>
 
 namespace Invader::Edit {
+    /**
+     * An expression compiled into a postfix program so it can be evaluated many times without parsing it again
+     */
+    class CompiledExpression {
+    public:
+        /**
+         * Compile the expression for both integer and floating point inputs; invalid expressions are only reported when
+         * they are evaluated
+         * @param expression expression to compile
+         */
+        CompiledExpression(const char *expression);
+
+        /**
+         * Evaluate the expression with the given input
+         * @param input value of n
+         * @return      result
+         * @throws      if the expression is invalid or divides by zero
+         */
+        double evaluate(double input) const;
+
+        /**
+         * Evaluate the expression with the given input
+         * @param input value of n
+         * @return      result
+         * @throws      if the expression is invalid or divides by zero
+         */
+        std::int64_t evaluate(std::int64_t input) const;
+
+        enum Operation : std::uint8_t {
+            OPERATION_PUSH_NUMBER,
+            OPERATION_PUSH_INPUT,
+            OPERATION_ADD_ZERO,
+            OPERATION_ADD,
+            OPERATION_SUBTRACT,
+            OPERATION_MULTIPLY,
+            OPERATION_DIVIDE,
+            OPERATION_POWER
+        };
+
+        template <typename Number> struct Instruction {
+            Operation operation;
+            Number number; // number to push, or multiplier of the input
+        };
+
+        template <typename Number> struct Program {
+            std::vector<Instruction<Number>> instructions;
+            std::size_t stack_size = 0;
+            bool valid = false;
+        };
+
+    private:
+        Program<double> float_program;
+        Program<std::int64_t> int_program;
+    };
+
     double evaluate_expression(const char *expression, double input);
     std::int64_t evaluate_expression(const char *expression, std::int64_t input);
 }
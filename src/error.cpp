@@ -2,6 +2,7 @@
 
 #include <invader/error.hpp>
 #include <invader/printf.hpp>
+#include <cstdarg>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -52,3 +53,65 @@ void set_up_color_term() noexcept {
 bool is_on_color_term() noexcept {
     return on_color_term;
 }
+
+static thread_local PrintfBuffer *printf_buffer = nullptr;
+
+PrintfBuffer *set_printf_buffer(PrintfBuffer *buffer) noexcept {
+    auto *previous = printf_buffer;
+    printf_buffer = buffer;
+    return previous;
+}
+
+int buffered_fprintf(std::FILE *stream, const char *format, ...) noexcept {
+    std::va_list args;
+    va_start(args, format);
+
+    int result;
+    if(printf_buffer == nullptr) {
+        result = std::vfprintf(stream, format, args);
+    }
+    else {
+        std::va_list args_copy;
+        va_copy(args_copy, args);
+        result = std::vsnprintf(nullptr, 0, format, args_copy);
+        va_end(args_copy);
+
+        if(result > 0) {
+            try {
+                // Keep text for the same stream together so it is written at once
+                if(printf_buffer->empty() || printf_buffer->back().first != stream) {
+                    printf_buffer->emplace_back(stream, std::string());
+                }
+                auto &text = printf_buffer->back().second;
+                auto offset = text.size();
+                text.resize(offset + result + 1);
+                std::vsnprintf(text.data() + offset, result + 1, format, args);
+                text.resize(offset + result);
+            }
+            catch(std::exception &) {
+                result = -1;
+            }
+        }
+    }
+
+    va_end(args);
+    return result;
+}
+
+PrintfBuffer *get_printf_buffer() noexcept {
+    return printf_buffer;
+}
+
+void flush_printf_buffer(PrintfBuffer &buffer, PrintfBuffer *destination) noexcept {
+    for(auto &i : buffer) {
+        if(destination != nullptr) {
+            try {
+                destination->emplace_back(std::move(i));
+                continue;
+            }
+            catch(std::exception &) {}
+        }
+        std::fwrite(i.second.data(), 1, i.second.size(), i.first);
+    }
+    buffer.clear();
+}
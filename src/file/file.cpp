@@ -2,6 +2,11 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 #include <invader/file/file.hpp>
@@ -12,6 +17,7 @@
 #include <filesystem>
 #include <cstring>
 #include <climits>
+#include <algorithm>
 
 namespace Invader::File {
     std::optional<std::vector<std::byte>> open_file(const std::filesystem::path &path) {
@@ -73,6 +79,33 @@ namespace Invader::File {
         return file_data;
     }
 
+    std::optional<std::vector<std::string>> open_list_file(const std::filesystem::path &path) {
+        auto file = open_file(path);
+        if(!file.has_value()) {
+            return std::nullopt;
+        }
+
+        std::vector<std::string> lines;
+        std::string line;
+        for(auto b : *file) {
+            auto c = static_cast<char>(b);
+            if(c == '\n' || c == '\r') {
+                if(!line.empty()) {
+                    lines.emplace_back(std::move(line));
+                    line.clear();
+                }
+            }
+            else {
+                line += c;
+            }
+        }
+        if(!line.empty()) {
+            lines.emplace_back(std::move(line));
+        }
+
+        return lines;
+    }
+
     bool save_file(const std::filesystem::path &path, const std::vector<std::byte> &data) {
         // Open the file
         auto path_string = path.string();
@@ -92,6 +125,119 @@ namespace Invader::File {
         std::fclose(f);
         return true;
     }
+
+    bool save_file_atomically(const std::filesystem::path &path, const std::vector<std::byte> &data) {
+        auto temporary_path = path;
+        temporary_path += ".tmp";
+
+        // Don't leave a partially written temporary file behind
+        std::error_code ec;
+        if(!save_file(temporary_path, data)) {
+            eprintf_error("Failed to replace %s", path.string().c_str());
+            std::filesystem::remove(temporary_path, ec);
+            return false;
+        }
+
+        std::filesystem::rename(temporary_path, path, ec);
+        if(ec) {
+            eprintf_error("Failed to replace %s: %s", path.string().c_str(), ec.message().c_str());
+            std::filesystem::remove(temporary_path, ec);
+            return false;
+        }
+
+        return true;
+    }
+
+    std::optional<MemoryMappedFile> MemoryMappedFile::map_file(const std::filesystem::path &path) {
+        auto path_string = path.string();
+        MemoryMappedFile file;
+
+        #ifdef _WIN32
+        HANDLE file_handle = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(file_handle == INVALID_HANDLE_VALUE) {
+            eprintf("Error: Failed to open %s for reading.\n", path_string.c_str());
+            return std::nullopt;
+        }
+
+        LARGE_INTEGER size;
+        if(!GetFileSizeEx(file_handle, &size)) {
+            CloseHandle(file_handle);
+            eprintf("Error: Failed to query the size of %s for reading.\n", path_string.c_str());
+            return std::nullopt;
+        }
+
+        file.mapping_size = static_cast<std::size_t>(size.QuadPart);
+        if(file.mapping_size > 0) {
+            HANDLE mapping_handle = CreateFileMappingW(file_handle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+            if(mapping_handle != nullptr) {
+                file.mapping = reinterpret_cast<std::byte *>(MapViewOfFile(mapping_handle, FILE_MAP_COPY, 0, 0, 0));
+                CloseHandle(mapping_handle);
+            }
+        }
+        CloseHandle(file_handle);
+        #else
+        int fd = open(path_string.c_str(), O_RDONLY);
+        if(fd < 0) {
+            eprintf("Error: Failed to open %s for reading.\n", path_string.c_str());
+            return std::nullopt;
+        }
+
+        struct stat file_stat;
+        if(fstat(fd, &file_stat) != 0) {
+            close(fd);
+            eprintf("Error: Failed to query the size of %s for reading.\n", path_string.c_str());
+            return std::nullopt;
+        }
+
+        file.mapping_size = static_cast<std::size_t>(file_stat.st_size);
+        if(file.mapping_size > 0) {
+            void *mapping = mmap(nullptr, file.mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if(mapping != MAP_FAILED) {
+                file.mapping = reinterpret_cast<std::byte *>(mapping);
+            }
+        }
+        close(fd);
+        #endif
+
+        if(file.mapping_size > 0 && file.mapping == nullptr) {
+            eprintf("Error: Failed to map %s into memory.\n", path_string.c_str());
+            return std::nullopt;
+        }
+
+        return file;
+    }
+
+    MemoryMappedFile::MemoryMappedFile(MemoryMappedFile &&move) noexcept : mapping(move.mapping), mapping_size(move.mapping_size) {
+        move.mapping = nullptr;
+        move.mapping_size = 0;
+    }
+
+    MemoryMappedFile &MemoryMappedFile::operator=(MemoryMappedFile &&move) noexcept {
+        if(this != &move) {
+            this->unmap();
+            this->mapping = move.mapping;
+            this->mapping_size = move.mapping_size;
+            move.mapping = nullptr;
+            move.mapping_size = 0;
+        }
+        return *this;
+    }
+
+    MemoryMappedFile::~MemoryMappedFile() {
+        this->unmap();
+    }
+
+    void MemoryMappedFile::unmap() noexcept {
+        if(this->mapping != nullptr) {
+            #ifdef _WIN32
+            UnmapViewOfFile(this->mapping);
+            #else
+            munmap(this->mapping, this->mapping_size);
+            #endif
+            this->mapping = nullptr;
+        }
+        this->mapping_size = 0;
+    }
     
     std::optional<std::filesystem::path> tag_path_to_file_path(const std::string &tag_path, const std::vector<std::filesystem::path> &tags) {
         for(auto &i : tags) {
@@ -468,23 +614,36 @@ namespace Invader::File {
     }
 
 
+    static constexpr bool is_path_separator(char c) noexcept {
+        return c == '\\' || c == '/' || c == INVADER_PREFERRED_PATH_SEPARATOR;
+    }
+
     std::string remove_duplicate_slashes(const std::string &path) {
-        const char *tag_path_c = path.c_str();
-        std::vector<char> tag_path_cv(tag_path_c, tag_path_c + path.size() + 1);
-        remove_duplicate_slashes_chars(tag_path_cv.data());
-        return tag_path_cv.data();
+        return remove_duplicate_slashes(path.c_str(), std::strlen(path.c_str()));
+    }
+
+    std::string remove_duplicate_slashes(const char *path, std::size_t length) {
+        // Build the path in one go rather than shifting the rest of the string down for every slash removed
+        std::string result;
+        result.reserve(length);
+        for(std::size_t i = 0; i < length; i++) {
+            result.push_back(path[i]);
+            if(is_path_separator(path[i]) && i + 1 < length && is_path_separator(path[i + 1])) {
+                i++;
+            }
+        }
+        return result;
     }
 
     void remove_duplicate_slashes_chars(char *path) {
-        for(char *i = path; *i; i++) {
-            char this_i = i[0];
-            char next_i = i[1];
-            if((this_i == '\\' || this_i == '/' || this_i == INVADER_PREFERRED_PATH_SEPARATOR) && (next_i == '\\' || next_i == '/' || next_i == INVADER_PREFERRED_PATH_SEPARATOR)) {
-                for(char *j = i + 1; *j; j++) {
-                    j[0] = j[1];
-                }
+        char *o = path;
+        for(const char *i = path; *i; i++) {
+            *(o++) = *i;
+            if(is_path_separator(i[0]) && is_path_separator(i[1])) {
+                i++;
             }
         }
+        *o = 0;
     }
     
     void check_working_directory(const char *file) {
@@ -503,39 +662,46 @@ namespace Invader::File {
         }
     }
     
+    static constexpr char normalize_path_char(char c) noexcept {
+        return is_path_separator(c) ? '/' : c;
+    }
+
     bool path_matches(const char *path, const char *pattern) noexcept {
-        for(const char *p = pattern;; p++) {
-            // End of string
-            if(*p == *path && *p == 0) {
-                return true;
-            }
-            else if(
-                (*p == '?' || *p == *path) || 
-                ((*p == '/' || *p == '\\' || *p == INVADER_PREFERRED_PATH_SEPARATOR) && (*path == '\\' || *path == '/' || *path == INVADER_PREFERRED_PATH_SEPARATOR))
-            ) {
-                path++;
-                continue;
-            }
-            else if(*p == '*') {
-                // Skip duplicates
+        // Match left to right, and when something doesn't match, go back to the last * and let it take one more character.
+        // Only the last * ever needs to be revisited, so this doesn't blow up on patterns with many *'s.
+        const char *p = pattern;
+        const char *star = nullptr;
+        const char *star_path = nullptr;
+
+        while(*path) {
+            if(*p == '*') {
                 while(*p == '*') {
                     p++;
                 }
                 if(*p == 0) {
                     return true;
                 }
-                for(const char *s = path; *s; s++) {
-                    if(path_matches(s, p)) {
-                        return true;
-                    }
-                }
-                return false;
+                star = p;
+                star_path = path;
+            }
+            else if(*p != 0 && (*p == '?' || normalize_path_char(*p) == normalize_path_char(*path))) {
+                p++;
+                path++;
+            }
+            else if(star != nullptr) {
+                p = star;
+                path = ++star_path;
             }
             else {
                 return false;
             }
         }
-        return true;
+
+        // Any *'s left over can match nothing
+        while(*p == '*') {
+            p++;
+        }
+        return *p == 0;
     }
     
     bool path_matches(const char *path, const std::vector<std::string> &include, const std::vector<std::string> &exclude) noexcept {
@@ -556,4 +722,85 @@ namespace Invader::File {
         // If include is empty, we're good
         return include.empty();
     }
+
+    PathMatcher::PathMatcher(const std::vector<std::string> &include, const std::vector<std::string> &exclude) {
+        this->include.reserve(include.size());
+        for(auto &i : include) {
+            this->include.emplace_back(compile(i));
+        }
+        this->exclude.reserve(exclude.size());
+        for(auto &e : exclude) {
+            this->exclude.emplace_back(compile(e));
+        }
+    }
+
+    PathMatcher::Pattern PathMatcher::compile(const std::string &pattern) {
+        Pattern compiled = {};
+
+        // Collapse repeated *'s and use the same separator for everything
+        for(char c : pattern) {
+            if(c == '*' && !compiled.pattern.empty() && compiled.pattern.back() == '*') {
+                continue;
+            }
+            compiled.pattern.push_back(normalize_path_char(c));
+        }
+
+        auto first_wildcard = compiled.pattern.find_first_of("*?");
+        auto last_star = compiled.pattern.rfind('*');
+        compiled.literal = first_wildcard == std::string::npos;
+        compiled.prefix_length = compiled.literal ? compiled.pattern.size() : first_wildcard;
+        if(last_star != std::string::npos && compiled.pattern.find('?', last_star) == std::string::npos) {
+            compiled.suffix_length = compiled.pattern.size() - last_star - 1;
+        }
+        compiled.minimum_length = compiled.pattern.size() - std::count(compiled.pattern.begin(), compiled.pattern.end(), '*');
+
+        return compiled;
+    }
+
+    bool PathMatcher::matches(const Pattern &pattern, const char *path, std::size_t path_length) noexcept {
+        if(path_length < pattern.minimum_length || (pattern.literal && path_length != pattern.pattern.size())) {
+            return false;
+        }
+
+        // Check the fixed ends first since most paths fail here
+        const char *p = pattern.pattern.c_str();
+        for(std::size_t i = 0; i < pattern.prefix_length; i++) {
+            if(p[i] != normalize_path_char(path[i])) {
+                return false;
+            }
+        }
+        if(pattern.literal) {
+            return true;
+        }
+        const char *p_suffix = p + pattern.pattern.size() - pattern.suffix_length;
+        const char *path_suffix = path + path_length - pattern.suffix_length;
+        for(std::size_t i = 0; i < pattern.suffix_length; i++) {
+            if(p_suffix[i] != normalize_path_char(path_suffix[i])) {
+                return false;
+            }
+        }
+
+        return path_matches(path + pattern.prefix_length, p + pattern.prefix_length);
+    }
+
+    bool PathMatcher::matches(const char *path) const noexcept {
+        auto path_length = std::strlen(path);
+
+        // Check if excluded
+        for(auto &e : this->exclude) {
+            if(matches(e, path, path_length)) {
+                return false;
+            }
+        }
+
+        // Check if included
+        for(auto &i : this->include) {
+            if(matches(i, path, path_length)) {
+                return true;
+            }
+        }
+
+        // If include is empty, we're good
+        return this->include.empty();
+    }
 }
@@ -1,5 +1,6 @@
 // SPDX-License-Identifier: GPL-3.0-only
 
+#include <algorithm>
 #include <cmath>
 
 #include <invader/hek/data_type.hpp>
@@ -237,12 +238,155 @@ namespace Invader::HEK {
         return (compress_float<11>(i)) | (compress_float<11>(j) << 11) | (compress_float<10>(k) << 22);
     }
 
-    void decompress_vector(std::uint32_t v, float &i, float &j, float &k) {
+    void decompress_vector(std::uint32_t v, float &i, float &j, float &k) noexcept {
         i = decompress_float<11>(v);
         j = decompress_float<11>(v >> 11);
         k = decompress_float<10>(v >> 22);
     }
 
+    // Number of values to process at a time in the batch kernels below
+    static constexpr std::size_t BATCH_SIZE = 256;
+
+    // Same as compress_float() on each float, but done in passes so the compiler can vectorize each one (clamping,
+    // converting, and picking a result all in one loop keeps it from doing so)
+    template<unsigned int bits> static void compress_floats(const float *input, std::uint32_t *output, std::size_t count) noexcept {
+        constexpr const std::uint32_t SIGNED_BIT = 1 << (bits - 1);
+        constexpr const std::uint32_t MASK = SIGNED_BIT - 1;
+
+        float clamped[BATCH_SIZE];
+        std::uint32_t positive[BATCH_SIZE], negative[BATCH_SIZE];
+
+        for(std::size_t v = 0; v < count; v++) {
+            clamped[v] = std::max(std::min(input[v], 1.0F), -1.0F);
+        }
+
+        // Going through std::int32_t keeps the result that doesn't get used from being an out-of-range conversion
+        for(std::size_t v = 0; v < count; v++) {
+            positive[v] = static_cast<std::uint32_t>(static_cast<std::int32_t>(clamped[v] * MASK + 0.5F));
+            negative[v] = static_cast<std::uint32_t>(static_cast<std::int32_t>((1.0 + clamped[v]) * MASK + 0.5)) | SIGNED_BIT;
+        }
+
+        for(std::size_t v = 0; v < count; v++) {
+            output[v] = clamped[v] >= 0.0F ? positive[v] : negative[v];
+        }
+    }
+
+    void compress_vectors(const float *i, const float *j, const float *k, std::uint32_t *compressed, std::size_t count) noexcept {
+        std::uint32_t compressed_i[BATCH_SIZE], compressed_j[BATCH_SIZE], compressed_k[BATCH_SIZE];
+
+        for(std::size_t first = 0; first < count; first += BATCH_SIZE) {
+            std::size_t batch_count = std::min(count - first, BATCH_SIZE);
+            compress_floats<11>(i + first, compressed_i, batch_count);
+            compress_floats<11>(j + first, compressed_j, batch_count);
+            compress_floats<10>(k + first, compressed_k, batch_count);
+            for(std::size_t v = 0; v < batch_count; v++) {
+                compressed[first + v] = compressed_i[v] | (compressed_j[v] << 11) | (compressed_k[v] << 22);
+            }
+        }
+    }
+
+    void decompress_vectors(const std::uint32_t *compressed, float *i, float *j, float *k, std::size_t count) noexcept {
+        for(std::size_t v = 0; v < count; v++) {
+            decompress_vector(compressed[v], i[v], j[v], k[v]);
+        }
+    }
+
+    void normalize_vectors(float *i, float *j, float *k, std::size_t count) noexcept {
+        // Same as Vector3D::normalize(), but without branching
+        for(std::size_t v = 0; v < count; v++) {
+            float distance = std::sqrt(i[v]*i[v] + j[v]*j[v] + k[v]*k[v]);
+            float m_distance = 1.0F / distance;
+            bool zero = distance == 0.0F;
+            i[v] = zero ? 0.0F : i[v] * m_distance;
+            j[v] = zero ? 0.0F : j[v] * m_distance;
+            k[v] = zero ? 1.0F : k[v] * m_distance;
+        }
+    }
+
+    void compress_model_vertices(const ModelVertexUncompressed<NativeEndian> *vertices, ModelVertexCompressed<NativeEndian> *compressed, std::size_t count) noexcept {
+        float i[3][BATCH_SIZE], j[3][BATCH_SIZE], k[3][BATCH_SIZE];
+        std::uint32_t vectors[3][BATCH_SIZE];
+
+        for(std::size_t first = 0; first < count; first += BATCH_SIZE) {
+            std::size_t batch_count = std::min(count - first, BATCH_SIZE);
+            auto *batch_vertices = vertices + first;
+            auto *batch_compressed = compressed + first;
+
+            // Split the normals, binormals, and tangents into their components, then compress them all at once
+            for(std::size_t v = 0; v < batch_count; v++) {
+                auto &vertex = batch_vertices[v];
+                i[0][v] = vertex.normal.i;
+                j[0][v] = vertex.normal.j;
+                k[0][v] = vertex.normal.k;
+                i[1][v] = vertex.binormal.i;
+                j[1][v] = vertex.binormal.j;
+                k[1][v] = vertex.binormal.k;
+                i[2][v] = vertex.tangent.i;
+                j[2][v] = vertex.tangent.j;
+                k[2][v] = vertex.tangent.k;
+            }
+            for(std::size_t c = 0; c < 3; c++) {
+                compress_vectors(i[c], j[c], k[c], vectors[c], batch_count);
+            }
+
+            for(std::size_t v = 0; v < batch_count; v++) {
+                auto &vertex = batch_vertices[v];
+                auto &r = batch_compressed[v];
+                r.position = vertex.position;
+                r.node0_index = vertex.node0_index > Invader::Parser::MaxCompressedModelNodeIndex::MAX_COMPRESSED_MODEL_NODE_INDEX ? -3 : vertex.node0_index * 3;
+                r.node0_weight = static_cast<std::int16_t>(compress_float<16>(vertex.node0_weight));
+                r.node1_index = vertex.node1_index > Invader::Parser::MaxCompressedModelNodeIndex::MAX_COMPRESSED_MODEL_NODE_INDEX ? -3 : vertex.node1_index * 3;
+                r.texture_coordinate_u = static_cast<std::int16_t>(compress_float<16>(vertex.texture_coords.x));
+                r.texture_coordinate_v = static_cast<std::int16_t>(compress_float<16>(vertex.texture_coords.y));
+                r.normal = vectors[0][v];
+                r.binormal = vectors[1][v];
+                r.tangent = vectors[2][v];
+            }
+        }
+    }
+
+    void decompress_model_vertices(const ModelVertexCompressed<NativeEndian> *compressed, ModelVertexUncompressed<NativeEndian> *vertices, std::size_t count) noexcept {
+        float i[3][BATCH_SIZE], j[3][BATCH_SIZE], k[3][BATCH_SIZE];
+        std::uint32_t vectors[3][BATCH_SIZE];
+
+        for(std::size_t first = 0; first < count; first += BATCH_SIZE) {
+            std::size_t batch_count = std::min(count - first, BATCH_SIZE);
+            auto *batch_compressed = compressed + first;
+            auto *batch_vertices = vertices + first;
+
+            for(std::size_t v = 0; v < batch_count; v++) {
+                auto &vertex = batch_compressed[v];
+                vectors[0][v] = vertex.normal;
+                vectors[1][v] = vertex.binormal;
+                vectors[2][v] = vertex.tangent;
+            }
+            for(std::size_t c = 0; c < 3; c++) {
+                decompress_vectors(vectors[c], i[c], j[c], k[c], batch_count);
+            }
+
+            for(std::size_t v = 0; v < batch_count; v++) {
+                auto &vertex = batch_compressed[v];
+                auto &r = batch_vertices[v];
+                r.position = vertex.position;
+                r.node0_index = vertex.node0_index < 0 ? 65535 : vertex.node0_index / 3;
+                r.node0_weight = decompress_float<16>(vertex.node0_weight);
+                r.node1_index = vertex.node1_index < 0 ? 65535 : vertex.node1_index / 3;
+                r.node1_weight = 1.0F - r.node0_weight; // this is just derived from node0_weight
+                r.texture_coords.x = decompress_float<16>(vertex.texture_coordinate_u);
+                r.texture_coords.y = decompress_float<16>(vertex.texture_coordinate_v);
+                r.normal.i = i[0][v];
+                r.normal.j = j[0][v];
+                r.normal.k = k[0][v];
+                r.binormal.i = i[1][v];
+                r.binormal.j = j[1][v];
+                r.binormal.k = k[1][v];
+                r.tangent.i = i[2][v];
+                r.tangent.j = j[2][v];
+                r.tangent.k = k[2][v];
+            }
+        }
+    }
+
     ModelVertexCompressed<NativeEndian> compress_model_vertex(const ModelVertexUncompressed<NativeEndian> &vertex) noexcept {
         ModelVertexCompressed<NativeEndian> r;
         r.position = vertex.position;
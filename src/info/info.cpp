@@ -1,6 +1,10 @@
 // SPDX-License-Identifier: GPL-3.0-only
 
+#include <cctype>
 #include <optional>
+#include <filesystem>
+#include <string>
+#include <vector>
 #include <invader/map/map.hpp>
 #include <invader/file/file.hpp>
 #include "../command_line_option.hpp"
@@ -9,6 +13,8 @@
 #include <invader/tag/parser/parser.hpp>
 #include <invader/hek/map.hpp>
 #include <invader/compress/compression.hpp>
+#include <invader/parallel/parallel.hpp>
+#include <invader/json/json.hpp>
 
 #include "language/language.hpp"
 #include "info_def.hpp"
@@ -18,12 +24,17 @@
 struct DisplayValue {
     const char * const name;
     void (* const calculate_value)(const Invader::Map &map);
+    
+    /** The value is printed as one item per line */
+    const bool list;
 };
 
-#define MAKE_DISPLAY_VALUE(name) {# name, Invader::Info::name }
+#define MAKE_DISPLAY_VALUE(name) {# name, Invader::Info::name, false }
+#define MAKE_LIST_DISPLAY_VALUE(name) {# name, Invader::Info::name, true }
 
-static std::byte header_cache[sizeof(Invader::HEK::NativeCacheFileHeader)];
-static std::size_t file_size = 0;
+// These are per thread, since each thread loads one map at a time
+static thread_local std::byte header_cache[sizeof(Invader::HEK::NativeCacheFileHeader)];
+static thread_local std::size_t file_size = 0;
 
 // Calculating compression ratio:
 //
@@ -264,56 +275,134 @@ static DisplayValue all_values[] = {
     MAKE_DISPLAY_VALUE(crc32_mismatched),
     MAKE_DISPLAY_VALUE(engine),
     
-    MAKE_DISPLAY_VALUE(external_bitmaps),
+    MAKE_LIST_DISPLAY_VALUE(external_bitmaps),
     MAKE_DISPLAY_VALUE(external_bitmaps_count),
     
-    MAKE_DISPLAY_VALUE(external_bitmap_indices),
+    MAKE_LIST_DISPLAY_VALUE(external_bitmap_indices),
     MAKE_DISPLAY_VALUE(external_bitmap_indices_count),
     
-    MAKE_DISPLAY_VALUE(external_bitmap_pointers),
+    MAKE_LIST_DISPLAY_VALUE(external_bitmap_pointers),
     MAKE_DISPLAY_VALUE(external_bitmap_pointers_count),
     
-    MAKE_DISPLAY_VALUE(external_indices),
+    MAKE_LIST_DISPLAY_VALUE(external_indices),
     MAKE_DISPLAY_VALUE(external_indices_count),
     
-    MAKE_DISPLAY_VALUE(external_loc_indices),
+    MAKE_LIST_DISPLAY_VALUE(external_loc_indices),
     MAKE_DISPLAY_VALUE(external_loc_indices_count),
     
-    MAKE_DISPLAY_VALUE(external_sounds),
+    MAKE_LIST_DISPLAY_VALUE(external_sounds),
     MAKE_DISPLAY_VALUE(external_sounds_count),
     
-    MAKE_DISPLAY_VALUE(external_sound_indices),
+    MAKE_LIST_DISPLAY_VALUE(external_sound_indices),
     MAKE_DISPLAY_VALUE(external_sound_indices_count),
     
-    MAKE_DISPLAY_VALUE(external_sound_pointers),
+    MAKE_LIST_DISPLAY_VALUE(external_sound_pointers),
     MAKE_DISPLAY_VALUE(external_sound_pointers_count),
     
-    MAKE_DISPLAY_VALUE(external_tags),
+    MAKE_LIST_DISPLAY_VALUE(external_tags),
     MAKE_DISPLAY_VALUE(external_tags_count),
     
-    MAKE_DISPLAY_VALUE(internal_bitmaps),
+    MAKE_LIST_DISPLAY_VALUE(internal_bitmaps),
     MAKE_DISPLAY_VALUE(internal_bitmaps_count),
     
-    MAKE_DISPLAY_VALUE(internal_sounds),
+    MAKE_LIST_DISPLAY_VALUE(internal_sounds),
     MAKE_DISPLAY_VALUE(internal_sounds_count),
     
     
     MAKE_DISPLAY_VALUE(is_compressed),
     MAKE_DISPLAY_VALUE(is_dirty),
     MAKE_DISPLAY_VALUE(is_protected),
-    MAKE_DISPLAY_VALUE(languages),
+    MAKE_LIST_DISPLAY_VALUE(languages),
     MAKE_DISPLAY_VALUE(map_type),
-    MAKE_DISPLAY_VALUE(protection_issues),
+    MAKE_LIST_DISPLAY_VALUE(protection_issues),
     MAKE_DISPLAY_VALUE(scenario),
     MAKE_DISPLAY_VALUE(scenario_path),
     MAKE_DISPLAY_VALUE(stub_count),
     MAKE_DISPLAY_VALUE(tag_order_match),
-    MAKE_DISPLAY_VALUE(tags),
+    MAKE_LIST_DISPLAY_VALUE(tags),
     MAKE_DISPLAY_VALUE(tags_count),
     MAKE_DISPLAY_VALUE(uncompressed_size),
     MAKE_DISPLAY_VALUE(uses_external_pointers)
 };
 
+enum OutputFormat {
+    OUTPUT_FORMAT_TEXT,
+    OUTPUT_FORMAT_JSON_LINES,
+    OUTPUT_FORMAT_CSV
+};
+
+// Run the query and return what it printed to stdout; anything else is printed as usual
+static std::vector<std::string> calculate_value_lines(const DisplayValue &value, const Invader::Map &map) {
+    PrintfBuffer buffer;
+    auto *previous_buffer = set_printf_buffer(&buffer);
+    try {
+        value.calculate_value(map);
+    }
+    catch(std::exception &) {
+        set_printf_buffer(previous_buffer);
+        throw;
+    }
+    set_printf_buffer(previous_buffer);
+    
+    std::string output;
+    for(auto &[stream, text] : buffer) {
+        if(stream == stdout) {
+            output += text;
+        }
+        else {
+            buffered_fprintf(stream, "%s", text.c_str());
+        }
+    }
+    
+    std::vector<std::string> lines;
+    std::size_t start = 0;
+    while(start < output.size()) {
+        auto end = output.find('\n', start);
+        if(end == std::string::npos) {
+            end = output.size();
+        }
+        lines.emplace_back(output, start, end - start);
+        start = end + 1;
+    }
+    return lines;
+}
+
+// Counts, flags, and ratios are written as numbers; anything else (e.g. CRC32 in hex) is written as a string
+static std::string json_value(const std::string &value) {
+    std::size_t i = value.size() > 0 && value[0] == '-';
+    std::size_t digits = 0, decimal_digits = 0;
+    for(; i < value.size() && std::isdigit(static_cast<unsigned char>(value[i])); i++) {
+        digits++;
+    }
+    if(i < value.size() && value[i] == '.') {
+        for(i++; i < value.size() && std::isdigit(static_cast<unsigned char>(value[i])); i++) {
+            decimal_digits++;
+        }
+        if(decimal_digits == 0) {
+            digits = 0;
+        }
+    }
+    if(i != value.size() || digits == 0 || (digits > 1 && value[value[0] == '-'] == '0')) {
+        return Invader::json_string(value);
+    }
+    return value;
+}
+
+static std::string csv_string(const std::string &string) {
+    if(string.find_first_of(",\"\r\n") == std::string::npos) {
+        return string;
+    }
+    std::string escaped = "\"";
+    for(char c : string) {
+        if(c == '"') {
+            escaped += '"';
+        }
+        escaped += c;
+    }
+    escaped += "\"";
+    return escaped;
+}
+
 int main(int argc, const char **argv) {
     set_up_color_term();
     
@@ -321,7 +410,10 @@ int main(int argc, const char **argv) {
 
     // Options struct
     struct MapInfoOptions {
-        const DisplayValue *type = &all_values[0];
+        std::vector<const DisplayValue *> types;
+        OutputFormat format = OutputFormat::OUTPUT_FORMAT_TEXT;
+        std::size_t max_threads = Parallel::default_thread_count();
+        std::optional<std::filesystem::path> map_list;
     } map_info_options;
     
     // Form the options list
@@ -337,25 +429,29 @@ int main(int argc, const char **argv) {
             options_list += i.name;
         }
     }
+    options_list += ". Use more than once to show more than one type.";
 
     // Command line options
     const CommandLineOption options[] = {
         CommandLineOption("type", 'T', 1, options_list.c_str(), "<type>"),
+        CommandLineOption("format", 'f', 1, "Set the output format. Can be text (default), jsonl (one JSON object per map per line), or csv (one row per map with a header row). Lists are written as arrays in jsonl and one item per line in csv. The overview type can only be used with text.", "<format>"),
+        CommandLineOption("threads", 'j', 1, "Set the number of maps to read at once. Default: CPU thread count", "<count>"),
+        CommandLineOption("map-list", 'L', 1, "Read every map listed in the given file (one path per line) in addition to any given as arguments.", "<file>"),
         CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_INFO)
     };
 
     static constexpr char DESCRIPTION[] = "Display map metadata.";
-    static constexpr char USAGE[] = "[option] <map>";
+    static constexpr char USAGE[] = "[options] <map> [map] [...]";
 
     // Do it!
-    auto remaining_arguments = Invader::CommandLineOption::parse_arguments<MapInfoOptions &>(argc, argv, options, USAGE, DESCRIPTION, 1, 1, map_info_options, [](char opt, const auto &args, auto &map_info_options) {
+    auto remaining_arguments = Invader::CommandLineOption::parse_arguments<MapInfoOptions &>(argc, argv, options, USAGE, DESCRIPTION, 0, 65535, map_info_options, [](char opt, const auto &args, auto &map_info_options) {
         switch(opt) {
             case 'T': {
                 bool found = false;
                 
                 for(auto &i : all_values) {
                     if(std::strcmp(args[0], i.name) == 0) {
-                        map_info_options.type = &i;
+                        map_info_options.types.push_back(&i);
                         found = true;
                         break;
                     }
@@ -367,30 +463,178 @@ int main(int argc, const char **argv) {
                 }
                 break;
             }
+            case 'f':
+                if(std::strcmp(args[0], "text") == 0) {
+                    map_info_options.format = OutputFormat::OUTPUT_FORMAT_TEXT;
+                }
+                else if(std::strcmp(args[0], "jsonl") == 0) {
+                    map_info_options.format = OutputFormat::OUTPUT_FORMAT_JSON_LINES;
+                }
+                else if(std::strcmp(args[0], "csv") == 0) {
+                    map_info_options.format = OutputFormat::OUTPUT_FORMAT_CSV;
+                }
+                else {
+                    eprintf_error("Unknown format %s", args[0]);
+                    std::exit(EXIT_FAILURE);
+                }
+                break;
+            case 'j':
+                try {
+                    map_info_options.max_threads = std::stoi(args[0]);
+                    if(map_info_options.max_threads < 1) {
+                        throw std::exception();
+                    }
+                }
+                catch(std::exception &) {
+                    eprintf_error("Invalid number of threads %s\n", args[0]);
+                    std::exit(EXIT_FAILURE);
+                }
+                break;
+            case 'L':
+                map_info_options.map_list = args[0];
+                break;
             case 'i':
                 Invader::show_version_info();
                 std::exit(EXIT_SUCCESS);
         }
     });
-
-    // Load it
-    std::unique_ptr<Map> map;
-    try {
-        auto file = File::open_file(remaining_arguments[0]).value();
-        file_size = file.size();
-        if(file_size >= sizeof(header_cache)) {
-            std::memcpy(header_cache, file.data(), sizeof(header_cache));
+    
+    if(map_info_options.types.empty()) {
+        map_info_options.types.push_back(&all_values[0]);
+    }
+    
+    auto format = map_info_options.format;
+    auto &types = map_info_options.types;
+    if(format != OutputFormat::OUTPUT_FORMAT_TEXT) {
+        for(auto *i : types) {
+            if(i == &all_values[0]) {
+                eprintf_error("The overview type can only be used with the text format");
+                return EXIT_FAILURE;
+            }
         }
-        
-        map = std::make_unique<Map>(Map::map_with_move(std::move(file)));
     }
-    catch (std::exception &e) {
-        eprintf_error("Failed to parse %s: %s", remaining_arguments[0], e.what());
+    
+    std::vector<std::string> maps;
+    if(map_info_options.map_list.has_value()) {
+        auto map_list = File::open_list_file(*map_info_options.map_list);
+        if(!map_list.has_value()) {
+            eprintf_error("Failed to open %s", map_info_options.map_list->string().c_str());
+            return EXIT_FAILURE;
+        }
+        maps = std::move(*map_list);
+    }
+    maps.insert(maps.end(), remaining_arguments.begin(), remaining_arguments.end());
+    
+    if(maps.empty()) {
+        eprintf_error("A map path was expected. Use -h for more information.");
         return EXIT_FAILURE;
     }
     
-    // Do it!
-    map_info_options.type->calculate_value(*map);
+    if(format == OutputFormat::OUTPUT_FORMAT_CSV) {
+        oprintf("path");
+        for(auto *i : types) {
+            oprintf(",%s", i->name);
+        }
+        oprintf(",error\n");
+    }
+    
+    // Each map is only read as far as its queries need, since it's mapped into memory rather than read in; compressed
+    // maps still need to be read and decompressed in full, though
+    std::vector<char> failed(maps.size());
+    Parallel(map_info_options.max_threads).for_each(maps.size(), [&](std::size_t m) {
+        auto &map_path = maps[m];
+        
+        auto print_error = [&](const std::string &error) {
+            failed[m] = true;
+            switch(format) {
+                case OutputFormat::OUTPUT_FORMAT_TEXT:
+                    eprintf_error("Failed to parse %s: %s", map_path.c_str(), error.c_str());
+                    break;
+                case OutputFormat::OUTPUT_FORMAT_JSON_LINES:
+                    oprintf("{\"path\": %s, \"error\": %s}\n", json_string(map_path).c_str(), json_string(error).c_str());
+                    break;
+                case OutputFormat::OUTPUT_FORMAT_CSV:
+                    oprintf("%s", csv_string(map_path).c_str());
+                    for(std::size_t t = 0; t < types.size(); t++) {
+                        oprintf(",");
+                    }
+                    oprintf(",%s\n", csv_string(error).c_str());
+                    break;
+            }
+        };
+        
+        auto map_file = File::MemoryMappedFile::map_file(map_path);
+        if(!map_file.has_value()) {
+            print_error("failed to open");
+            return;
+        }
+        
+        file_size = map_file->size();
+        std::memset(header_cache, 0, sizeof(header_cache));
+        if(file_size >= sizeof(header_cache)) {
+            std::memcpy(header_cache, map_file->data(), sizeof(header_cache));
+        }
+        
+        try {
+            auto map = Map::map_with_pointer(map_file->data(), map_file->size());
+            
+            // Text output is printed as-is
+            if(format == OutputFormat::OUTPUT_FORMAT_TEXT) {
+                if(maps.size() > 1) {
+                    oprintf("%s:\n", map_path.c_str());
+                }
+                for(auto *i : types) {
+                    i->calculate_value(map);
+                }
+                return;
+            }
+            
+            // Otherwise, gather every value first so a failed query doesn't leave a partial row
+            std::string row;
+            for(auto *i : types) {
+                auto lines = calculate_value_lines(*i, map);
+                if(format == OutputFormat::OUTPUT_FORMAT_JSON_LINES) {
+                    row += ", ";
+                    row += json_string(i->name);
+                    row += ": ";
+                    if(i->list) {
+                        row += "[";
+                        for(std::size_t l = 0; l < lines.size(); l++) {
+                            row += (l == 0 ? "" : ", ") + json_string(lines[l]);
+                        }
+                        row += "]";
+                    }
+                    else {
+                        row += json_value(lines.empty() ? std::string() : lines[0]);
+                    }
+                }
+                else {
+                    std::string value;
+                    for(std::size_t l = 0; l < lines.size(); l++) {
+                        value += (l == 0 ? "" : "\n") + lines[l];
+                    }
+                    row += ",";
+                    row += csv_string(value);
+                }
+            }
+            
+            if(format == OutputFormat::OUTPUT_FORMAT_JSON_LINES) {
+                oprintf("{\"path\": %s%s}\n", json_string(map_path).c_str(), row.c_str());
+            }
+            else {
+                oprintf("%s%s,\n", csv_string(map_path).c_str(), row.c_str());
+            }
+        }
+        catch (std::exception &e) {
+            print_error(e.what());
+        }
+    });
+    
+    for(auto i : failed) {
+        if(i) {
+            return EXIT_FAILURE;
+        }
+    }
     
     return EXIT_SUCCESS;
 }
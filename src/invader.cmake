@@ -16,6 +16,8 @@ set(INVADER_PARSER_FILES
     "${CMAKE_CURRENT_BINARY_DIR}/parser-normalize.cpp"
     "${CMAKE_CURRENT_BINARY_DIR}/parser-read-hek-file.cpp"
     "${CMAKE_CURRENT_BINARY_DIR}/parser-scan-padding.cpp"
+    "${CMAKE_CURRENT_BINARY_DIR}/parser-compare-fast.cpp"
+    "${CMAKE_CURRENT_BINARY_DIR}/parser-view.cpp"
     "${CMAKE_CURRENT_BINARY_DIR}/bitfield.cpp"
     "${CMAKE_CURRENT_BINARY_DIR}/enum.cpp"
 )
@@ -42,11 +44,14 @@ set(INVADER_SOURCE_FILES
     "${CMAKE_CURRENT_BINARY_DIR}/parser-normalize.cpp"
     "${CMAKE_CURRENT_BINARY_DIR}/parser-read-hek-file.cpp"
     "${CMAKE_CURRENT_BINARY_DIR}/parser-scan-padding.cpp"
+    "${CMAKE_CURRENT_BINARY_DIR}/parser-compare-fast.cpp"
+    "${CMAKE_CURRENT_BINARY_DIR}/parser-view.cpp"
     "${CMAKE_CURRENT_BINARY_DIR}/bitfield.cpp"
     "${CMAKE_CURRENT_BINARY_DIR}/enum.cpp"
 
     src/sound/sound_encoder_flac.cpp
     src/sound/sound_encoder_ogg_vorbis.cpp
+    src/sound/sound_encoder_pcm.cpp
     src/sound/sound_encoder_wav.cpp
     src/sound/sound_encoder_xbox_adpcm.cpp
     src/sound/sound_encoder.cpp
@@ -66,6 +71,8 @@ set(INVADER_SOURCE_FILES
     src/map/map.cpp
     src/map/tag.cpp
     src/file/file.cpp
+    src/parallel/parallel.cpp
+    src/json/json.cpp
     src/build/build_workload.cpp
     src/build/build_workload_dedupe.cpp
     src/bitmap/bcdec/bcdec.c
@@ -76,13 +83,18 @@ set(INVADER_SOURCE_FILES
     src/bitmap/sprite.cpp
     src/error_handler/error_handler.cpp
     src/model/jms.cpp
+    src/model/triangle_strip.cpp
+    src/model/tangent_space.cpp
     src/compress/compression.cpp
+    src/asset_cache/asset_cache.cpp
     src/tag/hek/header.cpp
     src/tag/hek/class/bitmap.cpp
     src/tag/hek/class/model_collision_geometry/intersection_check.cpp
     src/tag/hek/class/model_collision_geometry/model_collision_geometry.cpp
+    src/tag/hek/class/model_collision_geometry/prepared_bsp.cpp
     src/extract/extraction.cpp
     src/tag/parser/parser_struct.cpp
+    src/tag/parser/tag_view.cpp
     src/tag/parser/post_cache_deformat.cpp
     src/tag/parser/compile/actor.cpp
     src/tag/parser/compile/antenna.cpp
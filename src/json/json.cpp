@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <invader/json/json.hpp>
+#include <cstdio>
+
+namespace Invader {
+    std::string json_string(std::string_view string) {
+        std::string escaped = "\"";
+        for(char c : string) {
+            switch(c) {
+                case '"':
+                    escaped += "\\\"";
+                    break;
+                case '\\':
+                    escaped += "\\\\";
+                    break;
+                case '\n':
+                    escaped += "\\n";
+                    break;
+                case '\r':
+                    escaped += "\\r";
+                    break;
+                case '\t':
+                    escaped += "\\t";
+                    break;
+                default:
+                    if(static_cast<unsigned char>(c) < 0x20) {
+                        char control[8];
+                        std::snprintf(control, sizeof(control), "\\u%04X", static_cast<unsigned char>(c));
+                        escaped += control;
+                    }
+                    else {
+                        escaped += c;
+                    }
+                    break;
+            }
+        }
+        escaped += "\"";
+        return escaped;
+    }
+}
@@ -49,6 +49,25 @@ namespace Invader {
         return map;
     }
 
+    Map Map::map_with_pointer(std::byte *data, std::size_t data_size) {
+        if(data_size < sizeof(HEK::CacheFileHeader)) {
+            throw InvalidMapException(); // no
+        }
+
+        Map map;
+        try {
+            if(!map.decompress_if_needed(data, data_size)) {
+                map.unmanaged_data = data;
+                map.unmanaged_data_size = data_size;
+            }
+            map.load_map();
+        }
+        catch(Exception &) {
+            throw InvalidMapException();
+        }
+        return map;
+    }
+
     bool Map::decompress_if_needed(const std::byte *data, std::size_t data_size) {
         using namespace Invader::HEK;
         
@@ -119,7 +138,7 @@ namespace Invader {
         
         switch(map_type) {
             case DATA_MAP_CACHE:
-                return this->data.data();
+                return this->unmanaged_data != nullptr ? this->unmanaged_data : this->data.data();
             case DATA_MAP_BITMAP:
                 return this->bitmap_data.data();
             case DATA_MAP_SOUND:
@@ -140,7 +159,7 @@ namespace Invader {
         
         switch(map_type) {
             case DATA_MAP_CACHE:
-                return this->data.size();
+                return this->unmanaged_data != nullptr ? this->unmanaged_data_size : this->data.size();
             case DATA_MAP_BITMAP:
                 return this->bitmap_data.size();
             case DATA_MAP_SOUND:
@@ -623,6 +642,8 @@ namespace Invader {
 
     Map::Map(Map &&move) {
         this->data = std::move(move.data);
+        this->unmanaged_data = move.unmanaged_data;
+        this->unmanaged_data_size = move.unmanaged_data_size;
         this->bitmap_data = std::move(move.bitmap_data);
         this->loc_data = std::move(move.loc_data);
         this->sound_data = std::move(move.sound_data);
@@ -644,7 +665,7 @@ namespace Invader {
     }
     
     bool Map::is_clean() const noexcept {
-        if(this->get_crc32() != this->get_header_crc32() || this->is_protected() || this->data.size() != this->get_header_decompressed_file_size() || this->get_type() != this->get_header_type()) {
+        if(this->get_crc32() != this->get_header_crc32() || this->is_protected() || this->get_data_length(DATA_MAP_CACHE) != this->get_header_decompressed_file_size() || this->get_type() != this->get_header_type()) {
             return false;
         }
         else if(this->get_cache_version() != HEK::CacheFileEngine::CACHE_FILE_NATIVE) {
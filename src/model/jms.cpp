@@ -1,7 +1,12 @@
 // SPDX-License-Identifier: GPL-3.0-only
 
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
 #include <sstream>
 #include <stdexcept>
+#include <unordered_map>
 #include <invader/model/jms.hpp>
 
 namespace Invader {
@@ -89,10 +94,47 @@ namespace Invader {
         return value;
     }
     
+    // Try to read a number with std::from_chars, which is much faster than strtof/strtol and doesn't depend on the
+    // locale. Returns false if it can't be read this way (such as if it's out of range) so the caller can fall back to
+    // strtof/strtol, which also accept a few more things (leading spaces and plus signs, hexadecimal floats).
+    template <typename T> static bool from_chars_next(const char *&string, T &value) {
+#ifdef __cpp_lib_to_chars
+        const char *start = string;
+        while(*start == ' ') {
+            start++;
+        }
+        if(*start == '+' && start[1] != '-' && start[1] != '+') {
+            start++;
+        }
+        
+        // Numbers end at the next whitespace (or the end of the string)
+        const char *end = start;
+        while(*end && *end != ' ' && *end != '\r' && *end != '\n' && *end != '\t') {
+            end++;
+        }
+        
+        auto result = std::from_chars(start, end, value);
+        if(result.ec != std::errc() || *result.ptr == 'x' || *result.ptr == 'X') {
+            return false;
+        }
+        string = result.ptr;
+        return true;
+#else
+        (void)string;
+        (void)value;
+        return false;
+#endif
+    }
+    
     static float read_next_float(const char *&string) {
         string = next_character(string);
+        float value;
+        if(from_chars_next(string, value)) {
+            return value;
+        }
+        
         auto *old_str = string;
-        float value = std::strtof(string, const_cast<char **>(&string));
+        value = std::strtof(string, const_cast<char **>(&string));
         if(old_str == string) {
             auto string_copy = string;
             throw std::invalid_argument("cannot convert string `" + string_from_string(string_copy, false) + "` to a number");
@@ -102,8 +144,13 @@ namespace Invader {
     
     static std::int32_t read_next_int32(const char *&string) {
         string = next_character(string);
+        std::int32_t value;
+        if(from_chars_next(string, value)) {
+            return value;
+        }
+        
         auto *old_str = string;
-        std::int32_t value = std::strtol(string, const_cast<char **>(&string), 10);
+        value = std::strtol(string, const_cast<char **>(&string), 10);
         if(old_str == string) {
             auto string_copy = string;
             throw std::invalid_argument("cannot convert string `" + string_from_string(string_copy, false) + "` to an integer");
@@ -331,36 +378,329 @@ namespace Invader {
                std::to_string(static_cast<std::int16_t>(this->vertices[1]));
     }
     
-    void JMS::optimize() {
-        // Here we go
-        auto erase_vertex = [](JMS *jms, std::size_t vertex, std::size_t new_vertex = 0) {
-            jms->vertices.erase(jms->vertices.begin() + vertex);
-                    
-            // Go through each triangle and associate the triangles with the new vertex if they use the old one
-            // Or decrease their index by 1 if they reference a vertex after it
-            for(auto &t : jms->triangles) {
-                for(auto &t2 : t.vertices) {
-                    if(t2 == vertex) {
-                        t2 = new_vertex;
-                    }
-                    else if(t2 > vertex) {
-                        t2--;
-                    }
+    namespace {
+        // Identifies data made with JMS::to_binary(); bump the version if the format changes
+        constexpr const std::uint32_t JMS_BINARY_MAGIC = 0x534D4A42; // "BJMS"
+        constexpr const std::uint32_t JMS_BINARY_VERSION = 1;
+        
+        // Everything is stored little endian, with floats stored as their bits and strings prefixed with their length
+        struct BinaryWriter {
+            std::vector<std::byte> data;
+            
+            void write_u32(std::uint32_t value) {
+                HEK::LittleEndian<std::uint32_t> le = value;
+                auto *bytes = reinterpret_cast<const std::byte *>(&le);
+                this->data.insert(this->data.end(), bytes, bytes + sizeof(le));
+            }
+            void write_float(float value) {
+                std::uint32_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                this->write_u32(bits);
+            }
+            void write_string(const std::string &string) {
+                this->write_u32(static_cast<std::uint32_t>(string.size()));
+                auto *bytes = reinterpret_cast<const std::byte *>(string.data());
+                this->data.insert(this->data.end(), bytes, bytes + string.size());
+            }
+            void write_quaternion(const HEK::Quaternion<HEK::NativeEndian> &value) {
+                this->write_float(value.i);
+                this->write_float(value.j);
+                this->write_float(value.k);
+                this->write_float(value.w);
+            }
+            void write_point(const HEK::Point3D<HEK::NativeEndian> &value) {
+                this->write_float(value.x);
+                this->write_float(value.y);
+                this->write_float(value.z);
+            }
+        };
+        
+        struct BinaryReader {
+            const std::byte *data;
+            std::size_t size;
+            std::size_t offset = 0;
+            
+            const std::byte *read_bytes(std::size_t count) {
+                if(count > this->size - this->offset) {
+                    throw std::invalid_argument("binary JMS data is truncated");
                 }
+                auto *bytes = this->data + this->offset;
+                this->offset += count;
+                return bytes;
+            }
+            std::uint32_t read_u32() {
+                HEK::LittleEndian<std::uint32_t> le;
+                std::memcpy(&le, this->read_bytes(sizeof(le)), sizeof(le));
+                return le.read();
+            }
+            float read_float() {
+                auto bits = this->read_u32();
+                float value;
+                std::memcpy(&value, &bits, sizeof(value));
+                return value;
+            }
+            std::string read_string() {
+                auto length = this->read_u32();
+                auto *bytes = reinterpret_cast<const char *>(this->read_bytes(length));
+                return std::string(bytes, length);
+            }
+            HEK::Quaternion<HEK::NativeEndian> read_quaternion() {
+                HEK::Quaternion<HEK::NativeEndian> value;
+                value.i = this->read_float();
+                value.j = this->read_float();
+                value.k = this->read_float();
+                value.w = this->read_float();
+                return value;
+            }
+            HEK::Point3D<HEK::NativeEndian> read_point() {
+                HEK::Point3D<HEK::NativeEndian> value;
+                value.x = this->read_float();
+                value.y = this->read_float();
+                value.z = this->read_float();
+                return value;
+            }
+            
+            // Read an element count, making sure there is at least enough data left for that many elements so garbage
+            // counts can't make us allocate huge arrays
+            std::size_t read_count(std::size_t minimum_element_size) {
+                std::size_t count = this->read_u32();
+                if(count > (this->size - this->offset) / minimum_element_size) {
+                    throw std::invalid_argument("binary JMS data is truncated");
+                }
+                return count;
             }
         };
+    }
+    
+    std::vector<std::byte> JMS::to_binary() const {
+        BinaryWriter writer;
+        writer.data.reserve(64 + this->vertices.size() * 48 + this->triangles.size() * 16);
+        writer.write_u32(JMS_BINARY_MAGIC);
+        writer.write_u32(JMS_BINARY_VERSION);
+        writer.write_u32(this->node_list_checksum);
+        
+        writer.write_u32(static_cast<std::uint32_t>(this->nodes.size()));
+        for(auto &n : this->nodes) {
+            writer.write_string(n.name);
+            writer.write_u32(n.first_child);
+            writer.write_u32(n.sibling_node);
+            writer.write_quaternion(n.rotation);
+            writer.write_point(n.position);
+        }
+        
+        writer.write_u32(static_cast<std::uint32_t>(this->materials.size()));
+        for(auto &m : this->materials) {
+            writer.write_string(m.name);
+            writer.write_string(m.tif_path);
+        }
+        
+        writer.write_u32(static_cast<std::uint32_t>(this->markers.size()));
+        for(auto &m : this->markers) {
+            writer.write_string(m.name);
+            writer.write_u32(m.region);
+            writer.write_u32(m.node);
+            writer.write_quaternion(m.rotation);
+            writer.write_point(m.position);
+            writer.write_float(m.radius);
+        }
+        
+        writer.write_u32(static_cast<std::uint32_t>(this->regions.size()));
+        for(auto &r : this->regions) {
+            writer.write_string(r.name);
+        }
+        
+        writer.write_u32(static_cast<std::uint32_t>(this->vertices.size()));
+        for(auto &v : this->vertices) {
+            writer.write_u32(v.node0);
+            writer.write_point(v.position);
+            writer.write_float(v.normal.i);
+            writer.write_float(v.normal.j);
+            writer.write_float(v.normal.k);
+            writer.write_u32(v.node1);
+            writer.write_float(v.node1_weight);
+            writer.write_float(v.texture_coordinates.x);
+            writer.write_float(v.texture_coordinates.y);
+        }
+        
+        writer.write_u32(static_cast<std::uint32_t>(this->triangles.size()));
+        for(auto &t : this->triangles) {
+            writer.write_u32(t.region);
+            writer.write_u32(t.shader);
+            writer.write_u32(t.vertices[0]);
+            writer.write_u32(t.vertices[1]);
+            writer.write_u32(t.vertices[2]);
+        }
+        
+        return std::move(writer.data);
+    }
+    
+    JMS JMS::from_binary(const std::byte *data, std::size_t size) {
+        BinaryReader reader = { data, size };
+        if(reader.read_u32() != JMS_BINARY_MAGIC) {
+            throw std::invalid_argument("not binary JMS data");
+        }
+        if(reader.read_u32() != JMS_BINARY_VERSION) {
+            throw std::invalid_argument("unsupported binary JMS version");
+        }
+        
+        JMS jms;
+        jms.node_list_checksum = reader.read_u32();
+        
+        jms.nodes.resize(reader.read_count(4 * 10));
+        for(auto &n : jms.nodes) {
+            n.name = reader.read_string();
+            n.first_child = reader.read_u32();
+            n.sibling_node = reader.read_u32();
+            n.rotation = reader.read_quaternion();
+            n.position = reader.read_point();
+        }
+        
+        jms.materials.resize(reader.read_count(4 * 2));
+        for(auto &m : jms.materials) {
+            m.name = reader.read_string();
+            m.tif_path = reader.read_string();
+        }
+        
+        jms.markers.resize(reader.read_count(4 * 11));
+        for(auto &m : jms.markers) {
+            m.name = reader.read_string();
+            m.region = reader.read_u32();
+            m.node = reader.read_u32();
+            m.rotation = reader.read_quaternion();
+            m.position = reader.read_point();
+            m.radius = reader.read_float();
+        }
+        
+        jms.regions.resize(reader.read_count(4));
+        for(auto &r : jms.regions) {
+            r.name = reader.read_string();
+        }
+        
+        jms.vertices.resize(reader.read_count(4 * 11));
+        for(auto &v : jms.vertices) {
+            v.node0 = reader.read_u32();
+            v.position = reader.read_point();
+            v.normal.i = reader.read_float();
+            v.normal.j = reader.read_float();
+            v.normal.k = reader.read_float();
+            v.node1 = reader.read_u32();
+            v.node1_weight = reader.read_float();
+            v.texture_coordinates.x = reader.read_float();
+            v.texture_coordinates.y = reader.read_float();
+        }
         
-        // Optimize vertices by deduping
-        for(std::size_t v = 0; v < this->vertices.size(); v++) {
-            for(std::size_t v2 = v + 1; v2 < this->vertices.size(); v2++) {
-                // If it's the same, we can optimize it
-                if(this->vertices[v] == this->vertices[v2]) {
-                    // Delete vertex if needed
-                    erase_vertex(this, v2, v);
-                    
-                    // Decrement
-                    v2--;
+        jms.triangles.resize(reader.read_count(4 * 5));
+        for(auto &t : jms.triangles) {
+            t.region = reader.read_u32();
+            t.shader = reader.read_u32();
+            t.vertices[0] = reader.read_u32();
+            t.vertices[1] = reader.read_u32();
+            t.vertices[2] = reader.read_u32();
+        }
+        
+        if(reader.offset != size) {
+            throw std::invalid_argument("binary JMS data has trailing data");
+        }
+        
+        return jms;
+    }
+    
+    namespace {
+        // Hash the bits of a float, treating 0.0 and -0.0 the same since they compare equal
+        std::size_t hash_float(std::size_t hash, float value) noexcept {
+            if(value == 0.0F) {
+                value = 0.0F;
+            }
+            std::uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return (hash ^ bits) * 0x100000001B3;
+        }
+
+        struct VertexHash {
+            std::size_t operator()(const JMS::Vertex &vertex) const noexcept {
+                std::size_t hash = 0xCBF29CE484222325;
+                hash = (hash ^ vertex.node0) * 0x100000001B3;
+                hash = (hash ^ vertex.node1) * 0x100000001B3;
+                for(float value : { vertex.position.x.read(), vertex.position.y.read(), vertex.position.z.read(), vertex.normal.i.read(), vertex.normal.j.read(), vertex.normal.k.read(), vertex.node1_weight, vertex.texture_coordinates.x.read(), vertex.texture_coordinates.y.read() }) {
+                    hash = hash_float(hash, value);
                 }
+                return hash;
+            }
+        };
+
+        // Vertex with every float snapped to a grid, used for welding vertices that are nearly the same
+        struct QuantizedVertex {
+            HEK::Index node0;
+            HEK::Index node1;
+            std::int64_t values[9];
+
+            QuantizedVertex(const JMS::Vertex &vertex, float epsilon) noexcept : node0(vertex.node0), node1(vertex.node1) {
+                float floats[] = { vertex.position.x, vertex.position.y, vertex.position.z, vertex.normal.i, vertex.normal.j, vertex.normal.k, vertex.node1_weight, vertex.texture_coordinates.x, vertex.texture_coordinates.y };
+                static_assert(sizeof(floats) / sizeof(*floats) == sizeof(values) / sizeof(*values));
+                for(std::size_t i = 0; i < sizeof(floats) / sizeof(*floats); i++) {
+                    this->values[i] = static_cast<std::int64_t>(std::llround(floats[i] / epsilon));
+                }
+            }
+
+            bool operator ==(const QuantizedVertex &other) const noexcept {
+                return this->node0 == other.node0 && this->node1 == other.node1 && std::equal(std::begin(this->values), std::end(this->values), std::begin(other.values));
+            }
+        };
+
+        struct QuantizedVertexHash {
+            std::size_t operator()(const QuantizedVertex &vertex) const noexcept {
+                std::size_t hash = 0xCBF29CE484222325;
+                hash = (hash ^ vertex.node0) * 0x100000001B3;
+                hash = (hash ^ vertex.node1) * 0x100000001B3;
+                for(auto value : vertex.values) {
+                    hash = (hash ^ static_cast<std::uint64_t>(value)) * 0x100000001B3;
+                }
+                return hash;
+            }
+        };
+
+        // Move the first vertex of each key to the front (keeping their order), returning where each vertex ended up
+        template <typename Key, typename Hash, typename KeyFunction> std::vector<std::uint32_t> weld_vertices(std::vector<JMS::Vertex> &vertices, KeyFunction key_function) {
+            std::size_t vertex_count = vertices.size();
+            std::vector<std::uint32_t> remap(vertex_count);
+            std::unordered_map<Key, std::uint32_t, Hash> first_vertex;
+            first_vertex.reserve(vertex_count);
+
+            std::size_t welded_count = 0;
+            for(std::size_t v = 0; v < vertex_count; v++) {
+                auto [it, inserted] = first_vertex.try_emplace(key_function(vertices[v]), static_cast<std::uint32_t>(welded_count));
+                if(inserted) {
+                    if(welded_count != v) {
+                        vertices[welded_count] = vertices[v];
+                    }
+                    welded_count++;
+                }
+                remap[v] = it->second;
+            }
+
+            vertices.resize(welded_count);
+            return remap;
+        }
+    }
+
+    void JMS::optimize(float weld_epsilon) {
+        std::size_t vertex_count = this->vertices.size();
+
+        // Build a table of where each vertex goes once duplicates are removed
+        std::vector<std::uint32_t> remap;
+        if(weld_epsilon > 0.0F) {
+            remap = weld_vertices<QuantizedVertex, QuantizedVertexHash>(this->vertices, [weld_epsilon](const Vertex &vertex) { return QuantizedVertex(vertex, weld_epsilon); });
+        }
+        else {
+            remap = weld_vertices<Vertex, VertexHash>(this->vertices, [](const Vertex &vertex) -> const Vertex & { return vertex; });
+        }
+
+        // Point each triangle at the new vertices. Out-of-bounds indices are shifted down by the number of vertices removed
+        // so they're still reported as out-of-bounds (and by how much) later on.
+        std::size_t removed_count = vertex_count - this->vertices.size();
+        for(auto &t : this->triangles) {
+            for(auto &v : t.vertices) {
+                v = v < vertex_count ? remap[v] : static_cast<std::uint32_t>(v - removed_count);
             }
         }
     }
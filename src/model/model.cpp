@@ -3,14 +3,20 @@
 #include <vector>
 #include <cstring>
 #include <regex>
-#include <list>
 #include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
 
 #include <invader/version.hpp>
 #include <invader/printf.hpp>
 #include <invader/file/file.hpp>
+#include <invader/asset_cache/asset_cache.hpp>
 #include "../command_line_option.hpp"
 #include <invader/model/jms.hpp>
+#include <invader/model/triangle_strip.hpp>
+#include <invader/model/tangent_space.hpp>
 #include <invader/tag/parser/parser.hpp>
 #include <invader/tag/parser/compile/model.hpp>
 
@@ -24,7 +30,18 @@ const char *MODEL_EXTENSIONS[] = {
     ".gbxmodel"
 };
 
-template <typename T, Invader::HEK::TagFourCC fourcc> std::vector<std::byte> make_model_tag(const std::filesystem::path &path, const std::vector<std::filesystem::path> &tags, const Invader::JMSMap &map) {
+struct ModelOptions {
+    std::optional<ModelType> type;
+    std::vector<std::filesystem::path> tags;
+    std::filesystem::path data = "data";
+    bool filesystem_path = false;
+    float weld_epsilon = 0.0F;
+    std::size_t max_threads = std::thread::hardware_concurrency() < 1 ? 1 : std::thread::hardware_concurrency();
+    std::optional<Invader::AssetCache> cache;
+};
+
+template <typename T, Invader::HEK::TagFourCC fourcc> std::vector<std::byte> make_model_tag(const std::filesystem::path &path, const ModelOptions &model_options, const Invader::JMSMap &map) {
+    auto &tags = model_options.tags;
     using namespace Invader;
     
     // Load the tag if possible
@@ -101,7 +118,7 @@ template <typename T, Invader::HEK::TagFourCC fourcc> std::vector<std::byte> mak
         auto jms_data_copy = jms.second;
         
         // Optimize
-        jms_data_copy.optimize();
+        jms_data_copy.optimize(model_options.weld_epsilon);
         
         // Do bounds checking for nodes and regions
         auto region_count = jms_data_copy.regions.size();
@@ -473,7 +490,31 @@ template <typename T, Invader::HEK::TagFourCC fourcc> std::vector<std::byte> mak
         std::strncpy(region.name.string, i.c_str(), sizeof(region.name.string) - 1);
     }
     
-    std::size_t triangle_count = 0;
+    // Geometries and parts to build. The parts are independent of each other, so they get built in parallel once
+    // everything is laid out here, then the geometries get deduplicated in the same order as before.
+    using Geometry = typename std::remove_pointer<decltype(model_tag->geometries.data())>::type;
+    struct PendingGeometry {
+        Geometry geometry;
+        std::size_t region;
+        std::size_t permutation;
+        LoD lod;
+    };
+    struct PendingPart {
+        const JMS *jms;
+        std::size_t region;
+        std::size_t shader;
+        std::size_t geometry;
+        std::size_t part;
+        std::size_t list_indices;
+        
+        // Filled in once the part is built
+        std::size_t triangle_count = 0;
+        std::size_t strip_indices = 0;
+        double acmr_before = 0.0;
+        double acmr_after = 0.0;
+    };
+    std::vector<PendingGeometry> pending_geometries;
+    std::vector<PendingPart> pending_parts;
     
     // Go through each permutation now
     for(auto &i : permutations) {
@@ -486,6 +527,13 @@ template <typename T, Invader::HEK::TagFourCC fourcc> std::vector<std::byte> mak
             // Find all regions this encompasses
             std::vector<std::size_t> regions_we_are_in;
             for(auto &t : jms.triangles) {
+                for(auto &v : t.vertices) {
+                    if(v >= jms.vertices.size()) {
+                        eprintf_error("Vertex index out of bounds");
+                        std::exit(EXIT_FAILURE);
+                    }
+                }
+                
                 bool in_it = false;
                 for(auto &r : regions_we_are_in) {
                     if(r == t.region) {
@@ -536,297 +584,217 @@ template <typename T, Invader::HEK::TagFourCC fourcc> std::vector<std::byte> mak
                 }
                 
                 // Instantiate our new geometry
-                typename std::remove_pointer<decltype(model_tag->geometries.data())>::type geometry;
+                std::size_t geometry_index = pending_geometries.size();
+                auto &pending_geometry = pending_geometries.emplace_back();
+                pending_geometry.region = r;
+                pending_geometry.permutation = permutation_index;
+                pending_geometry.lod = lod.first;
+                auto &geometry = pending_geometry.geometry;
                 
-                // Now for the shader indices
+                // Now for the shader indices (and how many triangles use each one)
                 std::vector<std::size_t> shaders_we_use;
+                std::vector<std::size_t> shader_triangle_counts;
                 for(auto &t : jms.triangles) {
                     if(t.region == r) {
                         bool shader_in_it = false;
-                        for(auto &s : shaders_we_use) {
-                            if(s == t.shader) {
+                        for(std::size_t s = 0; s < shaders_we_use.size(); s++) {
+                            if(shaders_we_use[s] == t.shader) {
                                 shader_in_it = true;
+                                shader_triangle_counts[s]++;
                                 break;
                             }
                         }
                         if(!shader_in_it) {
                             shaders_we_use.emplace_back(t.shader);
+                            shader_triangle_counts.emplace_back(1);
                         }
                     }
                 }
                 
                 // Go through each shader. Add a part thing
-                for(auto &s : shaders_we_use) {
+                for(std::size_t si = 0; si < shaders_we_use.size(); si++) {
+                    auto s = shaders_we_use[si];
+                    auto &pending_part = pending_parts.emplace_back();
+                    pending_part.jms = &jms;
+                    pending_part.region = r;
+                    pending_part.shader = s;
+                    pending_part.list_indices = shader_triangle_counts[si] * 3;
+                    pending_part.geometry = geometry_index;
+                    pending_part.part = geometry.parts.size();
+                    
                     auto &part = geometry.parts.emplace_back();
                     part.prev_filthy_part_index = ~0;
                     part.next_filthy_part_index = ~0;
                     part.shader_index = s;
-                    
-                    // Isolate all triangles
-                    std::vector<JMS::Triangle> all_triangles_here;
-                    for(auto &t : jms.triangles) {
-                        if(t.region == r && t.shader == s) {
-                            all_triangles_here.emplace_back(t);
-                        }
-                    }
-                    
-                    // Isolate all vertices
-                    std::map<std::size_t, std::size_t> all_vertices_here_indexed;
-                    std::vector<JMS::Vertex> all_vertices_here;
-                    for(auto &t : all_triangles_here) {
-                        for(auto &v : t.vertices) {
-                            // Add the vertex. Note the index of it
-                            if(all_vertices_here_indexed.find(v) == all_vertices_here_indexed.end()) {
-                                if(v >= jms.vertices.size()) {
-                                    eprintf_error("Vertex index out of bounds");
-                                    std::exit(EXIT_FAILURE);
-                                }
-                                
-                                all_vertices_here_indexed[v] = all_vertices_here.size();
-                                all_vertices_here.emplace_back(jms.vertices[v]);
-                            }
-                        }
-                    }
-                    
-                    // Set the vertices now
-                    for(auto &t : all_triangles_here) {
-                        for(auto &v : t.vertices) {
-                            v = all_vertices_here_indexed[v];
-                        }
-                    }
-                    
-                    // Add all vertices
-                    for(auto &v : all_vertices_here) {
-                        auto &vm = part.uncompressed_vertices.emplace_back();
-                        vm.position = v.position;
-                        vm.normal = v.normal;
-                        vm.texture_coords = v.texture_coordinates;
-                        vm.node0_index = v.node0;
-                        vm.node0_weight = 1.0F - v.node1_weight;
-                        vm.node1_index = v.node1;
-                        vm.node1_weight = v.node1_weight;
-                    }
-                    
-                    // Calculate binormal/tangent (most of this is from the MEK @ https://github.com/Sigmmma/reclaimer/blob/e9900716d1962f4a172f517791c2f6b7900898c5/reclaimer/model/jms.py - thanks MosesofEgypt!)
-                    for(auto &t : all_triangles_here) {
-                        static constexpr const std::size_t range = sizeof(t.vertices) / sizeof(*t.vertices);
-                        static_assert(range == 3);
-                        
-                        for(std::size_t v = 0; v < range; v++) {
-                            // Get our vertices, binormal, and tangent
-                            auto &vertex0 = part.uncompressed_vertices[t.vertices[(v + 0) % range]];
-                            auto &vertex1 = part.uncompressed_vertices[t.vertices[(v + 1) % range]];
-                            auto &vertex2 = part.uncompressed_vertices[t.vertices[(v + 2) % range]];
-                            
-                            auto &b = vertex0.binormal;
-                            auto &t = vertex0.tangent;
-                            
-                            // Subtract the x/y/z from the other two vertices
-                            float x1 = vertex1.position.x - vertex0.position.x;
-                            float x2 = vertex2.position.x - vertex0.position.x;
-                            float y1 = vertex1.position.y - vertex0.position.y;
-                            float y2 = vertex2.position.y - vertex0.position.y;
-                            float z1 = vertex1.position.z - vertex0.position.z;
-                            float z2 = vertex2.position.z - vertex0.position.z;
-                            
-                            // Do the same thing with the texture coordinates
-                            float u1 = vertex1.texture_coords.x - vertex0.texture_coords.x;
-                            float u2 = vertex2.texture_coords.x - vertex0.texture_coords.x;
-                            
-                            // Since it's flipped, subtract v from 1 to flip it back.
-                            float v1 = (1.0F - vertex1.texture_coords.y) - (1.0F - vertex0.texture_coords.y);
-                            float v2 = (1.0F - vertex2.texture_coords.y) - (1.0F - vertex0.texture_coords.y);
-                            
-                            float r = u1 * v2 - u2 * v1;
-                            if(r == 0) {
-                                continue;
-                            }
-                            
-                            r = 1.0 / r;
-                            
-                            // Binormal
-                            float bi = -(u1 * x2 - u2 * x1) * r;
-                            float bj = -(u1 * y2 - u2 * y1) * r;
-                            float bk = -(u1 * z2 - u2 * z1) * r;
-                            float b_len = std::sqrt(bi*bi + bj*bj + bk*bk);
-                            
-                            // Tangent
-                            float ti = (v2 * x1 - v1 * x2) * r;
-                            float tj = (v2 * y1 - v1 * y2) * r;
-                            float tk = (v2 * z1 - v1 * z2) * r;
-                            float t_len = std::sqrt(ti*ti + tj*tj + tk*tk);
-                            
-                            if(b_len > 0) {
-                                b.i = b.i + bi / b_len;
-                                b.j = b.j + bj / b_len;
-                                b.k = b.k + bk / b_len;
-                            }
-                            
-                            if(t_len > 0) {
-                                t.i = t.i + ti / t_len;
-                                t.j = t.j + tj / t_len;
-                                t.k = t.k + tk / t_len;
-                            }
-                        }
-                    }
-                    
-                    // Normalize vectors
-                    for(auto &v : part.uncompressed_vertices) {
-                        v.binormal = v.binormal.normalize();
-                        v.tangent = v.tangent.normalize();
-                    }
-                    
-                    // Now let's... do this horrible monstrosity, triangle strips!
-                    //
-                    // Basically, triangles in Halo are stored like this:
-                    //
-                    // A B C D          A          B          C          D
-                    // 0 1 2 3 4 5 6 = (0, 1, 2); (1, 3, 2); (2, 3, 4); (3, 5, 4); (4, 5, 6)
-                    //
-                    // It can save lots of space, but only if everything is nicely sequenced like this.
-                    // If not, you can lose space by having to add degenerate triangles.
-                    // On average, it saves a decent amount of space... as far as 16-bit integers go at least.
-                    
-                    // Add the first triangle
-                    std::vector<std::uint32_t> triangle_man = { all_triangles_here[0].vertices[0], all_triangles_here[0].vertices[1], all_triangles_here[0].vertices[2] };
-                    
-                    // Our remaining triangles
-                    std::list<JMS::Triangle> remaining_triangles = std::list<JMS::Triangle>(all_triangles_here.begin() + 1, all_triangles_here.end());
-                    
-                    // Add the rest
-                    while(remaining_triangles.size() > 0) {
-                        bool normals_flipped = (triangle_man.size() % 2) == 1;
-                        
-                        HEK::Index current_triangle[3] = {};
-                        auto a_index = 0;
-                        
-                        auto b_index = normals_flipped ? 2 : 1;
-                        auto c_index = normals_flipped ? 1 : 2;
-                        
-                        auto a_index_next = a_index;
-                        auto b_index_next = c_index;
-                        auto c_index_next = b_index;
-                        
-                        auto &a = current_triangle[a_index];
-                        auto &b = current_triangle[b_index];
-                        
-                        a = triangle_man[triangle_man.size() - 2];
-                        b = triangle_man[triangle_man.size() - 1];
-                        
-                        // Let's try to find a triangle that can simply go next with only one index
-                        bool triangle_found = false;
-                        for(auto rt = remaining_triangles.begin(); rt != remaining_triangles.end(); rt++) {
-                            // ABC ; BDC -> A B C D
-                            if(rt->vertices[a_index] == a && rt->vertices[b_index] == b) {
-                                triangle_found = true;
-                                triangle_man.emplace_back(rt->vertices[c_index]);
-                                remaining_triangles.erase(rt);
-                                break;
-                            }
-                        }
-                        if(triangle_found) {
-                            continue;
-                        }
-                        
-                        // Try a triangle that can go next but requires two indices
-                        for(auto rt = remaining_triangles.begin(); rt != remaining_triangles.end(); rt++) {
-                            // ABC ; CBD -> A B C B D
-                            if(rt->vertices[a_index_next] == b && rt->vertices[b_index_next] == a) {
-                                triangle_man.emplace_back(rt->vertices[b_index_next]);
-                                triangle_man.emplace_back(rt->vertices[c_index_next]);
-                                triangle_found = true;
-                                remaining_triangles.erase(rt);
-                                break;
-                            }
-                        }
-                        if(triangle_found) {
-                            continue;
-                        }
-                        
-                        // Try a triangle that can go next but requires three indices
-                        for(auto rt = remaining_triangles.begin(); rt != remaining_triangles.end(); rt++) {
-                            // ABC ; CDE -> A B C C E D
-                            if(rt->vertices[a_index] == b) {
-                                triangle_man.emplace_back(b);
-                                triangle_man.emplace_back(rt->vertices[b_index]);
-                                triangle_man.emplace_back(rt->vertices[c_index]);
-                                triangle_found = true;
-                                remaining_triangles.erase(rt);
-                                break;
-                            }
-                        }
-                        if(triangle_found) {
-                            continue;
-                        }
-                        
-                        // Last resort - Guarantees we can get the triangle in place but requires five indices
-                        // ABC; DEF -> A B C C D D F E
-                        triangle_man.emplace_back(b);
-                        auto first_triangle = *remaining_triangles.begin();
-                        remaining_triangles.erase(remaining_triangles.begin());
-                        triangle_man.emplace_back(first_triangle.vertices[a_index]);
-                        triangle_man.emplace_back(first_triangle.vertices[a_index]);
-                        triangle_man.emplace_back(first_triangle.vertices[b_index]);
-                        triangle_man.emplace_back(first_triangle.vertices[c_index]);
-                    }
-                    
-                    // Add triangle count
-                    if(triangle_man.size() > 2) {
-                        triangle_count += triangle_man.size() - 2;
-                    }
-                    
-                    // Add null's
-                    while(triangle_man.size() % 3 > 0) {
-                        triangle_man.emplace_back(NULL_INDEX);
-                    }
-                    
-                    // Add the triangles
-                    part.triangles.resize(triangle_man.size() / 3);
-                    std::size_t q = 0;
-                    for(auto &t : part.triangles) {
-                        t.vertex0_index = triangle_man[q++];
-                        t.vertex1_index = triangle_man[q++];
-                        t.vertex2_index = triangle_man[q++];
-                    }
                 }
-                
-                // See if we've already made this exact geometry before
-                std::size_t new_geometry_index;
-                for(new_geometry_index = 0; new_geometry_index < model_tag->geometries.size(); new_geometry_index++) {
-                    if(model_tag->geometries[new_geometry_index] == geometry) {
-                        break; // found a duplicate
-                    }
-                }
-                
-                // If we didn't find it, we have to add it then
-                if(new_geometry_index == model_tag->geometries.size()) {
-                    model_tag->geometries.emplace_back(geometry);
-                }
-                
-                // Set the index
-                switch(lod.first) {
-                    case LoD::LOD_SUPERHIGH:
-                        p.super_high = new_geometry_index;
-                        break;
-                    case LoD::LOD_HIGH:
-                        p.high = new_geometry_index;
-                        break;
-                    case LoD::LOD_MEDIUM:
-                        p.medium = new_geometry_index;
-                        break;
-                    case LoD::LOD_LOW:
-                        p.low = new_geometry_index;
-                        break;
-                    case LoD::LOD_SUPERLOW:
-                        p.super_low = new_geometry_index;
-                        break;
-                    default:
-                        eprintf_error("Eep!");
-                        std::terminate();
+            }
+        }
+    }
+    
+    auto build_part = [&pending_geometries](PendingPart &pending_part) {
+        auto &jms = *pending_part.jms;
+        auto r = pending_part.region;
+        auto s = pending_part.shader;
+        auto &part = pending_geometries[pending_part.geometry].geometry.parts[pending_part.part];
+        
+        // Isolate all triangles
+        std::vector<JMS::Triangle> all_triangles_here;
+        for(auto &t : jms.triangles) {
+            if(t.region == r && t.shader == s) {
+                all_triangles_here.emplace_back(t);
+            }
+        }
+        
+        // Isolate all vertices
+        std::unordered_map<std::size_t, std::size_t> all_vertices_here_indexed;
+        std::vector<JMS::Vertex> all_vertices_here;
+        for(auto &t : all_triangles_here) {
+            for(auto &v : t.vertices) {
+                // Add the vertex. Note the index of it
+                auto [index, added] = all_vertices_here_indexed.try_emplace(v, all_vertices_here.size());
+                if(added) {
+                    all_vertices_here.emplace_back(jms.vertices[v]);
                 }
-                
+                v = index->second;
             }
         }
+        
+        // Add all vertices
+        part.uncompressed_vertices.reserve(all_vertices_here.size());
+        for(auto &v : all_vertices_here) {
+            auto &vm = part.uncompressed_vertices.emplace_back();
+            vm.position = v.position;
+            vm.normal = v.normal;
+            vm.texture_coords = v.texture_coordinates;
+            vm.node0_index = v.node0;
+            vm.node0_weight = 1.0F - v.node1_weight;
+            vm.node1_index = v.node1;
+            vm.node1_weight = v.node1_weight;
+        }
+        
+        // Calculate binormal/tangent
+        TangentSpace::calculate_binormals_and_tangents(part.uncompressed_vertices, all_triangles_here);
+        
+        // Now let's... do this horrible monstrosity, triangle strips!
+        //
+        // Basically, triangles in Halo are stored like this:
+        //
+        // A B C D          A          B          C          D
+        // 0 1 2 3 4 5 6 = (0, 1, 2); (1, 3, 2); (2, 3, 4); (3, 5, 4); (4, 5, 6)
+        //
+        // It can save lots of space, but only if everything is nicely sequenced like this.
+        // If not, you can lose space by having to add degenerate triangles.
+        // On average, it saves a decent amount of space... as far as 16-bit integers go at least.
+        
+        // Put the triangles in an order that reuses vertices while they're still cached, then strip them
+        auto part_vertex_count = part.uncompressed_vertices.size();
+        pending_part.acmr_before = TriangleStrip::calculate_list_acmr(all_triangles_here) * all_triangles_here.size();
+        TriangleStrip::optimize_vertex_cache(all_triangles_here, part_vertex_count);
+        auto triangle_man = TriangleStrip::make_strip(all_triangles_here, part_vertex_count);
+        pending_part.acmr_after = TriangleStrip::calculate_strip_acmr(triangle_man) * all_triangles_here.size();
+        pending_part.strip_indices = triangle_man.size();
+        
+        // Add triangle count
+        if(triangle_man.size() > 2) {
+            pending_part.triangle_count = triangle_man.size() - 2;
+        }
+        
+        // Add null's
+        while(triangle_man.size() % 3 > 0) {
+            triangle_man.emplace_back(NULL_INDEX);
+        }
+        
+        // Add the triangles
+        part.triangles.resize(triangle_man.size() / 3);
+        std::size_t q = 0;
+        for(auto &t : part.triangles) {
+            t.vertex0_index = triangle_man[q++];
+            t.vertex1_index = triangle_man[q++];
+            t.vertex2_index = triangle_man[q++];
+        }
+    };
+    
+    // Build the parts, biggest first so one big part doesn't get left for last
+    std::vector<std::size_t> part_order(pending_parts.size());
+    for(std::size_t i = 0; i < part_order.size(); i++) {
+        part_order[i] = i;
+    }
+    std::stable_sort(part_order.begin(), part_order.end(), [&pending_parts](std::size_t a, std::size_t b) {
+        return pending_parts[a].list_indices > pending_parts[b].list_indices;
+    });
+    
+    std::atomic<std::size_t> next_part = 0;
+    auto build_parts = [&next_part, &part_order, &pending_parts, &build_part]() {
+        for(std::size_t i; (i = next_part++) < part_order.size();) {
+            build_part(pending_parts[part_order[i]]);
+        }
+    };
+    
+    std::size_t thread_count = std::max(std::min(model_options.max_threads, pending_parts.size()), static_cast<std::size_t>(1));
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for(std::size_t t = 1; t < thread_count; t++) {
+        threads.emplace_back(build_parts);
+    }
+    build_parts();
+    for(auto &t : threads) {
+        t.join();
+    }
+    
+    // Track how well the triangles were stripped
+    std::size_t triangle_count = 0;
+    std::size_t total_list_indices = 0;
+    std::size_t total_strip_indices = 0;
+    std::size_t total_part_triangles = 0;
+    double total_acmr_before = 0.0;
+    double total_acmr_after = 0.0;
+    for(auto &pending_part : pending_parts) {
+        triangle_count += pending_part.triangle_count;
+        total_list_indices += pending_part.list_indices;
+        total_strip_indices += pending_part.strip_indices;
+        total_part_triangles += pending_part.list_indices / 3;
+        total_acmr_before += pending_part.acmr_before;
+        total_acmr_after += pending_part.acmr_after;
+    }
+    
+    for(auto &pending_geometry : pending_geometries) {
+        auto &geometry = pending_geometry.geometry;
+        auto &p = model_tag->regions[pending_geometry.region].permutations[pending_geometry.permutation];
+        
+        // See if we've already made this exact geometry before
+        std::size_t new_geometry_index;
+        for(new_geometry_index = 0; new_geometry_index < model_tag->geometries.size(); new_geometry_index++) {
+            if(model_tag->geometries[new_geometry_index] == geometry) {
+                break; // found a duplicate
+            }
+        }
+        
+        // If we didn't find it, we have to add it then
+        if(new_geometry_index == model_tag->geometries.size()) {
+            model_tag->geometries.emplace_back(std::move(geometry));
+        }
+        
+        // Set the index
+        switch(pending_geometry.lod) {
+            case LoD::LOD_SUPERHIGH:
+                p.super_high = new_geometry_index;
+                break;
+            case LoD::LOD_HIGH:
+                p.high = new_geometry_index;
+                break;
+            case LoD::LOD_MEDIUM:
+                p.medium = new_geometry_index;
+                break;
+            case LoD::LOD_LOW:
+                p.low = new_geometry_index;
+                break;
+            case LoD::LOD_SUPERLOW:
+                p.super_low = new_geometry_index;
+                break;
+            default:
+                eprintf_error("Eep!");
+                std::terminate();
+        }
     }
     
     // Get everything
@@ -1001,6 +969,9 @@ template <typename T, Invader::HEK::TagFourCC fourcc> std::vector<std::byte> mak
     
     oprintf("Total: %zu vertices (%0.03f KiB uncompressed; %0.03f KiB compressed)\n", vertex_count, vertex_size_uncompressed / 1024.0F, vertex_size_compressed / 1024.0F);
     oprintf("       %zu triangle strips (%0.03f KiB)\n", triangle_count, triangle_count * sizeof(HEK::Index) / 1024.0F);
+    if(total_part_triangles > 0) {
+        oprintf("       %zu strip indices vs %zu list indices (%0.01f%% saved); ACMR %0.03f -> %0.03f\n", total_strip_indices, total_list_indices, 100.0 - 100.0 * total_strip_indices / total_list_indices, total_acmr_before / total_part_triangles, total_acmr_after / total_part_triangles);
+    }
     oprintf("Output: %s, %0.03f KiB\n", HEK::tag_fourcc_to_extension(fourcc), rval.size() / 1024.0F);
     
     return rval;
@@ -1012,12 +983,7 @@ int main(int argc, const char **argv) {
     using namespace Invader;
     using namespace Invader::HEK;
     
-    struct ModelOptions {
-        std::optional<ModelType> type;
-        std::vector<std::filesystem::path> tags;
-        std::filesystem::path data = "data";
-        bool filesystem_path = false;
-    } model_options;
+    ModelOptions model_options;
 
     const CommandLineOption options[] {
         CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_INFO),
@@ -1025,6 +991,9 @@ int main(int argc, const char **argv) {
         CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_DATA),
         CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_TAGS_MULTIPLE),
         CommandLineOption("type", 'T', 1, "Specify the type of model. Can be: model, gbxmodel", "<type>"),
+        CommandLineOption("threads", 'j', 1, "Set the number of threads to use when loading JMS files and building geometry. Default: CPU thread count", "<count>"),
+        CommandLineOption("cache", 'c', 1, "Cache parsed JMS files in the given directory, loading them from there if they are unchanged.", "<dir>"),
+        CommandLineOption("weld-epsilon", 'w', 1, "Also merge vertices that match once their positions, normals, weights, and texture coordinates are snapped to a grid of this size. Default: 0 (only merge identical vertices)", "<dist>"),
     };
 
     static constexpr char DESCRIPTION[] = "Compile a model tag.";
@@ -1056,6 +1025,33 @@ int main(int argc, const char **argv) {
             case 't':
                 model_options.tags.emplace_back(args[0]);
                 break;
+            case 'w':
+                try {
+                    model_options.weld_epsilon = std::stof(args[0]);
+                    if(!(model_options.weld_epsilon >= 0.0F)) {
+                        throw std::exception();
+                    }
+                }
+                catch(std::exception &) {
+                    eprintf_error("Invalid weld epsilon %s", args[0]);
+                    std::exit(EXIT_FAILURE);
+                }
+                break;
+            case 'c':
+                model_options.cache.emplace(args[0]);
+                break;
+            case 'j':
+                try {
+                    model_options.max_threads = std::stoi(args[0]);
+                    if(model_options.max_threads < 1) {
+                        throw std::exception();
+                    }
+                }
+                catch(std::exception &) {
+                    eprintf_error("Invalid number of threads %s", args[0]);
+                    std::exit(EXIT_FAILURE);
+                }
+                break;
         }
     });
     
@@ -1115,9 +1111,18 @@ int main(int argc, const char **argv) {
         return EXIT_FAILURE;
     }
     
-    // Let's do this
+    // Find the JMS files
+    struct JMSFile {
+        std::filesystem::path path;
+        std::string model_name;
+        std::vector<std::byte> data;
+        std::optional<AssetCache::Key> cache_key;
+        bool cached = false;
+        std::optional<JMS> jms;
+        std::string error;
+    };
+    std::vector<JMSFile> jms_file_list;
     try {
-        // Get paths. Sort alphabetically.
         for(auto &i : std::filesystem::directory_iterator(directory)) {
             auto path = i.path();
             auto extension = path.extension().string();
@@ -1125,25 +1130,13 @@ int main(int argc, const char **argv) {
                 c = std::tolower(c);
             }
             if(extension == ".jms" && i.is_regular_file()) {
-                try {
-                    auto file = File::open_file(path);
-                    if(!file.has_value()) {
-                        eprintf_error("Failed to read %s", path.string().c_str());
-                        return EXIT_FAILURE;
-                    }
-                    
-                    // Lowercase model name
-                    auto model_name = path.filename().replace_extension().string();
-                    for(char &c : model_name) {
-                        c = std::tolower(c);
-                    }
-                    
-                    // Add it
-                    jms_files.emplace(model_name, JMS::from_string(std::string(reinterpret_cast<const char *>(file->data()), file->size()).c_str()));
-                }
-                catch(std::exception &e) {
-                    eprintf_error("Failed to parse %s: %s", path.string().c_str(), e.what());
-                    return EXIT_FAILURE;
+                auto &file = jms_file_list.emplace_back();
+                file.path = path;
+                
+                // Lowercase model name
+                file.model_name = path.filename().replace_extension().string();
+                for(char &c : file.model_name) {
+                    c = std::tolower(c);
                 }
             }
         }
@@ -1153,6 +1146,79 @@ int main(int argc, const char **argv) {
         return EXIT_FAILURE;
     }
     
+    // Sort alphabetically so errors are reported in a consistent order
+    std::sort(jms_file_list.begin(), jms_file_list.end(), [](const JMSFile &a, const JMSFile &b) { return a.path < b.path; });
+    
+    // Read and parse (or load from the cache) each file. These are independent, so do them in parallel.
+    std::atomic<std::size_t> next_jms_file = 0;
+    auto load_jms_files = [&next_jms_file, &jms_file_list, &model_options]() {
+        for(std::size_t i; (i = next_jms_file++) < jms_file_list.size();) {
+            auto &file = jms_file_list[i];
+            auto data = File::open_file(file.path);
+            if(!data.has_value()) {
+                file.error = "Failed to read " + file.path.string();
+                continue;
+            }
+            
+            if(model_options.cache.has_value()) {
+                file.cache_key.emplace("jms");
+                file.cache_key->add(*data);
+                auto cached = model_options.cache->load(*file.cache_key);
+                if(cached.has_value()) {
+                    try {
+                        file.jms = JMS::from_binary(cached->data(), cached->size());
+                        file.cached = true;
+                        continue;
+                    }
+                    catch(std::exception &) {
+                        eprintf_warn("Ignoring unreadable cache entry for %s", file.path.string().c_str());
+                    }
+                }
+            }
+            
+            try {
+                // Null terminate it in place rather than copying it into a string
+                data->emplace_back(std::byte());
+                file.jms = JMS::from_string(reinterpret_cast<const char *>(data->data()));
+            }
+            catch(std::exception &e) {
+                file.error = "Failed to parse " + file.path.string() + ": " + e.what();
+            }
+        }
+    };
+    
+    std::size_t thread_count = std::max(std::min(model_options.max_threads, jms_file_list.size()), static_cast<std::size_t>(1));
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for(std::size_t t = 1; t < thread_count; t++) {
+        threads.emplace_back(load_jms_files);
+    }
+    load_jms_files();
+    for(auto &t : threads) {
+        t.join();
+    }
+    
+    std::size_t cached_count = 0;
+    for(auto &file : jms_file_list) {
+        if(!file.jms.has_value()) {
+            eprintf_error("%s", file.error.c_str());
+            return EXIT_FAILURE;
+        }
+        
+        // Cache anything we had to parse
+        if(file.cached) {
+            cached_count++;
+        }
+        else if(file.cache_key.has_value() && !model_options.cache->store(*file.cache_key, file.jms->to_binary())) {
+            eprintf_warn("Failed to cache %s in %s", file.path.string().c_str(), model_options.cache->get_directory().string().c_str());
+        }
+        
+        jms_files.emplace(std::move(file.model_name), std::move(*file.jms));
+    }
+    if(cached_count > 0) {
+        oprintf("Loaded %zu of %zu JMS file%s from the cache\n", cached_count, jms_file_list.size(), jms_file_list.size() == 1 ? "" : "s");
+    }
+    
     // Nothing found?
     if(jms_files.empty()) {
         eprintf_error("No .jms files found in %s", directory.string().c_str());
@@ -1165,10 +1231,10 @@ int main(int argc, const char **argv) {
     
     switch(*model_options.type) {
         case ModelType::MODEL_TYPE_MODEL:
-            tag_data = make_model_tag<Parser::Model, TagFourCC::TAG_FOURCC_MODEL>(file_path, model_options.tags, jms_files);
+            tag_data = make_model_tag<Parser::Model, TagFourCC::TAG_FOURCC_MODEL>(file_path, model_options, jms_files);
             break;
         case ModelType::MODEL_TYPE_GBXMODEL:
-            tag_data = make_model_tag<Parser::GBXModel, TagFourCC::TAG_FOURCC_GBXMODEL>(file_path, model_options.tags, jms_files);
+            tag_data = make_model_tag<Parser::GBXModel, TagFourCC::TAG_FOURCC_GBXMODEL>(file_path, model_options, jms_files);
             break;
         default:
             std::terminate();
@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <cmath>
+#include <cstdint>
+#include <invader/model/tangent_space.hpp>
+
+namespace Invader::TangentSpace {
+    namespace {
+        // Each component of a set of vectors, stored in its own array
+        struct VectorArrays {
+            std::vector<float> i, j, k;
+
+            VectorArrays(std::size_t count) : i(count), j(count), k(count) {}
+        };
+    }
+
+    // Most of this is from the MEK @ https://github.com/Sigmmma/reclaimer/blob/e9900716d1962f4a172f517791c2f6b7900898c5/reclaimer/model/jms.py - thanks MosesofEgypt!
+    void calculate_binormals_and_tangents(std::vector<Parser::ModelVertexUncompressed> &vertices, const std::vector<JMS::Triangle> &triangles) {
+        static constexpr const std::size_t range = sizeof(triangles[0].vertices) / sizeof(*triangles[0].vertices);
+        static_assert(range == 3);
+
+        std::size_t vertex_count = vertices.size();
+        std::size_t corner_count = triangles.size() * range;
+
+        // Split up positions and texture coordinates. Since V is flipped, subtract it from 1 to flip it back.
+        std::vector<float> x(vertex_count), y(vertex_count), z(vertex_count), u(vertex_count), v(vertex_count);
+        for(std::size_t i = 0; i < vertex_count; i++) {
+            auto &vertex = vertices[i];
+            x[i] = vertex.position.x;
+            y[i] = vertex.position.y;
+            z[i] = vertex.position.z;
+            u[i] = vertex.texture_coords.x;
+            v[i] = 1.0F - vertex.texture_coords.y;
+        }
+
+        // Get the vertex at each corner of each triangle, along with the other two vertices going around the triangle
+        std::vector<std::uint32_t> corner0(corner_count), corner1(corner_count), corner2(corner_count);
+        for(std::size_t t = 0; t < triangles.size(); t++) {
+            auto &triangle = triangles[t];
+            for(std::size_t c = 0; c < range; c++) {
+                corner0[t * range + c] = triangle.vertices[(c + 0) % range];
+                corner1[t * range + c] = triangle.vertices[(c + 1) % range];
+                corner2[t * range + c] = triangle.vertices[(c + 2) % range];
+            }
+        }
+
+        // Calculate the normalized binormal and tangent each corner contributes. Corners that contribute nothing get 0,
+        // which doesn't change anything when added since the sums start at +0 and can never become -0.
+        VectorArrays corner_binormals(corner_count), corner_tangents(corner_count);
+        for(std::size_t c = 0; c < corner_count; c++) {
+            auto v0 = corner0[c];
+            auto v1 = corner1[c];
+            auto v2 = corner2[c];
+
+            // Subtract the x/y/z from the other two vertices
+            float x1 = x[v1] - x[v0];
+            float x2 = x[v2] - x[v0];
+            float y1 = y[v1] - y[v0];
+            float y2 = y[v2] - y[v0];
+            float z1 = z[v1] - z[v0];
+            float z2 = z[v2] - z[v0];
+
+            // Do the same thing with the texture coordinates
+            float u1 = u[v1] - u[v0];
+            float u2 = u[v2] - u[v0];
+            float w1 = v[v1] - v[v0];
+            float w2 = v[v2] - v[v0];
+
+            float r = u1 * w2 - u2 * w1;
+            bool valid = r != 0;
+            r = 1.0 / r;
+
+            // Binormal
+            float bi = -(u1 * x2 - u2 * x1) * r;
+            float bj = -(u1 * y2 - u2 * y1) * r;
+            float bk = -(u1 * z2 - u2 * z1) * r;
+            float b_len = std::sqrt(bi*bi + bj*bj + bk*bk);
+
+            // Tangent
+            float ti = (w2 * x1 - w1 * x2) * r;
+            float tj = (w2 * y1 - w1 * y2) * r;
+            float tk = (w2 * z1 - w1 * z2) * r;
+            float t_len = std::sqrt(ti*ti + tj*tj + tk*tk);
+
+            bool b_valid = valid && b_len > 0;
+            corner_binormals.i[c] = b_valid ? bi / b_len : 0.0F;
+            corner_binormals.j[c] = b_valid ? bj / b_len : 0.0F;
+            corner_binormals.k[c] = b_valid ? bk / b_len : 0.0F;
+
+            bool t_valid = valid && t_len > 0;
+            corner_tangents.i[c] = t_valid ? ti / t_len : 0.0F;
+            corner_tangents.j[c] = t_valid ? tj / t_len : 0.0F;
+            corner_tangents.k[c] = t_valid ? tk / t_len : 0.0F;
+        }
+
+        // Add them up in the same order as before
+        VectorArrays binormals(vertex_count), tangents(vertex_count);
+        for(std::size_t i = 0; i < vertex_count; i++) {
+            auto &vertex = vertices[i];
+            binormals.i[i] = vertex.binormal.i;
+            binormals.j[i] = vertex.binormal.j;
+            binormals.k[i] = vertex.binormal.k;
+            tangents.i[i] = vertex.tangent.i;
+            tangents.j[i] = vertex.tangent.j;
+            tangents.k[i] = vertex.tangent.k;
+        }
+        for(std::size_t c = 0; c < corner_count; c++) {
+            auto v0 = corner0[c];
+            binormals.i[v0] += corner_binormals.i[c];
+            binormals.j[v0] += corner_binormals.j[c];
+            binormals.k[v0] += corner_binormals.k[c];
+            tangents.i[v0] += corner_tangents.i[c];
+            tangents.j[v0] += corner_tangents.j[c];
+            tangents.k[v0] += corner_tangents.k[c];
+        }
+
+        // Normalize
+        HEK::normalize_vectors(binormals.i.data(), binormals.j.data(), binormals.k.data(), vertex_count);
+        HEK::normalize_vectors(tangents.i.data(), tangents.j.data(), tangents.k.data(), vertex_count);
+        for(std::size_t i = 0; i < vertex_count; i++) {
+            auto &vertex = vertices[i];
+            vertex.binormal.i = binormals.i[i];
+            vertex.binormal.j = binormals.j[i];
+            vertex.binormal.k = binormals.k[i];
+            vertex.tangent.i = tangents.i[i];
+            vertex.tangent.j = tangents.j[i];
+            vertex.tangent.k = tangents.k[i];
+        }
+    }
+}
@@ -0,0 +1,376 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <invader/model/triangle_strip.hpp>
+
+namespace Invader::TriangleStrip {
+    namespace {
+        // Triangles that use each vertex, stored contiguously
+        struct VertexTriangles {
+            std::vector<std::uint32_t> offsets;
+            std::vector<std::uint32_t> triangles;
+
+            VertexTriangles(const std::vector<JMS::Triangle> &triangles, std::size_t vertex_count) : offsets(vertex_count + 1) {
+                for(auto &t : triangles) {
+                    for(auto v : t.vertices) {
+                        this->offsets[v + 1]++;
+                    }
+                }
+                for(std::size_t v = 0; v < vertex_count; v++) {
+                    this->offsets[v + 1] += this->offsets[v];
+                }
+
+                this->triangles.resize(triangles.size() * 3);
+                auto next = this->offsets;
+                for(std::size_t t = 0; t < triangles.size(); t++) {
+                    for(auto v : triangles[t].vertices) {
+                        this->triangles[next[v]++] = static_cast<std::uint32_t>(t);
+                    }
+                }
+            }
+
+            const std::uint32_t *begin(std::uint32_t vertex) const noexcept {
+                return this->triangles.data() + this->offsets[vertex];
+            }
+
+            const std::uint32_t *end(std::uint32_t vertex) const noexcept {
+                return this->triangles.data() + this->offsets[vertex + 1];
+            }
+        };
+
+        // Number of triangles to look at when picking where to start a new strip
+        static constexpr std::size_t RESTART_LOOKAHEAD = 16;
+
+        // Forsyth's scoring constants
+        static constexpr float CACHE_DECAY_POWER = 1.5F;
+        static constexpr float LAST_TRIANGLE_SCORE = 0.75F;
+        static constexpr float VALENCE_BOOST_SCALE = 2.0F;
+        static constexpr float VALENCE_BOOST_POWER = 0.5F;
+
+        // Scores are looked up in tables since they're calculated a lot
+        struct ScoreTables {
+            static constexpr std::size_t MAX_VALENCE = 32;
+            float cache[VERTEX_CACHE_SIZE];
+            float valence[MAX_VALENCE];
+
+            ScoreTables() noexcept {
+                for(std::size_t c = 0; c < VERTEX_CACHE_SIZE; c++) {
+                    // The last triangle's vertices are all equally good since which one is used first doesn't matter
+                    if(c < 3) {
+                        this->cache[c] = LAST_TRIANGLE_SCORE;
+                    }
+                    else {
+                        this->cache[c] = std::pow(1.0F - static_cast<float>(c - 3) / (VERTEX_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+                    }
+                }
+                for(std::size_t v = 0; v < MAX_VALENCE; v++) {
+                    this->valence[v] = valence_score(v);
+                }
+            }
+
+            // Favor vertices with few triangles left so they don't get left behind
+            static float valence_score(std::size_t remaining_triangles) noexcept {
+                return VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remaining_triangles), -VALENCE_BOOST_POWER);
+            }
+
+            float vertex_score(int cache_position, std::uint32_t remaining_triangles) const noexcept {
+                // Nothing left to draw with this vertex
+                if(remaining_triangles == 0) {
+                    return -1.0F;
+                }
+                float score = cache_position >= 0 ? this->cache[cache_position] : 0.0F;
+                return score + (remaining_triangles < MAX_VALENCE ? this->valence[remaining_triangles] : valence_score(remaining_triangles));
+            }
+        };
+
+        bool has_edge(const JMS::Triangle &triangle, std::uint32_t a, std::uint32_t b) noexcept {
+            auto *v = triangle.vertices;
+            return (v[0] == a && v[1] == b) || (v[1] == a && v[2] == b) || (v[2] == a && v[0] == b);
+        }
+
+        // Rotate the triangle (keeping its winding order) so the given vertex is first
+        void rotate_to(std::uint32_t (&rotated)[3], const JMS::Triangle &triangle, std::uint32_t first) noexcept {
+            auto *v = triangle.vertices;
+            std::size_t offset = v[0] == first ? 0 : v[1] == first ? 1 : 2;
+            for(std::size_t i = 0; i < 3; i++) {
+                rotated[i] = v[(i + offset) % 3];
+            }
+        }
+
+        // Simple FIFO vertex cache, like most hardware has
+        class FIFOCache {
+        public:
+            // Returns true if the vertex had to be transformed
+            bool access(std::uint32_t vertex) {
+                if(std::find(this->entries.begin(), this->entries.end(), vertex) != this->entries.end()) {
+                    return false;
+                }
+                if(this->entries.size() < this->size) {
+                    this->entries.emplace_back(vertex);
+                }
+                else {
+                    this->entries[this->next] = vertex;
+                    this->next = (this->next + 1) % this->size;
+                }
+                return true;
+            }
+
+            FIFOCache(std::size_t size) : size(std::max(size, static_cast<std::size_t>(1))) {
+                this->entries.reserve(this->size);
+            }
+
+        private:
+            std::size_t size;
+            std::size_t next = 0;
+            std::vector<std::uint32_t> entries;
+        };
+    }
+
+    void optimize_vertex_cache(std::vector<JMS::Triangle> &triangles, std::size_t vertex_count) {
+        std::size_t triangle_count = triangles.size();
+        if(triangle_count < 2) {
+            return;
+        }
+
+        VertexTriangles vertex_triangles(triangles, vertex_count);
+        static const ScoreTables score_tables;
+
+        // Triangles still to be drawn are kept at the front of each vertex's list
+        std::vector<std::uint32_t> remaining(vertex_count);
+        std::vector<int> cache_position(vertex_count, -1);
+        std::vector<float> score(vertex_count);
+        for(std::size_t v = 0; v < vertex_count; v++) {
+            remaining[v] = vertex_triangles.offsets[v + 1] - vertex_triangles.offsets[v];
+            score[v] = score_tables.vertex_score(-1, remaining[v]);
+        }
+
+        std::vector<bool> added(triangle_count);
+
+        // One extra slot for the vertices pushed out of the cache by each triangle
+        std::vector<std::uint32_t> cache, new_cache;
+        cache.reserve(VERTEX_CACHE_SIZE + 3);
+        new_cache.reserve(VERTEX_CACHE_SIZE + 3);
+
+        std::vector<JMS::Triangle> ordered;
+        ordered.reserve(triangle_count);
+
+        // Set to triangle_count if there's no best triangle
+        std::size_t best_triangle = triangle_count;
+        std::size_t next_unadded = 0;
+
+        while(ordered.size() < triangle_count) {
+            // If nothing in the cache has any triangles left, start over with the next triangle that hasn't been added
+            if(best_triangle == triangle_count) {
+                while(added[next_unadded]) {
+                    next_unadded++;
+                }
+                best_triangle = next_unadded;
+            }
+
+            auto t = best_triangle;
+            auto &triangle = triangles[t];
+            added[t] = true;
+            ordered.emplace_back(triangle);
+
+            // Remove the triangle from its vertices' lists, and put its vertices at the front of the cache
+            new_cache.clear();
+            for(auto v : triangle.vertices) {
+                auto *first = vertex_triangles.triangles.data() + vertex_triangles.offsets[v];
+                auto *last = first + remaining[v];
+                auto *found = std::find(first, last, static_cast<std::uint32_t>(t));
+                std::swap(*found, *(last - 1));
+                remaining[v]--;
+                if(std::find(new_cache.begin(), new_cache.end(), v) == new_cache.end()) {
+                    new_cache.emplace_back(v);
+                }
+            }
+            for(auto v : cache) {
+                if(std::find(new_cache.begin(), new_cache.end(), v) == new_cache.end()) {
+                    new_cache.emplace_back(v);
+                }
+            }
+
+            // Anything past the end of the cache is evicted
+            for(std::size_t c = 0; c < new_cache.size(); c++) {
+                auto v = new_cache[c];
+                cache_position[v] = c < VERTEX_CACHE_SIZE ? static_cast<int>(c) : -1;
+                score[v] = score_tables.vertex_score(cache_position[v], remaining[v]);
+            }
+
+            // Only triangles using vertices whose scores changed need to be rescored, and the best one of those is next
+            best_triangle = triangle_count;
+            float best_score = -1.0F;
+            for(auto v : new_cache) {
+                auto *first = vertex_triangles.triangles.data() + vertex_triangles.offsets[v];
+                for(auto *rt = first; rt < first + remaining[v]; rt++) {
+                    float new_score = 0.0F;
+                    for(auto tv : triangles[*rt].vertices) {
+                        new_score += score[tv];
+                    }
+                    if(new_score > best_score) {
+                        best_score = new_score;
+                        best_triangle = *rt;
+                    }
+                }
+            }
+
+            if(new_cache.size() > VERTEX_CACHE_SIZE) {
+                new_cache.resize(VERTEX_CACHE_SIZE);
+            }
+            std::swap(cache, new_cache);
+        }
+
+        triangles = std::move(ordered);
+    }
+
+    std::vector<std::uint32_t> make_strip(const std::vector<JMS::Triangle> &triangles, std::size_t vertex_count) {
+        std::size_t triangle_count = triangles.size();
+        std::vector<std::uint32_t> strip;
+        if(triangle_count == 0) {
+            return strip;
+        }
+        strip.reserve(triangle_count * 2 + 2);
+
+        VertexTriangles vertex_triangles(triangles, vertex_count);
+        std::vector<bool> used(triangle_count);
+
+        // Find an unused triangle with the edge a -> b
+        auto find_edge = [&](std::uint32_t a, std::uint32_t b) -> std::optional<std::uint32_t> {
+            for(auto *t = vertex_triangles.begin(a); t < vertex_triangles.end(a); t++) {
+                if(!used[*t] && has_edge(triangles[*t], a, b)) {
+                    return *t;
+                }
+            }
+            return std::nullopt;
+        };
+
+        // Get whether the strip could keep going after ending on (a, ..., b, c)
+        auto can_continue = [&](const std::uint32_t (&rotated)[3]) {
+            return find_edge(rotated[2], rotated[1]).has_value();
+        };
+
+        // Add a triangle starting at its first vertex, which must already be the last index, so it's drawn as-is
+        auto add_triangle = [&](std::uint32_t t, const std::uint32_t (&rotated)[3]) {
+            used[t] = true;
+            if((strip.size() - 1) % 2 == 0) {
+                strip.emplace_back(rotated[1]);
+                strip.emplace_back(rotated[2]);
+            }
+            else {
+                strip.emplace_back(rotated[2]);
+                strip.emplace_back(rotated[1]);
+            }
+        };
+
+        std::size_t next_unused = 0;
+        std::size_t triangles_left = triangle_count;
+        while(triangles_left > 0) {
+            triangles_left--;
+
+            if(!strip.empty()) {
+                // Best case: a triangle shares the last edge, so it only needs one index
+                //
+                // A B C D          A          B          C          D
+                // 0 1 2 3 4 5 6 = (0, 1, 2); (1, 3, 2); (2, 3, 4); (3, 5, 4); (4, 5, 6)
+                auto a = strip[strip.size() - 2];
+                auto b = strip[strip.size() - 1];
+                bool even = (strip.size() - 2) % 2 == 0;
+                auto next = even ? find_edge(a, b) : find_edge(b, a);
+                if(next.has_value()) {
+                    auto &v = triangles[*next].vertices;
+                    used[*next] = true;
+                    strip.emplace_back(v[0] != a && v[0] != b ? v[0] : v[1] != a && v[1] != b ? v[1] : v[2]);
+                    continue;
+                }
+
+                // Next best: a triangle shares the last vertex, so it needs three indices (A B C C D E)
+                std::optional<std::uint32_t> shared;
+                std::uint32_t rotated[3] = {};
+                for(auto *t = vertex_triangles.begin(b); t < vertex_triangles.end(b); t++) {
+                    if(!used[*t]) {
+                        std::uint32_t candidate[3];
+                        rotate_to(candidate, triangles[*t], b);
+                        if(!shared.has_value() || can_continue(candidate)) {
+                            shared = *t;
+                            std::copy(std::begin(candidate), std::end(candidate), rotated);
+                            if(can_continue(candidate)) {
+                                break;
+                            }
+                        }
+                    }
+                }
+                if(shared.has_value()) {
+                    strip.emplace_back(b);
+                    add_triangle(*shared, rotated);
+                    continue;
+                }
+            }
+
+            // Otherwise, start a new strip. Strips starting at the edge of a mesh get further before running out of
+            // triangles, so look a little ahead for the triangle with the fewest unused neighbors.
+            while(used[next_unused]) {
+                next_unused++;
+            }
+            std::size_t start = next_unused;
+            std::size_t start_neighbors = 4;
+            for(std::size_t t = next_unused; t < std::min(next_unused + RESTART_LOOKAHEAD, triangle_count) && start_neighbors > 1; t++) {
+                if(!used[t]) {
+                    auto &v = triangles[t].vertices;
+                    std::size_t neighbors = find_edge(v[1], v[0]).has_value() + find_edge(v[2], v[1]).has_value() + find_edge(v[0], v[2]).has_value();
+                    if(neighbors < start_neighbors) {
+                        start = t;
+                        start_neighbors = neighbors;
+                    }
+                }
+            }
+            auto &triangle = triangles[start];
+            std::uint32_t rotated[3] = {};
+            for(std::size_t r = 0; r < 3; r++) {
+                rotate_to(rotated, triangle, triangle.vertices[r]);
+                if(can_continue(rotated)) {
+                    break;
+                }
+            }
+
+            // Join it with degenerate triangles (A B C C D D E F), which needs five indices
+            if(!strip.empty()) {
+                strip.emplace_back(strip.back());
+                strip.emplace_back(rotated[0]);
+            }
+            strip.emplace_back(rotated[0]);
+            add_triangle(start, rotated);
+        }
+
+        return strip;
+    }
+
+    double calculate_list_acmr(const std::vector<JMS::Triangle> &triangles, std::size_t cache_size) {
+        if(triangles.empty()) {
+            return 0.0;
+        }
+
+        FIFOCache cache(cache_size);
+        std::size_t misses = 0;
+        for(auto &t : triangles) {
+            for(auto v : t.vertices) {
+                misses += cache.access(v);
+            }
+        }
+        return static_cast<double>(misses) / triangles.size();
+    }
+
+    double calculate_strip_acmr(const std::vector<std::uint32_t> &strip, std::size_t cache_size) {
+        FIFOCache cache(cache_size);
+        std::size_t misses = 0;
+        std::size_t triangle_count = 0;
+        for(std::size_t i = 0; i < strip.size(); i++) {
+            misses += cache.access(strip[i]);
+            if(i >= 2 && strip[i] != strip[i - 1] && strip[i] != strip[i - 2] && strip[i - 1] != strip[i - 2]) {
+                triangle_count++;
+            }
+        }
+        return triangle_count == 0 ? 0.0 : static_cast<double>(misses) / triangle_count;
+    }
+}
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <invader/parallel/parallel.hpp>
+#include <invader/printf.hpp>
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Invader {
+    std::size_t Parallel::default_thread_count() noexcept {
+        auto count = std::thread::hardware_concurrency();
+        return count < 1 ? 1 : count;
+    }
+
+    Parallel::Parallel(std::size_t thread_count) noexcept : thread_count(thread_count == 0 ? default_thread_count() : thread_count) {}
+
+    bool Parallel::for_each(std::size_t count, const std::function<void (std::size_t index)> &function, std::size_t chunk_size) {
+        if(chunk_size == 0) {
+            chunk_size = 1;
+        }
+
+        std::size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+        std::size_t thread_count = std::min(this->thread_count, chunk_count);
+        if(thread_count == 0) {
+            return !this->cancelled;
+        }
+
+        // Each thread owns a range of chunks; the owner takes from the front and thieves take from the back
+        struct Queue {
+            std::mutex mutex;
+            std::size_t next;
+            std::size_t end;
+        };
+        auto queues = std::make_unique<Queue[]>(thread_count);
+        for(std::size_t t = 0; t < thread_count; t++) {
+            queues[t].next = chunk_count * t / thread_count;
+            queues[t].end = chunk_count * (t + 1) / thread_count;
+        }
+
+        // Output is held per index and printed once every index before it is done; if this is running inside another
+        // for_each(), it goes to the caller's buffer instead
+        auto *caller_buffer = get_printf_buffer();
+        std::vector<PrintfBuffer> output(count);
+        std::vector<bool> finished(count);
+        std::size_t next_to_print = 0;
+        std::mutex output_mutex;
+
+        std::exception_ptr exception;
+        std::mutex exception_mutex;
+
+        auto take_chunk = [&queues, thread_count](std::size_t thread_index, std::size_t &chunk) -> bool {
+            auto &own = queues[thread_index];
+            {
+                std::scoped_lock lock(own.mutex);
+                if(own.next < own.end) {
+                    chunk = own.next++;
+                    return true;
+                }
+            }
+
+            // Steal half of what's left from the first thread that has anything left
+            for(std::size_t offset = 1; offset < thread_count; offset++) {
+                auto &victim = queues[(thread_index + offset) % thread_count];
+                std::size_t stolen_start, stolen_end;
+                {
+                    std::scoped_lock lock(victim.mutex);
+                    if(victim.next >= victim.end) {
+                        continue;
+                    }
+                    stolen_end = victim.end;
+                    stolen_start = victim.next + (victim.end - victim.next) / 2;
+                    victim.end = stolen_start;
+                }
+
+                // If only one chunk was left, the victim keeps nothing and we run it
+                std::scoped_lock lock(own.mutex);
+                chunk = stolen_start;
+                own.next = stolen_start + 1;
+                own.end = stolen_end;
+                return true;
+            }
+
+            return false;
+        };
+
+        auto worker = [&](std::size_t thread_index) {
+            std::size_t chunk;
+            while(!this->cancelled && take_chunk(thread_index, chunk)) {
+                std::size_t first = chunk * chunk_size;
+                std::size_t last = std::min(first + chunk_size, count);
+
+                for(std::size_t i = first; i < last && !this->cancelled; i++) {
+                    auto *previous_buffer = set_printf_buffer(&output[i]);
+                    try {
+                        function(i);
+                    }
+                    catch(...) {
+                        std::scoped_lock lock(exception_mutex);
+                        if(!exception) {
+                            exception = std::current_exception();
+                        }
+                        this->cancelled = true;
+                    }
+                    set_printf_buffer(previous_buffer);
+
+                    std::scoped_lock lock(output_mutex);
+                    finished[i] = true;
+                    while(next_to_print < count && finished[next_to_print]) {
+                        flush_printf_buffer(output[next_to_print], caller_buffer);
+                        output[next_to_print].shrink_to_fit();
+                        next_to_print++;
+                    }
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count - 1);
+        for(std::size_t t = 1; t < thread_count; t++) {
+            threads.emplace_back(worker, t);
+        }
+        worker(0);
+        for(auto &t : threads) {
+            t.join();
+        }
+
+        // If cancelled, print whatever was finished past the indices that never ran
+        for(std::size_t i = next_to_print; i < count; i++) {
+            flush_printf_buffer(output[i], caller_buffer);
+        }
+
+        if(exception) {
+            std::rethrow_exception(exception);
+        }
+
+        return !this->cancelled;
+    }
+}
@@ -89,8 +89,9 @@ int main(int argc, const char **argv) {
         auto virtual_tags = File::load_virtual_tag_folder({recover_options.tags});
         std::size_t total = 0;
         std::size_t recovered = 0;
+        File::PathMatcher matcher(recover_options.batch, recover_options.batch_exclude);
         for(auto &t : virtual_tags) {
-            if(File::path_matches(t.tag_path.c_str(), recover_options.batch, recover_options.batch_exclude)) {
+            if(matcher.matches(t.tag_path.c_str())) {
                 total++;
                 if(!do_on_tag(t.tag_path)) {
                     eprintf("Skipped %s\n", t.tag_path.c_str());
@@ -2,7 +2,14 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <tuple>
 #include <invader/printf.hpp>
 #include <invader/version.hpp>
 #include <invader/tag/hek/header.hpp>
@@ -11,54 +18,234 @@
 #include <invader/tag/parser/parser.hpp>
 #include <invader/file/file.hpp>
 #include <invader/map/map.hpp>
+#include <invader/parallel/parallel.hpp>
+#include <invader/json/json.hpp>
+
+using namespace Invader;
+
+// A field is a byte offset in a struct of a tag class
+using PaddingField = std::tuple<HEK::TagFourCC, std::string_view, std::size_t>;
+
+struct PaddingFieldResults {
+    /** Number of times a non-zero byte was found here */
+    std::size_t count = 0;
+
+    /** Where it was first found: map index, tag index, and the order it was found in the tag */
+    std::tuple<std::size_t, std::size_t, std::size_t> first_order;
+    std::string first_tag;
+    HEK::Pointer first_address;
+    std::uint8_t first_value;
+};
+
+struct MapResults {
+    bool loaded = false;
+    std::size_t tags_scanned = 0;
+    std::size_t tag_errors = 0;
+};
+
+static void scan_map(const Map &map, std::size_t map_index, const char *map_prefix, bool json, std::size_t thread_count, std::map<PaddingField, PaddingFieldResults> &fields, std::mutex &fields_mutex, MapResults &map_results) {
+    auto tag_count = map.get_tag_count();
+    std::atomic<std::size_t> tags_scanned = 0;
+    std::atomic<std::size_t> tag_errors = 0;
+
+    // Tags are scanned in parallel, but anything found is still printed in tag order
+    Parallel(thread_count).for_each(tag_count, [&](std::size_t t) {
+        auto &tag = map.get_tag(t);
+        if(!tag.data_is_available()) {
+            return;
+        }
+
+        // Gather this tag's results first so the shared results are only locked once per tag
+        std::map<PaddingField, PaddingFieldResults> tag_fields;
+        std::size_t found = 0;
+        Parser::PaddingScanCallback callback = [&](const Tag &tag, const Parser::PaddingFinding &finding) {
+            if(!json) {
+                oprintf("%s%s.%s: %s @ 0x%04zX - %02X\n", map_prefix, tag.get_path().c_str(), HEK::tag_fourcc_to_extension(tag.get_tag_fourcc()), finding.struct_name, finding.offset, finding.value);
+                return;
+            }
+
+            auto &field = tag_fields[PaddingField(tag.get_tag_fourcc(), finding.struct_name, finding.offset)];
+            if(field.count++ == 0) {
+                field.first_order = { map_index, t, found };
+                field.first_tag = tag.get_path();
+                field.first_address = static_cast<HEK::Pointer>(finding.struct_pointer + finding.offset);
+                field.first_value = finding.value;
+            }
+            found++;
+        };
+
+        try {
+            #define DO_TAG_CLASS(c, v) case HEK::v: {\
+                Parser::c::scan_padding(tag, callback);\
+                break;\
+            }
+
+            auto tci = tag.get_tag_fourcc();
+            if(tci == HEK::TagFourCC::TAG_FOURCC_SCENARIO_STRUCTURE_BSP && map.get_cache_version() != HEK::CacheFileEngine::CACHE_FILE_NATIVE) {
+                Parser::ScenarioStructureBSP::scan_padding(tag, callback, tag.get_base_struct<HEK::ScenarioStructureBSPCompiledHeader>().pointer);
+            }
+            else {
+                switch(tci) {
+                    DO_BASED_ON_TAG_CLASS
+                    default: break;
+                }
+            }
+
+            #undef DO_TAG_CLASS
+        }
+        catch(std::exception &e) {
+            tag_errors++;
+            if(!json) {
+                eprintf_error("%sFailed to scan %s.%s: %s", map_prefix, tag.get_path().c_str(), HEK::tag_fourcc_to_extension(tag.get_tag_fourcc()), e.what());
+            }
+        }
+        tags_scanned++;
+
+        if(tag_fields.empty()) {
+            return;
+        }
+
+        std::scoped_lock lock(fields_mutex);
+        for(auto &i : tag_fields) {
+            auto &field = fields[i.first];
+            if(field.count == 0 || i.second.first_order < field.first_order) {
+                auto count = field.count;
+                field = std::move(i.second);
+                field.count += count;
+            }
+            else {
+                field.count += i.second.count;
+            }
+        }
+    });
+
+    map_results.tags_scanned = tags_scanned;
+    map_results.tag_errors = tag_errors;
+}
 
 int main(int argc, char * const *argv) {
     set_up_color_term();
-    
-    using namespace Invader;
-    
+
     const CommandLineOption options[] {
-        CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_INFO)
+        CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_INFO),
+        CommandLineOption("threads", 'j', 1, "Set the number of threads to use for scanning. Default: CPU thread count", "<count>"),
+        CommandLineOption("json", 'J', 0, "Output the number of times each field was found to be non-zero and where it was first found as JSON instead of listing every value."),
+        CommandLineOption("map-list", 'L', 1, "Scan every map listed in the given file (one path per line) in addition to any given as arguments.", "<file>")
     };
 
     static constexpr char DESCRIPTION[] = "Scans for unknown hidden data in tags";
-    static constexpr char USAGE[] = "[options] <map>";
+    static constexpr char USAGE[] = "[options] <map> [map] [...]";
 
     struct ScanOptions {
+        std::size_t max_threads = Parallel::default_thread_count();
+        bool json = false;
+        std::optional<std::filesystem::path> map_list;
     } scan_options;
 
-    auto remaining_arguments = CommandLineOption::parse_arguments<ScanOptions &>(argc, argv, options, USAGE, DESCRIPTION, 1, 1, scan_options, [](char opt, const std::vector<const char *> &, ScanOptions &) {
+    auto remaining_arguments = CommandLineOption::parse_arguments<ScanOptions &>(argc, argv, options, USAGE, DESCRIPTION, 0, 65535, scan_options, [](char opt, const std::vector<const char *> &arguments, ScanOptions &scan_options) {
         switch(opt) {
             case 'i':
                 show_version_info();
                 std::exit(EXIT_SUCCESS);
+            case 'j':
+                try {
+                    scan_options.max_threads = std::stoi(arguments[0]);
+                    if(scan_options.max_threads < 1) {
+                        throw std::exception();
+                    }
+                }
+                catch(std::exception &) {
+                    eprintf_error("Invalid number of threads %s\n", arguments[0]);
+                    std::exit(EXIT_FAILURE);
+                }
+                break;
+            case 'J':
+                scan_options.json = true;
+                break;
+            case 'L':
+                scan_options.map_list = arguments[0];
+                break;
         }
     });
-    
-    auto map_data = File::open_file(remaining_arguments[0]).value();
-    auto map = Map::map_with_copy(map_data.data(), map_data.size());
-    auto tag_count = map.get_tag_count();
-    
-    for(std::size_t t = 0; t < tag_count; t++) {
-        auto &tag = map.get_tag(t);
-        if(!tag.data_is_available()) {
-            continue;
+
+    std::vector<std::string> maps;
+    if(scan_options.map_list.has_value()) {
+        auto map_list = File::open_list_file(*scan_options.map_list);
+        if(!map_list.has_value()) {
+            eprintf_error("Failed to open %s", scan_options.map_list->string().c_str());
+            return EXIT_FAILURE;
         }
-        
-        #define DO_TAG_CLASS(c, v) case HEK::v: {\
-            Parser::c::scan_padding(tag);\
-            break;\
+        maps = std::move(*map_list);
+    }
+    maps.insert(maps.end(), remaining_arguments.begin(), remaining_arguments.end());
+
+    if(maps.empty()) {
+        eprintf_error("A map path was expected. Use -h for more information.");
+        return EXIT_FAILURE;
+    }
+
+    // Split the threads between maps and the tags in each map
+    std::size_t map_threads = std::min(scan_options.max_threads, maps.size());
+    std::size_t tag_threads = std::max<std::size_t>(1, scan_options.max_threads / map_threads);
+
+    std::map<PaddingField, PaddingFieldResults> fields;
+    std::mutex fields_mutex;
+    std::vector<MapResults> map_results(maps.size());
+
+    Parallel(map_threads).for_each(maps.size(), [&](std::size_t m) {
+        auto &map_path = maps[m];
+        std::string map_prefix = maps.size() > 1 ? map_path + ": " : std::string();
+
+        auto map_file = File::MemoryMappedFile::map_file(map_path);
+        if(!map_file.has_value()) {
+            return;
+        }
+
+        std::optional<Map> map;
+        try {
+            map.emplace(Map::map_with_pointer(map_file->data(), map_file->size()));
         }
-        
-        auto tci = tag.get_tag_fourcc();
-        if(tci == HEK::TagFourCC::TAG_FOURCC_SCENARIO_STRUCTURE_BSP && map.get_cache_version() != HEK::CacheFileEngine::CACHE_FILE_NATIVE) {
-            Parser::ScenarioStructureBSP::scan_padding(tag, tag.get_base_struct<HEK::ScenarioStructureBSPCompiledHeader>().pointer);
-            continue;
+        catch(std::exception &e) {
+            eprintf_error("Failed to parse %s: %s", map_path.c_str(), e.what());
+            return;
         }
-        
-        switch(tci) {
-            DO_BASED_ON_TAG_CLASS
-            default: break;
+
+        map_results[m].loaded = true;
+        scan_map(*map, m, map_prefix.c_str(), scan_options.json, tag_threads, fields, fields_mutex, map_results[m]);
+    });
+
+    if(scan_options.json) {
+        std::size_t loaded = 0;
+        oprintf("{\n    \"maps\": [");
+        for(std::size_t m = 0; m < maps.size(); m++) {
+            auto &results = map_results[m];
+            loaded += results.loaded;
+            oprintf("%s\n        { \"path\": %s, \"loaded\": %s, \"tags_scanned\": %zu, \"tag_errors\": %zu }", m == 0 ? "" : ",", json_string(maps[m]).c_str(), results.loaded ? "true" : "false", results.tags_scanned, results.tag_errors);
+        }
+        oprintf("\n    ],\n    \"fields\": [");
+        bool first_field = true;
+        for(auto &[key, field] : fields) {
+            auto &[tag_fourcc, struct_name, offset] = key;
+            oprintf("%s\n        { \"tag_class\": %s, \"struct\": %s, \"offset\": %zu, \"count\": %zu, \"first\": { \"map\": %s, \"tag\": %s, \"address\": %u, \"value\": %u } }",
+                    first_field ? "" : ",",
+                    json_string(HEK::tag_fourcc_to_extension(tag_fourcc)).c_str(),
+                    json_string(struct_name).c_str(),
+                    offset,
+                    field.count,
+                    json_string(maps[std::get<0>(field.first_order)]).c_str(),
+                    json_string(field.first_tag).c_str(),
+                    static_cast<unsigned int>(field.first_address),
+                    static_cast<unsigned int>(field.first_value));
+            first_field = false;
+        }
+        oprintf("\n    ]\n}\n");
+        return loaded == maps.size() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    for(auto &i : map_results) {
+        if(!i.loaded) {
+            return EXIT_FAILURE;
         }
     }
+    return EXIT_SUCCESS;
 }
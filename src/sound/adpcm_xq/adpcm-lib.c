@@ -79,6 +79,29 @@ void adpcm_free_context (void *p)
     free (pcnxt);
 }
 
+/* Get or set the step index of each channel. The index is the only state carried
+ * from one block to the next when noise shaping is off, so this can be used to
+ * resume encoding at an arbitrary block.
+ */
+
+void adpcm_get_indices (void *p, int8_t *indices)
+{
+    struct adpcm_context *pcnxt = (struct adpcm_context *) p;
+    int ch;
+
+    for (ch = 0; ch < pcnxt->num_channels; ch++)
+        indices[ch] = pcnxt->channels[ch].index;
+}
+
+void adpcm_set_indices (void *p, const int8_t *indices)
+{
+    struct adpcm_context *pcnxt = (struct adpcm_context *) p;
+    int ch;
+
+    for (ch = 0; ch < pcnxt->num_channels; ch++)
+        pcnxt->channels[ch].index = indices[ch];
+}
+
 static void set_decode_parameters (struct adpcm_context *pcnxt, int32_t *init_pcmdata, int8_t *init_index)
 {
     int ch;
@@ -52,6 +52,8 @@ static const int index_table[] = {
 
 void *adpcm_create_context (int num_channels, int lookahead, int noise_shaping, int32_t *initial_deltas);
 void adpcm_free_context(void *p);
+void adpcm_get_indices (void *p, int8_t *indices);
+void adpcm_set_indices (void *p, const int8_t *indices);
 int adpcm_encode_block (void *p, uint8_t *outbuf, size_t *outbufsize, const int16_t *inbuf, int inbufcount);
 
 #define NOISE_SHAPING_OFF       0   // flat noise (no shaping)
@@ -4,18 +4,52 @@
 #include "../command_line_option.hpp"
 #include <invader/printf.hpp>
 #include <invader/file/file.hpp>
+#include <invader/asset_cache/asset_cache.hpp>
 #include <invader/tag/parser/parser.hpp>
 #include <invader/sound/sound_encoder.hpp>
 #include <invader/sound/sound_reader.hpp>
 #include <invader/version.hpp>
 #include <vorbis/vorbisenc.h>
-#include <samplerate.h>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
 #include <thread>
 
 using namespace Invader;
 using namespace Invader::HEK;
 
+// Time spent in each stage of making a sound, summed across every thread (in microseconds)
+struct SoundStageTimes {
+    enum Stage {
+        STAGE_CONVERT,
+        STAGE_RESAMPLE,
+        STAGE_SPLIT,
+        STAGE_MOUTH_DATA,
+        STAGE_ENCODE,
+
+        STAGE_COUNT
+    };
+
+    static constexpr const char *STAGE_NAMES[STAGE_COUNT] = {
+        "convert",
+        "resample",
+        "split",
+        "mouth data",
+        "encode"
+    };
+
+    std::atomic<std::uint64_t> microseconds[STAGE_COUNT] = {};
+
+    void add(Stage stage, std::chrono::steady_clock::time_point start) noexcept {
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        this->microseconds[stage] += static_cast<std::uint64_t>(elapsed);
+    }
+};
+
 struct SoundOptions {
     std::filesystem::path data = "data";
     std::filesystem::path tags = "tags";
@@ -28,10 +62,194 @@ struct SoundOptions {
     std::optional<std::uint32_t> sample_rate;
     std::optional<std::uint16_t> bitrate;
     std::size_t max_threads = std::thread::hardware_concurrency() < 1 ? 1 : std::thread::hardware_concurrency();
+    SoundEncoder::XboxADPCMEncodeMode adpcm_mode = SoundEncoder::XboxADPCMEncodeMode::XBOX_ADPCM_ENCODE_DETERMINISTIC;
+
+    // Cache encoded permutations here
+    std::optional<AssetCache> cache;
+
+    // Batch stuff
+    bool batch = false;
+    std::vector<std::string> search;
+    std::vector<std::string> search_exclude;
+
+    // Record how long each stage took here, if set
+    SoundStageTimes *stage_times = nullptr;
 };
 
 static void populate_pitch_range(std::vector<SoundReader::Sound> &permutations, const std::filesystem::path &directory, std::uint32_t &highest_sample_rate, std::uint16_t &highest_channel_count);
-static void process_permutation_thread(SoundReader::Sound *permutation, std::uint16_t highest_sample_rate, SoundFormat format, std::uint16_t highest_channel_count, std::atomic<std::size_t> *thread_count, bool fit_adpcm_block_size);
+
+// Queue of jobs which are run on a fixed number of threads; jobs may queue more jobs while running. If a job throws,
+// the remaining jobs are dropped and the exception is rethrown by run().
+class SoundJobQueue {
+public:
+    void push(std::function<void()> job) {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->jobs.emplace_back(std::move(job));
+        this->condition.notify_one();
+    }
+
+    void run(std::size_t thread_count) {
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count);
+        for(std::size_t t = 0; t < thread_count; t++) {
+            threads.emplace_back(&SoundJobQueue::work, this);
+        }
+        for(auto &t : threads) {
+            t.join();
+        }
+        if(this->exception) {
+            std::rethrow_exception(this->exception);
+        }
+    }
+
+private:
+    std::deque<std::function<void()>> jobs;
+    std::size_t running = 0;
+    std::exception_ptr exception;
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    void work() {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        while(true) {
+            // Wait for a job, stopping once nothing is queued and nothing is running that could queue something
+            this->condition.wait(lock, [this]() { return !this->jobs.empty() || this->running == 0; });
+            if(this->jobs.empty()) {
+                this->condition.notify_all();
+                return;
+            }
+
+            auto job = std::move(this->jobs.front());
+            this->jobs.pop_front();
+            this->running++;
+            lock.unlock();
+            try {
+                job();
+                lock.lock();
+            }
+            catch(...) {
+                lock.lock();
+                if(!this->exception) {
+                    this->exception = std::current_exception();
+                }
+                this->jobs.clear();
+            }
+            this->running--;
+            this->condition.notify_all();
+        }
+    }
+};
+
+// Encoded samples for one permutation (or one piece of a split permutation)
+struct EncodedSound {
+    std::vector<std::byte> samples;
+    std::vector<std::byte> mouth_data;
+    std::size_t buffer_size = 0;
+};
+
+// Everything that goes into encoding a permutation besides the permutation itself
+struct SoundEncodeSettings {
+    SoundFormat format;
+    std::uint32_t sample_rate;
+    std::uint16_t channel_count;
+    bool fit_adpcm_block_size;
+    bool split_pieces;
+    bool is_dialogue;
+};
+
+// Hash everything that affects the encoded permutation. This must be called before the permutation is processed.
+static AssetCache::Key make_cache_key(const SoundReader::Sound &permutation, const SoundEncodeSettings &settings, const SoundOptions &sound_options) {
+    AssetCache::Key key("sound");
+
+    key.add(permutation.pcm);
+    key.add_value(permutation.sample_rate);
+    key.add_value(permutation.channel_count);
+    key.add_value(permutation.bits_per_sample);
+
+    key.add_value(settings.format);
+    key.add_value(settings.sample_rate);
+    key.add_value(settings.channel_count);
+    key.add_value(settings.fit_adpcm_block_size);
+    key.add_value(settings.split_pieces);
+    key.add_value(settings.is_dialogue);
+
+    key.add_value(sound_options.compression_level);
+    key.add_value(sound_options.bitrate);
+    key.add_value(sound_options.adpcm_mode);
+
+    return key;
+}
+
+// Cache entries are the length of the permutation in seconds followed by each piece (buffer size, samples, mouth data)
+static std::vector<std::byte> serialize_cache_entry(double seconds, const std::vector<EncodedSound> &pieces) {
+    std::vector<std::byte> entry;
+    auto write_value = [&entry](std::uint64_t value) {
+        LittleEndian<std::uint64_t> value_le = value;
+        auto *bytes = reinterpret_cast<const std::byte *>(&value_le);
+        entry.insert(entry.end(), bytes, bytes + sizeof(value_le));
+    };
+    auto write_data = [&entry, &write_value](const std::vector<std::byte> &data) {
+        write_value(data.size());
+        entry.insert(entry.end(), data.begin(), data.end());
+    };
+
+    std::uint64_t seconds_bits;
+    static_assert(sizeof(seconds_bits) == sizeof(seconds));
+    std::memcpy(&seconds_bits, &seconds, sizeof(seconds_bits));
+    write_value(seconds_bits);
+    write_value(pieces.size());
+    for(auto &piece : pieces) {
+        write_value(piece.buffer_size);
+        write_data(piece.samples);
+        write_data(piece.mouth_data);
+    }
+    return entry;
+}
+
+static bool deserialize_cache_entry(const std::vector<std::byte> &entry, double &seconds, std::vector<EncodedSound> &pieces) {
+    std::size_t offset = 0;
+    auto read_value = [&entry, &offset](std::uint64_t &value) {
+        if(entry.size() - offset < sizeof(LittleEndian<std::uint64_t>)) {
+            return false;
+        }
+        value = reinterpret_cast<const LittleEndian<std::uint64_t> *>(entry.data() + offset)->read();
+        offset += sizeof(LittleEndian<std::uint64_t>);
+        return true;
+    };
+    auto read_data = [&entry, &offset, &read_value](std::vector<std::byte> &data) {
+        std::uint64_t size;
+        if(!read_value(size) || entry.size() - offset < size) {
+            return false;
+        }
+        data = std::vector<std::byte>(entry.data() + offset, entry.data() + offset + size);
+        offset += size;
+        return true;
+    };
+
+    std::uint64_t seconds_bits, piece_count;
+    if(!read_value(seconds_bits) || !read_value(piece_count) || piece_count == 0 || piece_count > entry.size()) {
+        return false;
+    }
+    std::memcpy(&seconds, &seconds_bits, sizeof(seconds));
+
+    std::vector<EncodedSound> new_pieces(piece_count);
+    for(auto &piece : new_pieces) {
+        std::uint64_t buffer_size;
+        if(!read_value(buffer_size) || !read_data(piece.samples) || !read_data(piece.mouth_data)) {
+            return false;
+        }
+        piece.buffer_size = buffer_size;
+    }
+    if(offset != entry.size()) {
+        return false;
+    }
+
+    pieces = std::move(new_pieces);
+    return true;
+}
+
+static void process_permutation(SoundReader::Sound *permutation, std::uint16_t highest_sample_rate, SoundFormat format, std::uint16_t highest_channel_count, bool fit_adpcm_block_size, SoundStageTimes *stage_times);
+static EncodedSound encode_permutation(const std::vector<std::byte> &pcm, const SoundReader::Sound &permutation, bool is_dialogue, SoundFormat format, const SoundOptions &sound_options, std::size_t encoder_threads, SoundStageTimes *stage_times);
 
 template<typename T> static std::vector<std::byte> make_sound_tag(const std::filesystem::path &tag_path, const std::filesystem::path &data_path, SoundOptions &sound_options) {
     static constexpr std::size_t XBOX_ADPCM_SPLIT_SIZE = 65520;
@@ -44,7 +262,7 @@ template<typename T> static std::vector<std::byte> make_sound_tag(const std::fil
     if(std::filesystem::exists(tag_path)) {
         if(std::filesystem::is_directory(tag_path)) {
             eprintf_error("A directory exists at %s where a file was expected", tag_path.string().c_str());
-            std::exit(EXIT_FAILURE);
+            throw InvalidInputSoundException();
         }
         auto sound_file = File::open_file(tag_path);
         if(sound_file.has_value()) {
@@ -54,7 +272,7 @@ template<typename T> static std::vector<std::byte> make_sound_tag(const std::fil
             }
             catch(std::exception &e) {
                 eprintf_error("An error occurred while attempting to read %s", tag_path.string().c_str());
-                std::exit(EXIT_FAILURE);
+                throw InvalidInputSoundException();
             }
         }
         if(sound_options.sound_class.has_value()) {
@@ -67,7 +285,7 @@ template<typename T> static std::vector<std::byte> make_sound_tag(const std::fil
     else {
         if(!sound_options.sound_class.has_value()) {
             eprintf_error("A sound class is required when generating new sound tags");
-            std::exit(EXIT_FAILURE);
+            throw InvalidInputSoundException();
         }
         sound_tag.sound_class = *sound_options.sound_class;
     }
@@ -91,10 +309,10 @@ template<typename T> static std::vector<std::byte> make_sound_tag(const std::fil
             break;
         case SoundFormat::SOUND_FORMAT_IMA_ADPCM:
             eprintf_error("IMA ADPCM is unsupported");
-            std::exit(EXIT_FAILURE);
+            throw InvalidInputSoundException();
         default:
             eprintf_error("Unsupported audio codec");
-            std::exit(EXIT_FAILURE);
+            throw InvalidInputSoundException();
     }
 
     auto &format = sound_tag.format;
@@ -107,7 +325,7 @@ template<typename T> static std::vector<std::byte> make_sound_tag(const std::fil
     // Error if bullshit compression levels were given
     if(sound_options.compression_level > 1.0F || sound_options.compression_level < 0.0F) {
         eprintf_error("Compression level (%.05f) is outside of the allowed range of 0.0 to 1.0", *sound_options.compression_level);
-        std::exit(EXIT_FAILURE);
+        throw InvalidInputSoundException();
     }
 
     // Clear the old one
@@ -143,19 +361,21 @@ template<typename T> static std::vector<std::byte> make_sound_tag(const std::fil
     // Is it bullshit?
     if(contains_files && contains_directories) {
         eprintf_error("Data directory must have only directories or only files");
-        std::exit(EXIT_FAILURE);
+        throw InvalidInputSoundException();
     }
     if(!contains_files && !contains_directories) {
         eprintf_error("Data directory is empty");
-        std::exit(EXIT_FAILURE);
+        throw InvalidInputSoundException();
     }
 
     std::uint16_t highest_channel_count = 0;
     std::uint32_t highest_sample_rate = 0;
     std::vector<std::pair<std::vector<SoundReader::Sound>, std::string>> pitch_ranges;
 
-    oprintf("Loading sounds...\n");
-    oflush();
+    if(!sound_options.batch) {
+        oprintf("Loading sounds...\n");
+        oflush();
+    }
 
     // Load the sounds
     if(contains_files) {
@@ -168,19 +388,19 @@ template<typename T> static std::vector<std::byte> make_sound_tag(const std::fil
             auto &path = f.path();
             if(!f.is_directory()) {
                 eprintf_error("Unexpected file %s", path.string().c_str());
-                std::exit(EXIT_FAILURE);
+                throw InvalidInputSoundException();
             }
             auto &pitch_range = pitch_ranges.emplace_back(std::vector<SoundReader::Sound>(), path.filename().string());
             populate_pitch_range(pitch_range.first, path, highest_sample_rate, highest_channel_count);
             if(i == NULL_INDEX) {
                 eprintf_error("%u or more pitch ranges are present", NULL_INDEX);
-                std::exit(EXIT_FAILURE);
+                throw InvalidInputSoundException();
             }
 
             // Make sure we have stuff
             if(pitch_range.first.size() == 0) {
                 eprintf_error("No permutations found in %s", path.string().c_str());
-                std::exit(EXIT_FAILURE);
+                throw InvalidInputSoundException();
             }
         }
     }
@@ -212,7 +432,7 @@ template<typename T> static std::vector<std::byte> make_sound_tag(const std::fil
     }
     else {
         eprintf_error("Unsupported sample rate %u", highest_sample_rate);
-        std::exit(EXIT_FAILURE);
+        throw InvalidInputSoundException();
     }
 
     // Sound tags currently only support single and dual channels
@@ -224,42 +444,9 @@ template<typename T> static std::vector<std::byte> make_sound_tag(const std::fil
     }
     else {
         eprintf_error("Unsupported channel count %u", highest_channel_count);
-        std::exit(EXIT_FAILURE);
-    }
-
-    // Resample permutations when needed
-    oprintf("Processing sounds...\n");
-    oflush();
-    std::size_t total_sound_count = 0;
-    std::atomic<std::size_t> thread_count = 0;
-
-    // Wait until we have 0 threads working
-    auto wait_until_threads_are_done = [&thread_count]() {
-        while(thread_count > 0) {
-            std::this_thread::sleep_for(std::chrono::microseconds(1000));
-        }
-    };
-
-    // Wait until we have room for more threads
-    auto wait_until_threads_are_open = [&thread_count, &sound_options]() {
-        while(thread_count >= sound_options.max_threads) {
-            std::this_thread::sleep_for(std::chrono::microseconds(1000));
-        }
-    };
-
-    // Process things!
-    for(auto &pitch_range : pitch_ranges) {
-        for(auto &permutation : pitch_range.first) {
-            total_sound_count++;
-            wait_until_threads_are_open();
-            thread_count++;
-            std::thread(process_permutation_thread, &permutation, highest_sample_rate, format, highest_channel_count, &thread_count, sound_tag.flags & SoundFlagsFlag::SOUND_FLAGS_FLAG_FIT_TO_ADPCM_BLOCKSIZE).detach();
-        }
+        throw InvalidInputSoundException();
     }
 
-    // Wait until done
-    wait_until_threads_are_done();
-
     // Remove pitch ranges that are present in the tag but not in what we found
     while(true) {
         bool should_continue = false;
@@ -338,7 +525,6 @@ template<typename T> static std::vector<std::byte> make_sound_tag(const std::fil
             eprintf_error("Invalid format output name. What?");
             std::terminate();
     }
-    oprintf("Found %zu sound%s:\n", total_sound_count, total_sound_count == 1 ? "" : "s");
 
     // Check if this is dialogue
     bool is_dialogue;
@@ -355,21 +541,121 @@ template<typename T> static std::vector<std::byte> make_sound_tag(const std::fil
 
     if(is_dialogue && split) {
         eprintf_error("Split dialogue is unsupported.");
-        std::exit(EXIT_FAILURE);
+        throw InvalidInputSoundException();
+    }
+
+    // Process and encode each permutation. Each permutation is resampled and then encoded by the same job, so nothing
+    // waits on every other permutation to be resampled first. Lossy split permutations queue a job for each piece.
+    if(!sound_options.batch) {
+        oprintf("Processing sounds...\n");
+        oflush();
     }
 
-    // Make sure we don't completely blow things up
-    std::mutex encoding_mutex;
+    struct PermutationJob {
+        SoundReader::Sound *permutation;
+        double seconds = 0.0;
+        std::vector<EncodedSound> pieces;
+        std::optional<AssetCache::Key> cache_key;
+        bool cached = false;
+    };
 
-    // Encode this
+    std::vector<std::vector<PermutationJob>> jobs(pitch_range_count);
+    std::vector<PermutationJob *> jobs_by_size;
+    std::size_t total_sound_count = 0;
+    for(std::size_t pr = 0; pr < pitch_range_count; pr++) {
+        for(auto &permutation : pitch_ranges[pr].first) {
+            jobs[pr].emplace_back().permutation = &permutation;
+            total_sound_count++;
+        }
+        for(auto &job : jobs[pr]) {
+            jobs_by_size.emplace_back(&job);
+        }
+    }
+
+    // Start with the longest sounds so a long one doesn't end up running by itself at the end
+    std::stable_sort(jobs_by_size.begin(), jobs_by_size.end(), [](const PermutationJob *a, const PermutationJob *b) { return a->permutation->pcm.size() > b->permutation->pcm.size(); });
+
+    SoundStageTimes own_stage_times;
+    auto &stage_times = sound_options.stage_times != nullptr ? *sound_options.stage_times : own_stage_times;
+    SoundJobQueue queue;
+
+    // Xbox ADPCM can encode a long permutation on multiple threads, so give each permutation its share of the threads
+    std::size_t encoder_threads = std::max(sound_options.max_threads / std::max(total_sound_count, static_cast<std::size_t>(1)), static_cast<std::size_t>(1));
+    bool fit_adpcm_block_size = sound_tag.flags & SoundFlagsFlag::SOUND_FLAGS_FLAG_FIT_TO_ADPCM_BLOCKSIZE;
+    SoundEncodeSettings settings = { format, highest_sample_rate, highest_channel_count, fit_adpcm_block_size, split && enable_threading_split_permutation_encoding, is_dialogue };
+    std::atomic<std::size_t> cached_count = 0;
+
+    for(auto *job : jobs_by_size) {
+        queue.push([job, &queue, &stage_times, &sound_options, &settings, &cached_count, encoder_threads, highest_sample_rate, highest_channel_count, format, fit_adpcm_block_size, split, enable_threading_split_permutation_encoding, is_dialogue]() {
+            auto &permutation = *job->permutation;
+
+            // Check if we already encoded this permutation with these settings
+            if(sound_options.cache.has_value()) {
+                job->cache_key = make_cache_key(permutation, settings, sound_options);
+                auto cached = sound_options.cache->load(*job->cache_key);
+                if(cached.has_value()) {
+                    if(deserialize_cache_entry(*cached, job->seconds, job->pieces)) {
+                        job->cached = true;
+                        cached_count++;
+                        permutation.pcm = std::vector<std::byte>();
+                        return;
+                    }
+                    eprintf_warn("Ignoring unreadable cache entry for %s", permutation.name.c_str());
+                }
+            }
+
+            process_permutation(&permutation, highest_sample_rate, format, highest_channel_count, fit_adpcm_block_size, &stage_times);
+
+            // Calculate length
+            job->seconds = permutation.pcm.size() / static_cast<double>(static_cast<std::size_t>(permutation.sample_rate) * static_cast<std::size_t>(permutation.bits_per_sample / 8) * static_cast<std::size_t>(permutation.channel_count));
+
+            // Split things we can't trivially split losslessly, encoding each piece separately
+            if(split && enable_threading_split_permutation_encoding) {
+                auto split_start = std::chrono::steady_clock::now();
+                std::size_t bytes_per_sample_all_channels = permutation.bits_per_sample / 8 * permutation.channel_count;
+                std::size_t max_split_size = SPLIT_BUFFER_SIZE - (SPLIT_BUFFER_SIZE % bytes_per_sample_all_channels);
+                std::size_t piece_count = (permutation.pcm.size() + max_split_size - 1) / max_split_size;
+                job->pieces.resize(piece_count);
+                stage_times.add(SoundStageTimes::STAGE_SPLIT, split_start);
+
+                for(std::size_t piece = 0; piece < piece_count; piece++) {
+                    queue.push([job, piece, max_split_size, &stage_times, &sound_options, encoder_threads, format, is_dialogue]() {
+                        auto &pcm = job->permutation->pcm;
+                        auto *start = pcm.data() + piece * max_split_size;
+                        auto *end = pcm.data() + std::min(pcm.size(), (piece + 1) * max_split_size);
+                        job->pieces[piece] = encode_permutation(std::vector<std::byte>(start, end), *job->permutation, is_dialogue, format, sound_options, encoder_threads, &stage_times);
+                    });
+                }
+            }
+            else {
+                job->pieces.emplace_back(encode_permutation(permutation.pcm, permutation, is_dialogue, format, sound_options, encoder_threads, &stage_times));
+                permutation.pcm = std::vector<std::byte>();
+            }
+        });
+    }
+
+    std::size_t thread_count = std::max(std::min(sound_options.max_threads, total_sound_count), static_cast<std::size_t>(1));
+    queue.run(thread_count);
+
+    // Save anything we had to encode so it can be reused next time
+    if(sound_options.cache.has_value()) {
+        for(auto *job : jobs_by_size) {
+            if(!job->cached && !sound_options.cache->store(*job->cache_key, serialize_cache_entry(job->seconds, job->pieces))) {
+                eprintf_warn("Failed to cache %s in %s", job->permutation->name.c_str(), sound_options.cache->get_directory().string().c_str());
+            }
+        }
+    }
+
+    // Put everything in the tag in the same order as it was read
+    if(!sound_options.batch) {
+        oprintf("Found %zu sound%s:\n", total_sound_count, total_sound_count == 1 ? "" : "s");
+    }
     for(std::size_t pr = 0; pr < pitch_range_count; pr++) {
-        encoding_mutex.lock();
         auto &pitch_range = sound_tag.pitch_ranges[pitch_range_index[pr]];
         auto &permutations = pitch_ranges[pr].first;
         auto actual_permutation_count = permutations.size();
         pitch_range.actual_permutation_count = actual_permutation_count;
         pitch_range.permutations.resize(actual_permutation_count);
-        encoding_mutex.unlock();
 
         for(auto &p : pitch_range.permutations) {
             p.format = sound_tag.format;
@@ -378,221 +664,40 @@ template<typename T> static std::vector<std::byte> make_sound_tag(const std::fil
         for(std::size_t i = 0; i < actual_permutation_count; i++) {
             // Get the permutation and set its name, too
             auto &permutation = permutations[i];
+            auto &job = jobs[pr][i];
             std::strncpy(pitch_range.permutations[i].name.string, permutation.name.c_str(), sizeof(pitch_range.permutations[i].name.string) - 1);
 
-            // Calculate length
-            double seconds = permutation.pcm.size() / static_cast<double>(static_cast<std::size_t>(permutation.sample_rate) * static_cast<std::size_t>(permutation.bits_per_sample / 8) * static_cast<std::size_t>(permutation.channel_count));
-            std::size_t bytes_per_sample_one_channel = permutation.bits_per_sample / 8;
-            std::size_t bytes_per_sample_all_channels = bytes_per_sample_one_channel * permutation.channel_count;
-
-            // Encode a permutation
-            auto encode_permutation = [](auto *sound_tag, std::size_t pitch_range, std::size_t pitch_range_permutation, std::mutex *mutex, std::vector<std::byte> pcm, const SoundReader::Sound *permutation, bool is_dialogue, SoundFormat format, SoundOptions *sound_options, std::atomic<std::size_t> *thread_count) {
-                auto generate_mouth_data = [&permutation](const std::vector<std::uint8_t> &pcm_8_bit) -> std::vector<std::byte> {
-                    // Basically, take the sample rate, multiply by channel count, divide by tick rate (30 Hz), and round the result
-                    std::size_t samples_per_tick = static_cast<std::size_t>((permutation->sample_rate * permutation->channel_count) / TICK_RATE + 0.5);
-                    std::size_t sample_count = pcm_8_bit.size();
-
-                    // Generate samples, adding an extra tick for incomplete ticks
-                    std::size_t tick_count = (sample_count + samples_per_tick - 1) / samples_per_tick;
-                    std::vector<std::byte> mouth_data = std::vector<std::byte>(tick_count);
-                    auto *pcm_data = pcm_8_bit.data();
-
-                    // Get max and total
-                    std::uint8_t max = 0;
-                    double mouth_total = 0;
-                    for(std::size_t t = 0; t < tick_count; t++) {
-                        // Get the sample range, accounting for when there aren't enough ticks
-                        std::size_t first_sample = t * samples_per_tick;
-                        std::size_t sample_count_to_check = sample_count - first_sample;
-                        if(sample_count_to_check > samples_per_tick) {
-                            sample_count_to_check = samples_per_tick;
-                        }
-                        std::size_t last_sample = first_sample + sample_count_to_check;
-                        double total = 0;
-                        for(std::size_t s = first_sample; s < last_sample; s++) {
-                            total += pcm_data[s];
-                        }
-
-                        // Divide by samples per tick
-                        double average = total / samples_per_tick;
-                        mouth_total += average;
-                        mouth_data[t] = static_cast<std::byte>(average);
-
-                        if(average > max) {
-                            max = average;
-                        }
-                    }
-
-                    // Get average and min, clamping min to 0-255
-                    double average = mouth_total / tick_count;
-                    double min = 2.0 * average - max;
-                    if(min > UINT8_MAX) {
-                        min = UINT8_MAX;
-                    }
-                    else if(min < 0) {
-                        min = 0;
-                    }
-
-                    // Get range
-                    double range = static_cast<double>(max + average) / 2 - min;
-
-                    // Do nothing if there's no range
-                    if(range == 0) {
-                        return mouth_data;
-                    }
-
-                    // Go through each sample
-                    for(std::size_t t = 0; t < tick_count; t++) {
-                        double sample = (static_cast<std::uint8_t>(mouth_data[t]) - min) / range;
-
-                        // Clamp to 0 - 255
-                        if(sample >= 1.0) {
-                            mouth_data[t] = static_cast<std::byte>(UINT8_MAX);
-                        }
-                        else if(sample <= 0.0) {
-                            mouth_data[t] = static_cast<std::byte>(0);
-                        }
-                        else {
-                            mouth_data[t] = static_cast<std::byte>(sample * UINT8_MAX);
-                        }
-                    }
-
-                    return mouth_data;
-                };
-
-                // Generate mouth data if needed
-                std::vector<std::byte> mouth_data;
-                if(is_dialogue) {
-                    // Convert samples to 8-bit unsigned so we can use it to generate mouth data
-                    auto samples_float = SoundEncoder::convert_int_to_float(pcm, permutation->bits_per_sample);
-                    std::vector<std::uint8_t> pcm_8_bit;
-                    pcm_8_bit.reserve(samples_float.size());
-                    for(auto &f : samples_float) {
-                        float ff = f;
-                        if(ff < 0.0F) {
-                            ff *= -1.0F;
-                        }
-                        pcm_8_bit.emplace_back(static_cast<std::uint8_t>(ff * UINT8_MAX));
-                    }
-                    samples_float = {};
-                    mouth_data = generate_mouth_data(pcm_8_bit);
+            // Add each piece, chaining them together if it was split
+            auto permutation_template = pitch_range.permutations[i];
+            std::size_t piece_count = job.pieces.size();
+            for(std::size_t piece = 0; piece < piece_count; piece++) {
+                auto &p = piece == 0 ? pitch_range.permutations[i] : pitch_range.permutations.emplace_back(permutation_template);
+                auto &encoded = job.pieces[piece];
+                p.samples = std::move(encoded.samples);
+                p.buffer_size = encoded.buffer_size;
+                p.mouth_data = std::move(encoded.mouth_data);
+
+                if(piece + 1 == piece_count) {
+                    p.next_permutation_index = NULL_INDEX;
                 }
-
-                // Do the encoding thing
-                std::vector<std::byte> samples;
-                std::size_t buffer_size = 0;
-
-                switch(format) {
-                    // Basically, just make it 16-bit big endian
-                    case SoundFormat::SOUND_FORMAT_16_BIT_PCM:
-                        samples = Invader::SoundEncoder::convert_to_16_bit_pcm_big_endian(pcm, permutation->bits_per_sample);
-                        buffer_size = samples.size();
-                        break;
-
-                    // Encode to Vorbis in an Ogg container
-                    case SoundFormat::SOUND_FORMAT_OGG_VORBIS: {
-                        if(sound_options->compression_level > 1.0F) {
-                            sound_options->compression_level = 1.0F;
-                        }
-                        else if(sound_options->compression_level < 0.0F) {
-                            sound_options->compression_level = 0.0F;
-                        }
-                        if(sound_options->bitrate.has_value()) {
-                            samples = Invader::SoundEncoder::encode_to_ogg_vorbis_cbr(pcm, permutation->bits_per_sample, permutation->channel_count, permutation->sample_rate, *sound_options->bitrate);
-                        }
-                        else {
-                            samples = Invader::SoundEncoder::encode_to_ogg_vorbis_vbr(pcm, permutation->bits_per_sample, permutation->channel_count, permutation->sample_rate, *sound_options->compression_level);
-                        }
-                        buffer_size = pcm.size() / (permutation->bits_per_sample / 8) * sizeof(std::int16_t);
-                        break;
-                    }
-
-                    // Encode to Xbox ADPCMeme
-                    case SoundFormat::SOUND_FORMAT_XBOX_ADPCM:
-                        samples = Invader::SoundEncoder::encode_to_xbox_adpcm(pcm, permutation->bits_per_sample, permutation->channel_count);
-                        break;
-
-                    default:
-                        eprintf_error("Invalid format. What?");
-                        std::terminate();
-                }
-
-                // Set the default stuff
-                mutex->lock();
-                auto &p = sound_tag->pitch_ranges[pitch_range].permutations[pitch_range_permutation];
-                p.samples = samples;
-                p.buffer_size = buffer_size;
-                p.samples.shrink_to_fit();
-                p.mouth_data = mouth_data;
-                mutex->unlock();
-
-                // Finish up
-                (*thread_count)--;
-            };
-
-            // Split things we can't trivially split losslessly
-            if(split && enable_threading_split_permutation_encoding) {
-                std::size_t max_split_size = SPLIT_BUFFER_SIZE - (SPLIT_BUFFER_SIZE % bytes_per_sample_all_channels);
-
-                std::size_t digested = 0;
-                while(permutation.pcm.size() > 0) {
-                    // Basically, if we haven't encoded anything, use the i-th permutation, otherwise make a new one as a copy
-                    encoding_mutex.lock();
-                    auto &p = digested == 0 ? pitch_range.permutations[i] : pitch_range.permutations.emplace_back(pitch_range.permutations[i]);
-                    encoding_mutex.unlock();
-                    std::size_t remaining_size = permutation.pcm.size();
-                    std::size_t permutation_size = remaining_size > max_split_size ? max_split_size : remaining_size;
-
-                    // Encode it
-                    auto *sample_data_start = permutation.pcm.data();
-                    auto sample_data = std::vector<std::byte>(sample_data_start, sample_data_start + permutation_size);
-                    permutation.pcm = std::vector<std::byte>(permutation.pcm.begin() + permutation_size, permutation.pcm.end());
-                    permutation.pcm.shrink_to_fit();
-                    digested += permutation_size;
-
-                    if(permutation.pcm.size() == 0) {
-                        p.next_permutation_index = NULL_INDEX;
+                else {
+                    std::size_t next_permutation = pitch_range.permutations.size();
+                    if(next_permutation > MAX_PERMUTATIONS) {
+                        eprintf_error("Maximum number of total permutations (%zu > %zu) exceeded", next_permutation, MAX_PERMUTATIONS);
+                        throw InvalidInputSoundException();
                     }
-                    else {
-                        std::size_t next_permutation = pitch_range.permutations.size();
-                        if(next_permutation > MAX_PERMUTATIONS) {
-                            encoding_mutex.lock();
-                            eprintf_error("Maximum number of total permutations (%zu > %zu) exceeded", next_permutation, MAX_PERMUTATIONS);
-                            std::exit(EXIT_FAILURE);
-                        }
-                        p.next_permutation_index = static_cast<Index>(next_permutation);
-                    }
-
-                    // Wait until we have threads cleared up
-                    wait_until_threads_are_open();
-
-                    // Punch it
-                    thread_count++;
-                    std::thread(encode_permutation, &sound_tag, pr, &p - pitch_range.permutations.data(), &encoding_mutex, std::move(sample_data), &permutation, is_dialogue, format, &sound_options, &thread_count).detach();
+                    p.next_permutation_index = static_cast<Index>(next_permutation);
                 }
             }
-            else {
-                // Wait until we have threads cleared up
-                wait_until_threads_are_open();
-
-                // Punch it
-                thread_count++;
-                auto &p = pitch_range.permutations[i];
-                p.next_permutation_index = NULL_INDEX;
-                std::thread(encode_permutation, &sound_tag, pr, &p - pitch_range.permutations.data(), &encoding_mutex, std::move(permutation.pcm), &permutation, is_dialogue, format, &sound_options, &thread_count).detach();
-            }
 
             // Print sound info
-            encoding_mutex.lock();
-            oprintf("    %-32s%2zu:%06.3f (%2zu-bit %6s %5zu Hz)\n", permutation.name.c_str(), static_cast<std::size_t>(seconds) / 60, std::fmod(seconds, 60.0), static_cast<std::size_t>(permutation.input_bits_per_sample), permutation.input_channel_count == 1 ? "mono" : "stereo", static_cast<std::size_t>(permutation.input_sample_rate));
+            if(!sound_options.batch) {
+                oprintf("    %-32s%2zu:%06.3f (%2zu-bit %6s %5zu Hz)%s\n", permutation.name.c_str(), static_cast<std::size_t>(job.seconds) / 60, std::fmod(job.seconds, 60.0), static_cast<std::size_t>(permutation.input_bits_per_sample), permutation.input_channel_count == 1 ? "mono" : "stereo", static_cast<std::size_t>(permutation.input_sample_rate), job.cached ? " (cached)" : "");
+            }
             permutation.pcm = std::vector<std::byte>();
-            encoding_mutex.unlock();
         }
     }
 
-    // Wait until we have 0 threads left
-    wait_until_threads_are_done();
-
     // Next, if we can split losslessly, do it
     if(split && !enable_threading_split_permutation_encoding) {
         auto split_size = format == SoundFormat::SOUND_FORMAT_XBOX_ADPCM ? XBOX_ADPCM_SPLIT_SIZE : SPLIT_BUFFER_SIZE;
@@ -648,11 +753,187 @@ template<typename T> static std::vector<std::byte> make_sound_tag(const std::fil
 
     auto sound_tag_data = sound_tag.generate_hek_tag_data(TagFourCC::TAG_FOURCC_SOUND, true);
 
-    oprintf("Output: %s, %s, %zu Hz%s, %s, %.03f MiB\n", output_name, highest_channel_count == 1 ? "mono" : "stereo", static_cast<std::size_t>(highest_sample_rate), split ? ", split" : "", SoundClass_to_string(sound_class), sound_tag_data.size() / 1024.0 / 1024.0);
+    // In batch mode, everything about the tag goes on one line since other tags are being made at the same time
+    char cached_info[64] = {};
+    if(cached_count > 0) {
+        std::snprintf(cached_info, sizeof(cached_info), " (%zu of %zu cached)", cached_count.load(), total_sound_count);
+    }
+    if(sound_options.batch) {
+        auto tag_name = data_path.lexically_relative(sound_options.data).string();
+        oprintf("%s: %zu sound%s, %s, %s, %zu Hz%s, %s, %.03f MiB%s\n", tag_name.c_str(), total_sound_count, total_sound_count == 1 ? "" : "s", output_name, highest_channel_count == 1 ? "mono" : "stereo", static_cast<std::size_t>(highest_sample_rate), split ? ", split" : "", SoundClass_to_string(sound_class), sound_tag_data.size() / 1024.0 / 1024.0, cached_info);
+        return sound_tag_data;
+    }
+
+    oprintf("Output: %s, %s, %zu Hz%s, %s, %.03f MiB%s\n", output_name, highest_channel_count == 1 ? "mono" : "stereo", static_cast<std::size_t>(highest_sample_rate), split ? ", split" : "", SoundClass_to_string(sound_class), sound_tag_data.size() / 1024.0 / 1024.0, cached_info);
+
+    oprintf("Time spent in each stage (summed across %zu thread%s):\n", thread_count, thread_count == 1 ? "" : "s");
+    for(std::size_t s = 0; s < SoundStageTimes::STAGE_COUNT; s++) {
+        oprintf("    %-10s %10.03f s\n", SoundStageTimes::STAGE_NAMES[s], stage_times.microseconds[s].load() / 1000000.0);
+    }
 
     return sound_tag_data;
 }
 
+static bool is_supported_sound_file(const std::filesystem::path &path) {
+    auto extension = path.extension().string();
+    for(auto &c : extension) {
+        c = std::tolower(c);
+    }
+    return extension == ".wav" || extension == ".wave" || extension == ".flac";
+}
+
+// Make the sound tag from the data directory and save it
+static bool make_and_save_sound_tag(const std::string &halo_tag_path, SoundOptions &sound_options) {
+    auto data_path = std::filesystem::path(sound_options.data) / halo_tag_path;
+    if(!std::filesystem::is_directory(data_path)) {
+        eprintf_error("No directory exists at %s", data_path.string().c_str());
+        return false;
+    }
+
+    // Generate sound tag
+    std::vector<std::byte> sound_tag_data;
+    auto tag_path = std::filesystem::path(sound_options.tags) / (halo_tag_path + ".sound");
+
+    try {
+        sound_tag_data = make_sound_tag<Parser::Sound>(tag_path, data_path, sound_options);
+    }
+    catch(std::exception &e) {
+        eprintf_error("Failed to create sound tag %s due to an exception error: %s", halo_tag_path.c_str(), e.what());
+        return false;
+    }
+
+    // Create missing directories if needed
+    std::error_code ec;
+    std::filesystem::create_directories(tag_path.parent_path(), ec);
+
+    // Save
+    if(!Invader::File::save_file(tag_path.string().c_str(), sound_tag_data)) {
+        eprintf_error("Failed to save %s", tag_path.string().c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// A directory with sound files in it is a sound tag unless its parent directory is an existing sound tag, in which case
+// it is one of that tag's pitch ranges. New sound tags with multiple pitch ranges have to be made individually.
+static std::optional<std::vector<std::string>> find_sound_tags_in_data(const SoundOptions &sound_options) {
+    std::vector<std::string> sound_tags;
+    try {
+        std::vector<std::filesystem::path> directories;
+        for(auto &i : std::filesystem::recursive_directory_iterator(sound_options.data)) {
+            if(i.is_regular_file() && is_supported_sound_file(i.path())) {
+                directories.emplace_back(i.path().parent_path());
+            }
+        }
+        std::sort(directories.begin(), directories.end());
+        directories.erase(std::unique(directories.begin(), directories.end()), directories.end());
+
+        File::PathMatcher matcher(sound_options.search, sound_options.search_exclude);
+        for(auto &directory : directories) {
+            auto sound_tag = directory.lexically_relative(sound_options.data);
+            if(sound_tag.has_parent_path() && std::filesystem::is_regular_file(std::filesystem::path(sound_options.tags / sound_tag.parent_path()) += ".sound")) {
+                sound_tag = sound_tag.parent_path();
+            }
+            auto sound_tag_string = sound_tag.string();
+            if(matcher.matches(sound_tag_string.c_str())) {
+                sound_tags.emplace_back(std::move(sound_tag_string));
+            }
+        }
+    }
+    catch(std::exception &e) {
+        eprintf_error("Error listing %s: %s", sound_options.data.string().c_str(), e.what());
+        return std::nullopt;
+    }
+
+    std::sort(sound_tags.begin(), sound_tags.end());
+    sound_tags.erase(std::unique(sound_tags.begin(), sound_tags.end()), sound_tags.end());
+    return sound_tags;
+}
+
+// Get the total size of the sound files a sound tag is made from
+static std::uintmax_t source_size(const SoundOptions &sound_options, const std::string &sound_tag) {
+    std::uintmax_t size = 0;
+    std::error_code ec;
+    for(auto &i : std::filesystem::recursive_directory_iterator(sound_options.data / sound_tag, ec)) {
+        if(i.is_regular_file(ec)) {
+            auto file_size = i.file_size(ec);
+            size += ec ? 0 : file_size;
+        }
+    }
+    return size;
+}
+
+static int perform_the_batch_ritual(SoundOptions &sound_options, std::vector<std::string> sound_tags) {
+    auto batch_start = std::chrono::steady_clock::now();
+
+    // Start with the biggest sounds so one long sound isn't left running by itself at the end
+    std::vector<std::pair<std::uintmax_t, std::string>> queue;
+    queue.reserve(sound_tags.size());
+    for(auto &sound_tag : sound_tags) {
+        queue.emplace_back(source_size(sound_options, sound_tag), std::move(sound_tag));
+    }
+    std::stable_sort(queue.begin(), queue.end(), [](auto &a, auto &b) { return a.first > b.first; });
+
+    SoundStageTimes stage_times;
+    sound_options.stage_times = &stage_times;
+
+    // Make one sound tag per thread, splitting any leftover threads between them
+    std::mutex thread_mutex;
+    std::vector<std::thread> threads;
+    std::size_t sound_index = 0;
+    std::size_t success = 0;
+    std::size_t thread_count = std::min(sound_options.max_threads, queue.size());
+    std::size_t threads_per_sound = std::max(sound_options.max_threads / std::max(thread_count, static_cast<std::size_t>(1)), static_cast<std::size_t>(1));
+    threads.reserve(thread_count);
+
+    auto sound_worker = [](auto *queue, std::size_t *sound_index, std::mutex *thread_mutex, std::size_t *success, const SoundOptions *sound_options, std::size_t threads_per_sound) {
+        while(true) {
+            thread_mutex->lock();
+            std::size_t this_index = *sound_index;
+            if(this_index == queue->size()) {
+                thread_mutex->unlock();
+                return;
+            }
+            (*sound_index)++;
+            thread_mutex->unlock();
+
+            // Each sound gets its own options since they get filled in from the tag
+            auto options = *sound_options;
+            options.max_threads = threads_per_sound;
+            bool result = make_and_save_sound_tag((*queue)[this_index].second, options);
+
+            // Increment
+            thread_mutex->lock();
+            (*success) += result;
+            thread_mutex->unlock();
+        }
+    };
+
+    // Go through each sound
+    for(std::size_t i = 0; i < thread_count; i++) {
+        threads.emplace_back(sound_worker, &queue, &sound_index, &thread_mutex, &success, &sound_options, threads_per_sound);
+    }
+
+    // Wait for all threads to end
+    for(auto &i : threads) {
+        i.join();
+    }
+
+    sound_options.stage_times = nullptr;
+
+    oprintf("Made %zu out of %zu sound tag%s\n", success, queue.size(), queue.size() == 1 ? "" : "s");
+
+    // Show where the time went
+    oprintf("Time spent in each stage (summed across %zu thread%s):\n", sound_options.max_threads, sound_options.max_threads == 1 ? "" : "s");
+    for(std::size_t s = 0; s < SoundStageTimes::STAGE_COUNT; s++) {
+        oprintf("    %-10s %10.03f s\n", SoundStageTimes::STAGE_NAMES[s], stage_times.microseconds[s].load() / 1000000.0);
+    }
+    oprintf("Finished in %.03f s\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - batch_start).count());
+
+    return success == queue.size() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int main(int argc, const char **argv) {
     set_up_color_term();
 
@@ -663,6 +944,8 @@ int main(int argc, const char **argv) {
         CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_FS_PATH),
         CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_DATA),
         CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_TAGS),
+        CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_BATCH),
+        CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_BATCH_EXCLUDE),
         CommandLineOption("split", 's', 0, "Split permutations into 227.5 KiB chunks. This is necessary for longer sounds (e.g. music) when being played in the original Halo engine."),
         CommandLineOption("no-split", 'S', 0, "Do not split permutations."),
         CommandLineOption("format", 'F', 1, "Set the format. Can be: 16-bit_pcm, ogg_vorbis, or xbox_adpcm. Default: 16-bit_pcm", "<fmt>"),
@@ -671,13 +954,15 @@ int main(int argc, const char **argv) {
         CommandLineOption("compress-level", 'l', 1, "Set the compression level. This can be between 0.0 and 1.0. For Ogg Vorbis, higher levels result in better quality but worse sizes. Default: 0.8", "<lvl>"),
         CommandLineOption("bitrate", 'R', 1, "Set the bitrate in kilobits per second. This only applies to vorbis.", "<br>"),
         CommandLineOption("class", 'c', 1, "Set the class. This is required when generating new sounds. Can be: ambient_computers, ambient_machinery, ambient_nature, device_computers, device_door, device_force_field, device_machinery, device_nature, first_person_damage, game_event, music, object_impacts, particle_impacts, projectile_impact, projectile_detonation, scripted_dialog_force_unspatialized, scripted_dialog_other, scripted_dialog_player, scripted_effect, slow_particle_impacts, unit_dialog, unit_footsteps, vehicle_collision, vehicle_engine, weapon_charge, weapon_empty, weapon_fire, weapon_idle, weapon_overheat, weapon_ready, weapon_reload", "<class>"),
-        CommandLineOption("threads", 'j', 1, "Set the number of threads to use for parallel resampling and encoding. Default: CPU thread count")
+        CommandLineOption("threads", 'j', 1, "Set the number of threads to use for parallel resampling and encoding. Default: CPU thread count"),
+        CommandLineOption("cache", 'a', 1, "Cache encoded permutations in the given directory, reusing them if the source audio and sound settings are unchanged.", "<dir>"),
+        CommandLineOption("adpcm-mode", 'A', 1, "Set the Xbox ADPCM encoding mode. Can be: deterministic (same output regardless of thread count) or quality (more lookahead and noise shaping; much slower). Default: deterministic", "<mode>")
     };
 
     static constexpr char DESCRIPTION[] = "Create or modify a sound tag.";
-    static constexpr char USAGE[] = "[options] <sound-tag>";
+    static constexpr char USAGE[] = "[options] <-b [expr] | <sound-tag>>";
 
-    auto remaining_arguments = CommandLineOption::parse_arguments<SoundOptions &>(argc, argv, options, USAGE, DESCRIPTION, 1, 1, sound_options, [](char opt, const std::vector<const char *> &arguments, auto &sound_options) {
+    auto remaining_arguments = CommandLineOption::parse_arguments<SoundOptions &>(argc, argv, options, USAGE, DESCRIPTION, 0, 1, sound_options, [](char opt, const std::vector<const char *> &arguments, auto &sound_options) {
         switch(opt) {
             case 'd':
                 sound_options.data = arguments[0];
@@ -695,9 +980,24 @@ int main(int argc, const char **argv) {
                 sound_options.split = true;
                 break;
 
+            case 'b':
+                sound_options.search.emplace_back(File::preferred_path_to_halo_path(arguments[0]));
+                break;
+
+            case 'e':
+                sound_options.search_exclude.emplace_back(File::preferred_path_to_halo_path(arguments[0]));
+                break;
+
+            case 'a':
+                sound_options.cache.emplace(arguments[0]);
+                break;
+
             case 'j':
                 try {
                     sound_options.max_threads = std::stoul(arguments[0]);
+                    if(sound_options.max_threads < 1) {
+                        throw std::exception();
+                    }
                 }
                 catch(std::exception &) {
                     eprintf_error("Invalid number of threads %s\n", arguments[0]);
@@ -709,6 +1009,19 @@ int main(int argc, const char **argv) {
                 sound_options.split = false;
                 break;
 
+            case 'A':
+                if(std::strcmp(arguments[0], "deterministic") == 0) {
+                    sound_options.adpcm_mode = SoundEncoder::XboxADPCMEncodeMode::XBOX_ADPCM_ENCODE_DETERMINISTIC;
+                }
+                else if(std::strcmp(arguments[0], "quality") == 0) {
+                    sound_options.adpcm_mode = SoundEncoder::XboxADPCMEncodeMode::XBOX_ADPCM_ENCODE_QUALITY;
+                }
+                else {
+                    eprintf_error("Unknown Xbox ADPCM mode %s (should be \"deterministic\" or \"quality\")", arguments[0]);
+                    std::exit(EXIT_FAILURE);
+                }
+                break;
+
             case 'R':
                 try {
                     sound_options.bitrate = static_cast<std::uint16_t>(std::stol(arguments[0]));
@@ -778,7 +1091,28 @@ int main(int argc, const char **argv) {
         return EXIT_FAILURE;
     }
 
-    // Get our paths and make sure a data directory exists
+    // Make all matching sounds in the data directory?
+    if(!sound_options.search.empty() || !sound_options.search_exclude.empty()) {
+        if(!remaining_arguments.empty() || sound_options.fs_path) {
+            eprintf_error("Can't use an extra tag path or --fs-path with -b. Use -h for more information.");
+            return EXIT_FAILURE;
+        }
+
+        auto sound_tags = find_sound_tags_in_data(sound_options);
+        if(!sound_tags.has_value()) {
+            return EXIT_FAILURE;
+        }
+
+        sound_options.batch = true;
+        return perform_the_batch_ritual(sound_options, std::move(*sound_tags));
+    }
+
+    if(remaining_arguments.empty()) {
+        eprintf_error("A sound tag path was expected. Use -h for more information.");
+        return EXIT_FAILURE;
+    }
+
+    // Get our paths
     std::string halo_tag_path;
     if(sound_options.fs_path) {
         auto tag_path_maybe = Invader::File::file_path_to_tag_path(remaining_arguments[0], sound_options.tags);
@@ -793,33 +1127,7 @@ int main(int argc, const char **argv) {
 
     // Remove trailing slashes
     halo_tag_path = Invader::File::remove_trailing_slashes(halo_tag_path);
-    auto data_path = std::filesystem::path(sound_options.data) / halo_tag_path;
-    if(!std::filesystem::is_directory(data_path)) {
-        eprintf_error("No directory exists at %s", data_path.string().c_str());
-        return EXIT_FAILURE;
-    }
-
-    // Generate sound tag
-    std::vector<std::byte> sound_tag_data;
-    auto tag_path = std::filesystem::path(sound_options.tags) / (halo_tag_path + ".sound");
-
-    try {
-        sound_tag_data = make_sound_tag<Parser::Sound>(tag_path, data_path, sound_options);
-    }
-    catch(std::exception &e) {
-        eprintf_error("Failed to create sound tag due to an exception error: %s", e.what());
-        return EXIT_FAILURE;
-    }
-
-    // Create missing directories if needed
-    std::error_code ec;
-    std::filesystem::create_directories(tag_path.parent_path(), ec);
-
-    // Save
-    if(!Invader::File::save_file(tag_path.string().c_str(), sound_tag_data)) {
-        eprintf_error("Failed to save %s", tag_path.string().c_str());
-        return EXIT_FAILURE;
-    }
+    return make_and_save_sound_tag(halo_tag_path, sound_options) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 static void populate_pitch_range(std::vector<SoundReader::Sound> &permutations, const std::filesystem::path &directory, std::uint32_t &highest_sample_rate, std::uint16_t &highest_channel_count) {
@@ -828,7 +1136,7 @@ static void populate_pitch_range(std::vector<SoundReader::Sound> &permutations,
         auto path = wav.path();
         if(wav.is_directory()) {
             eprintf_error("Unexpected directory %s", path.string().c_str());
-            std::exit(EXIT_FAILURE);
+            throw InvalidInputSoundException();
         }
         auto extension = path.extension().string();
         for(auto &c : extension) {
@@ -846,12 +1154,12 @@ static void populate_pitch_range(std::vector<SoundReader::Sound> &permutations,
             }
             else {
                 eprintf_error("Unsupported input file %s.\nSupported input formats are Free Lossless Audio Codec (.flac) or Waveform Audio (.wav, .wave).", path.string().c_str());
-                std::exit(EXIT_FAILURE);
+                throw InvalidInputSoundException();
             }
         }
         catch(std::exception &e) {
             eprintf_error("Failed to load %s: %s", path.string().c_str(), e.what());
-            std::exit(EXIT_FAILURE);
+            throw InvalidInputSoundException();
         }
 
         // Get the permutation name
@@ -859,7 +1167,7 @@ static void populate_pitch_range(std::vector<SoundReader::Sound> &permutations,
         sound.name = filename.substr(0, filename.size() - extension.size());
         if(sound.name.size() >= sizeof(HEK::TagString)) {
             eprintf_error("Permutation name %s exceeds the maximum permutation name size (%zu >= %zu)", sound.name.c_str(), sound.name.size(), sizeof(HEK::TagString));
-            std::exit(EXIT_FAILURE);
+            throw InvalidInputSoundException();
         }
 
         // Lowercase it
@@ -878,11 +1186,11 @@ static void populate_pitch_range(std::vector<SoundReader::Sound> &permutations,
         // Make sure we can actually work with this
         if(sound.channel_count > 2 || sound.channel_count < 1) {
             eprintf_error("Unsupported channel count %u in %s", static_cast<unsigned int>(sound.channel_count), path.string().c_str());
-            std::exit(EXIT_FAILURE);
+            throw InvalidInputSoundException();
         }
         if(sound.bits_per_sample % 8 != 0 || sound.bits_per_sample < 8 || sound.bits_per_sample > 24) {
             eprintf_error("Bits per sample (%u) is not divisible by 8 in %s (or is too small or too big)", static_cast<unsigned int>(sound.bits_per_sample), path.string().c_str());
-            std::exit(EXIT_FAILURE);
+            throw InvalidInputSoundException();
         }
 
         // Make it small
@@ -896,21 +1204,20 @@ static void populate_pitch_range(std::vector<SoundReader::Sound> &permutations,
             }
             else if(sound.name == permutations[i].name) {
                 eprintf_error("Multiple permutations with the same name (%s) cannot be added", permutations[i].name.c_str());
-                std::exit(EXIT_FAILURE);
+                throw InvalidInputSoundException();
             }
         }
         permutations.insert(permutations.begin() + i, std::move(sound));
     }
 }
 
-static void process_permutation_thread(SoundReader::Sound *permutation, std::uint16_t highest_sample_rate, SoundFormat format, std::uint16_t highest_channel_count, std::atomic<std::size_t> *thread_count, bool fit_adpcm_block_size) {
+static void process_permutation(SoundReader::Sound *permutation, std::uint16_t highest_sample_rate, SoundFormat format, std::uint16_t highest_channel_count, bool fit_adpcm_block_size, SoundStageTimes *stage_times) {
+    auto convert_start = std::chrono::steady_clock::now();
+
     // Calculate some stuff
     std::size_t bytes_per_sample = permutation->bits_per_sample / 8;
     std::size_t sample_count = permutation->pcm.size() / bytes_per_sample;
 
-    // Mutex for errors
-    static std::mutex error_mutex;
-
     // Bits per sample doesn't match; we can fix that though
     if(bytes_per_sample != sizeof(std::uint16_t) && (format == SoundFormat::SOUND_FORMAT_16_BIT_PCM || format == SoundFormat::SOUND_FORMAT_XBOX_ADPCM)) {
         std::size_t new_bytes_per_sample = sizeof(std::uint16_t);
@@ -960,39 +1267,17 @@ static void process_permutation_thread(SoundReader::Sound *permutation, std::uin
         permutation->channel_count = 1;
     }
 
+    stage_times->add(SoundStageTimes::STAGE_CONVERT, convert_start);
+    auto resample_start = std::chrono::steady_clock::now();
+
     // Sample rate doesn't match; this can be fixed with resampling
     if(static_cast<double>(highest_sample_rate) != permutation->sample_rate) {
         double ratio = static_cast<double>(highest_sample_rate) / permutation->sample_rate;
-        std::vector<float> float_samples = SoundEncoder::convert_int_to_float(permutation->pcm, permutation->bits_per_sample);
-        std::vector<float> new_samples(float_samples.size() * ratio);
-        permutation->sample_rate = highest_sample_rate;
-
-        // Resample it
-        SRC_DATA data = {};
-        data.data_in = float_samples.data();
-        data.data_out = new_samples.data();
-        data.input_frames = float_samples.size() / permutation->channel_count;
-        data.output_frames = new_samples.size() / permutation->channel_count;
-        data.src_ratio = ratio;
-        int res = src_simple(&data, SRC_SINC_BEST_QUALITY, permutation->channel_count);
-        if(res) {
-            error_mutex.lock();
-            eprintf_error("Failed to resample: %s", src_strerror(res));
-            std::exit(EXIT_FAILURE);
-        }
-        new_samples.resize(data.output_frames_gen * permutation->channel_count);
-
-        // Set stuff
-        if(format == SoundFormat::SOUND_FORMAT_16_BIT_PCM) {
-            bytes_per_sample = sizeof(std::uint16_t);
-        }
+        permutation->pcm = SoundEncoder::resample(permutation->pcm, permutation->bits_per_sample, permutation->channel_count, ratio);
         permutation->sample_rate = highest_sample_rate;
-        permutation->bits_per_sample = bytes_per_sample * 8;
-        sample_count = new_samples.size();
-        permutation->pcm = SoundEncoder::convert_float_to_int(new_samples, permutation->bits_per_sample);
+        sample_count = permutation->pcm.size() / bytes_per_sample;
     }
 
-
     // Add samples to fit block size via resampling
     auto adpcm_block_size = SoundEncoder::calculate_adpcm_pcm_block_size(highest_channel_count);
     auto trip_adpcm_block_size = adpcm_block_size * 123;
@@ -1002,26 +1287,11 @@ static void process_permutation_thread(SoundReader::Sound *permutation, std::uin
         std::size_t delta = trip_adpcm_block_size + (adpcm_block_size - (sample_count % adpcm_block_size));
         if(delta > 0) {
             double ratio = delta / static_cast<double>(quad_adpcm_block_size);
-            std::vector<float> float_samples = SoundEncoder::convert_int_to_float(permutation->pcm, permutation->bits_per_sample);
-            std::vector<float> new_samples(float_samples.size() * ratio);
             auto new_quad = static_cast<std::size_t>(quad_adpcm_block_size * ratio);
 
-            // Resample it
-            SRC_DATA data = {};
-            data.data_in = float_samples.data();
-            data.data_out = new_samples.data();
-            data.input_frames = float_samples.size() / permutation->channel_count;
-            data.output_frames = new_samples.size() / permutation->channel_count;
-            data.src_ratio = ratio;
-            int res = src_simple(&data, SRC_SINC_BEST_QUALITY, permutation->channel_count);
-            if(res) {
-                error_mutex.lock();
-                eprintf_error("Failed to resample: %s", src_strerror(res));
-                std::exit(EXIT_FAILURE);
-            }
-
-            new_samples.resize(data.output_frames_gen * permutation->channel_count);
-            auto new_int_samples = SoundEncoder::convert_float_to_int(new_samples, permutation->bits_per_sample);
+            // Only the start gets replaced, so there's no need to resample any more than that
+            auto new_int_samples = SoundEncoder::resample(permutation->pcm, permutation->bits_per_sample, permutation->channel_count, ratio, (new_quad + permutation->channel_count - 1) / permutation->channel_count);
+            new_quad = std::min(new_quad, new_int_samples.size() / bytes_per_sample);
 
             permutation->pcm.erase(permutation->pcm.begin(), permutation->pcm.begin() + quad_adpcm_block_size * bytes_per_sample);
             permutation->pcm.insert(permutation->pcm.begin(), new_int_samples.begin(), new_int_samples.begin() + new_quad * bytes_per_sample);
@@ -1031,5 +1301,139 @@ static void process_permutation_thread(SoundReader::Sound *permutation, std::uin
         }
     }
 
-    (*thread_count)--;
+    stage_times->add(SoundStageTimes::STAGE_RESAMPLE, resample_start);
+}
+
+static std::vector<std::byte> generate_mouth_data(const std::vector<std::uint8_t> &pcm_8_bit, const SoundReader::Sound &permutation) {
+    // Basically, take the sample rate, multiply by channel count, divide by tick rate (30 Hz), and round the result
+    std::size_t samples_per_tick = static_cast<std::size_t>((permutation.sample_rate * permutation.channel_count) / TICK_RATE + 0.5);
+    std::size_t sample_count = pcm_8_bit.size();
+
+    // Generate samples, adding an extra tick for incomplete ticks
+    std::size_t tick_count = (sample_count + samples_per_tick - 1) / samples_per_tick;
+    std::vector<std::byte> mouth_data = std::vector<std::byte>(tick_count);
+    auto *pcm_data = pcm_8_bit.data();
+
+    // Get max and total
+    std::uint8_t max = 0;
+    double mouth_total = 0;
+    for(std::size_t t = 0; t < tick_count; t++) {
+        // Get the sample range, accounting for when there aren't enough ticks
+        std::size_t first_sample = t * samples_per_tick;
+        std::size_t sample_count_to_check = sample_count - first_sample;
+        if(sample_count_to_check > samples_per_tick) {
+            sample_count_to_check = samples_per_tick;
+        }
+        std::size_t last_sample = first_sample + sample_count_to_check;
+        double total = 0;
+        for(std::size_t s = first_sample; s < last_sample; s++) {
+            total += pcm_data[s];
+        }
+
+        // Divide by samples per tick
+        double average = total / samples_per_tick;
+        mouth_total += average;
+        mouth_data[t] = static_cast<std::byte>(average);
+
+        if(average > max) {
+            max = average;
+        }
+    }
+
+    // Get average and min, clamping min to 0-255
+    double average = mouth_total / tick_count;
+    double min = 2.0 * average - max;
+    if(min > UINT8_MAX) {
+        min = UINT8_MAX;
+    }
+    else if(min < 0) {
+        min = 0;
+    }
+
+    // Get range
+    double range = static_cast<double>(max + average) / 2 - min;
+
+    // Do nothing if there's no range
+    if(range == 0) {
+        return mouth_data;
+    }
+
+    // Go through each sample
+    for(std::size_t t = 0; t < tick_count; t++) {
+        double sample = (static_cast<std::uint8_t>(mouth_data[t]) - min) / range;
+
+        // Clamp to 0 - 255
+        if(sample >= 1.0) {
+            mouth_data[t] = static_cast<std::byte>(UINT8_MAX);
+        }
+        else if(sample <= 0.0) {
+            mouth_data[t] = static_cast<std::byte>(0);
+        }
+        else {
+            mouth_data[t] = static_cast<std::byte>(sample * UINT8_MAX);
+        }
+    }
+
+    return mouth_data;
+}
+
+static EncodedSound encode_permutation(const std::vector<std::byte> &pcm, const SoundReader::Sound &permutation, bool is_dialogue, SoundFormat format, const SoundOptions &sound_options, std::size_t encoder_threads, SoundStageTimes *stage_times) {
+    EncodedSound encoded;
+
+    // Generate mouth data if needed
+    if(is_dialogue) {
+        auto mouth_start = std::chrono::steady_clock::now();
+
+        // Convert samples to 8-bit unsigned so we can use it to generate mouth data
+        auto samples_float = SoundEncoder::convert_int_to_float(pcm, permutation.bits_per_sample);
+        std::vector<std::uint8_t> pcm_8_bit;
+        pcm_8_bit.reserve(samples_float.size());
+        for(auto &f : samples_float) {
+            float ff = f;
+            if(ff < 0.0F) {
+                ff *= -1.0F;
+            }
+            pcm_8_bit.emplace_back(static_cast<std::uint8_t>(ff * UINT8_MAX));
+        }
+        samples_float = {};
+        encoded.mouth_data = generate_mouth_data(pcm_8_bit, permutation);
+
+        stage_times->add(SoundStageTimes::STAGE_MOUTH_DATA, mouth_start);
+    }
+
+    // Do the encoding thing
+    auto encode_start = std::chrono::steady_clock::now();
+
+    switch(format) {
+        // Basically, just make it 16-bit big endian
+        case SoundFormat::SOUND_FORMAT_16_BIT_PCM:
+            encoded.samples = Invader::SoundEncoder::convert_to_16_bit_pcm_big_endian(pcm, permutation.bits_per_sample);
+            encoded.buffer_size = encoded.samples.size();
+            break;
+
+        // Encode to Vorbis in an Ogg container (the compression level was already range-checked)
+        case SoundFormat::SOUND_FORMAT_OGG_VORBIS:
+            if(sound_options.bitrate.has_value()) {
+                encoded.samples = Invader::SoundEncoder::encode_to_ogg_vorbis_cbr(pcm, permutation.bits_per_sample, permutation.channel_count, permutation.sample_rate, *sound_options.bitrate);
+            }
+            else {
+                encoded.samples = Invader::SoundEncoder::encode_to_ogg_vorbis_vbr(pcm, permutation.bits_per_sample, permutation.channel_count, permutation.sample_rate, *sound_options.compression_level);
+            }
+            encoded.buffer_size = pcm.size() / (permutation.bits_per_sample / 8) * sizeof(std::int16_t);
+            break;
+
+        // Encode to Xbox ADPCMeme
+        case SoundFormat::SOUND_FORMAT_XBOX_ADPCM:
+            encoded.samples = Invader::SoundEncoder::encode_to_xbox_adpcm(pcm, permutation.bits_per_sample, permutation.channel_count, sound_options.adpcm_mode, encoder_threads);
+            break;
+
+        default:
+            eprintf_error("Invalid format. What?");
+            std::terminate();
+    }
+
+    encoded.samples.shrink_to_fit();
+    stage_times->add(SoundStageTimes::STAGE_ENCODE, encode_start);
+
+    return encoded;
 }
@@ -0,0 +1,280 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <invader/sound/sound_encoder.hpp>
+#include <cstring>
+
+// The conversion kernels below are written so the compiler can vectorize them (SSE2 on x86-64 and NEON on AArch64 are
+// always available). On x86, each kernel is also built for AVX2 and picked at runtime if the CPU supports it.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define INVADER_SOUND_PCM_AVX2_DISPATCH
+#define INVADER_SOUND_PCM_KERNEL [[gnu::always_inline]] inline
+#define INVADER_SOUND_PCM_AVX2 [[gnu::target("avx2")]]
+#else
+#define INVADER_SOUND_PCM_KERNEL inline
+#define INVADER_SOUND_PCM_AVX2
+#endif
+
+namespace Invader::SoundEncoder {
+    namespace {
+        // Read a little endian, sign extended sample that is BYTES long
+        template<std::size_t BYTES> INVADER_SOUND_PCM_KERNEL std::int32_t load_sample(const std::byte *pcm) noexcept {
+            if constexpr(BYTES == 1) {
+                return static_cast<std::int8_t>(pcm[0]);
+            }
+            else if constexpr(BYTES == 2) {
+                std::int16_t sample;
+                std::memcpy(&sample, pcm, sizeof(sample));
+                return sample;
+            }
+            else if constexpr(BYTES == 3) {
+                // Put it in the upper 24 bits and shift it back down to sign extend it
+                std::uint32_t sample = static_cast<std::uint32_t>(static_cast<std::uint8_t>(pcm[0])) << 8 |
+                                       static_cast<std::uint32_t>(static_cast<std::uint8_t>(pcm[1])) << 16 |
+                                       static_cast<std::uint32_t>(static_cast<std::uint8_t>(pcm[2])) << 24;
+                return static_cast<std::int32_t>(sample) >> 8;
+            }
+            else {
+                std::int32_t sample;
+                std::memcpy(&sample, pcm, sizeof(sample));
+                return sample;
+            }
+        }
+
+        // Write the lowest BYTES bytes of the sample in little (or big) endian
+        template<std::size_t BYTES, bool BIG_ENDIAN = false> INVADER_SOUND_PCM_KERNEL void store_sample(std::int32_t sample, std::byte *pcm) noexcept {
+            for(std::size_t b = 0; b < BYTES; b++) {
+                pcm[BIG_ENDIAN ? (BYTES - 1 - b) : b] = static_cast<std::byte>((sample >> b * 8) & 0xFF);
+            }
+        }
+
+        template<std::size_t BYTES> INVADER_SOUND_PCM_KERNEL void int_to_float_kernel(const std::byte *pcm, float *output, std::size_t sample_count, float divide_by, float divide_by_minus_one) noexcept {
+            for(std::size_t i = 0; i < sample_count; i++) {
+                auto sample = load_sample<BYTES>(pcm + i * BYTES);
+                output[i] = static_cast<float>(sample) / (sample < 0 ? divide_by : divide_by_minus_one);
+            }
+        }
+
+        template<std::size_t BYTES> INVADER_SOUND_PCM_KERNEL void float_to_int_kernel(const float *pcm, std::byte *output, std::size_t sample_count, float multiply_by, float multiply_by_minus_one, std::int32_t max, std::int32_t min) noexcept {
+            // Clamping in float before truncating gives the same result as truncating to 64-bit and then clamping, since
+            // anything at or above the float max is clamped either way
+            float max_float = static_cast<float>(max);
+            float min_float = static_cast<float>(min);
+            for(std::size_t i = 0; i < sample_count; i++) {
+                float sample = pcm[i] * (pcm[i] < 0 ? multiply_by : multiply_by_minus_one);
+                sample = sample < min_float ? min_float : sample;
+                std::int32_t sample_int = sample >= max_float ? max : static_cast<std::int32_t>(sample);
+                store_sample<BYTES>(sample_int, output + i * BYTES);
+            }
+        }
+
+        template<std::size_t BYTES, std::size_t NEW_BYTES, bool BIG_ENDIAN> INVADER_SOUND_PCM_KERNEL void int_to_int_kernel(const std::byte *pcm, std::byte *output, std::size_t sample_count, std::size_t bits_per_sample, std::size_t new_bits_per_sample) noexcept {
+            if(new_bits_per_sample >= bits_per_sample) {
+                unsigned int shift = new_bits_per_sample - bits_per_sample;
+                for(std::size_t i = 0; i < sample_count; i++) {
+                    auto sample = load_sample<BYTES>(pcm + i * BYTES);
+                    store_sample<NEW_BYTES, BIG_ENDIAN>(static_cast<std::int32_t>(static_cast<std::uint32_t>(sample) << shift), output + i * NEW_BYTES);
+                }
+            }
+            else {
+                // Divide, rounding toward zero
+                unsigned int shift = bits_per_sample - new_bits_per_sample;
+                std::int32_t round = (static_cast<std::int32_t>(1) << shift) - 1;
+                for(std::size_t i = 0; i < sample_count; i++) {
+                    auto sample = load_sample<BYTES>(pcm + i * BYTES);
+                    store_sample<NEW_BYTES, BIG_ENDIAN>((sample + (sample < 0 ? round : 0)) >> shift, output + i * NEW_BYTES);
+                }
+            }
+        }
+
+        // Instantiate each kernel for the baseline instruction set and for AVX2 (which is the same as the baseline if we
+        // can't dispatch at runtime)
+        template<std::size_t BYTES> void int_to_float_generic(const std::byte *pcm, float *output, std::size_t sample_count, float divide_by, float divide_by_minus_one) noexcept {
+            int_to_float_kernel<BYTES>(pcm, output, sample_count, divide_by, divide_by_minus_one);
+        }
+        template<std::size_t BYTES> INVADER_SOUND_PCM_AVX2 void int_to_float_avx2(const std::byte *pcm, float *output, std::size_t sample_count, float divide_by, float divide_by_minus_one) noexcept {
+            int_to_float_kernel<BYTES>(pcm, output, sample_count, divide_by, divide_by_minus_one);
+        }
+
+        template<std::size_t BYTES> void float_to_int_generic(const float *pcm, std::byte *output, std::size_t sample_count, float multiply_by, float multiply_by_minus_one, std::int32_t max, std::int32_t min) noexcept {
+            float_to_int_kernel<BYTES>(pcm, output, sample_count, multiply_by, multiply_by_minus_one, max, min);
+        }
+        template<std::size_t BYTES> INVADER_SOUND_PCM_AVX2 void float_to_int_avx2(const float *pcm, std::byte *output, std::size_t sample_count, float multiply_by, float multiply_by_minus_one, std::int32_t max, std::int32_t min) noexcept {
+            float_to_int_kernel<BYTES>(pcm, output, sample_count, multiply_by, multiply_by_minus_one, max, min);
+        }
+
+        template<std::size_t BYTES, std::size_t NEW_BYTES, bool BIG_ENDIAN> void int_to_int_generic(const std::byte *pcm, std::byte *output, std::size_t sample_count, std::size_t bits_per_sample, std::size_t new_bits_per_sample) noexcept {
+            int_to_int_kernel<BYTES, NEW_BYTES, BIG_ENDIAN>(pcm, output, sample_count, bits_per_sample, new_bits_per_sample);
+        }
+        template<std::size_t BYTES, std::size_t NEW_BYTES, bool BIG_ENDIAN> INVADER_SOUND_PCM_AVX2 void int_to_int_avx2(const std::byte *pcm, std::byte *output, std::size_t sample_count, std::size_t bits_per_sample, std::size_t new_bits_per_sample) noexcept {
+            int_to_int_kernel<BYTES, NEW_BYTES, BIG_ENDIAN>(pcm, output, sample_count, bits_per_sample, new_bits_per_sample);
+        }
+
+        bool use_avx2() noexcept {
+            #ifdef INVADER_SOUND_PCM_AVX2_DISPATCH
+            static const bool has_avx2 = __builtin_cpu_supports("avx2");
+            return has_avx2;
+            #else
+            return false;
+            #endif
+        }
+
+        template<std::size_t BYTES> void int_to_float(const std::byte *pcm, float *output, std::size_t sample_count, float divide_by, float divide_by_minus_one) noexcept {
+            if(use_avx2()) {
+                int_to_float_avx2<BYTES>(pcm, output, sample_count, divide_by, divide_by_minus_one);
+            }
+            else {
+                int_to_float_generic<BYTES>(pcm, output, sample_count, divide_by, divide_by_minus_one);
+            }
+        }
+
+        template<std::size_t BYTES> void float_to_int(const float *pcm, std::byte *output, std::size_t sample_count, float multiply_by, float multiply_by_minus_one, std::int32_t max, std::int32_t min) noexcept {
+            if(use_avx2()) {
+                float_to_int_avx2<BYTES>(pcm, output, sample_count, multiply_by, multiply_by_minus_one, max, min);
+            }
+            else {
+                float_to_int_generic<BYTES>(pcm, output, sample_count, multiply_by, multiply_by_minus_one, max, min);
+            }
+        }
+
+        template<std::size_t BYTES, std::size_t NEW_BYTES, bool BIG_ENDIAN> void int_to_int(const std::byte *pcm, std::byte *output, std::size_t sample_count, std::size_t bits_per_sample, std::size_t new_bits_per_sample) noexcept {
+            if(use_avx2()) {
+                int_to_int_avx2<BYTES, NEW_BYTES, BIG_ENDIAN>(pcm, output, sample_count, bits_per_sample, new_bits_per_sample);
+            }
+            else {
+                int_to_int_generic<BYTES, NEW_BYTES, BIG_ENDIAN>(pcm, output, sample_count, bits_per_sample, new_bits_per_sample);
+            }
+        }
+
+        template<std::size_t BYTES, bool BIG_ENDIAN> void int_to_int_dispatch_output(const std::byte *pcm, std::byte *output, std::size_t sample_count, std::size_t bits_per_sample, std::size_t new_bits_per_sample) noexcept {
+            switch(new_bits_per_sample / 8) {
+                case 1:
+                    return int_to_int<BYTES, 1, BIG_ENDIAN>(pcm, output, sample_count, bits_per_sample, new_bits_per_sample);
+                case 2:
+                    return int_to_int<BYTES, 2, BIG_ENDIAN>(pcm, output, sample_count, bits_per_sample, new_bits_per_sample);
+                case 3:
+                    return int_to_int<BYTES, 3, BIG_ENDIAN>(pcm, output, sample_count, bits_per_sample, new_bits_per_sample);
+                case 4:
+                    return int_to_int<BYTES, 4, BIG_ENDIAN>(pcm, output, sample_count, bits_per_sample, new_bits_per_sample);
+                default:
+                    return;
+            }
+        }
+
+        template<bool BIG_ENDIAN> void int_to_int_dispatch(const std::byte *pcm, std::byte *output, std::size_t sample_count, std::size_t bits_per_sample, std::size_t new_bits_per_sample) noexcept {
+            switch(bits_per_sample / 8) {
+                case 1:
+                    return int_to_int_dispatch_output<1, BIG_ENDIAN>(pcm, output, sample_count, bits_per_sample, new_bits_per_sample);
+                case 2:
+                    return int_to_int_dispatch_output<2, BIG_ENDIAN>(pcm, output, sample_count, bits_per_sample, new_bits_per_sample);
+                case 3:
+                    return int_to_int_dispatch_output<3, BIG_ENDIAN>(pcm, output, sample_count, bits_per_sample, new_bits_per_sample);
+                case 4:
+                    return int_to_int_dispatch_output<4, BIG_ENDIAN>(pcm, output, sample_count, bits_per_sample, new_bits_per_sample);
+                default:
+                    return;
+            }
+        }
+    }
+
+    std::int32_t read_sample(const std::byte *pcm, std::size_t bits_per_sample) noexcept {
+        std::size_t bytes_per_sample = bits_per_sample / 8;
+        std::int32_t sample_value = 0;
+
+        // Get the sample value
+        for(std::size_t b = 0; b < bytes_per_sample; b++) {
+            std::int32_t significance = 8 * b;
+            if(b + 1 == bytes_per_sample) {
+                sample_value |= static_cast<std::int64_t>(static_cast<std::int8_t>(pcm[b])) << significance;
+            }
+            else {
+                sample_value |= static_cast<std::int64_t>(static_cast<std::uint8_t>(pcm[b])) << significance;
+            }
+        }
+
+        return sample_value;
+    }
+
+    void write_sample(std::int32_t sample, std::byte *pcm, std::size_t bits_per_sample) noexcept {
+        std::size_t bytes_per_sample = bits_per_sample / 8;
+        for(std::size_t b = 0; b < bytes_per_sample; b++) {
+            pcm[b] = static_cast<std::byte>((sample >> b * 8) & 0xFF);
+        }
+    }
+
+    std::vector<std::byte> convert_to_16_bit_pcm_big_endian(const std::vector<std::byte> &pcm, std::size_t bits_per_sample) {
+        std::size_t sample_count = pcm.size() / (bits_per_sample / 8);
+        std::vector<std::byte> output(sample_count * sizeof(std::uint16_t));
+        convert_to_16_bit_pcm_big_endian(pcm.data(), output.data(), sample_count, bits_per_sample);
+        return output;
+    }
+
+    void convert_to_16_bit_pcm_big_endian(const std::byte *pcm, std::byte *output, std::size_t sample_count, std::size_t bits_per_sample) noexcept {
+        // Convert to 16 bits per sample and swap endianness at the same time
+        int_to_int_dispatch<true>(pcm, output, sample_count, bits_per_sample, 16);
+    }
+
+    std::vector<std::byte> convert_int_to_int(const std::vector<std::byte> &pcm, std::size_t bits_per_sample, std::size_t new_bits_per_sample) {
+        std::size_t sample_count = pcm.size() / (bits_per_sample / 8);
+        std::vector<std::byte> samples(sample_count * (new_bits_per_sample / 8));
+        convert_int_to_int(pcm.data(), samples.data(), sample_count, bits_per_sample, new_bits_per_sample);
+        return samples;
+    }
+
+    void convert_int_to_int(const std::byte *pcm, std::byte *output, std::size_t sample_count, std::size_t bits_per_sample, std::size_t new_bits_per_sample) noexcept {
+        int_to_int_dispatch<false>(pcm, output, sample_count, bits_per_sample, new_bits_per_sample);
+    }
+
+    std::vector<float> convert_int_to_float(const std::vector<std::byte> &pcm, std::size_t bits_per_sample) {
+        std::vector<float> samples(pcm.size() / (bits_per_sample / 8));
+        convert_int_to_float(pcm.data(), samples.data(), samples.size(), bits_per_sample);
+        return samples;
+    }
+
+    void convert_int_to_float(const std::byte *pcm, float *output, std::size_t sample_count, std::size_t bits_per_sample) noexcept {
+        // Calculate what we divide by
+        float divide_by = static_cast<float>(static_cast<std::int64_t>(1) << bits_per_sample) / 2.0F;
+        float divide_by_minus_one = divide_by - 1;
+
+        switch(bits_per_sample / 8) {
+            case 1:
+                return int_to_float<1>(pcm, output, sample_count, divide_by, divide_by_minus_one);
+            case 2:
+                return int_to_float<2>(pcm, output, sample_count, divide_by, divide_by_minus_one);
+            case 3:
+                return int_to_float<3>(pcm, output, sample_count, divide_by, divide_by_minus_one);
+            case 4:
+                return int_to_float<4>(pcm, output, sample_count, divide_by, divide_by_minus_one);
+            default:
+                return;
+        }
+    }
+
+    std::vector<std::byte> convert_float_to_int(const std::vector<float> &pcm, std::size_t new_bits_per_sample) {
+        std::vector<std::byte> samples(pcm.size() * (new_bits_per_sample / 8));
+        convert_float_to_int(pcm.data(), samples.data(), pcm.size(), new_bits_per_sample);
+        return samples;
+    }
+
+    void convert_float_to_int(const float *pcm, std::byte *output, std::size_t sample_count, std::size_t new_bits_per_sample) noexcept {
+        // Calculate what we multiply by
+        std::int64_t multiply_by = (static_cast<std::int64_t>(1) << new_bits_per_sample) / 2;
+        std::int64_t multiply_by_minus_one = multiply_by - 1;
+        auto multiply_by_float = static_cast<float>(multiply_by);
+        auto multiply_by_minus_one_float = static_cast<float>(multiply_by_minus_one);
+        auto max = static_cast<std::int32_t>(multiply_by_minus_one);
+        auto min = static_cast<std::int32_t>(-multiply_by);
+
+        switch(new_bits_per_sample / 8) {
+            case 1:
+                return float_to_int<1>(pcm, output, sample_count, multiply_by_float, multiply_by_minus_one_float, max, min);
+            case 2:
+                return float_to_int<2>(pcm, output, sample_count, multiply_by_float, multiply_by_minus_one_float, max, min);
+            case 3:
+                return float_to_int<3>(pcm, output, sample_count, multiply_by_float, multiply_by_minus_one_float, max, min);
+            case 4:
+                return float_to_int<4>(pcm, output, sample_count, multiply_by_float, multiply_by_minus_one_float, max, min);
+            default:
+                return;
+        }
+    }
+}
@@ -3,8 +3,12 @@
 #include <invader/sound/sound_encoder.hpp>
 #include <invader/printf.hpp>
 #include <invader/error.hpp>
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <cstdint>
+#include <cstring>
+#include <thread>
 
 extern "C" {
 #include "adpcm_xq/adpcm-lib.h"
@@ -13,6 +17,12 @@ extern "C" {
 namespace Invader::SoundEncoder {
     static constexpr std::size_t code_chunks_count = 8;
 
+    // Number of blocks encoded by each job when encoding in parallel
+    static constexpr std::size_t blocks_per_run = 512;
+
+    // Number of blocks before a run that are encoded (and thrown out) to prime the encoder state for that run
+    static constexpr std::size_t warm_up_blocks = 4;
+
     static std::size_t calculate_samples_per_block() noexcept {
         return code_chunks_count * 8;
     }
@@ -21,8 +31,51 @@ namespace Invader::SoundEncoder {
         return calculate_samples_per_block() * channel_count;
     }
 
+    namespace {
+        // Wraps the adpcm_xq context so it always gets freed
+        struct ADPCMContext {
+            void *context;
+
+            ADPCMContext(std::size_t channel_count, int lookahead, int noise_shaping, std::int32_t *average_deltas) : context(adpcm_create_context(channel_count, lookahead, noise_shaping, average_deltas)) {}
+            ~ADPCMContext() {
+                adpcm_free_context(this->context);
+            }
+            ADPCMContext(const ADPCMContext &) = delete;
+            ADPCMContext &operator=(const ADPCMContext &) = delete;
+        };
+
+        // Step indices (one per channel) at a block boundary
+        struct BlockIndices {
+            std::int8_t channel[MAX_AUDIO_CHANNEL_COUNT] = {};
+
+            bool operator==(const BlockIndices &other) const noexcept {
+                return std::memcmp(this->channel, other.channel, sizeof(this->channel)) == 0;
+            }
+        };
+
+        struct BlockEncoder {
+            const std::int16_t *pcm_stream;
+            std::uint8_t *adpcm_stream;
+            std::size_t channel_count;
+            std::size_t samples_per_block;
+            std::size_t pcm_block_size;
+            std::size_t adpcm_block_size;
+
+            void encode_block(void *context, std::size_t block, std::uint8_t *output = nullptr) const noexcept {
+                std::size_t num_bytes_decoded = 0;
+                adpcm_encode_block(context, output == nullptr ? this->adpcm_stream + block * this->adpcm_block_size : output, &num_bytes_decoded, this->pcm_stream + block * this->pcm_block_size, this->samples_per_block);
+            }
+
+            BlockIndices get_indices(void *context) const noexcept {
+                BlockIndices indices;
+                adpcm_get_indices(context, indices.channel);
+                return indices;
+            }
+        };
+    }
+
     // From the MEK - I have no clue how to do this
-    std::vector<std::byte> encode_to_xbox_adpcm(const std::vector<std::byte> &pcm, std::size_t bits_per_sample, std::size_t channel_count) {
+    std::vector<std::byte> encode_to_xbox_adpcm(const std::vector<std::byte> &pcm, std::size_t bits_per_sample, std::size_t channel_count, XboxADPCMEncodeMode mode, std::size_t thread_count) {
         // Set some parameters
         std::unique_ptr<std::vector<std::byte>> pcm_16_bit_data_ptr;
         const std::int16_t *pcm_stream;
@@ -38,19 +91,22 @@ namespace Invader::SoundEncoder {
             pcm_stream = reinterpret_cast<const std::int16_t *>(pcm.data());
         }
 
-        // Set our output
-        std::vector<std::byte> adpcm_stream_buffer(sample_count * bytes_per_sample);
-        std::uint8_t *adpcm_stream = reinterpret_cast<std::uint8_t *>(adpcm_stream_buffer.data());
-
         std::size_t samples_per_block = code_chunks_count * 8;
         std::size_t block_count = sample_count / samples_per_block;
-        std::size_t num_bytes_decoded = 0;
 
         std::size_t pcm_block_size   = calculate_adpcm_pcm_block_size(channel_count);  // number of pcm sint16 per block
         std::size_t adpcm_block_size = (code_chunks_count * 4 + 4) * channel_count;  // number of adpcm bytes per block
 
+        // Nothing to encode (there isn't even enough to calculate the initial predictors)
+        if(block_count == 0) {
+            return {};
+        }
+
+        // Set our output
+        std::vector<std::byte> adpcm_stream_buffer(block_count * adpcm_block_size);
+        std::uint8_t *adpcm_stream = reinterpret_cast<std::uint8_t *>(adpcm_stream_buffer.data());
+
         std::int32_t average_deltas[2];
-        void *adpcm_context = NULL;
 
         // calculate initial adpcm predictors using decaying average
         for (std::size_t c = 0; c < channel_count; c++) {
@@ -61,17 +117,93 @@ namespace Invader::SoundEncoder {
             average_deltas[c] /= 8;
         }
 
-        // Encode!
-        adpcm_context = adpcm_create_context(channel_count, 3, 0, average_deltas);
-        for (std::size_t b = 0; b < block_count; b++) {
-            adpcm_encode_block(adpcm_context, adpcm_stream, &num_bytes_decoded, pcm_stream, samples_per_block);
-            adpcm_stream += adpcm_block_size;
-            pcm_stream += pcm_block_size;
+        // Quality mode looks further ahead and shapes the noise, both of which are a lot slower
+        bool quality = mode == XboxADPCMEncodeMode::XBOX_ADPCM_ENCODE_QUALITY;
+        int lookahead = quality ? 5 : 3;
+        int noise_shaping = quality ? NOISE_SHAPING_DYNAMIC : NOISE_SHAPING_OFF;
+
+        BlockEncoder encoder = { pcm_stream, adpcm_stream, channel_count, samples_per_block, pcm_block_size, adpcm_block_size };
+        std::size_t run_count = (block_count + blocks_per_run - 1) / blocks_per_run;
+        thread_count = std::min(std::max(thread_count, static_cast<std::size_t>(1)), run_count);
+
+        // If we're only using one thread, deterministic mode can just encode everything in one go
+        if(!quality && thread_count == 1) {
+            ADPCMContext context(channel_count, lookahead, noise_shaping, average_deltas);
+            for(std::size_t b = 0; b < block_count; b++) {
+                encoder.encode_block(context.context, b);
+            }
+            return adpcm_stream_buffer;
+        }
+
+        // Otherwise, encode each run of blocks separately. The step indices at the start of every block and at the end of
+        // every run are recorded so deterministic mode can check its guesses afterwards.
+        std::vector<BlockIndices> block_indices(block_count);
+        std::vector<BlockIndices> run_end_indices(run_count);
+
+        auto encode_run = [&encoder, &block_indices, &run_end_indices, &average_deltas, channel_count, block_count, lookahead, noise_shaping](std::size_t run) {
+            std::size_t first_block = run * blocks_per_run;
+            std::size_t end_block = std::min(first_block + blocks_per_run, block_count);
+            ADPCMContext context(channel_count, lookahead, noise_shaping, average_deltas);
+
+            // Prime the encoder by encoding the last few blocks of the previous run into a scratch buffer. Because the
+            // step index adapts quickly, this usually ends up exactly where encoding the whole stream would have.
+            std::uint8_t scratch[(code_chunks_count * 4 + 4) * MAX_AUDIO_CHANNEL_COUNT];
+            for(std::size_t b = first_block - std::min(first_block, warm_up_blocks); b < first_block; b++) {
+                encoder.encode_block(context.context, b, scratch);
+            }
+
+            for(std::size_t b = first_block; b < end_block; b++) {
+                block_indices[b] = encoder.get_indices(context.context);
+                encoder.encode_block(context.context, b);
+            }
+            run_end_indices[run] = encoder.get_indices(context.context);
+        };
+
+        std::atomic<std::size_t> next_run = 0;
+        auto encode_runs = [&next_run, &encode_run, run_count]() {
+            for(std::size_t run; (run = next_run++) < run_count;) {
+                encode_run(run);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count - 1);
+        for(std::size_t t = 1; t < thread_count; t++) {
+            threads.emplace_back(encode_runs);
+        }
+        encode_runs();
+        for(auto &t : threads) {
+            t.join();
+        }
+
+        // In deterministic mode, make sure each run started where the previous run actually ended. If not, re-encode
+        // from the correct state until it converges with what was already encoded (usually within a block or two), at
+        // which point the rest of the run is already identical to a sequential encode.
+        if(!quality) {
+            for(std::size_t run = 1; run < run_count; run++) {
+                std::size_t first_block = run * blocks_per_run;
+                std::size_t end_block = std::min(first_block + blocks_per_run, block_count);
+
+                ADPCMContext context(channel_count, lookahead, noise_shaping, average_deltas);
+                adpcm_set_indices(context.context, run_end_indices[run - 1].channel);
+
+                bool converged = false;
+                for(std::size_t b = first_block; b < end_block; b++) {
+                    auto actual = encoder.get_indices(context.context);
+                    if(actual == block_indices[b]) {
+                        converged = true;
+                        break;
+                    }
+                    block_indices[b] = actual;
+                    encoder.encode_block(context.context, b);
+                }
+
+                if(!converged) {
+                    run_end_indices[run] = encoder.get_indices(context.context);
+                }
+            }
         }
-        adpcm_free_context(adpcm_context);
 
-        // Resize to fit the buffer
-        adpcm_stream_buffer.resize(reinterpret_cast<std::byte *>(adpcm_stream) - adpcm_stream_buffer.data());
         return adpcm_stream_buffer;
     }
 }
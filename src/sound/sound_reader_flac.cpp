@@ -9,12 +9,18 @@
 namespace Invader::SoundReader {
     static FLAC__StreamDecoderWriteStatus write_flac_data(const FLAC__StreamDecoder *, const FLAC__Frame *frame, const FLAC__int32 * const buffer[], void *client_data) noexcept {
         auto &result = *reinterpret_cast<SoundReader::Sound *>(client_data);
-        auto bytes = frame->header.bits_per_sample / 8;
+        std::size_t bytes = frame->header.bits_per_sample / 8;
+        std::size_t channels = frame->header.channels;
+        std::size_t offset = result.pcm.size();
+
+        // Grow the buffer once per frame (the stream info usually lets us reserve everything up front, too)
+        result.pcm.resize(offset + frame->header.blocksize * channels * bytes);
+        auto *output = result.pcm.data() + offset;
         for(std::size_t i = 0; i < frame->header.blocksize; i++) {
-            for(std::size_t c = 0; c < frame->header.channels; c++) {
-                auto &s = buffer[c][i];
+            for(std::size_t c = 0; c < channels; c++) {
+                auto s = buffer[c][i];
                 for(std::size_t b = 0; b < bytes; b++) {
-                    result.pcm.emplace_back(static_cast<std::byte>((s >> b * 8) & 0xFF));
+                    *(output++) = static_cast<std::byte>((s >> b * 8) & 0xFF);
                 }
             }
         }
@@ -31,6 +37,9 @@ namespace Invader::SoundReader {
             result.input_bits_per_sample = stream_info.bits_per_sample;
             result.input_channel_count = stream_info.channels;
             result.input_sample_rate = stream_info.sample_rate;
+            if(stream_info.total_samples > 0) {
+                result.pcm.reserve(stream_info.total_samples * stream_info.channels * (stream_info.bits_per_sample / 8));
+            }
         }
     }
 
@@ -27,6 +27,8 @@ namespace Invader::SoundReader {
     Sound sound_from_ogg(const std::byte *data, std::size_t data_length) {
         Sound result = {};
         result.bits_per_sample = 24;
+
+        // Decoded samples are interleaved here and then converted to 24-bit straight into the output
         std::vector<float> pcm_float;
 
         // Let's begin.
@@ -133,6 +135,7 @@ namespace Invader::SoundReader {
                 }
 
                 std::size_t convsize = BUFFER_SIZE / vi.channels;
+                pcm_float.resize(convsize * vi.channels);
 
                 vorbis_dsp_state vd;
                 vorbis_block vb;
@@ -176,11 +179,16 @@ namespace Invader::SoundReader {
                                             // Loopdeedoo
                                             while((samples = vorbis_synthesis_pcmout(&vd, &pcm)) > 0) {
                                                 std::size_t bout = std::min(static_cast<std::size_t>(samples), convsize);
+                                                auto *interleaved = pcm_float.data();
                                                 for(std::size_t j = 0; j < bout; j++) {
                                                     for(i = 0; i < vi.channels; i++) {
-                                                        pcm_float.emplace_back(pcm[i][j]);
+                                                        *(interleaved++) = pcm[i][j];
                                                     }
                                                 }
+                                                std::size_t samples_out = bout * vi.channels;
+                                                std::size_t pcm_offset = result.pcm.size();
+                                                result.pcm.resize(pcm_offset + samples_out * 3);
+                                                SoundEncoder::convert_float_to_int(pcm_float.data(), result.pcm.data() + pcm_offset, samples_out, 24);
                                                 vorbis_synthesis_read(&vd, bout);
                                             }
                                         }
@@ -230,7 +238,6 @@ namespace Invader::SoundReader {
             vorbis_info_clear(&vi);
         }
 
-        result.pcm = SoundEncoder::convert_float_to_int(pcm_float, 24);
         result.input_bits_per_sample = 32;
         result.bits_per_sample = 24;
 
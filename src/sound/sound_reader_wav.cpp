@@ -4,6 +4,8 @@
 #include <invader/error.hpp>
 #include <invader/sound/sound_reader.hpp>
 #include <invader/sound/sound_encoder.hpp>
+#include <algorithm>
+#include <cstring>
 #include <memory>
 #include <invader/file/file.hpp>
 #include "wav.hpp"
@@ -109,10 +111,17 @@ namespace Invader::SoundReader {
             }
         }
         else if(fmt_subchunk.audio_format == 3) {
-            std::vector<float> pcm_float(data_size / sizeof(*pcm_float.data()));
-            std::memcpy(result.pcm.data(), data + offset, data_size);
+            // Convert a chunk at a time rather than copying the whole thing into a float buffer first
+            static constexpr std::size_t CHUNK_SAMPLES = 4096;
+            float pcm_float[CHUNK_SAMPLES];
+            std::size_t sample_count = data_size / sizeof(*pcm_float);
             result.bits_per_sample = 24;
-            result.pcm = SoundEncoder::convert_float_to_int(pcm_float, 24);
+            result.pcm = std::vector<std::byte>(sample_count * 3);
+            for(std::size_t s = 0; s < sample_count; s += CHUNK_SAMPLES) {
+                std::size_t chunk_samples = std::min(CHUNK_SAMPLES, sample_count - s);
+                std::memcpy(pcm_float, data + offset + s * sizeof(*pcm_float), chunk_samples * sizeof(*pcm_float));
+                SoundEncoder::convert_float_to_int(pcm_float, result.pcm.data() + s * 3, chunk_samples, 24);
+            }
         }
         else {
             std::terminate();
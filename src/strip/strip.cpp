@@ -10,6 +10,8 @@
 #include "../command_line_option.hpp"
 #include <invader/tag/parser/parser.hpp>
 #include <invader/file/file.hpp>
+#include <invader/parallel/parallel.hpp>
+#include <atomic>
 
 using namespace Invader;
 
@@ -57,7 +59,8 @@ int main(int argc, char * const *argv) {
         CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_TAGS),
         CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_BATCH),
         CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_BATCH_EXCLUDE),
-        CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_FS_PATH)
+        CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_FS_PATH),
+        CommandLineOption("threads", 'j', 1, "Set the number of threads to use for parallel stripping when using --batch. Default: CPU thread count", "<count>")
     };
 
     static constexpr char DESCRIPTION[] = "Strips extra hidden data from tags.";
@@ -68,6 +71,7 @@ int main(int argc, char * const *argv) {
         bool fs_path = false;
         std::vector<std::string> search;
         std::vector<std::string> search_exclude;
+        std::size_t max_threads = Parallel::default_thread_count();
     } strip_options;
 
     auto remaining_arguments = CommandLineOption::parse_arguments<StripOptions &>(argc, argv, options, USAGE, DESCRIPTION, 0, 1, strip_options, [](char opt, const std::vector<const char *> &arguments, auto &strip_options) {
@@ -87,6 +91,18 @@ int main(int argc, char * const *argv) {
             case 'P':
                 strip_options.fs_path = true;
                 break;
+            case 'j':
+                try {
+                    strip_options.max_threads = std::stoi(arguments[0]);
+                    if(strip_options.max_threads < 1) {
+                        throw std::exception();
+                    }
+                }
+                catch(std::exception &) {
+                    eprintf_error("Invalid number of threads %s\n", arguments[0]);
+                    std::exit(EXIT_FAILURE);
+                }
+                break;
         }
     });
     
@@ -111,21 +127,25 @@ int main(int argc, char * const *argv) {
         return EXIT_FAILURE;
     }
 
-    std::size_t success = 0;
-    std::size_t total = 0;
-    
     if(single_tag.has_value()) {
         return strip_tag(File::tag_path_to_file_path(*single_tag, strip_options.tags).string().c_str(), File::halo_path_to_preferred_path(single_tag->join())) ? EXIT_SUCCESS : EXIT_FAILURE;
     }
     
+    File::PathMatcher matcher(strip_options.search, strip_options.search_exclude);
+    std::vector<File::TagFile> all_tags;
     for(auto &i : File::load_virtual_tag_folder( { strip_options.tags } )) {
-        if(File::path_matches(i.tag_path.c_str(), strip_options.search, strip_options.search_exclude)) {
-            total++;
-            success += strip_tag(i.full_path.c_str(), i.tag_path) ? 1 : 0;
+        if(matcher.matches(i.tag_path.c_str())) {
+            all_tags.emplace_back(std::move(i));
         }
     }
 
-    oprintf("Stripped %zu out of %zu tag%s\n", success, total, total == 1 ? "" : "s");
+    std::atomic<std::size_t> success = 0;
+    Parallel(strip_options.max_threads).for_each(all_tags.size(), [&all_tags, &success](std::size_t i) {
+        success += strip_tag(all_tags[i].full_path.c_str(), all_tags[i].tag_path) ? 1 : 0;
+    });
+
+    std::size_t total = all_tags.size();
+    oprintf("Stripped %zu out of %zu tag%s\n", success.load(), total, total == 1 ? "" : "s");
 
     return EXIT_SUCCESS;
 }
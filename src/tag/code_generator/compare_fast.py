@@ -0,0 +1,100 @@
+# SPDX-License-Identifier: GPL-3.0-only
+
+def make_compare_fast(all_used_structs, struct_name, all_enums, all_bitfields, hpp, cpp_compare_fast):
+    hpp.write("        bool compare_fast(const ParserStruct &what, bool precision = false, bool ignore_volatile = false) const override;\n")
+    hpp.write("        std::uint64_t structural_hash(bool ignore_volatile = false) const override;\n")
+    hpp.write("        bool compare_fields(const {} &what, bool precision, bool ignore_volatile) const noexcept;\n".format(struct_name))
+    hpp.write("        std::uint64_t hash_fields(std::uint64_t hash, bool ignore_volatile) const noexcept;\n")
+
+    compare = []
+    hashing = []
+
+    # Go through the same values get_values_internal() lists so this matches ParserStruct::compare()
+    for struct in all_used_structs:
+        if "hidden" in struct and struct["hidden"]:
+            continue
+
+        if ("cache_only" in struct and struct["cache_only"]) or ("unused" in struct and struct["unused"]):
+            continue
+
+        type = struct["type"]
+        if type == "ScenarioScriptNodeValue" or type == "ScenarioStructureBSPArrayVertex" or type == "TagID":
+            continue
+
+        # Arrays are exposed as their first element only
+        member = struct["member_name"]
+        if "count" in struct and struct["count"] > 1:
+            member = "{}[0]".format(member)
+
+        if type == "TagReflexive":
+            compare.append("this->{}.size() != what.{}.size()".format(member, member))
+            compare.append("!std::equal(this->{}.begin(), this->{}.end(), what.{}.begin(), [precision, ignore_volatile](const auto &a, const auto &b) {{ return a.compare_fields(b, precision, ignore_volatile); }})".format(member, member, member))
+            hashing.append("hash = StructCompare::hash_word(hash, this->{}.size());".format(member))
+            hashing.append("for(auto &i : this->{}) {{".format(member))
+            hashing.append("    hash = i.hash_fields(hash, ignore_volatile);")
+            hashing.append("}")
+            continue
+
+        found = False
+        for b in all_bitfields:
+            if type == b["name"]:
+                found = True
+
+                # Same mask as the listed bits
+                mask = 2**len(b["fields"]) - 1
+                if "cache_only" in b:
+                    for a in b["cache_only"]:
+                        for n in range(0, len(b["fields"])):
+                            if b["fields"][n] == a:
+                                mask = mask & ~(1 << n)
+                                break
+                if "__excluded" in struct and struct["__excluded"] is not None:
+                    mask = (~struct["__excluded"]) & mask
+
+                if mask != 0:
+                    compare.append("!StructCompare::same_bitmask(this->{}, what.{}, 0x{:X})".format(member, member, mask))
+                    hashing.append("hash = StructCompare::hash_bitmask(hash, this->{}, 0x{:X});".format(member, mask))
+                break
+        if found:
+            continue
+
+        for e in all_enums:
+            if type == e["name"]:
+                found = True
+                count = len(e["options"])
+                compare.append("!StructCompare::same_enum(this->{}, what.{}, {})".format(member, member, count))
+                hashing.append("hash = StructCompare::hash_enum(hash, this->{}, {});".format(member, count))
+                break
+        if found:
+            continue
+
+        compare_line = "!StructCompare::same_value(this->{}, what.{}, precision)".format(member, member)
+        hash_line = "hash = StructCompare::hash_value(hash, this->{});".format(member)
+        if "volatile" in struct and struct["volatile"]:
+            compare_line = "(!ignore_volatile && {})".format(compare_line)
+            hash_line = "if(!ignore_volatile) {{ {} }}".format(hash_line)
+        compare.append(compare_line)
+        hashing.append(hash_line)
+
+    cpp_compare_fast.write("    bool {}::compare_fast(const ParserStruct &what, bool precision, bool ignore_volatile) const {{\n".format(struct_name))
+    cpp_compare_fast.write("        const auto *other = dynamic_cast<const {} *>(&what);\n".format(struct_name))
+    cpp_compare_fast.write("        return other != nullptr && this->compare_fields(*other, precision, ignore_volatile);\n")
+    cpp_compare_fast.write("    }\n")
+
+    cpp_compare_fast.write("    bool {}::compare_fields([[maybe_unused]] const {} &what, [[maybe_unused]] bool precision, [[maybe_unused]] bool ignore_volatile) const noexcept {{\n".format(struct_name, struct_name))
+    for c in compare:
+        cpp_compare_fast.write("        if({}) {{\n".format(c))
+        cpp_compare_fast.write("            return false;\n")
+        cpp_compare_fast.write("        }\n")
+    cpp_compare_fast.write("        return true;\n")
+    cpp_compare_fast.write("    }\n")
+
+    cpp_compare_fast.write("    std::uint64_t {}::structural_hash(bool ignore_volatile) const {{\n".format(struct_name))
+    cpp_compare_fast.write("        return this->hash_fields(StructCompare::HASH_SEED, ignore_volatile);\n")
+    cpp_compare_fast.write("    }\n")
+
+    cpp_compare_fast.write("    std::uint64_t {}::hash_fields(std::uint64_t hash, [[maybe_unused]] bool ignore_volatile) const noexcept {{\n".format(struct_name))
+    for h in hashing:
+        cpp_compare_fast.write("        {}\n".format(h))
+    cpp_compare_fast.write("        return hash;\n")
+    cpp_compare_fast.write("    }\n")
@@ -13,8 +13,10 @@ from check_invalid_ranges import make_check_invalid_ranges
 from check_invalid_indices import make_check_invalid_indices
 from check_normalize import make_normalize
 from scan_padding import make_scan_padding
+from compare_fast import make_compare_fast
+from view import make_view
 
-def make_parser(all_enums, all_bitfields, all_structs_arranged, all_structs, hpp, cpp_save_hek_data, cpp_read_hek_data, cpp_read_cache_file_data, cpp_cache_format_data, cpp_cache_deformat_data, cpp_refactor_reference, cpp_struct_value, cpp_check_invalid_ranges, cpp_check_invalid_indices, cpp_normalize, cpp_read_hek_file, cpp_scan_padding):
+def make_parser(all_enums, all_bitfields, all_structs_arranged, all_structs, hpp, cpp_save_hek_data, cpp_read_hek_data, cpp_read_cache_file_data, cpp_cache_format_data, cpp_cache_deformat_data, cpp_refactor_reference, cpp_struct_value, cpp_check_invalid_ranges, cpp_check_invalid_indices, cpp_normalize, cpp_read_hek_file, cpp_scan_padding, cpp_compare_fast, cpp_view):
     def write_for_all_cpps(what):
         cpp_save_hek_data.write(what)
         cpp_read_cache_file_data.write(what)
@@ -28,6 +30,8 @@ def make_parser(all_enums, all_bitfields, all_structs_arranged, all_structs, hpp
         cpp_normalize.write(what)
         cpp_read_hek_file.write(what)
         cpp_scan_padding.write(what)
+        cpp_compare_fast.write(what)
+        cpp_view.write(what)
 
     hpp.write("// SPDX-License-Identifier: GPL-3.0-only\n\n// This file was auto-generated.\n// If you want to edit this, edit the .json definitions and rerun the generator script, instead.\n\n")
     write_for_all_cpps("// SPDX-License-Identifier: GPL-3.0-only\n\n// This file was auto-generated.\n// If you want to edit this, edit the .json definitions and rerun the generator script, instead.\n\n")
@@ -36,8 +40,11 @@ def make_parser(all_enums, all_bitfields, all_structs_arranged, all_structs, hpp
     hpp.write("#define {}\n\n".format(header_name))
     hpp.write("#include <string>\n")
     hpp.write("#include <optional>\n")
+    hpp.write("#include <span>\n")
     hpp.write("#include \"../../map/map.hpp\"\n")
-    hpp.write("#include \"parser_struct.hpp\"\n\n")
+    hpp.write("#include \"parser_struct.hpp\"\n")
+    hpp.write("#include \"tag_view.hpp\"\n")
+    hpp.write("#include \"padding_scan.hpp\"\n\n")
     hpp.write("namespace Invader {\n")
     hpp.write("    class BuildWorkload;\n")
     hpp.write("}\n")
@@ -51,6 +58,9 @@ def make_parser(all_enums, all_bitfields, all_structs_arranged, all_structs, hpp
     cpp_cache_format_data.write("#include <invader/build/build_workload.hpp>\n")
     cpp_read_cache_file_data.write("#include <invader/file/file.hpp>\n")
     cpp_read_hek_data.write("#include <invader/file/file.hpp>\n")
+    cpp_compare_fast.write("#include <algorithm>\n")
+    cpp_compare_fast.write("#include <invader/tag/parser/struct_compare.hpp>\n")
+    cpp_view.write("#include <cstring>\n")
     cpp_save_hek_data.write("extern \"C\" std::uint32_t crc32(std::uint32_t crc, const void *buf, std::size_t size) noexcept;\n")
     write_for_all_cpps("namespace Invader::Parser {\n")
 
@@ -192,6 +202,8 @@ def make_parser(all_enums, all_bitfields, all_structs_arranged, all_structs, hpp
         make_check_invalid_ranges(all_used_structs, struct_name, hpp, cpp_check_invalid_ranges)
         make_check_invalid_indices(all_used_structs, struct_name, hpp, cpp_check_invalid_indices, all_structs_arranged)
         make_normalize(all_used_structs, struct_name, hpp, cpp_normalize, normalize)
+        make_compare_fast(all_used_structs, struct_name, all_enums, all_bitfields, hpp, cpp_compare_fast)
+        make_view(all_used_structs, struct_name, hpp, cpp_view)
 
         hpp.write("        ~{}() override = default;\n".format(struct_name))
 
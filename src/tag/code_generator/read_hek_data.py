@@ -53,7 +53,7 @@ def make_parse_hek_tag_data(postprocess_hek_data, all_bitfields, struct_name, al
                 cpp_read_hek_data.write("                throw InvalidTagDataException();\n")
                 cpp_read_hek_data.write("            }\n")
                 if not unread:
-                    cpp_read_hek_data.write("            r.{}.path = Invader::File::remove_duplicate_slashes(std::string(reinterpret_cast<const char *>(data)));\n".format(name))
+                    cpp_read_hek_data.write("            r.{}.path = Invader::File::remove_duplicate_slashes(h_{}_char, h_{}_expected_length);\n".format(name, name, name))
                 cpp_read_hek_data.write("            data_size -= h_{}_expected_length + 1;\n".format(name))
                 cpp_read_hek_data.write("            data_read += h_{}_expected_length + 1;\n".format(name))
                 cpp_read_hek_data.write("            data += h_{}_expected_length + 1;\n".format(name))
@@ -5,12 +5,12 @@ import sys
 def make_scan_padding(all_used_structs, struct_name, all_bitfields, hpp, cpp_scan_padding):
     hpp.write("\n        /**\n")
     hpp.write("         * Scan the padding for non-zero values.\n")
-    hpp.write("         * @param tag     Tag to read data from\n")
-    hpp.write("         * @param pointer Pointer to read from; if none is given, then the start of the tag will be used\n")
-    hpp.write("         * @return parsed tag data\n")
+    hpp.write("         * @param tag      Tag to read data from\n")
+    hpp.write("         * @param callback Function to call for each non-zero byte found\n")
+    hpp.write("         * @param pointer  Pointer to read from; if none is given, then the start of the tag will be used\n")
     hpp.write("         */\n")
-    hpp.write("        static void scan_padding(const Invader::Tag &tag, std::optional<HEK::Pointer> pointer = std::nullopt);\n")
-    cpp_scan_padding.write("    void {}::scan_padding([[maybe_unused]] const Invader::Tag &tag, [[maybe_unused]] std::optional<HEK::Pointer> pointer) {{\n".format(struct_name))
+    hpp.write("        static void scan_padding(const Invader::Tag &tag, const PaddingScanCallback &callback, std::optional<HEK::Pointer> pointer = std::nullopt);\n")
+    cpp_scan_padding.write("    void {}::scan_padding([[maybe_unused]] const Invader::Tag &tag, [[maybe_unused]] const PaddingScanCallback &callback, [[maybe_unused]] std::optional<HEK::Pointer> pointer) {{\n".format(struct_name))
     if len(all_used_structs) > 0:
         cpp_scan_padding.write("        const auto &l = pointer.has_value() ? tag.get_struct_at_pointer<HEK::{}>(*pointer) : tag.get_base_struct<HEK::{}>();\n".format(struct_name, struct_name))
         cpp_scan_padding.write("        auto l_copy = l;\n")
@@ -24,7 +24,7 @@ def make_scan_padding(all_used_structs, struct_name, all_bitfields, hpp, cpp_sca
                 else:
                     cpp_scan_padding.write("            auto l_{}_ptr = l.{}.pointer;\n".format(name, name))
                 cpp_scan_padding.write("            for(std::size_t i = 0; i < l_{}_count; i++) {{\n".format(name))
-                cpp_scan_padding.write("                {}::scan_padding(tag, l_{}_ptr + i * sizeof({}::struct_little));\n".format(struct["struct"], name, struct["struct"]))
+                cpp_scan_padding.write("                {}::scan_padding(tag, callback, l_{}_ptr + i * sizeof({}::struct_little));\n".format(struct["struct"], name, struct["struct"]))
                 cpp_scan_padding.write("            }\n")
                 cpp_scan_padding.write("        }\n")
                 
@@ -47,7 +47,7 @@ def make_scan_padding(all_used_structs, struct_name, all_bitfields, hpp, cpp_sca
         cpp_scan_padding.write("        for(std::size_t i = 0; i < sizeof(l_copy); i++) {\n")
         cpp_scan_padding.write("            auto v = reinterpret_cast<const std::uint8_t *>(&l_copy)[i];\n")
         cpp_scan_padding.write("            if(v != 0) {\n")
-        cpp_scan_padding.write("                oprintf(\"%s.%s: {} @ 0x%04zX - %02X\\n\", tag.get_path().c_str(), Invader::HEK::tag_fourcc_to_extension(tag.get_tag_fourcc()), i, v);\n".format(struct_name))
+        cpp_scan_padding.write("                callback(tag, PaddingFinding {{ \"{}\", i, v, pointer.value_or(tag.get_base_struct_pointer()) }});\n".format(struct_name))
         cpp_scan_padding.write("            }\n")
         cpp_scan_padding.write("        }\n")
     cpp_scan_padding.write("    }\n")
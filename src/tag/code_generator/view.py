@@ -0,0 +1,213 @@
+# SPDX-License-Identifier: GPL-3.0-only
+
+def make_view(all_used_structs, struct_name, hpp, cpp_view):
+    # Everything stored after the struct in a tag file, in the order it is stored (the same order parse_hek_tag_data reads it)
+    tail_members = []
+    for struct in all_used_structs:
+        if struct["type"] == "TagDependency" or struct["type"] == "TagReflexive" or struct["type"] == "TagDataOffset":
+            tail_members.append(struct)
+
+    hpp.write("\n        /**\n")
+    hpp.write("         * Read-only view of the struct in a HEK tag file\n")
+    hpp.write("         */\n")
+    hpp.write("        class View {\n")
+    hpp.write("        public:\n")
+    hpp.write("            using struct_big = HEK::{}<HEK::BigEndian>;\n".format(struct_name))
+    hpp.write("\n            /**\n")
+    hpp.write("             * Make a view of a struct that has already been validated\n")
+    hpp.write("             * @param base pointer to the struct\n")
+    hpp.write("             * @param tail pointer to the struct's data\n")
+    hpp.write("             */\n")
+    hpp.write("            View(const std::byte *base, const std::byte *tail) noexcept : base(base), tail(tail) {}\n")
+    hpp.write("\n            /**\n")
+    hpp.write("             * Check that the struct's data is in bounds and valid\n")
+    hpp.write("             * @param base      pointer to the struct\n")
+    hpp.write("             * @param tail      pointer to the struct's data\n")
+    hpp.write("             * @param tail_size bytes available at tail\n")
+    hpp.write("             * @return          number of bytes of data used by the struct\n")
+    hpp.write("             * @throws          if invalid\n")
+    hpp.write("             */\n")
+    hpp.write("            static std::size_t validate(const std::byte *base, const std::byte *tail, std::size_t tail_size);\n")
+    hpp.write("\n            /**\n")
+    hpp.write("             * Validate a HEK tag file and make a view of it\n")
+    hpp.write("             * @param data      tag file data; this must outlive the view\n")
+    hpp.write("             * @param data_size size of the tag file\n")
+    hpp.write("             * @return          view of the tag file\n")
+    hpp.write("             * @throws          if invalid\n")
+    hpp.write("             */\n")
+    hpp.write("            static View from_hek_tag_file(const std::byte *data, std::size_t data_size);\n")
+    hpp.write("\n            /**\n")
+    hpp.write("             * Get the struct's fields; these are read from big endian when accessed\n")
+    hpp.write("             * @return fields\n")
+    hpp.write("             */\n")
+    hpp.write("            const struct_big &fields() const noexcept {\n")
+    hpp.write("                return *reinterpret_cast<const struct_big *>(this->base);\n")
+    hpp.write("            }\n")
+    hpp.write("\n            /**\n")
+    hpp.write("             * Get the number of bytes of data used by the struct, including the data of any structs in reflexives\n")
+    hpp.write("             * @return size in bytes\n")
+    hpp.write("             */\n")
+    hpp.write("            std::size_t tail_size() const noexcept;\n")
+    hpp.write("\n            /**\n")
+    hpp.write("             * List every dependency in the struct, including ones in reflexives\n")
+    hpp.write("             * @param dependencies list to append the dependencies to\n")
+    hpp.write("             * @return             pointer to the end of the struct's data\n")
+    hpp.write("             */\n")
+    hpp.write("            const std::byte *list_dependencies(std::vector<DependencyView> &dependencies) const;\n")
+
+    for struct in tail_members:
+        if ("cache_only" in struct and struct["cache_only"]) or ("unused" in struct and struct["unused"]):
+            continue
+        name = struct["member_name"]
+        if struct["type"] == "TagDependency":
+            hpp.write("            DependencyView {}() const noexcept;\n".format(name))
+        elif struct["type"] == "TagReflexive":
+            hpp.write("            ReflexiveView<{}::View> {}() const noexcept;\n".format(struct["struct"], name))
+        else:
+            hpp.write("            std::span<const std::byte> {}() const noexcept;\n".format(name))
+
+    hpp.write("        private:\n")
+    hpp.write("            const std::byte *base;\n")
+    hpp.write("            const std::byte *tail;\n")
+    hpp.write("            const std::byte *tail_at(std::size_t index) const noexcept;\n")
+    hpp.write("        };\n\n")
+
+    def size_of_member(struct, where):
+        name = struct["member_name"]
+        if struct["type"] == "TagDependency":
+            return "(h.{}.path_size.read() > 0 ? h.{}.path_size.read() + 1 : 0)".format(name, name)
+        elif struct["type"] == "TagReflexive":
+            return "ReflexiveView<{}::View>({}, h.{}.count.read()).size_in_bytes()".format(struct["struct"], where, name)
+        else:
+            return "h.{}.size.read()".format(name)
+
+    # Find where each member's data is by skipping the data before it
+    cpp_view.write("    const std::byte *{}::View::tail_at([[maybe_unused]] std::size_t index) const noexcept {{\n".format(struct_name))
+    cpp_view.write("        const std::byte *t = this->tail;\n")
+    if len(tail_members) > 0:
+        cpp_view.write("        const auto &h = this->fields();\n")
+    for i in range(0, len(tail_members)):
+        cpp_view.write("        if(index == {}) {{\n".format(i))
+        cpp_view.write("            return t;\n")
+        cpp_view.write("        }\n")
+        cpp_view.write("        t += {};\n".format(size_of_member(tail_members[i], "t")))
+    cpp_view.write("        return t;\n")
+    cpp_view.write("    }\n")
+
+    cpp_view.write("    std::size_t {}::View::tail_size() const noexcept {{\n".format(struct_name))
+    cpp_view.write("        return this->tail_at({}) - this->tail;\n".format(len(tail_members)))
+    cpp_view.write("    }\n")
+
+    for i in range(0, len(tail_members)):
+        struct = tail_members[i]
+        if ("cache_only" in struct and struct["cache_only"]) or ("unused" in struct and struct["unused"]):
+            continue
+        name = struct["member_name"]
+        if struct["type"] == "TagDependency":
+            cpp_view.write("    DependencyView {}::View::{}() const noexcept {{\n".format(struct_name, name))
+            cpp_view.write("        const auto &h = this->fields();\n")
+            cpp_view.write("        return DependencyView {{ h.{}.tag_fourcc.read(), std::string_view(reinterpret_cast<const char *>(this->tail_at({})), h.{}.path_size.read()) }};\n".format(name, i, name))
+        elif struct["type"] == "TagReflexive":
+            cpp_view.write("    ReflexiveView<{}::View> {}::View::{}() const noexcept {{\n".format(struct["struct"], struct_name, name))
+            cpp_view.write("        return ReflexiveView<{}::View>(this->tail_at({}), this->fields().{}.count.read());\n".format(struct["struct"], i, name))
+        else:
+            cpp_view.write("    std::span<const std::byte> {}::View::{}() const noexcept {{\n".format(struct_name, name))
+            cpp_view.write("        return std::span<const std::byte>(this->tail_at({}), this->fields().{}.size.read());\n".format(i, name))
+        cpp_view.write("    }\n")
+
+    # Go through the data once, doing the same checks parse_hek_tag_data does
+    cpp_view.write("    std::size_t {}::View::validate({}const std::byte *base, {}const std::byte *tail, {}std::size_t tail_size) {{\n".format(struct_name, *(["[[maybe_unused]] "] * 3)))
+    cpp_view.write("        std::size_t used = 0;\n")
+    if len(tail_members) > 0:
+        cpp_view.write("        const auto &h = *reinterpret_cast<const struct_big *>(base);\n")
+    for struct in tail_members:
+        name = struct["member_name"]
+        if struct["type"] == "TagDependency":
+            cpp_view.write("        std::size_t h_{}_length = h.{}.path_size;\n".format(name, name))
+            cpp_view.write("        if(h_{}_length > 0) {{\n".format(name))
+            cpp_view.write("            if(h_{}_length + 1 > tail_size - used) {{\n".format(name))
+            cpp_view.write("                eprintf_error(\"Failed to read dependency {}::{}: %zu bytes needed > %zu bytes available\", h_{}_length, tail_size - used);\n".format(struct_name, name, name))
+            cpp_view.write("                throw OutOfBoundsException();\n")
+            cpp_view.write("            }\n")
+            cpp_view.write("            const char *h_{}_char = reinterpret_cast<const char *>(tail + used);\n".format(name))
+            cpp_view.write("            if(std::memchr(h_{}_char, 0, h_{}_length) != nullptr) {{\n".format(name, name))
+            cpp_view.write("                eprintf_error(\"Failed to read dependency {}::{}: size is smaller than expected (%zu expected > %zu actual)\", h_{}_length, std::strlen(h_{}_char));\n".format(struct_name, name, name, name))
+            cpp_view.write("                throw InvalidTagDataException();\n")
+            cpp_view.write("            }\n")
+            cpp_view.write("            if(h_{}_char[h_{}_length] != 0) {{\n".format(name, name))
+            cpp_view.write("                eprintf_error(\"Failed to read dependency {}::{}: missing null terminator\");\n".format(struct_name, name))
+            cpp_view.write("                throw InvalidTagDataException();\n")
+            cpp_view.write("            }\n")
+            cpp_view.write("            used += h_{}_length + 1;\n".format(name))
+            cpp_view.write("        }\n")
+        elif struct["type"] == "TagReflexive":
+            cpp_view.write("        std::size_t h_{}_count = h.{}.count;\n".format(name, name))
+            cpp_view.write("        if(h_{}_count > 0) {{\n".format(name))
+            cpp_view.write("            std::size_t total_size = sizeof({}::struct_big) * h_{}_count;\n".format(struct["struct"], name))
+            cpp_view.write("            if(total_size > tail_size - used) {\n")
+            cpp_view.write("                eprintf_error(\"Failed to read reflexive {}::{}: %zu bytes needed > %zu bytes available\", total_size, tail_size - used);\n".format(struct_name, name))
+            cpp_view.write("                throw OutOfBoundsException();\n")
+            cpp_view.write("            }\n")
+            cpp_view.write("            const std::byte *array = tail + used;\n")
+            cpp_view.write("            used += total_size;\n")
+            cpp_view.write("            for(std::size_t ref = 0; ref < h_{}_count; ref++) {{\n".format(name))
+            cpp_view.write("                used += {}::View::validate(array + ref * sizeof({}::struct_big), tail + used, tail_size - used);\n".format(struct["struct"], struct["struct"]))
+            cpp_view.write("            }\n")
+            cpp_view.write("        }\n")
+        else:
+            cpp_view.write("        std::size_t h_{}_size = h.{}.size;\n".format(name, name))
+            cpp_view.write("        if(h_{}_size > tail_size - used) {{\n".format(name))
+            cpp_view.write("            eprintf_error(\"Failed to read tag data block {}::{}: %zu bytes needed > %zu bytes available\", h_{}_size, tail_size - used);\n".format(struct_name, name, name))
+            cpp_view.write("            throw OutOfBoundsException();\n")
+            cpp_view.write("        }\n")
+            cpp_view.write("        used += h_{}_size;\n".format(name))
+    cpp_view.write("        return used;\n")
+    cpp_view.write("    }\n")
+
+    cpp_view.write("    {}::View {}::View::from_hek_tag_file(const std::byte *data, std::size_t data_size) {{\n".format(struct_name, struct_name))
+    cpp_view.write("        HEK::TagFileHeader::validate_header(reinterpret_cast<const HEK::TagFileHeader *>(data), data_size);\n")
+    cpp_view.write("        data += sizeof(HEK::TagFileHeader);\n")
+    cpp_view.write("        data_size -= sizeof(HEK::TagFileHeader);\n")
+    cpp_view.write("        if(sizeof(struct_big) > data_size) {\n")
+    cpp_view.write("            eprintf_error(\"Failed to read {} base struct: %zu bytes needed > %zu bytes available\", sizeof(struct_big), data_size);\n".format(struct_name))
+    cpp_view.write("            throw OutOfBoundsException();\n")
+    cpp_view.write("        }\n")
+    cpp_view.write("        const std::byte *tail = data + sizeof(struct_big);\n")
+    cpp_view.write("        std::size_t tail_size = data_size - sizeof(struct_big);\n")
+    cpp_view.write("        if(validate(data, tail, tail_size) != tail_size) {\n")
+    cpp_view.write("            eprintf_error(\"invalid tag file; tag data was left over\");\n")
+    cpp_view.write("            throw InvalidTagDataException();\n")
+    cpp_view.write("        }\n")
+    cpp_view.write("        return View(data, tail);\n")
+    cpp_view.write("    }\n")
+
+    # Go through the data in order so each struct's data is only walked once
+    cpp_view.write("    const std::byte *{}::View::list_dependencies([[maybe_unused]] std::vector<DependencyView> &dependencies) const {{\n".format(struct_name))
+    cpp_view.write("        const std::byte *t = this->tail;\n")
+    if len(tail_members) > 0:
+        cpp_view.write("        const auto &h = this->fields();\n")
+    for struct in tail_members:
+        unread = ("cache_only" in struct and struct["cache_only"]) or ("unused" in struct and struct["unused"])
+        name = struct["member_name"]
+        if struct["type"] == "TagDependency":
+            cpp_view.write("        if(std::size_t length = h.{}.path_size; length > 0) {{\n".format(name))
+            if not unread:
+                cpp_view.write("            dependencies.emplace_back(DependencyView {{ h.{}.tag_fourcc.read(), std::string_view(reinterpret_cast<const char *>(t), length) }});\n".format(name))
+            cpp_view.write("            t += length + 1;\n")
+            cpp_view.write("        }\n")
+        elif struct["type"] == "TagReflexive":
+            cpp_view.write("        {\n")
+            cpp_view.write("            std::size_t count = h.{}.count;\n".format(name))
+            cpp_view.write("            const std::byte *element = t;\n")
+            cpp_view.write("            t += count * sizeof({}::struct_big);\n".format(struct["struct"]))
+            cpp_view.write("            for(std::size_t i = 0; i < count; i++, element += sizeof({}::struct_big)) {{\n".format(struct["struct"]))
+            if unread:
+                cpp_view.write("                t += {}::View(element, t).tail_size();\n".format(struct["struct"]))
+            else:
+                cpp_view.write("                t = {}::View(element, t).list_dependencies(dependencies);\n".format(struct["struct"]))
+            cpp_view.write("            }\n")
+            cpp_view.write("        }\n")
+        else:
+            cpp_view.write("        t += h.{}.size.read();\n".format(name))
+    cpp_view.write("        return t;\n")
+    cpp_view.write("    }\n")
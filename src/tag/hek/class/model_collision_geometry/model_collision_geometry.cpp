@@ -1,10 +1,27 @@
 // SPDX-License-Identifier: GPL-3.0-only
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 #include <invader/tag/hek/class/model_collision_geometry.hpp>
 #include "intersection_check.hpp"
 
 namespace Invader::HEK {
+    void BSPData::prepare() {
+        this->prepared = PreparedBSP::prepare(*this);
+    }
+
     bool BSPData::check_for_intersection(const Point3D<LittleEndian> &point_a, const Point3D<LittleEndian> &point_b, Point3D<LittleEndian> *intersection_point, std::uint32_t *surface_index, std::uint32_t *leaf_index) const {
+        if(this->prepared) {
+            Point3D<NativeEndian> new_intersection_point;
+            if(this->prepared->check_for_intersection(point_a, point_b, &new_intersection_point, surface_index, leaf_index)) {
+                if(intersection_point) *intersection_point = new_intersection_point;
+                return true;
+            }
+            return false;
+        }
+
         // Set our variables up
         Point3D<LittleEndian> new_intersection_point;
         std::uint32_t new_surface_index, new_leaf_index;
@@ -32,6 +49,15 @@ namespace Invader::HEK {
     }
     
     bool BSPData::check_for_intersection(const Point3D<LittleEndian> &point, float range, Point3D<LittleEndian> *intersection_point, std::uint32_t *surface_index, std::uint32_t *leaf_index) const {
+        if(this->prepared) {
+            Point3D<NativeEndian> new_intersection_point;
+            if(this->prepared->check_for_intersection(point, range, &new_intersection_point, surface_index, leaf_index)) {
+                if(intersection_point) *intersection_point = new_intersection_point;
+                return true;
+            }
+            return false;
+        }
+
         // Plus or minus distance it
         auto position_above = point;
         position_above.z = position_above.z + range;
@@ -105,6 +131,10 @@ namespace Invader::HEK {
     }
     
     bool BSPData::check_if_point_inside_bsp(const Point3D<LittleEndian> &point, std::uint32_t *leaf_index) const {
+        if(this->prepared) {
+            return this->prepared->check_if_point_inside_bsp(point, leaf_index);
+        }
+
         auto result = HEK::leaf_for_point_of_bsp_tree(point, this->bsp3d_nodes, this->bsp3d_node_count, this->planes, this->plane_count);
         
         // If null, then we don't have anything
@@ -119,4 +149,58 @@ namespace Invader::HEK {
         
         return true;
     }
+
+    std::vector<BSPPointResult> find_points_in_bsps(const std::vector<BSPData> &bsps, const std::vector<BSPPointQuery> &queries) {
+        // Spawning threads isn't worth it for just a few points
+        static constexpr std::size_t PARALLEL_MINIMUM_QUERIES = 1024;
+        static constexpr std::size_t QUERIES_PER_CHUNK = 64;
+
+        std::size_t query_count = queries.size();
+        std::vector<BSPPointResult> results(query_count);
+
+        auto find_point = [&bsps, &queries, &results](std::size_t q) {
+            auto &query = queries[q];
+            auto &result = results[q];
+            auto &bsp = bsps[query.bsp_index];
+            if(query.raycast) {
+                result.found = bsp.check_for_intersection(query.point, query.range, nullptr, &result.surface_index, &result.leaf_index);
+            }
+            else {
+                result.found = bsp.check_if_point_inside_bsp(query.point, &result.leaf_index);
+            }
+        };
+
+        // Unprepared BSPs may throw, so only use threads if every BSP is prepared
+        std::size_t chunk_count = (query_count + QUERIES_PER_CHUNK - 1) / QUERIES_PER_CHUNK;
+        std::size_t thread_count = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1U), chunk_count);
+        bool all_prepared = std::all_of(queries.begin(), queries.end(), [&bsps](const BSPPointQuery &query) { return bsps[query.bsp_index].prepared != nullptr; });
+        if(query_count < PARALLEL_MINIMUM_QUERIES || thread_count < 2 || !all_prepared) {
+            for(std::size_t q = 0; q < query_count; q++) {
+                find_point(q);
+            }
+            return results;
+        }
+
+        std::atomic<std::size_t> next_chunk = 0;
+        auto find_points_thread = [&next_chunk, &find_point, chunk_count, query_count]() {
+            for(std::size_t c = next_chunk++; c < chunk_count; c = next_chunk++) {
+                std::size_t end = std::min(query_count, (c + 1) * QUERIES_PER_CHUNK);
+                for(std::size_t q = c * QUERIES_PER_CHUNK; q < end; q++) {
+                    find_point(q);
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count - 1);
+        for(std::size_t t = 1; t < thread_count; t++) {
+            threads.emplace_back(find_points_thread);
+        }
+        find_points_thread();
+        for(auto &t : threads) {
+            t.join();
+        }
+
+        return results;
+    }
 }
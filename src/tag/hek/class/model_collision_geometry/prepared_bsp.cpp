@@ -0,0 +1,421 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <array>
+#include <cmath>
+
+#include <invader/tag/hek/class/model_collision_geometry.hpp>
+
+namespace Invader::HEK {
+    static constexpr std::uint32_t UNVISITED = ~static_cast<std::uint32_t>(0);
+
+    static bool is_node(FlaggedInt<std::uint32_t> index) noexcept {
+        return !index.flag_value() && !index.is_null();
+    }
+
+    // Renumber reachable nodes depth-first so a node is usually followed by one of its children. Returns false if an index is out of bounds.
+    template <typename GetChildren> static bool order_nodes(FlaggedInt<std::uint32_t> root, std::uint32_t node_count, std::vector<std::uint32_t> &remap, std::vector<std::uint32_t> &order, const GetChildren &get_children) {
+        std::vector<std::uint32_t> stack;
+        if(is_node(root)) {
+            stack.emplace_back(root.int_value());
+        }
+        while(!stack.empty()) {
+            auto index = stack.back();
+            stack.pop_back();
+            if(index >= node_count) {
+                return false;
+            }
+            if(remap[index] != UNVISITED) {
+                continue;
+            }
+            remap[index] = static_cast<std::uint32_t>(order.size());
+            order.emplace_back(index);
+
+            // Push the first child last so it is placed right after this node
+            auto children = get_children(index);
+            for(std::size_t c = 2; c > 0; c--) {
+                if(is_node(children[c - 1])) {
+                    stack.emplace_back(children[c - 1].int_value());
+                }
+            }
+        }
+        return true;
+    }
+
+    static FlaggedInt<std::uint32_t> remap_child(FlaggedInt<std::uint32_t> child, const std::vector<std::uint32_t> &remap) noexcept {
+        if(is_node(child)) {
+            return FlaggedInt<std::uint32_t> { remap[child.int_value()] };
+        }
+        return child;
+    }
+
+    std::shared_ptr<const PreparedBSP> PreparedBSP::prepare(const BSPData &bsp) {
+        auto prepared = std::make_shared<PreparedBSP>();
+
+        // Order the BSP3D nodes, inlining their planes
+        std::vector<std::uint32_t> bsp3d_remap(bsp.bsp3d_node_count, UNVISITED);
+        std::vector<std::uint32_t> bsp3d_order;
+        if(bsp.bsp3d_node_count == 0 || !order_nodes(FlaggedInt<std::uint32_t> { 0 }, bsp.bsp3d_node_count, bsp3d_remap, bsp3d_order, [&bsp](std::uint32_t index) {
+            auto &node = bsp.bsp3d_nodes[index];
+            return std::array<FlaggedInt<std::uint32_t>, 2> { node.back_child.read(), node.front_child.read() };
+        })) {
+            return nullptr;
+        }
+
+        std::vector<bool> leaf_used(bsp.leaf_count, false);
+        prepared->bsp3d_nodes.reserve(bsp3d_order.size());
+        for(auto index : bsp3d_order) {
+            auto &node = bsp.bsp3d_nodes[index];
+            std::uint32_t plane = node.plane.read();
+            if(plane >= bsp.plane_count) {
+                return nullptr;
+            }
+
+            auto &prepared_node = prepared->bsp3d_nodes.emplace_back();
+            prepared_node.plane = bsp.planes[plane].plane;
+            prepared_node.children[0] = remap_child(node.back_child.read(), bsp3d_remap);
+            prepared_node.children[1] = remap_child(node.front_child.read(), bsp3d_remap);
+
+            // Note which leaves can be reached
+            for(auto &child : prepared_node.children) {
+                if(child.flag_value() && !child.is_null()) {
+                    if(child.int_value() >= bsp.leaf_count) {
+                        return nullptr;
+                    }
+                    leaf_used[child.int_value()] = true;
+                }
+            }
+        }
+
+        // Copy the leaves, checking the BSP2D reference ranges of the ones we can reach
+        std::vector<bool> reference_used(bsp.bsp2d_reference_count, false);
+        prepared->leaves.reserve(bsp.leaf_count);
+        for(std::uint32_t l = 0; l < bsp.leaf_count; l++) {
+            auto &leaf = bsp.leaves[l];
+            auto &prepared_leaf = prepared->leaves.emplace_back();
+            prepared_leaf.first_bsp2d_reference = leaf.first_bsp2d_reference.read();
+            prepared_leaf.bsp2d_reference_count = leaf.bsp2d_reference_count.read();
+
+            if(!leaf_used[l] || prepared_leaf.bsp2d_reference_count == 0) {
+                continue;
+            }
+
+            std::uint64_t end = static_cast<std::uint64_t>(prepared_leaf.first_bsp2d_reference) + prepared_leaf.bsp2d_reference_count;
+            if(end > bsp.bsp2d_reference_count) {
+                return nullptr;
+            }
+            for(std::uint32_t r = prepared_leaf.first_bsp2d_reference; r < end; r++) {
+                reference_used[r] = true;
+            }
+        }
+
+        // Order the BSP2D nodes of the references we can reach
+        std::vector<std::uint32_t> bsp2d_remap(bsp.bsp2d_node_count, UNVISITED);
+        std::vector<std::uint32_t> bsp2d_order;
+        for(std::uint32_t r = 0; r < bsp.bsp2d_reference_count; r++) {
+            if(reference_used[r] && !order_nodes(bsp.bsp2d_references[r].bsp2d_node.read(), bsp.bsp2d_node_count, bsp2d_remap, bsp2d_order, [&bsp](std::uint32_t index) {
+                auto &node = bsp.bsp2d_nodes[index];
+                return std::array<FlaggedInt<std::uint32_t>, 2> { node.left_child.read(), node.right_child.read() };
+            })) {
+                return nullptr;
+            }
+        }
+
+        prepared->bsp2d_nodes.reserve(bsp2d_order.size());
+        for(auto index : bsp2d_order) {
+            auto &node = bsp.bsp2d_nodes[index];
+            auto &prepared_node = prepared->bsp2d_nodes.emplace_back();
+            prepared_node.plane = node.plane;
+            prepared_node.children[0] = remap_child(node.left_child.read(), bsp2d_remap);
+            prepared_node.children[1] = remap_child(node.right_child.read(), bsp2d_remap);
+
+            for(auto &child : prepared_node.children) {
+                if(child.flag_value() && !child.is_null() && child.int_value() >= bsp.surface_count) {
+                    return nullptr;
+                }
+            }
+        }
+
+        // Lastly, copy the references with their planes and projections
+        prepared->bsp2d_references.reserve(bsp.bsp2d_reference_count);
+        for(std::uint32_t r = 0; r < bsp.bsp2d_reference_count; r++) {
+            auto &reference = bsp.bsp2d_references[r];
+            auto &prepared_reference = prepared->bsp2d_references.emplace_back();
+            if(!reference_used[r]) {
+                continue;
+            }
+
+            auto root = reference.bsp2d_node.read();
+            if(root.flag_value() && !root.is_null() && root.int_value() >= bsp.surface_count) {
+                return nullptr;
+            }
+            prepared_reference.bsp2d_node = remap_child(root, bsp2d_remap);
+
+            auto plane = reference.plane.read().int_value();
+            if(plane >= bsp.plane_count) {
+                return nullptr;
+            }
+            prepared_reference.plane = bsp.planes[plane].plane;
+
+            // This is from <https://web.archive.org/web/20160605164254/http://www.halomods.com/ips/index.php?/topic/357-collision-bsp-structure/>
+            float x = std::fabs(prepared_reference.plane.vector.i);
+            float y = std::fabs(prepared_reference.plane.vector.j);
+            float z = std::fabs(prepared_reference.plane.vector.k);
+            int axis = 0;
+            int sign = 0;
+
+            // Get the axis
+            float highest;
+            if (z < y || z < x) {
+                if (x > y) {
+                    axis = 0;
+                    highest = x;
+                }
+                else {
+                    axis = 1;
+                    highest = y;
+                }
+            }
+            else {
+                axis = 2;
+                highest = z;
+            }
+
+            if(highest > 0.0f) {
+                sign = 1;
+            }
+
+            // Projection plane
+            static const std::uint8_t PLANE_INDICES[2][3][2] = {
+                {
+                    {2, 1},
+                    {0, 2},
+                    {1, 0}
+                },
+                {
+                    {1, 2},
+                    {2, 0},
+                    {0, 1}
+                }
+            };
+
+            prepared_reference.projection[0] = PLANE_INDICES[sign][axis][0];
+            prepared_reference.projection[1] = PLANE_INDICES[sign][axis][1];
+        }
+
+        return prepared;
+    }
+
+    struct PreparedBSP::IntersectionQuery {
+        const PreparedBSP &bsp;
+        const Point3D<NativeEndian> &original_point_a;
+        const Point3D<NativeEndian> &original_point_b;
+
+        bool check_for_intersection_bsp2d_node(FlaggedInt<std::uint32_t> node_index, const Point2D<NativeEndian> &point, std::uint32_t &surface_index) const noexcept {
+            // Null has the flag set, too
+            while(!node_index.flag_value()) {
+                auto &node = this->bsp.bsp2d_nodes[node_index.int_value()];
+                node_index = node.children[point.distance_from_plane(node.plane) > 0.0F];
+            }
+
+            if(node_index.is_null()) {
+                return false;
+            }
+
+            surface_index = node_index.int_value();
+            return true;
+        }
+
+        bool check_for_intersection_recursion(
+            const Point3D<NativeEndian> &point_a,
+            const Point3D<NativeEndian> &point_b,
+            std::uint32_t &surface_index,
+            std::uint32_t &leaf_index,
+            Point3D<NativeEndian> &intersection_point,
+            FlaggedInt<std::uint32_t> node_index
+        ) const noexcept {
+            // Check if they're equal. If so, there's no intersection
+            if(point_a == point_b) {
+                return false;
+            }
+
+            while(!node_index.flag_value()) {
+                auto &node = this->bsp.bsp3d_nodes[node_index.int_value()];
+                auto node_index_a = node.children[point_a.distance_from_plane(node.plane) >= 0];
+                auto node_index_b = node.children[point_b.distance_from_plane(node.plane) >= 0];
+
+                // If they're the same, keep going
+                if(node_index_a == node_index_b) {
+                    node_index = node_index_a;
+                    continue;
+                }
+
+                // Otherwise, split the line at the plane and take whichever side is closest to point a
+                Point3D<NativeEndian> intersection_front;
+                if(!intersect_plane_with_points(node.plane, point_a, point_b, &intersection_front)) {
+                    return false;
+                }
+
+                Point3D<NativeEndian> point_a_intersection;
+                Point3D<NativeEndian> point_b_intersection;
+                std::uint32_t leaf_a_intersection, leaf_b_intersection, surface_a_intersection, surface_b_intersection;
+
+                bool point_a_intersected = this->check_for_intersection_recursion(point_a, intersection_front, surface_a_intersection, leaf_a_intersection, point_a_intersection, node_index_a);
+                bool point_b_intersected = this->check_for_intersection_recursion(intersection_front, point_b, surface_b_intersection, leaf_b_intersection, point_b_intersection, node_index_b);
+
+                if(!point_a_intersected && !point_b_intersected) {
+                    return false;
+                }
+
+                if(point_a_intersected && point_b_intersected) {
+                    float a_distance_squared = point_a_intersection.distance_from_point_squared(point_a);
+                    float b_distance_squared = point_b_intersection.distance_from_point_squared(point_a);
+
+                    if(a_distance_squared > b_distance_squared) {
+                        point_a_intersected = false;
+                    }
+                }
+
+                if(point_a_intersected) {
+                    intersection_point = point_a_intersection;
+                    leaf_index = leaf_a_intersection;
+                    surface_index = surface_a_intersection;
+                }
+                else {
+                    intersection_point = point_b_intersection;
+                    leaf_index = leaf_b_intersection;
+                    surface_index = surface_b_intersection;
+                }
+
+                return true;
+            }
+
+            // Fell out of the BSP; null
+            if(node_index.is_null()) {
+                return false;
+            }
+
+            // Go through each BSP2D reference of the leaf
+            std::uint32_t leaf_index_t = node_index.int_value();
+            auto &leaf = this->bsp.leaves[leaf_index_t];
+            auto *reference = this->bsp.bsp2d_references.data() + leaf.first_bsp2d_reference;
+            auto *reference_end = reference + leaf.bsp2d_reference_count;
+
+            bool ever_intersected = false;
+            float closest_intersection_distance = 0.0F;
+            for(; reference < reference_end; reference++) {
+                // Make sure point a is in front and point b is behind
+                Point3D<NativeEndian> intersection;
+                if(!intersect_plane_with_points(reference->plane, this->original_point_a, this->original_point_b, &intersection)) {
+                    continue;
+                }
+
+                // If it's further than what we got previously, disregard it
+                float intersection_distance = point_a.distance_from_point_squared(intersection);
+                if(ever_intersected && closest_intersection_distance < intersection_distance) {
+                    continue;
+                }
+
+                Point2D<NativeEndian> point;
+                point.x = (&intersection.x)[reference->projection[0]];
+                point.y = (&intersection.x)[reference->projection[1]];
+
+                if(this->check_for_intersection_bsp2d_node(reference->bsp2d_node, point, surface_index)) {
+                    ever_intersected = true;
+                    intersection_point = intersection;
+                    leaf_index = leaf_index_t;
+                    closest_intersection_distance = intersection_distance;
+                }
+            }
+
+            return ever_intersected;
+        }
+    };
+
+    bool PreparedBSP::check_for_intersection(const Point3D<NativeEndian> &point_a, const Point3D<NativeEndian> &point_b, Point3D<NativeEndian> *intersection_point, std::uint32_t *surface_index, std::uint32_t *leaf_index) const noexcept {
+        Point3D<NativeEndian> new_intersection_point;
+        std::uint32_t new_surface_index, new_leaf_index;
+
+        IntersectionQuery query = { *this, point_a, point_b };
+        if(query.check_for_intersection_recursion(point_a, point_b, new_surface_index, new_leaf_index, new_intersection_point, FlaggedInt<std::uint32_t> { 0 })) {
+            if(intersection_point) {
+                *intersection_point = new_intersection_point;
+            }
+            if(surface_index) {
+                *surface_index = new_surface_index;
+            }
+            if(leaf_index) {
+                *leaf_index = new_leaf_index;
+            }
+            return true;
+        }
+
+        return false;
+    }
+
+    bool PreparedBSP::check_for_intersection(const Point3D<NativeEndian> &point, float range, Point3D<NativeEndian> *intersection_point, std::uint32_t *surface_index, std::uint32_t *leaf_index) const noexcept {
+        auto position_above = point;
+        position_above.z = position_above.z + range;
+        auto position_below = point;
+        position_below.z = position_below.z - range;
+
+        // Cast downward, keeping whichever intersection is closest to our input point
+        bool found = false;
+        float closest_distance_squared = 0.0F;
+        Point3D<NativeEndian> closest_intersection_point;
+        std::uint32_t closest_surface_index = 0, closest_leaf_index = 0;
+
+        auto current_position = position_above;
+        while(current_position.z > position_below.z) {
+            std::uint32_t leaf_index_found;
+            std::uint32_t surface_index_found;
+            Point3D<NativeEndian> intersection_point_found;
+            if(!this->check_for_intersection(current_position, position_below, &intersection_point_found, &surface_index_found, &leaf_index_found)) {
+                break;
+            }
+
+            float new_distance = intersection_point_found.distance_from_point_squared(point);
+            if(!found || new_distance < closest_distance_squared) {
+                found = true;
+                closest_distance_squared = new_distance;
+                closest_intersection_point = intersection_point_found;
+                closest_surface_index = surface_index_found;
+                closest_leaf_index = leaf_index_found;
+            }
+
+            current_position.z = intersection_point_found.z - 0.01F; // subtract a lil' bit so we don't loop forever
+        }
+
+        if(found) {
+            if(intersection_point) {
+                *intersection_point = closest_intersection_point;
+            }
+            if(surface_index) {
+                *surface_index = closest_surface_index;
+            }
+            if(leaf_index) {
+                *leaf_index = closest_leaf_index;
+            }
+        }
+
+        return found;
+    }
+
+    bool PreparedBSP::check_if_point_inside_bsp(const Point3D<NativeEndian> &point, std::uint32_t *leaf_index) const noexcept {
+        FlaggedInt<std::uint32_t> node_index = { 0 };
+        while(!node_index.flag_value()) {
+            auto &node = this->bsp3d_nodes[node_index.int_value()];
+            node_index = node.children[point.distance_from_plane(node.plane) >= 0];
+        }
+
+        // If null, then we don't have anything
+        if(node_index.is_null()) {
+            return false;
+        }
+
+        if(leaf_index) {
+            *leaf_index = node_index.int_value();
+        }
+
+        return true;
+    }
+}
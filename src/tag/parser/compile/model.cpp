@@ -211,20 +211,37 @@ namespace Invader::Parser {
                 return true;
             }
 
-            part.uncompressed_vertices.reserve(part.compressed_vertices.size());
-            for(auto &v : part.compressed_vertices) {
-                auto before_data = v.generate_hek_tag_data();
-                auto after_data = HEK::decompress_model_vertex(*reinterpret_cast<ModelVertexCompressed::struct_big *>(before_data.data()));
+            // Decompress everything at once
+            std::size_t vertex_count = part.compressed_vertices.size();
+            std::vector<HEK::ModelVertexCompressed<HEK::NativeEndian>> before_data(vertex_count);
+            std::vector<HEK::ModelVertexUncompressed<HEK::NativeEndian>> after_data(vertex_count);
+            for(std::size_t i = 0; i < vertex_count; i++) {
+                auto &v = part.compressed_vertices[i];
+                auto &b = before_data[i];
+                b.position = v.position;
+                b.normal = v.normal;
+                b.binormal = v.binormal;
+                b.tangent = v.tangent;
+                b.texture_coordinate_u = v.texture_coordinate_u;
+                b.texture_coordinate_v = v.texture_coordinate_v;
+                b.node0_index = v.node0_index;
+                b.node1_index = v.node1_index;
+                b.node0_weight = v.node0_weight;
+            }
+            HEK::decompress_model_vertices(before_data.data(), after_data.data(), vertex_count);
+
+            part.uncompressed_vertices.reserve(vertex_count);
+            for(auto &a : after_data) {
                 auto &after_data_write = part.uncompressed_vertices.emplace_back();
-                after_data_write.binormal = after_data.binormal;
-                after_data_write.normal = after_data.normal;
-                after_data_write.position = after_data.position;
-                after_data_write.tangent = after_data.tangent;
-                after_data_write.node0_index = after_data.node0_index;
-                after_data_write.node0_weight = after_data.node0_weight;
-                after_data_write.node1_index = after_data.node1_index;
-                after_data_write.node1_weight = after_data.node1_weight;
-                after_data_write.texture_coords = after_data.texture_coords;
+                after_data_write.binormal = a.binormal;
+                after_data_write.normal = a.normal;
+                after_data_write.position = a.position;
+                after_data_write.tangent = a.tangent;
+                after_data_write.node0_index = a.node0_index;
+                after_data_write.node0_weight = a.node0_weight;
+                after_data_write.node1_index = a.node1_index;
+                after_data_write.node1_weight = a.node1_weight;
+                after_data_write.texture_coords = a.texture_coords;
             }
         }
         else if(part.compressed_vertices.size() == 0 && part.uncompressed_vertices.size() > 0) {
@@ -261,26 +278,37 @@ namespace Invader::Parser {
                 return true;
             }
 
-            part.compressed_vertices.reserve(part.uncompressed_vertices.size());
-
-            for(auto &v : part.uncompressed_vertices) {
-                // Resolve local nodes before throwing them into the compressor
-                auto before_data_copy = *reinterpret_cast<ModelVertexUncompressed::struct_big *>(v.generate_hek_tag_data().data());
-                before_data_copy.node0_index = resolve_local_node(before_data_copy.node0_index);
-                before_data_copy.node1_index = resolve_local_node(before_data_copy.node1_index);
+            // Resolve local nodes before throwing them into the compressor, then compress everything at once
+            std::size_t vertex_count = part.uncompressed_vertices.size();
+            std::vector<HEK::ModelVertexUncompressed<HEK::NativeEndian>> before_data(vertex_count);
+            std::vector<HEK::ModelVertexCompressed<HEK::NativeEndian>> after_data(vertex_count);
+            for(std::size_t i = 0; i < vertex_count; i++) {
+                auto &v = part.uncompressed_vertices[i];
+                auto &b = before_data[i];
+                b.position = v.position;
+                b.normal = v.normal;
+                b.binormal = v.binormal;
+                b.tangent = v.tangent;
+                b.texture_coords = v.texture_coords;
+                b.node0_index = resolve_local_node(v.node0_index);
+                b.node1_index = resolve_local_node(v.node1_index);
+                b.node0_weight = v.node0_weight;
+                b.node1_weight = v.node1_weight;
+            }
+            HEK::compress_model_vertices(before_data.data(), after_data.data(), vertex_count);
 
-                // Done
-                auto after_data = HEK::compress_model_vertex(before_data_copy);
+            part.compressed_vertices.reserve(vertex_count);
+            for(auto &a : after_data) {
                 auto &after_data_write = part.compressed_vertices.emplace_back();
-                after_data_write.binormal = after_data.binormal;
-                after_data_write.normal = after_data.normal;
-                after_data_write.position = after_data.position;
-                after_data_write.tangent = after_data.tangent;
-                after_data_write.node0_index = after_data.node0_index;
-                after_data_write.node0_weight = after_data.node0_weight;
-                after_data_write.node1_index = after_data.node1_index;
-                after_data_write.texture_coordinate_u = after_data.texture_coordinate_u;
-                after_data_write.texture_coordinate_v = after_data.texture_coordinate_v;
+                after_data_write.binormal = a.binormal;
+                after_data_write.normal = a.normal;
+                after_data_write.position = a.position;
+                after_data_write.tangent = a.tangent;
+                after_data_write.node0_index = a.node0_index;
+                after_data_write.node0_weight = a.node0_weight;
+                after_data_write.node1_index = a.node1_index;
+                after_data_write.texture_coordinate_u = a.texture_coordinate_u;
+                after_data_write.texture_coordinate_v = a.texture_coordinate_v;
             }
         }
         else if(part.compressed_vertices.size() != part.uncompressed_vertices.size()) {
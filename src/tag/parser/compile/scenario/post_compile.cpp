@@ -168,6 +168,9 @@ namespace Invader::Parser {
             if(bsp_data_s.render_leaf_count) {
                 bsp_data_s.render_leaves = reinterpret_cast<const ScenarioStructureBSPLeaf::struct_little *>(workload.structs[*bsp_tag_struct->resolve_pointer(&bsp_tag_data.leaves.pointer)].data.data());
             }
+
+            // Queries are repeated a lot, so build a native copy of the collision BSP for them
+            bsp_data_s.prepare();
         }
 
         return bsp_data;
@@ -183,16 +186,71 @@ namespace Invader::Parser {
             auto *encounter_array = reinterpret_cast<ScenarioEncounter::struct_little *>(encounter_struct.data.data());
             auto bsp_count = bsp_data.size();
 
+            // We also need to find firing position indices
+            struct FiringPositionIndex {
+                HEK::Index cluster_index = NULL_INDEX;
+                std::uint32_t surface_index = 0;
+                bool found = false;
+            };
+
+            // And we'll hold onto this, too
+            struct SquadPositionFound {
+                std::size_t squad = ~0;
+                std::size_t starting_position = ~0;
+                HEK::Index cluster_index = NULL_INDEX;
+                bool found = false;
+            };
+
+            // The best BSP found for each encounter
+            struct EncounterBSP {
+                std::size_t best_bsp;
+                std::size_t best_bsp_firing_position_hits = 0;
+                std::size_t best_bsp_squad_hits = 0;
+                std::size_t best_bsp_total_hits = 0;
+                std::size_t total_best_bsps = 0;
+                std::vector<FiringPositionIndex> best_firing_positions_indices;
+                std::vector<SquadPositionFound> best_squad_positions_found;
+                bool raycast;
+            };
+            std::vector<EncounterBSP> encounter_bsps(encounter_list_count);
+
+            // Look up every squad starting location and firing position in each BSP it could be in all at once
+            std::vector<HEK::BSPPointQuery> queries;
             for(std::size_t i = 0; i < encounter_list_count; i++) {
                 auto &encounter = scenario.encounters[i];
                 auto &encounter_data = encounter_array[i];
+                bool manual_bsp_index_specified = encounter.flags & HEK::ScenarioEncounterFlagsFlag::SCENARIO_ENCOUNTER_FLAGS_FLAG_MANUAL_BSP_INDEX_SPECIFIED;
+                std::size_t start_bsp = manual_bsp_index_specified ? encounter_data.manual_bsp_index.read() : 0;
+                bool raycast = encounter_bsps[i].raycast = !(encounter.flags & HEK::ScenarioEncounterFlagsFlag::SCENARIO_ENCOUNTER_FLAGS_FLAG__3D_FIRING_POSITIONS);
+
+                for(std::size_t b = start_bsp; b < bsp_count; b++) {
+                    for(auto &squad : encounter.squads) {
+                        for(auto &location : squad.starting_locations) {
+                            queries.emplace_back(HEK::BSPPointQuery { location.position, b, raycast });
+                        }
+                    }
+                    for(auto &f : encounter.firing_positions) {
+                        queries.emplace_back(HEK::BSPPointQuery { f.position, b, raycast });
+                    }
+                    if(manual_bsp_index_specified) {
+                        break;
+                    }
+                }
+            }
+            auto results = HEK::find_points_in_bsps(bsp_data, queries);
+            auto *result = results.data();
+
+            for(std::size_t i = 0; i < encounter_list_count; i++) {
+                auto &encounter = scenario.encounters[i];
+                auto &encounter_data = encounter_array[i];
+                auto &encounter_bsp = encounter_bsps[i];
 
                 // Set this to 1 because memes
                 encounter_data.one = 1;
 
                 // If we have a manual BSP index, set this stuff here
                 std::size_t start_bsp = 0;
-                std::size_t best_bsp;
+                std::size_t &best_bsp = encounter_bsp.best_bsp;
                 bool manual_bsp_index_specified = encounter.flags & HEK::ScenarioEncounterFlagsFlag::SCENARIO_ENCOUNTER_FLAGS_FLAG_MANUAL_BSP_INDEX_SPECIFIED;
                 if(manual_bsp_index_specified) {
                     encounter_data.precomputed_bsp_index = encounter_data.manual_bsp_index;
@@ -204,41 +262,24 @@ namespace Invader::Parser {
                 }
 
                 // Otherwise, we need to look for the best BSP
-                std::size_t best_bsp_firing_position_hits = 0;
-                std::size_t best_bsp_squad_hits = 0;
-                std::size_t best_bsp_total_hits = 0;
-                std::size_t total_best_bsps = 0;
+                std::size_t &best_bsp_firing_position_hits = encounter_bsp.best_bsp_firing_position_hits;
+                std::size_t &best_bsp_squad_hits = encounter_bsp.best_bsp_squad_hits;
+                std::size_t &best_bsp_total_hits = encounter_bsp.best_bsp_total_hits;
+                std::size_t &total_best_bsps = encounter_bsp.total_best_bsps;
 
-                // We also need to find firing position indices
-                struct FiringPositionIndex {
-                    HEK::Index cluster_index = NULL_INDEX;
-                    std::uint32_t surface_index = 0;
-                    bool found = false;
-                };
                 std::size_t firing_position_count = encounter.firing_positions.size();
-                std::vector<FiringPositionIndex> best_firing_positions_indices(firing_position_count);
-
-                // And we'll hold onto this, too
-                struct SquadPositionFound {
-                    std::size_t squad = ~0;
-                    std::size_t starting_position = ~0;
-                    HEK::Index cluster_index = NULL_INDEX;
-                    bool found = false;
-                };
+                auto &best_firing_positions_indices = encounter_bsp.best_firing_positions_indices;
+                best_firing_positions_indices.resize(firing_position_count);
 
                 // Get some default data
                 std::size_t squad_count = encounter.squads.size();
-                std::vector<SquadPositionFound> best_squad_positions_found;
+                auto &best_squad_positions_found = encounter_bsp.best_squad_positions_found;
                 for(std::size_t s = 0; s < squad_count; s++) {
                     auto position_count = encounter.squads[s].starting_locations.size();
                     for(std::size_t p = 0; p < position_count; p++) {
                         best_squad_positions_found.emplace_back(SquadPositionFound { s, p });
                     }
                 }
-                std::size_t squad_position_count = best_squad_positions_found.size();
-
-                // Also, are we raycasting?
-                bool raycast = !(encounter.flags & HEK::ScenarioEncounterFlagsFlag::SCENARIO_ENCOUNTER_FLAGS_FLAG__3D_FIRING_POSITIONS);
 
                 // Go through each BSP
                 std::vector<FiringPositionIndex> firing_positions_indices = best_firing_positions_indices;
@@ -251,33 +292,17 @@ namespace Invader::Parser {
                     // Go through each squad; add 1 to hits for every squad we find in the BSP
                     std::size_t squad_hits = 0;
                     for(std::size_t s = 0; s < squad_count; s++) {
-                        auto &squad = encounter.squads[s];
-                        std::size_t location_count = squad.starting_locations.size();
+                        std::size_t location_count = encounter.squads[s].starting_locations.size();
 
                         for(std::size_t l = 0; l < location_count; l++) {
-                            auto &location = squad.starting_locations[l];
-
-                            // If raycasting check for a surface that is 0.5 world units above/below it
-                            bool found;
-                            std::optional<std::uint32_t> leaf_index;
-
-                            if(raycast) {
-                                std::uint32_t leaf;
-                                if((found = bsp.check_for_intersection(location.position, 0.5F, nullptr, nullptr, &leaf))) {
-                                    leaf_index = leaf;
-                                }
-                            }
-                            else {
-                                std::uint32_t leaf;
-                                if((found = bsp.check_if_point_inside_bsp(location.position, &leaf))) {
-                                    leaf_index = leaf;
-                                }
-                            }
+                            // If raycasting, this checks for a surface that is 0.5 world units above/below it
+                            auto &location_result = *(result++);
+                            bool found = location_result.found;
 
                             // Set the cluster index
                             HEK::Index cluster_index;
-                            if(leaf_index.has_value()) {
-                                cluster_index = bsp.render_leaves[*leaf_index].cluster;
+                            if(found) {
+                                cluster_index = bsp.render_leaves[location_result.leaf_index].cluster;
                             }
                             else {
                                 cluster_index = NULL_INDEX;
@@ -290,26 +315,12 @@ namespace Invader::Parser {
 
                     // Go through each firing position
                     std::size_t firing_position_hits = 0;
-                    for(auto &f : encounter.firing_positions) {
-                        // Here are the indices we'll set
-                        bool in_bsp;
-                        std::uint32_t surface_index = 0;
-                        std::uint32_t leaf_index = 0;
-
-                        // Raycast stuff
-                        if(raycast) {
-                            in_bsp = bsp.check_for_intersection(f.position, 0.5F, nullptr, &surface_index, &leaf_index);
-                        }
-                        else {
-                            std::uint32_t leaf;
-                            if((in_bsp = bsp.check_if_point_inside_bsp(f.position, &leaf))) {
-                                leaf_index = leaf;
-                            }
-                        }
+                    for(std::size_t f = 0; f < firing_position_count; f++) {
+                        auto &firing_position_result = *(result++);
 
                         // If we're in the BSP, add it
-                        if(in_bsp) {
-                            firing_positions_indices.emplace_back(FiringPositionIndex {bsp.render_leaves[leaf_index].cluster, surface_index, true});
+                        if(firing_position_result.found) {
+                            firing_positions_indices.emplace_back(FiringPositionIndex {bsp.render_leaves[firing_position_result.leaf_index].cluster, firing_position_result.surface_index, true});
                             firing_position_hits++;
                         }
                         else {
@@ -345,8 +356,40 @@ namespace Invader::Parser {
 
                 // Set our best BSP
                 encounter_data.precomputed_bsp_index = static_cast<HEK::Index>(best_bsp);
+            }
+
+            // Now look up every squad move position in the BSP its encounter was placed in
+            queries.clear();
+            for(std::size_t i = 0; i < encounter_list_count; i++) {
+                auto &encounter_bsp = encounter_bsps[i];
+                if(encounter_bsp.total_best_bsps == 0 || encounter_bsp.best_squad_positions_found.empty()) {
+                    continue;
+                }
+                for(auto &squad : scenario.encounters[i].squads) {
+                    for(auto &move_position : squad.move_positions) {
+                        queries.emplace_back(HEK::BSPPointQuery { move_position.position, encounter_bsp.best_bsp, encounter_bsp.raycast });
+                    }
+                }
+            }
+            results = HEK::find_points_in_bsps(bsp_data, queries);
+            result = results.data();
 
+            for(std::size_t i = 0; i < encounter_list_count; i++) {
+                auto &encounter = scenario.encounters[i];
+                auto &encounter_data = encounter_array[i];
+                auto &encounter_bsp = encounter_bsps[i];
+                auto best_bsp = encounter_bsp.best_bsp;
+                auto best_bsp_total_hits = encounter_bsp.best_bsp_total_hits;
+                auto total_best_bsps = encounter_bsp.total_best_bsps;
+                auto &best_firing_positions_indices = encounter_bsp.best_firing_positions_indices;
+                auto &best_squad_positions_found = encounter_bsp.best_squad_positions_found;
+
+                std::size_t firing_position_count = best_firing_positions_indices.size();
+                std::size_t squad_position_count = best_squad_positions_found.size();
+                std::size_t squad_count = encounter.squads.size();
                 auto best_possible_hits = squad_position_count + firing_position_count;
+                auto best_bsp_firing_position_hits = encounter_bsp.best_bsp_firing_position_hits;
+                auto best_bsp_squad_hits = encounter_bsp.best_bsp_squad_hits;
 
                 // Ambiguous?
                 if(total_best_bsps > 1) {
@@ -458,26 +501,14 @@ namespace Invader::Parser {
                                     continue;
                                 }
 
-                                std::optional<std::uint32_t> leaf_index;
-                                std::uint32_t surface_index = 0;
-
-                                if(raycast) {
-                                    std::uint32_t leaf;
-                                    if(found_bsp->check_for_intersection(move_position_data[p].position, 0.5F, nullptr, &surface_index, &leaf)) {
-                                        leaf_index = leaf;
-                                    }
-                                }
-                                else {
-                                    std::uint32_t leaf;
-                                    if(found_bsp->check_if_point_inside_bsp(move_position_data[p].position, &leaf)) {
-                                        leaf_index = leaf;
-                                    }
-                                }
+                                // If raycasting, this checks for a surface that is 0.5 world units above/below it
+                                auto &move_position_result = *(result++);
+                                std::uint32_t surface_index = move_position_result.surface_index;
 
                                 // Set the cluster index
                                 HEK::Index cluster_index;
-                                if(leaf_index.has_value()) {
-                                    cluster_index = found_bsp->render_leaves[*leaf_index].cluster;
+                                if(move_position_result.found) {
+                                    cluster_index = found_bsp->render_leaves[move_position_result.leaf_index].cluster;
                                 }
                                 else {
                                     cluster_index = NULL_INDEX;
@@ -528,6 +559,24 @@ namespace Invader::Parser {
             auto &command_list_struct = workload.structs[*scenario_struct.resolve_pointer(&scenario_data.command_lists.pointer)];
             auto *command_list_array = reinterpret_cast<ScenarioCommandList::struct_little *>(command_list_struct.data.data());
             auto bsp_count = bsp_data.size();
+
+            // Look up every point in each BSP its command list could be in all at once
+            std::vector<HEK::BSPPointQuery> queries;
+            for(auto &command_list : scenario.command_lists) {
+                bool manual_bsp_index_specified = command_list.flags & HEK::ScenarioCommandListFlagsFlag::SCENARIO_COMMAND_LIST_FLAGS_FLAG_MANUAL_BSP_INDEX;
+                std::size_t start = manual_bsp_index_specified ? command_list.manual_bsp_index : 0;
+                for(std::size_t b = start; b < bsp_count; b++) {
+                    for(auto &p : command_list.points) {
+                        queries.emplace_back(HEK::BSPPointQuery { p.position, b, true });
+                    }
+                    if(manual_bsp_index_specified) {
+                        break;
+                    }
+                }
+            }
+            auto results = HEK::find_points_in_bsps(bsp_data, queries);
+            auto *result = results.data();
+
             for(std::size_t i = 0; i < command_list_count; i++) {
                 auto &command_list = scenario.command_lists[i];
                 auto &command_list_data = command_list_array[i];
@@ -559,18 +608,17 @@ namespace Invader::Parser {
 
                 // Go through each BSP (or one BSP for manual) to look for surface indices
                 for(std::size_t b = start; b < bsp_count; b++) {
-                    auto &bsp = bsp_data[b];
                     std::size_t hits = 0;
                     std::vector<std::optional<std::uint32_t>> surface_indices;
                     surface_indices.reserve(point_count);
 
                     // Basically, add 1 for every time we find it in here
                     // We need to check if there is a surface that is half a world unit or less below the position
-                    for(auto &p : command_list.points) {
-                        std::uint32_t surface_index = 0;
-                        if(bsp.check_for_intersection(p.position, 0.5F, nullptr, &surface_index, nullptr)) {
+                    for(std::size_t p = 0; p < point_count; p++) {
+                        auto &point_result = *(result++);
+                        if(point_result.found) {
                             hits++;
-                            surface_indices.emplace_back(surface_index); // found a surface
+                            surface_indices.emplace_back(point_result.surface_index); // found a surface
                         }
                         else {
                             surface_indices.emplace_back(std::nullopt); // no surface underneath
@@ -6,11 +6,18 @@
 #include <invader/build/build_workload.hpp>
 #include <invader/tag/parser/compile/bitmap.hpp>
 #include <invader/tag/parser/compile/shader.hpp>
+#include <algorithm>
+#include <atomic>
+#include <bit>
 #include <cassert>
 #include <map>
+#include <thread>
 #include <utility>
 
 namespace Invader::Parser {
+    // Below this many cluster surface indices, finding each cluster's predicted resources isn't worth spinning up threads
+    static constexpr std::size_t PARALLEL_PREDICTED_RESOURCES_MINIMUM_SURFACE_INDICES = 16384;
+
     void ScenarioStructureBSP::pre_compile(BuildWorkload &workload, std::size_t tag_index, std::size_t, std::size_t) {
         this->runtime_decals.clear(); // delete these in case this tag was extracted improperly
         
@@ -347,79 +354,152 @@ namespace Invader::Parser {
                 }
             }
             
-            auto cluster_struct_index = *tag_struct.resolve_pointer(&tag_data.clusters.pointer);
-            auto get_clusters_struct = [&workload, &cluster_struct_index]() -> Invader::BuildWorkload::BuildWorkloadStruct & {
-                return workload.structs[cluster_struct_index];
+            // Give each resource an index in sorted order, so the resources of a cluster can be gathered in a bitset and
+            // read back already sorted with no duplicates
+            std::vector<std::pair<std::size_t, std::size_t>> all_resources;
+            for(auto &p : predicted_resources_per_surface_index_array) {
+                all_resources.insert(all_resources.end(), p.second.begin(), p.second.end());
+            }
+            std::sort(all_resources.begin(), all_resources.end());
+            all_resources.erase(std::unique(all_resources.begin(), all_resources.end()), all_resources.end());
+            
+            // Each set of surfaces along with the indices of the resources it uses
+            struct SurfaceRange {
+                std::size_t first;
+                std::size_t end;
+                std::vector<std::size_t> resources;
             };
+            std::vector<SurfaceRange> surface_ranges;
+            surface_ranges.reserve(predicted_resources_per_surface_index_array.size());
+            for(auto &p : predicted_resources_per_surface_index_array) {
+                auto &range = surface_ranges.emplace_back();
+                range.first = p.first.first;
+                range.end = p.first.second;
+                for(auto &r : p.second) {
+                    range.resources.emplace_back(std::lower_bound(all_resources.begin(), all_resources.end(), r) - all_resources.begin());
+                }
+            }
             
-            auto *clusters = reinterpret_cast<ScenarioStructureBSPCluster::struct_little *>(get_clusters_struct().data.data());
-            for(std::size_t c = 0; c < cluster_count; c++) {
-                auto &cluster_struct = clusters[c];
-                auto &cluster_struct_parsed = this->clusters[c];
-                
-                std::list<std::pair<std::size_t, std::size_t>> things_to_import;
+            // Split surface indices at the start and end of every set of surfaces. Every surface index between two
+            // boundaries is in the same sets, so finding which sets a surface is in is just a binary search.
+            std::vector<std::size_t> boundaries;
+            for(auto &r : surface_ranges) {
+                boundaries.emplace_back(r.first);
+                boundaries.emplace_back(r.end);
+            }
+            std::sort(boundaries.begin(), boundaries.end());
+            boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+            
+            std::vector<std::vector<std::size_t>> ranges_per_segment(boundaries.size());
+            for(std::size_t r = 0; r < surface_ranges.size(); r++) {
+                auto segment_first = std::lower_bound(boundaries.begin(), boundaries.end(), surface_ranges[r].first) - boundaries.begin();
+                auto segment_end = std::lower_bound(boundaries.begin(), boundaries.end(), surface_ranges[r].end) - boundaries.begin();
+                for(auto segment = segment_first; segment < segment_end; segment++) {
+                    ranges_per_segment[segment].emplace_back(r);
+                }
+            }
+            
+            // Find the resources for each cluster. This only reads the tag, so clusters can be done in parallel.
+            std::vector<std::vector<std::size_t>> cluster_resources(cluster_count);
+            auto find_cluster_resources = [this, &all_resources, &surface_ranges, &boundaries, &ranges_per_segment, &cluster_resources](std::size_t c) {
+                std::vector<bool> range_added(surface_ranges.size());
+                std::vector<std::uint64_t> resource_bits((all_resources.size() + 63) / 64);
                 
-                // Add all the things
-                for(auto &sc : cluster_struct_parsed.subclusters) {
+                for(auto &sc : this->clusters[c].subclusters) {
                     for(auto &si : sc.surface_indices) {
                         auto index = static_cast<std::size_t>(si.index);
-                        for(auto &p : predicted_resources_per_surface_index_array) {
-                            auto &range = p.first;
-                            if(index >= range.first && index < range.second) {
-                                bool in_things_to_import = false;
-                                for(auto &t : things_to_import) {
-                                    if(t == range) {
-                                        in_things_to_import = true;
-                                        break;
-                                    }
-                                }
-                                if(!in_things_to_import) {
-                                    things_to_import.emplace_back(range);
+                        auto segment = std::upper_bound(boundaries.begin(), boundaries.end(), index) - boundaries.begin();
+                        if(segment == 0) {
+                            continue; // before every set
+                        }
+                        for(auto r : ranges_per_segment[segment - 1]) {
+                            if(!range_added[r]) {
+                                range_added[r] = true;
+                                for(auto resource : surface_ranges[r].resources) {
+                                    resource_bits[resource / 64] |= static_cast<std::uint64_t>(1) << (resource % 64);
                                 }
                             }
                         }
                     }
                 }
                 
-                // We have predicted resources to add maybe?
-                if(!things_to_import.empty()) {
-                    // Make a list of things
-                    std::list<std::pair<std::size_t, std::size_t>> all_predicted_resources;
-                    for(auto &i : things_to_import) {
-                        auto &a = predicted_resources_per_surface_index_array[i];
-                        all_predicted_resources.insert(all_predicted_resources.end(), a.begin(), a.end());
+                auto &resources = cluster_resources[c];
+                for(std::size_t w = 0; w < resource_bits.size(); w++) {
+                    for(auto bits = resource_bits[w]; bits != 0; bits &= bits - 1) {
+                        resources.emplace_back(w * 64 + std::countr_zero(bits));
                     }
-                    all_predicted_resources.sort(); // unique() requires sorting first
-                    all_predicted_resources.unique();
+                }
+            };
+            
+            std::size_t total_surface_indices = 0;
+            for(auto &cluster : this->clusters) {
+                for(auto &sc : cluster.subclusters) {
+                    total_surface_indices += sc.surface_indices.size();
+                }
+            }
+            
+            std::size_t thread_count = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1U), cluster_count);
+            if(total_surface_indices < PARALLEL_PREDICTED_RESOURCES_MINIMUM_SURFACE_INDICES || thread_count < 2) {
+                for(std::size_t c = 0; c < cluster_count; c++) {
+                    find_cluster_resources(c);
+                }
+            }
+            else {
+                std::atomic<std::size_t> next_cluster = 0;
+                auto find_cluster_resources_thread = [&next_cluster, &find_cluster_resources, cluster_count]() {
+                    for(std::size_t c = next_cluster++; c < cluster_count; c = next_cluster++) {
+                        find_cluster_resources(c);
+                    }
+                };
+                
+                std::vector<std::thread> threads;
+                threads.reserve(thread_count - 1);
+                for(std::size_t t = 1; t < thread_count; t++) {
+                    threads.emplace_back(find_cluster_resources_thread);
+                }
+                find_cluster_resources_thread();
+                for(auto &t : threads) {
+                    t.join();
+                }
+            }
+            
+            // Add them to the clusters in order
+            auto cluster_struct_index = *tag_struct.resolve_pointer(&tag_data.clusters.pointer);
+            auto get_clusters_struct = [&workload, &cluster_struct_index]() -> Invader::BuildWorkload::BuildWorkloadStruct & {
+                return workload.structs[cluster_struct_index];
+            };
+            
+            auto *clusters = reinterpret_cast<ScenarioStructureBSPCluster::struct_little *>(get_clusters_struct().data.data());
+            for(std::size_t c = 0; c < cluster_count; c++) {
+                auto &cluster_struct = clusters[c];
+                auto &all_predicted_resources = cluster_resources[c];
+                
+                // We have predicted resources to add maybe?
+                auto all_predicted_resource_count = all_predicted_resources.size();
+                if(all_predicted_resource_count > 0) {
+                    // Add a new pointer
+                    auto &new_pointer = get_clusters_struct().pointers.emplace_back();
+                    new_pointer.struct_index = workload.structs.size();
+                    new_pointer.offset = reinterpret_cast<std::byte *>(&cluster_struct.predicted_resources.pointer) - reinterpret_cast<std::byte *>(clusters);
                     
-                    auto all_predicted_resource_count = all_predicted_resources.size();
+                    cluster_struct.predicted_resources.count = all_predicted_resource_count;
                     
-                    // We do!
-                    if(all_predicted_resource_count > 0) {
-                        // Add a new pointer
-                        auto &new_pointer = get_clusters_struct().pointers.emplace_back();
-                        new_pointer.struct_index = workload.structs.size();
-                        new_pointer.offset = reinterpret_cast<std::byte *>(&cluster_struct.predicted_resources.pointer) - reinterpret_cast<std::byte *>(clusters);
-                        
-                        cluster_struct.predicted_resources.count = all_predicted_resource_count;
-                        
-                        auto &new_predicted_resources_struct = workload.structs.emplace_back();
-                        PredictedResource::struct_little *new_predicted_resources;
-                        new_predicted_resources_struct.data.resize(sizeof(*new_predicted_resources) * all_predicted_resource_count);
-                        new_predicted_resources = reinterpret_cast<decltype(new_predicted_resources)>(new_predicted_resources_struct.data.data());
+                    auto &new_predicted_resources_struct = workload.structs.emplace_back();
+                    PredictedResource::struct_little *new_predicted_resources;
+                    new_predicted_resources_struct.data.resize(sizeof(*new_predicted_resources) * all_predicted_resource_count);
+                    new_predicted_resources = reinterpret_cast<decltype(new_predicted_resources)>(new_predicted_resources_struct.data.data());
+                    
+                    for(std::size_t tp = 0; tp < all_predicted_resource_count; tp++) {
+                        auto &resource = all_resources[all_predicted_resources[tp]];
+                        auto &t = new_predicted_resources[tp];
+                        t.resource_index = resource.second;
+                        t.tag = HEK::TagID { static_cast<std::uint32_t>(resource.first) };
+                        t.type = HEK::PredictedResourceType::PREDICTED_RESOURCE_TYPE_BITMAP;
                         
-                        auto resource = all_predicted_resources.begin();
-                        for(std::size_t tp = 0; tp < all_predicted_resource_count; tp++, resource++) {
-                            auto &t = new_predicted_resources[tp];
-                            t.resource_index = resource->second;
-                            t.tag = HEK::TagID { static_cast<std::uint32_t>(resource->first) };
-                            t.type = HEK::PredictedResourceType::PREDICTED_RESOURCE_TYPE_BITMAP;
-                            
-                            auto &reference = new_predicted_resources_struct.dependencies.emplace_back();
-                            reference.offset = reinterpret_cast<std::byte *>(&t.tag) - reinterpret_cast<std::byte *>(new_predicted_resources);
-                            reference.tag_index = resource->first;
-                            reference.tag_id_only = true;
-                        }
+                        auto &reference = new_predicted_resources_struct.dependencies.emplace_back();
+                        reference.offset = reinterpret_cast<std::byte *>(&t.tag) - reinterpret_cast<std::byte *>(new_predicted_resources);
+                        reference.tag_index = resource.first;
+                        reference.tag_id_only = true;
                     }
                 }
             }
@@ -3,6 +3,7 @@
 #include <cassert>
 #include <invader/tag/parser/parser.hpp>
 #include <invader/tag/parser/parser_struct.hpp>
+#include <invader/tag/parser/struct_compare.hpp>
 #include <invader/tag/hek/header.hpp>
 #include <invader/file/file.hpp>
 #include "../../crc/crc32.h"
@@ -807,25 +808,14 @@ namespace Invader::Parser {
     }
 
     bool ParserStruct::compare(const ParserStruct *what, bool precision, bool ignore_volatile, std::list<std::string> *differences) const {
+        // Only walk the values if we need to say what is different
+        if(differences == nullptr) {
+            return this->compare_fast(*what, precision, ignore_volatile);
+        }
         return this->compare(what, precision, ignore_volatile, differences, 1);
     }
 
-    static constexpr bool too_different(double a, double b) noexcept {
-        double delta = FLOAT_EPSILON;
-
-        auto max_discrepency = a * delta;
-        if(max_discrepency < 0.0) {
-            max_discrepency *= -1.0;
-        }
-
-        auto difference = (a - b);
-        if(difference < 0.0) {
-            difference *= -1.0;
-        }
-
-        // (a-b) > delta && b is not in [a - dA, a + dA]
-        return difference > delta && ((b > a + max_discrepency) || (b < a - max_discrepency));
-    }
+    using StructCompare::too_different;
 
     static_assert(too_different(1, 1) == false);
     static_assert(too_different(1.000025, 1) == false);
@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <invader/tag/parser/parser.hpp>
+#include <invader/tag/parser/tag_view.hpp>
+#include <invader/tag/hek/header.hpp>
+#include <invader/printf.hpp>
+
+namespace Invader::Parser {
+    void list_hek_tag_file_dependencies(const std::byte *data, std::size_t data_size, std::vector<DependencyView> &dependencies) {
+        const auto *header = reinterpret_cast<const HEK::TagFileHeader *>(data);
+        HEK::TagFileHeader::validate_header(header, data_size);
+
+        #define DO_TAG_CLASS(class_struct, fourcc) case TagFourCC::fourcc: { \
+            Parser::class_struct::View::from_hek_tag_file(data, data_size).list_dependencies(dependencies); \
+            return; \
+        }
+
+        switch(header->tag_fourcc) {
+            DO_BASED_ON_TAG_CLASS
+
+            case Invader::HEK::TagFourCC::TAG_FOURCC_NONE:
+            case Invader::HEK::TagFourCC::TAG_FOURCC_NULL:
+            case Invader::HEK::TagFourCC::TAG_FOURCC_SPHEROID:
+                break;
+        }
+
+        eprintf_error("Unknown tag class %s", tag_fourcc_to_extension(header->tag_fourcc));
+        throw InvalidTagDataException();
+
+        #undef DO_TAG_CLASS
+    }
+}